@@ -90,7 +90,7 @@ public:
 
 	void Refresh()
 	{
-		D3DXMatrixLookAtLH(&m_oMatrix, &m_position, &m_targetPosition, &m_up);
+		SetCamera(m_position, m_up, m_targetPosition);
 	}
 
 	void Update(float a_timeDelta)
@@ -130,16 +130,9 @@ public:
 			D3DXVECTOR3 targetToCameraUnitVector;
 			D3DXVec3Normalize(&targetToCameraUnitVector, &targetToCamera);
 
-			D3DXMATRIX walkMatrix;
-			D3DXMatrixTranslation(&walkMatrix, -targetToCameraUnitVector.x, 0.0f, -targetToCameraUnitVector.z);
-			m_targetNode->MultMatrix(walkMatrix);
-			
-			D3DXMATRIX targetTransformationMatrix = m_targetNode->GetMatrix();
-			D3DXVECTOR3 scale, translation;
-			D3DXQUATERNION rotation;
-			D3DXMatrixDecompose(&scale, &rotation, &translation, &targetTransformationMatrix);
+			m_targetNode->Translate(D3DXVECTOR3(-targetToCameraUnitVector.x, 0.0f, -targetToCameraUnitVector.z));
 
-			m_targetPosition = translation;
+			m_targetPosition = m_targetNode->GetTranslation();
 			m_position = m_targetPosition + m_offset;
 
 			Refresh();
@@ -153,12 +146,7 @@ public:
 		if (m_elapsedTime >= 2.0f && m_seeking == false && m_initialized == false)
 		{
 			m_initialized = true;
-			D3DXMATRIX targetTransformationMatrix = m_targetNode->GetMatrix();
-			D3DXVECTOR3 scale, translation;
-			D3DXQUATERNION rotation;
-			D3DXMatrixDecompose(&scale, &rotation, &translation, &targetTransformationMatrix);
-
-			m_targetPosition = translation;
+			m_targetPosition = m_targetNode->GetTranslation();
 			//m_position = m_targetPosition + m_offset;
 
 			StartSeeking(m_targetPosition + m_offset);
@@ -180,27 +168,10 @@ public:
 
 	void Turn(float a_xDelta, float a_yDelta)
 	{
-		D3DXMATRIX targetTransformationMatrix = m_targetNode->GetMatrix();
-		D3DXVECTOR3 scale, translation;
-		D3DXQUATERNION rotation;
-		D3DXMatrixDecompose(&scale, &rotation, &translation, &targetTransformationMatrix);
-
-		D3DXMATRIX theTranslation;
-		D3DXMatrixIdentity(&theTranslation);
-
-		D3DXMATRIX originTranslation;
-		D3DXMatrixTranslation(&originTranslation, -translation.x, -translation.y, -translation.z);
-
-		D3DXMATRIX turnMatrix;
-		D3DXMatrixRotationY(&turnMatrix, a_xDelta);
-
-		D3DXMATRIX characterTranslation;
-		D3DXMatrixTranslation(&characterTranslation, translation.x, translation.y, translation.z);
-
-		D3DXMatrixMultiply(&theTranslation, &originTranslation, &turnMatrix);
-		D3DXMatrixMultiply(&theTranslation, &theTranslation, &characterTranslation);
-
-		m_targetNode->MultMatrix(theTranslation);
+		// rotate about the character's own position
+		D3DXQUATERNION turn;
+		D3DXQuaternionRotationYawPitchRoll(&turn, a_xDelta, 0.0f, 0.0f);
+		m_targetNode->Rotate(turn);
 	}
 
 	void Handle(float a_xDelta, float a_yDelta)
@@ -11,6 +11,8 @@
 #include "Mouse.h"
 #include "Camera.h"
 #include "Renderer.h"
+#include "ParticleFountain.h"
+#include "HeightfieldLoader.h"
 #include <sstream>
 #include <map>
 #include <vector>
@@ -40,6 +42,7 @@ Transform*		g_treeTransform = NULL;
 Transform*		g_monsterTransform = NULL;
 Transform*      g_gasStationTransform = NULL;
 Transform*		g_characterTransform = NULL;
+Transform*		g_fountainTransform = NULL;
 
 
 Geometry*		g_dwarfGeometry = NULL;
@@ -47,6 +50,11 @@ Geometry*		g_treeGeometry = NULL;
 Geometry*		g_monsterGeometry = NULL;
 Geometry*       g_gasStationGeometry = NULL;
 std::vector<Geometry*>* g_billboardGeometry = NULL;
+StaticBatch*	g_propBatch = NULL;
+SkinnedGeometry*	g_characterSkin = NULL;
+ParticleFountain*	g_fountain = NULL;
+Heightfield*	g_groundField = NULL;
+ParticleCollider*	g_groundCollider = NULL;
 
 Articulated*	g_characterNode = NULL;
 Articulated*	g_characterPelvis = NULL;
@@ -125,6 +133,7 @@ void CALLBACK OnFrameMove( IDirect3DDevice9* pd3dDevice, double a_time, float a_
 {
 	g_camera->Update(a_elapsedTime);
 	g_masterShader->SetCameraPosition(g_camera->GetPosition());
+	AnimSystem::SetViewPosition(g_camera->GetPosition());
 	g_renderer->Update(g_camera, a_elapsedTime);
 	
 	for (UINT i = 0; i < g_billboardTranslates->capacity(); i++)
@@ -327,6 +336,13 @@ void InitalizeGraph()
 	
 	g_gasStationTransform->SetSibling(g_monsterTransform);
 	g_monsterTransform->SetChild(g_monsterGeometry);
+
+	// the props never move so bake their world matrices and take them out of the update pass
+	g_dwarfTransform->Freeze(identityMatrix);
+	g_treeTransform->Freeze(identityMatrix);
+	g_gasStationTransform->Freeze(identityMatrix);
+	g_monsterTransform->Freeze(identityMatrix);
+
     for (UINT i = 0; i < 6; i++)
     {
         D3DXMatrixScaling(&scalingMatrix, 30.0f, 30.0f, 30.0f);
@@ -353,6 +369,33 @@ void InitalizeGraph()
         g_billboardGeometry->push_back(_billboardGeometry);
 	}
 
+	// merge the frozen tree, gas station and monster into material chunks (the dwarf keeps its own
+	// node as the master shader binds a normal map to it by description)
+	g_propBatch = new StaticBatch(device);
+	g_propBatch->Build(g_treeTransform, identityMatrix);
+	g_monsterTransform->InsertSibling(g_propBatch);
+
+	// a fountain beside the props, drawn by ParticleFountain.fx through the library's ParticleDecode.fxh
+	D3DXMatrixTranslation(&worldMatrix, -40.0f, 0.0f, -60.0f);
+
+	g_fountainTransform = new Transform(device, worldMatrix);
+	g_fountain = new ParticleFountain(device);
+	g_fountainTransform->SetChild(g_fountain);
+	g_monsterTransform->InsertSibling(g_fountainTransform);
+
+	// the demo draws no terrain, so height.png only stands in for the uneven ground under the props for
+	// the fountain's water to splash on. It is a 256 unit square centred on the origin whose bumps rise
+	// 4 units either side of the floor, kept on the CPU so it is loaded once rather than with the device
+	g_groundField = new Heightfield();
+
+	if (HeightfieldFromFile(g_groundField, device, L"height.png", Vector3(-128.0f, -4.0f, -128.0f), 0.25f, 8.0f))
+	{
+		g_groundCollider = new ParticleCollider();
+		g_groundCollider->AddHeightfield(g_groundField, ParticleCollider::RESPONSE_BOUNCE, 0.3f, 0.2f);
+		g_groundCollider->Build();
+		g_fountain->SetCollider(g_groundCollider);
+	}
+
     
     for (UINT i =0; i < g_billboardTransforms->capacity(); i++)
     {
@@ -480,6 +523,15 @@ void InitalizeGraph()
 	g_characterLLowerLeg->AddAnimation(L"Walk", LLLWalkAnim);
 	g_characterUpperBack->AddAnimation(L"Walk", UBWalkAnim);
 
+	// solve the whole character in one pass from the root link
+	g_characterNode->BuildSkeleton();
+
+	// draw the character's parts as one skinned mesh, placed beside the character transform where the
+	// world matrix is identity and after the links in the update pass
+	g_characterSkin = new SkinnedGeometry(device);
+	g_characterSkin->Build(g_characterNode);
+	g_characterTransform->InsertSibling(g_characterSkin);
+
 }
 
 void CleanUp()
@@ -499,6 +551,15 @@ void CleanUp()
 	SAFE_DELETE(g_dwarfGeometry);
 	SAFE_DELETE(g_monsterGeometry);
 	SAFE_DELETE(g_treeGeometry);
+
+	SAFE_DELETE(g_propBatch);
+	SAFE_DELETE(g_characterSkin);
+	SAFE_DELETE(g_fountainTransform);
+	SAFE_DELETE(g_fountain);
+	SAFE_DELETE(g_groundCollider);
+	SAFE_DELETE(g_groundField);
+
+	JobSystem::Shutdown();
 }
 
 //--------------------------------------------------------------------------------------
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "Shader.h"
+#include "SkinnedGeometry.h"
 #include <iostream>
 #include <map>
 #include <string>
@@ -50,6 +51,7 @@ protected:
     LPDIRECT3DVERTEXDECLARATION9	 m_pVertexDec;
     LPDIRECT3DTEXTURE9               m_billboardTexture;
     LPDIRECT3DVERTEXBUFFER9			 m_pVB;
+    bool                             m_bonePalette;   // geometry being rendered is skinned by the shader
 
 public:
 	MasterShader(LPDIRECT3DDEVICE9 a_device, LPCTSTR a_fileName, std::vector<std::string>* a_meshNames, std::vector<LPDIRECT3DTEXTURE9>* a_textureShadowMap, std::vector<LPDIRECT3DSURFACE9>* a_pSurfaceShadowDS, std::vector<LPDIRECT3DSURFACE9>* a_shadowMapSurface ) : Shader(a_device, a_fileName)
@@ -57,6 +59,7 @@ public:
 	    this->m_pSurfaceShadowDS = a_pSurfaceShadowDS;
 	    this->m_textureShadowMap = a_textureShadowMap;
 	    this->m_shadowMapSurface = a_shadowMapSurface;
+	    this->m_bonePalette = false;
 	    
         // definition of square vertices
         Vertex_PosTex vertSquare[] = 
@@ -260,7 +263,7 @@ public:
         V(m_pD3DDevice->SetRenderTarget(0, m_shadowMapSurface->at(index)))
         V(m_pD3DDevice->SetDepthStencilSurface((*m_pSurfaceShadowDS)[index])) 
 
-        V(m_pEffect->SetTechnique("MasterGenerate"))
+        V(m_pEffect->SetTechnique(m_bonePalette ? "MasterGenerateSkinned" : "MasterGenerate"))
         V( m_pEffect->CommitChanges());
         V(m_pEffect->Begin(&unPasses, NULL))
 
@@ -281,6 +284,13 @@ public:
 		{
 			return;
 		}
+
+		// hidden geometry (such as links merged into a skinned mesh) would draw nothing, so skip its
+		// shadow and lighting passes altogether
+		if (!a_geometry->IsVisible())
+		{
+			return;
+		}
         
 		HRESULT hr;
 		UINT unPasses;
@@ -289,7 +299,12 @@ public:
         LPDIRECT3DSURFACE9 pSurfaceOld;
         LPDIRECT3DSURFACE9 pSurfaceOldDS;
         
-		V(m_pD3DDevice->GetTransform(D3DTS_WORLD, &oMatWorld))
+		// world and inverse transpose come cached from the rendering transform
+		SGLib::Matrix oMatWorldSG, oMatWorldITSG;
+		GetWorldMatrices(&oMatWorldSG, &oMatWorldITSG);
+		oMatWorld = oMatWorldSG;
+		oMatWorldIT = oMatWorldITSG;
+
 		V(m_pD3DDevice->GetTransform(D3DTS_VIEW, &oMatView))
 		V(m_pD3DDevice->GetTransform(D3DTS_PROJECTION, &oMatProj))
         if (a_geometry->GetDescription() == (LPCTSTR)"Billboard")
@@ -311,8 +326,6 @@ public:
             D3DXMatrixMultiply(&oMatWorldViewProj, &oMatWorldViewProj, &oMatProj);
 
         }
-		D3DXMatrixInverse(&oMatWorldIT, NULL, &oMatWorld);
-		D3DXMatrixTranspose(&oMatWorldIT, &oMatWorldIT);
 		
 		
  		V(m_pEffect->SetMatrix("g_worldViewProjectionMatrix", &oMatWorldViewProj))
@@ -342,6 +355,14 @@ public:
         }
         //V(m_pEffect->SetTexture("g_normalTexture",(*m_normalTextures->find("dwarf")).second))
         
+        // skinned geometry drawn with its bone palette needs the skinned techniques
+        SGLib::SkinnedGeometry* skinned = dynamic_cast<SGLib::SkinnedGeometry*>(a_geometry);
+        m_bonePalette = skinned && skinned->UsesBonePalette();
+        if (m_bonePalette)
+        {
+            skinned->SetBoneMatrices(m_pEffect, "g_boneMatrices");
+        }
+
         V(m_pD3DDevice->GetRenderTarget(0, &pSurfaceOld))
         V(m_pD3DDevice->GetDepthStencilSurface(&pSurfaceOldDS))
         
@@ -350,7 +371,7 @@ public:
         V(m_pD3DDevice->SetRenderTarget(0, pSurfaceOld))
         V(m_pD3DDevice->SetDepthStencilSurface(pSurfaceOldDS))
         
-        V(m_pEffect->SetTechnique("Master")) 
+        V(m_pEffect->SetTechnique(m_bonePalette ? "MasterSkinned" : "Master")) 
         V(m_pEffect->SetTexture("g_shadowTexture", m_textureShadowMap->at(0)))
         
         if (a_geometry->GetDescription() == (LPCTSTR)"Billboard")
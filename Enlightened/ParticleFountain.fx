@@ -0,0 +1,65 @@
+//====================================================================
+// ParticleFountain.fx
+// Additive point sprites for the ParticleFountain node, reading its
+// vertices with DecodeParticle() from the library
+// Date 19/10/26
+//====================================================================
+
+#include "../SceneGraph/ParticleDecode.fxh"
+
+// used to transform particles from the system's space into homogenous clipping space
+uniform extern float4x4 g_matWorldViewProjection;
+
+// height of the viewport in pixels, turns the particles' sizes into point sizes
+uniform extern float g_viewportHeight;
+
+// vertex shader output structure
+struct VSOutput_Sprite
+{
+	float4 pos: POSITION0;
+	float4 colour: COLOR0;
+	float size: PSIZE;
+};
+
+VSOutput_Sprite VS_Fountain(ParticleInput a_Input)
+{
+	VSOutput_Sprite Output;
+
+	// the positions are already where the particles are, nothing to integrate
+	ParticleData particle = DecodeParticle(a_Input);
+
+	Output.pos = mul(float4(particle.position, 1.0f), g_matWorldViewProjection);
+
+	// the particle's size in world units, shrinking with distance
+	Output.size = particle.size * g_viewportHeight / Output.pos.w;
+
+	// fade out over the last third of the particle's life
+	float lifeUsed = saturate(particle.age / particle.lifeTime);
+	Output.colour = particle.colour;
+	Output.colour.a *= saturate((1.0f - lifeUsed) * 3.0f);
+
+	return Output;
+}
+
+// round soft sprites from the texture coordinates point sprites are given
+float4 PS_Fountain(float4 a_colour: COLOR0, float2 a_tex: TEXCOORD0) : COLOR
+{
+	float2 offset = a_tex * 2.0f - 1.0f;
+
+	return a_colour * saturate(1.0f - dot(offset, offset));
+}
+
+technique FountainTech
+{
+	pass P0
+	{
+		vertexShader = compile vs_2_0 VS_Fountain();
+		pixelShader = compile ps_2_0 PS_Fountain();
+
+		PointSpriteEnable = true;
+		AlphaBlendEnable = true;
+		SrcBlend = SrcAlpha;
+		DestBlend = One;
+		ZWriteEnable = false;
+	}
+}
@@ -0,0 +1,94 @@
+//====================================================================
+// ParticleFountain.h
+// A fountain of additive sprites showing how a ParticleSystem is
+// drawn with the library's ParticleDecode.fxh
+// Date 19/10/26
+//====================================================================
+#pragma once
+
+#include "ParticleSystem.h"
+
+using namespace SGLib;
+
+class ParticleFountain : public ParticleSystem
+{
+public:
+	// drawn with ParticleFountain.fx, which needs no texture
+	ParticleFountain(LPDIRECT3DDEVICE9 a_pD3DDevice) :
+		ParticleSystem(a_pD3DDevice, L"ParticleFountain.fx", "FountainTech", NULL, Vector3(0.0f, -40.0f, 0.0f), 8000, 1.0f / 2500.0f)
+	{
+		if (m_pEffect)
+			m_pEffect->SetTechnique(m_sTechName);
+
+		// about the largest sprite's radius, so sprites at the edge of the view aren't culled
+		SetBoundsMargin(1.5f);
+	}
+	~ParticleFountain(){}
+
+	// every stream of the new particles is written for the whole range at once
+	void InitParticles(UINT a_nFirst, UINT a_nCount)
+	{
+		FLOAT* pVelY = m_oParticles.GetStream(ParticleStore::VEL_Y) + a_nFirst;
+		FLOAT* pAge = m_oParticles.GetStream(ParticleStore::AGE) + a_nFirst;
+		FLOAT* pMass = m_oParticles.GetStream(ParticleStore::MASS) + a_nFirst;
+		UINT* pColours = m_oParticles.GetColours() + a_nFirst;
+
+		// a small nozzle at the origin spraying up and outwards
+		m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::POS_X) + a_nFirst, a_nCount, -0.5f, 0.5f);
+		m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::POS_Y) + a_nFirst, a_nCount, 0.0f, 0.5f);
+		m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::POS_Z) + a_nFirst, a_nCount, -0.5f, 0.5f);
+		m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::VEL_X) + a_nFirst, a_nCount, -6.0f, 6.0f);
+		m_oEmitter.Uniform(pVelY, a_nCount, 35.0f, 50.0f);
+		m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::VEL_Z) + a_nFirst, a_nCount, -6.0f, 6.0f);
+		m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::LIFE) + a_nFirst, a_nCount, 2.5f, 3.5f);
+		m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::SIZE) + a_nFirst, a_nCount, 0.6f, 1.4f);
+
+		for (UINT i = 0; i < a_nCount; ++i)
+		{
+			pAge[i] = 0.0f;
+			pMass[i] = 1.0f;
+
+			// faster particles are whiter
+			UINT nWhite = (UINT)((pVelY[i] - 35.0f) * 6.0f);
+			pColours[i] = D3DCOLOR_ARGB(200, 60 + nWhite, 120 + nWhite, 255);
+		}
+	}
+
+	void Render()
+	{
+		HRESULT hr;
+		UINT unStart, unPasses;
+
+		if (!m_pEffect || !SetVertexStream(&unStart))
+			return;
+
+		D3DXMATRIX oMatWorldViewProj, oMatWorld, oMatView, oMatProj;
+
+		V(m_pD3DDevice->GetTransform(D3DTS_WORLD, &oMatWorld))
+		V(m_pD3DDevice->GetTransform(D3DTS_VIEW, &oMatView))
+		V(m_pD3DDevice->GetTransform(D3DTS_PROJECTION, &oMatProj))
+
+		D3DXMatrixMultiply(&oMatWorldViewProj, &oMatWorld, &oMatView);
+		D3DXMatrixMultiply(&oMatWorldViewProj, &oMatWorldViewProj, &oMatProj);
+
+		D3DVIEWPORT9 oViewport;
+		V(m_pD3DDevice->GetViewport(&oViewport))
+
+		V(m_pEffect->SetMatrix("g_matWorldViewProjection", &oMatWorldViewProj))
+		V(m_pEffect->SetFloat("g_viewportHeight", (FLOAT)oViewport.Height))
+
+		// the box the vertices were encoded in
+		SetDecodeParameters();
+
+		V(m_pEffect->Begin(&unPasses, 0))
+
+		for (UINT i = 0; i < unPasses; ++i)
+		{
+			V(m_pEffect->BeginPass(i))
+			V(m_pD3DDevice->DrawPrimitive(D3DPT_POINTLIST, unStart, GetNumVertices()))
+			V(m_pEffect->EndPass())
+		}
+
+		V(m_pEffect->End())
+	}
+};
@@ -37,6 +37,8 @@ void Renderer::Render( SGLib::Node* a_pNodeBase )
     V(a_pNodeBase->GetDevice()->SetRenderTarget(0, pSurfaceOld))
     V(a_pNodeBase->GetDevice()->SetDepthStencilSurface(pSurfaceOldDS))
 
+    UploadTransient();
+
     V(a_pNodeBase->GetDevice()->BeginScene())
 
         // call general render function for base node
@@ -29,15 +29,18 @@ public:
 		UINT unPasses;
 		D3DXMATRIX oMatWorldViewProj, oMatWorld, oMatView, oMatProj, oMatWorldIT;
 
-		V(m_pD3DDevice->GetTransform(D3DTS_WORLD, &oMatWorld))
+		// world and inverse transpose come cached from the rendering transform
+		SGLib::Matrix oMatWorldSG, oMatWorldITSG;
+		GetWorldMatrices(&oMatWorldSG, &oMatWorldITSG);
+		oMatWorld = oMatWorldSG;
+		oMatWorldIT = oMatWorldITSG;
+
 		V(m_pD3DDevice->GetTransform(D3DTS_VIEW, &oMatView))
 		V(m_pD3DDevice->GetTransform(D3DTS_PROJECTION, &oMatProj))
 
 		D3DXMatrixMultiply(&oMatWorldViewProj, &oMatWorld, &oMatView);
 		D3DXMatrixMultiply(&oMatWorldViewProj, &oMatWorldViewProj, &oMatProj);
 
-		D3DXMatrixInverse(&oMatWorldIT, NULL, &oMatWorld);
-		D3DXMatrixTranspose(&oMatWorldIT, &oMatWorldIT);
 		
 
  		V(m_pEffect->SetMatrix("g_matWorldViewProjection", &oMatWorldViewProj))
@@ -267,6 +267,53 @@ float4 PS_Shadow(VSShadowOutput a_input, uniform int index) : COLOR
     //return a_Input.depth.x / 60.0f;
 }
 
+// bone palette skinning for SGLib::SkinnedGeometry, the palette holds world matrices so the node is
+// drawn with an identity world matrix and the skinned vertex goes through the usual shaders
+#define MAX_BONES 32
+
+uniform extern float4x3 g_boneMatrices[MAX_BONES];
+
+struct VSSkinInput
+{
+	float3 position : POSITION;
+	float3 normal : NORMAL;
+	float2 textureCoordinates : TEXCOORD0;
+	float4 boneIndices : BLENDINDICES;
+	float4 boneWeights : BLENDWEIGHT;
+};
+
+VSInput Skin(VSSkinInput a_input)
+{
+	VSInput output;
+	float3 position = float3(0.0f, 0.0f, 0.0f);
+	float3 normal = float3(0.0f, 0.0f, 0.0f);
+
+	for (int i = 0; i < 4; ++i)
+	{
+		float4x3 bone = g_boneMatrices[(int)a_input.boneIndices[i]];
+		position += mul(float4(a_input.position, 1.0f), bone) * a_input.boneWeights[i];
+		normal += mul(a_input.normal, (float3x3)bone) * a_input.boneWeights[i];
+	}
+
+	output.position = position;
+	output.textureCoordinates = a_input.textureCoordinates;
+	output.normal = normalize(normal);
+	output.tangent = float4(0.0f, 0.0f, 0.0f, 1.0f);
+	output.binormal = float3(0.0f, 0.0f, 0.0f);
+
+	return output;
+}
+
+VSOutput VS_LumosSkinned(VSSkinInput a_input, uniform int index)
+{
+	return VS_Lumos(Skin(a_input), index);
+}
+
+VSShadowOutput VS_ShadowSkinned(VSSkinInput a_input, uniform int index)
+{
+	return VS_Shadow(Skin(a_input), index);
+}
+
 technique Master
 {
 	pass P0
@@ -332,3 +379,47 @@ technique MasterGenerate
         pixelShader = compile ps_3_0 PS_Shadow(2);
     }
 }
+
+technique MasterSkinned
+{
+	pass P0
+	{
+		vertexShader = compile vs_3_0 VS_LumosSkinned(0);
+		pixelShader = compile ps_3_0 PS_Lumos(0);
+	}
+    pass P1
+    {
+        SRCBLEND = ONE;
+        DESTBLEND = ONE;
+        ALPHABLENDENABLE = true;
+        vertexShader = compile vs_3_0 VS_LumosSkinned(1);
+        pixelShader = compile ps_3_0 PS_Lumos(1);
+    }
+    pass P2
+    {
+        vertexShader = compile vs_3_0 VS_LumosSkinned(2);
+        pixelShader = compile ps_3_0 PS_Lumos(2);
+    }
+}
+
+technique MasterGenerateSkinned
+{
+    pass P0
+    {
+        colorwriteenable = red;    
+        vertexShader = compile vs_3_0 VS_ShadowSkinned(0);
+        pixelShader = compile ps_3_0 PS_Shadow(0);
+    }
+    pass P1
+    {
+        colorwriteenable = green;    
+        vertexShader = compile vs_3_0 VS_ShadowSkinned(1);
+        pixelShader = compile ps_3_0 PS_Shadow(1);
+    }
+    pass P2
+    {
+        colorwriteenable = blue;    
+        vertexShader = compile vs_3_0 VS_ShadowSkinned(2);
+        pixelShader = compile ps_3_0 PS_Shadow(2);
+    }
+}
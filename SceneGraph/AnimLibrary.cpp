@@ -0,0 +1,640 @@
+#include "AnimLibrary.h"
+#include <cfloat>
+
+using std::vector;
+using std::map;
+using std::multimap;
+
+namespace SGLib
+{
+	vector<CurveBlock>		AnimLibrary::s_vecBlocks;
+	vector<AnimLibrary::Clip>	AnimLibrary::s_vecClips;
+	multimap<UINT, UINT>	AnimLibrary::s_mapHashes;
+	map<AnimLibrary::String, UINT>	AnimLibrary::s_mapNames;
+	vector<LPCTSTR>			AnimLibrary::s_vecNames;
+	FLOAT					AnimLibrary::s_fMaxError = 0.005f;
+	UINT					AnimLibrary::s_nKeys = 0;
+	UINT					AnimLibrary::s_nSourceBytes = 0;
+
+	// attempts at fitting the keys more tightly before every key is kept, and how much tighter each one is
+	static const UINT MAX_FIT_ATTEMPTS = 6;
+	static const FLOAT FIT_TIGHTEN = 0.75f;
+
+	// widest gap a block may hold relative to its narrowest before it ends early
+	static const FLOAT MAX_GAP_RATIO = 16.0f;
+
+	/**
+	*	\brief	Clamps the angles of a track the way SGLib::Articulated clamps a sampled angle
+	*	\param	vector<TimeStep>& a_rvecKeys - keys to clamp
+	*	\param	FLOAT a_fMin - minimum angle
+	*	\param	FLOAT a_fMax - maximum angle
+	*/
+
+	static void ClampKeys(vector<TimeStep>& a_rvecKeys, FLOAT a_fMin, FLOAT a_fMax)
+	{
+		for (UINT i = 0; i < a_rvecKeys.size(); ++i)
+		{
+			if (a_rvecKeys[i].m_fAngle < a_fMin)
+				a_rvecKeys[i].m_fAngle = a_fMin;
+			else if (a_rvecKeys[i].m_fAngle > a_fMax)
+				a_rvecKeys[i].m_fAngle = a_fMax;
+		}
+	}
+
+	/**
+	*	\brief	Calculates the angle of one 16 bit quantization step of a track
+	*	\param	const vector<TimeStep>& a_rvecKeys - keys of the track
+	*	\return	FLOAT - step size, 0 if every angle is the same
+	*/
+
+	static FLOAT QuantizationStep(const vector<TimeStep>& a_rvecKeys)
+	{
+		if (a_rvecKeys.empty())
+			return 0.0f;
+
+		FLOAT fMin = a_rvecKeys[0].m_fAngle, fMax = fMin;
+
+		for (UINT i = 1; i < a_rvecKeys.size(); ++i)
+		{
+			if (a_rvecKeys[i].m_fAngle < fMin)
+				fMin = a_rvecKeys[i].m_fAngle;
+			else if (a_rvecKeys[i].m_fAngle > fMax)
+				fMax = a_rvecKeys[i].m_fAngle;
+		}
+
+		return (fMax - fMin) / 65535.0f;
+	}
+
+	/**
+	*	\brief	Compresses the keys of an animation and stores them as a clip
+	*	\param	const AnimContainer& a_rAnim - rotation and twist keys of the animation
+	*	\param	FLOAT a_fRotMin - minimum rotation angle of the joint the clip is for
+	*	\param	FLOAT a_fRotMax - maximum rotation angle of the joint the clip is for
+	*	\param	FLOAT a_fTwistMin - minimum twist angle of the joint the clip is for
+	*	\param	FLOAT a_fTwistMax - maximum twist angle of the joint the clip is for
+	*	\return	UINT - clip ID, the ID of an existing clip if one compressed to identical data
+	*/
+
+	UINT AnimLibrary::AddClip(const AnimContainer& a_rAnim, FLOAT a_fRotMin, FLOAT a_fRotMax, FLOAT a_fTwistMin, FLOAT a_fTwistMax)
+	{
+		// angles outside the limits are never seen so they don't need to be stored
+		vector<TimeStep> vecRot(a_rAnim.m_vecRot);
+		vector<TimeStep> vecTwist(a_rAnim.m_vecTwist);
+
+		ClampKeys(vecRot, a_fRotMin, a_fRotMax);
+		ClampKeys(vecTwist, a_fTwistMin, a_fTwistMax);
+
+		UINT nFirstBlock = (UINT)s_vecBlocks.size();
+
+		Clip oClip;
+		oClip.fLength = a_rAnim.GetLength();
+		oClip.bSharedTimes = a_rAnim.HasSharedTimes();
+
+		if (oClip.bSharedTimes)
+			CompressTracks(vecRot, &vecTwist, oClip.oRot, &oClip.oTwist);
+		else
+		{
+			CompressTracks(vecRot, NULL, oClip.oRot, NULL);
+			CompressTracks(vecTwist, NULL, oClip.oTwist, NULL);
+		}
+
+		UINT nHash = HashClip(oClip);
+
+		// reuse an identical clip if there is one
+		std::pair<multimap<UINT, UINT>::iterator, multimap<UINT, UINT>::iterator> range = s_mapHashes.equal_range(nHash);
+		for (multimap<UINT, UINT>::iterator iter = range.first; iter != range.second; ++iter)
+		{
+			if (MatchClips(s_vecClips[iter->second], oClip))
+			{
+				s_vecBlocks.resize(nFirstBlock);
+				return iter->second;
+			}
+		}
+
+		UINT nClip = (UINT)s_vecClips.size();
+		s_vecClips.push_back(oClip);
+		s_mapHashes.insert(std::make_pair(nHash, nClip));
+
+		s_nKeys += oClip.oRot.m_nKeys + oClip.oTwist.m_nKeys;
+		s_nSourceBytes += (UINT)((a_rAnim.m_vecRot.size() + a_rAnim.m_vecTwist.size()) * sizeof(TimeStep));
+
+		return nClip;
+	}
+
+	/**
+	*	\brief	Accessor for the length of a clip
+	*	\param	UINT a_nClip - clip ID
+	*	\return	FLOAT - time of the last key in either track
+	*/
+
+	FLOAT AnimLibrary::GetClipLength(UINT a_nClip)
+	{
+		return s_vecClips[a_nClip].fLength;
+	}
+
+	/**
+	*	\brief	Samples the rotation and twist angles of a clip at a time
+	*	\param	UINT a_nClip - clip ID
+	*	\param	FLOAT a_fTime - time into the clip, may move forwards, backwards or jump anywhere
+	*	\param	AnimCursor& a_rCursor - keys found by the previous sample of this clip, updated with the keys found
+	*	\param	FLOAT& a_rfRot - receives the rotation angle, untouched if there are no rotation keys
+	*	\param	FLOAT& a_rfTwist - receives the twist angle, untouched if there are no twist keys
+	*	\note	Cursor key indices are relative to the clip so a cursor can be reset without knowing the clip
+	*/
+
+	void AnimLibrary::SampleClip(UINT a_nClip, FLOAT a_fTime, AnimCursor& a_rCursor, FLOAT& a_rfRot, FLOAT& a_rfTwist)
+	{
+		const Clip& rClip = s_vecClips[a_nClip];
+
+		if (rClip.bSharedTimes)
+		{
+			SampleCurvePair(rClip.oRot, rClip.oTwist, &s_vecBlocks[0], a_fTime, a_rCursor.m_nRotKey, a_rfRot, a_rfTwist);
+			a_rCursor.m_nTwistKey = a_rCursor.m_nRotKey;
+			return;
+		}
+
+		if (rClip.oRot.m_nKeys)
+			a_rfRot = SampleCurve(rClip.oRot, &s_vecBlocks[0], a_fTime, a_rCursor.m_nRotKey);
+		if (rClip.oTwist.m_nKeys)
+			a_rfTwist = SampleCurve(rClip.oTwist, &s_vecBlocks[0], a_fTime, a_rCursor.m_nTwistKey);
+	}
+
+	/**
+	*	\brief	Interns an animation name
+	*	\param	LPCTSTR a_sName - name of the animation
+	*	\return	UINT - name ID, the same for every string with the same contents
+	*/
+
+	UINT AnimLibrary::GetNameID(LPCTSTR a_sName)
+	{
+		if (a_sName == NULL)
+			return INVALID_ID;
+
+		map<String, UINT>::iterator iterPos = s_mapNames.find(a_sName);
+
+		if (iterPos != s_mapNames.end())
+			return iterPos->second;
+
+		// map keys never move so the stored string can be handed out by GetName()
+		UINT nName = (UINT)s_vecNames.size();
+		iterPos = s_mapNames.insert(std::make_pair(String(a_sName), nName)).first;
+		s_vecNames.push_back(iterPos->first.c_str());
+
+		return nName;
+	}
+
+	/**
+	*	\brief	Finds the ID of an animation name without interning it
+	*	\param	LPCTSTR a_sName - name of the animation
+	*	\return	UINT - name ID or INVALID_ID if the name has never been interned
+	*/
+
+	UINT AnimLibrary::FindNameID(LPCTSTR a_sName)
+	{
+		if (a_sName == NULL)
+			return INVALID_ID;
+
+		map<String, UINT>::const_iterator iterPos = s_mapNames.find(a_sName);
+
+		return (iterPos != s_mapNames.end()) ? iterPos->second : INVALID_ID;
+	}
+
+	/**
+	*	\brief	Accessor for an interned name
+	*	\param	UINT a_nName - name ID
+	*	\return	LPCTSTR - the name or NULL if the ID is not valid
+	*/
+
+	LPCTSTR AnimLibrary::GetName(UINT a_nName)
+	{
+		return (a_nName < s_vecNames.size()) ? s_vecNames[a_nName] : NULL;
+	}
+
+	/**
+	*	\brief	Mutator for the largest angle error compression may introduce, used by clips added afterwards
+	*	\param	FLOAT a_fMaxError - error in radians, 0 keeps every key and only quantizes them
+	*/
+
+	void AnimLibrary::SetMaxError(FLOAT a_fMaxError)
+	{
+		s_fMaxError = (a_fMaxError < 0.0f) ? 0.0f : a_fMaxError;
+	}
+
+	/**
+	*	\brief	Accessor for the largest angle error compression may introduce
+	*	\return	FLOAT - error in radians
+	*/
+
+	FLOAT AnimLibrary::GetMaxError()
+	{
+		return s_fMaxError;
+	}
+
+	/**
+	*	\brief	Accessor for the number of clips stored
+	*	\return	UINT - number of unique clips
+	*/
+
+	UINT AnimLibrary::GetNumClips()
+	{
+		return (UINT)s_vecClips.size();
+	}
+
+	/**
+	*	\brief	Accessor for the number of keys stored
+	*	\return	UINT - number of keys kept by compression across all clips
+	*/
+
+	UINT AnimLibrary::GetNumKeys()
+	{
+		return s_nKeys;
+	}
+
+	/**
+	*	\brief	Accessor for the size the stored clips had before compression
+	*	\return	UINT - bytes of TimeStep keys the unique clips were made from
+	*/
+
+	UINT AnimLibrary::GetSourceBytes()
+	{
+		return s_nSourceBytes;
+	}
+
+	/**
+	*	\brief	Accessor for the size of the stored clips
+	*	\return	UINT - bytes used by the key blocks and clip descriptions
+	*/
+
+	UINT AnimLibrary::GetMemoryUsed()
+	{
+		return (UINT)(s_vecBlocks.size() * sizeof(CurveBlock) + s_vecClips.size() * sizeof(Clip));
+	}
+
+	/**
+	*	\brief	Releases every clip and name
+	*	\pre	No nodes are holding clip or name IDs
+	*/
+
+	void AnimLibrary::Clear()
+	{
+		vector<CurveBlock>().swap(s_vecBlocks);
+		vector<Clip>().swap(s_vecClips);
+		s_mapHashes.clear();
+		s_mapNames.clear();
+		s_vecNames.clear();
+		s_nKeys = 0;
+		s_nSourceBytes = 0;
+	}
+
+	/**
+	*	\brief	Compresses one track, or two tracks with keys at the same times, onto the end of s_vecBlocks
+	*	\param	const vector<TimeStep>& a_rvecA - keys of the first track
+	*	\param	const vector<TimeStep>* a_pvecB - keys of the second track or NULL, same times as a_rvecA
+	*	\param	Curve& a_rCurveA - receives the first curve
+	*	\param	Curve* a_pCurveB - receives the second curve if a_pvecB is not NULL
+	*	\note	Both curves keep the same keys so they can still share a cursor
+	*/
+
+	void AnimLibrary::CompressTracks(const vector<TimeStep>& a_rvecA, const vector<TimeStep>* a_pvecB, Curve& a_rCurveA, Curve* a_pCurveB)
+	{
+		UINT nFirstBlock = (UINT)s_vecBlocks.size();
+
+		// leave room for the quantization error within the fit
+		FLOAT fQuantA = QuantizationStep(a_rvecA) * 0.5f;
+		FLOAT fQuantB = a_pvecB ? QuantizationStep(*a_pvecB) * 0.5f : 0.0f;
+		FLOAT fFit = s_fMaxError;
+
+		for (UINT nAttempt = 0; ; ++nAttempt)
+		{
+			s_vecBlocks.resize(nFirstBlock);
+
+			// a negative error keeps every key
+			FLOAT fErrorA = (nAttempt < MAX_FIT_ATTEMPTS) ? fFit - fQuantA : -1.0f;
+			FLOAT fErrorB = (nAttempt < MAX_FIT_ATTEMPTS) ? fFit - fQuantB : -1.0f;
+
+			vector<UINT> vecKept;
+			ReduceKeys(a_rvecA, a_pvecB, fErrorA, fErrorB, vecKept);
+
+			EncodeCurve(a_rvecA, vecKept, a_rCurveA);
+			FLOAT fError = CurveError(a_rCurveA, a_rvecA);
+
+			if (a_pvecB)
+			{
+				EncodeCurve(*a_pvecB, vecKept, *a_pCurveB);
+				FLOAT fErrorCurveB = CurveError(*a_pCurveB, *a_pvecB);
+
+				if (fErrorCurveB > fError)
+					fError = fErrorCurveB;
+			}
+
+			// the time deltas move keys slightly so tighten the fit until the result is within the error
+			if (fError <= s_fMaxError || nAttempt == MAX_FIT_ATTEMPTS)
+				return;
+
+			fFit *= FIT_TIGHTEN;
+		}
+	}
+
+	/**
+	*	\brief	Chooses the keys to keep so linear interpolation between them stays within an error
+	*	\param	const vector<TimeStep>& a_rvecA - keys of the first track
+	*	\param	const vector<TimeStep>* a_pvecB - keys of the second track or NULL, same times as a_rvecA
+	*	\param	FLOAT a_fErrorA - largest error allowed in the first track, negative keeps every key
+	*	\param	FLOAT a_fErrorB - largest error allowed in the second track
+	*	\param	vector<UINT>& a_rvecKept - receives the indices of the keys to keep in ascending order
+	*	\note	Greedy, each segment is extended for as long as every key it skips still fits
+	*/
+
+	void AnimLibrary::ReduceKeys(const vector<TimeStep>& a_rvecA, const vector<TimeStep>* a_pvecB,
+								 FLOAT a_fErrorA, FLOAT a_fErrorB, vector<UINT>& a_rvecKept)
+	{
+		UINT nKeys = (UINT)a_rvecA.size();
+
+		a_rvecKept.clear();
+
+		if (nKeys == 0)
+			return;
+
+		a_rvecKept.push_back(0);
+
+		UINT nStart = 0;
+		for (UINT nEnd = 2; nEnd < nKeys; ++nEnd)
+		{
+			// the key before nEnd is needed if the segment can't reach past it
+			if (!FitsSegment(a_rvecA, nStart, nEnd, a_fErrorA) || (a_pvecB && !FitsSegment(*a_pvecB, nStart, nEnd, a_fErrorB)))
+			{
+				nStart = nEnd - 1;
+				a_rvecKept.push_back(nStart);
+			}
+		}
+
+		if (nKeys > 1)
+			a_rvecKept.push_back(nKeys - 1);
+	}
+
+	/**
+	*	\brief	Checks whether the keys between two keys can be dropped
+	*	\param	const vector<TimeStep>& a_rvecKeys - keys of the track
+	*	\param	UINT a_nStart - key the segment starts at
+	*	\param	UINT a_nEnd - key the segment ends at
+	*	\param	FLOAT a_fError - largest error allowed
+	*	\return	BOOL - TRUE if interpolating from a_nStart to a_nEnd is within a_fError at every key between them
+	*/
+
+	BOOL AnimLibrary::FitsSegment(const vector<TimeStep>& a_rvecKeys, UINT a_nStart, UINT a_nEnd, FLOAT a_fError)
+	{
+		const TimeStep& rStart = a_rvecKeys[a_nStart];
+		const TimeStep& rEnd = a_rvecKeys[a_nEnd];
+		FLOAT fSpan = rEnd.m_fTime - rStart.m_fTime;
+
+		for (UINT i = a_nStart + 1; i < a_nEnd; ++i)
+		{
+			// a key sharing its time with a neighbour is a step in the curve
+			if (a_rvecKeys[i].m_fTime == a_rvecKeys[i - 1].m_fTime || a_rvecKeys[i].m_fTime == a_rvecKeys[i + 1].m_fTime)
+				return FALSE;
+
+			FLOAT fWeight = (a_rvecKeys[i].m_fTime - rStart.m_fTime) / fSpan;
+			FLOAT fAngle = rStart.m_fAngle + (rEnd.m_fAngle - rStart.m_fAngle) * fWeight;
+
+			if (!(fabs(fAngle - a_rvecKeys[i].m_fAngle) <= a_fError))
+				return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Chooses how many of the kept keys go in the next block of a curve
+	*	\param	const vector<TimeStep>& a_rvecKeys - keys of the track
+	*	\param	const vector<UINT>& a_rvecKept - indices of the keys to store
+	*	\param	UINT a_nFirst - first kept key of the block
+	*	\param	FLOAT& a_rfWidest - receives the widest gap between the keys of the block
+	*	\return	UINT - number of keys, at most CURVE_BLOCK_KEYS
+	*	\note	The tick is the widest gap over 254 so a long hold beside dense keys would leave the short
+	*			gaps a step or two and collapse them. The block ends before any gap that would make the
+	*			widest more than MAX_GAP_RATIO times the narrowest, the gap between blocks costs nothing.
+	*/
+
+	static UINT BlockKeys(const vector<TimeStep>& a_rvecKeys, const vector<UINT>& a_rvecKept, UINT a_nFirst, FLOAT& a_rfWidest)
+	{
+		UINT nKeys = (UINT)a_rvecKept.size();
+		UINT nCount = 1;
+		FLOAT fNarrowest = FLT_MAX;
+
+		a_rfWidest = 0.0f;
+
+		for (; nCount < CURVE_BLOCK_KEYS && a_nFirst + nCount < nKeys; ++nCount)
+		{
+			FLOAT fGap = a_rvecKeys[a_rvecKept[a_nFirst + nCount]].m_fTime - a_rvecKeys[a_rvecKept[a_nFirst + nCount - 1]].m_fTime;
+
+			// steps have no gap to lose
+			FLOAT fNarrow = (fGap > 0.0f && fGap < fNarrowest) ? fGap : fNarrowest;
+			FLOAT fWide = (fGap > a_rfWidest) ? fGap : a_rfWidest;
+
+			if (fWide > fNarrow * MAX_GAP_RATIO)
+				break;
+
+			fNarrowest = fNarrow;
+			a_rfWidest = fWide;
+		}
+
+		return nCount;
+	}
+
+	/**
+	*	\brief	Quantizes the kept keys of a track into blocks on the end of s_vecBlocks
+	*	\param	const vector<TimeStep>& a_rvecKeys - keys of the track
+	*	\param	const vector<UINT>& a_rvecKept - indices of the keys to store
+	*	\param	Curve& a_rCurve - receives the curve
+	*/
+
+	void AnimLibrary::EncodeCurve(const vector<TimeStep>& a_rvecKeys, const vector<UINT>& a_rvecKept, Curve& a_rCurve)
+	{
+		UINT nKeys = (UINT)a_rvecKept.size();
+
+		a_rCurve.m_nFirstBlock = (UINT)s_vecBlocks.size();
+		a_rCurve.m_nKeys = nKeys;
+		a_rCurve.m_fMin = 0.0f;
+		a_rCurve.m_fScale = 0.0f;
+
+		if (nKeys == 0)
+			return;
+
+		// spread the 16 bits over the angles actually used
+		FLOAT fMin = a_rvecKeys[a_rvecKept[0]].m_fAngle, fMax = fMin;
+
+		for (UINT i = 1; i < nKeys; ++i)
+		{
+			FLOAT fAngle = a_rvecKeys[a_rvecKept[i]].m_fAngle;
+
+			if (fAngle < fMin)
+				fMin = fAngle;
+			else if (fAngle > fMax)
+				fMax = fAngle;
+		}
+
+		a_rCurve.m_fMin = fMin;
+		a_rCurve.m_fScale = (fMax - fMin) / 65535.0f;
+
+		UINT nStored = 0;
+
+		for (UINT nFirst = 0; nFirst < nKeys; )
+		{
+			FLOAT fWidest;
+			UINT nCount = BlockKeys(a_rvecKeys, a_rvecKept, nFirst, fWidest);
+
+			CurveBlock oBlock;
+			memset(&oBlock, 0, sizeof(oBlock));
+
+			oBlock.m_fTime = a_rvecKeys[a_rvecKept[nFirst]].m_fTime;
+			oBlock.m_fTick = fWidest / 254.0f;
+
+			// decoded times may not pass the first key of the next block or the search would skip keys
+			FLOAT fLimit = (nFirst + nCount < nKeys) ? a_rvecKeys[a_rvecKept[nFirst + nCount]].m_fTime : FLT_MAX;
+			UINT nPrevSteps = 0;
+
+			// a block that ends early repeats its last key, sampling passes straight over the copies
+			for (UINT i = 0; i < CURVE_BLOCK_KEYS; ++i)
+			{
+				const TimeStep& rKey = a_rvecKeys[a_rvecKept[nFirst + ((i < nCount) ? i : nCount - 1)]];
+
+				UINT nSteps = nPrevSteps;
+				if (i < nCount && oBlock.m_fTick > 0.0f)
+				{
+					// round to the nearest step, which halves the error of rounding down
+					nSteps = (UINT)floor((rKey.m_fTime - oBlock.m_fTime) / oBlock.m_fTick + 0.5f);
+
+					while (nSteps > nPrevSteps && oBlock.m_fTime + (FLOAT)nSteps * oBlock.m_fTick > fLimit)
+						--nSteps;
+				}
+
+				if (nSteps < nPrevSteps)
+					nSteps = nPrevSteps;
+				else if (nSteps > nPrevSteps + 255)
+					nSteps = nPrevSteps + 255;
+
+				oBlock.m_aDelta[i] = (unsigned char)(nSteps - nPrevSteps);
+				nPrevSteps = nSteps;
+
+				if (a_rCurve.m_fScale > 0.0f)
+				{
+					FLOAT fSteps = floor((rKey.m_fAngle - fMin) / a_rCurve.m_fScale + 0.5f);
+					oBlock.m_aAngle[i] = (unsigned short)((fSteps > 65535.0f) ? 65535.0f : fSteps);
+				}
+			}
+
+			s_vecBlocks.push_back(oBlock);
+
+			// the copies count as keys, except in the last block which simply ends
+			nFirst += nCount;
+			nStored += (nFirst < nKeys) ? CURVE_BLOCK_KEYS : nCount;
+		}
+
+		a_rCurve.m_nKeys = nStored;
+	}
+
+	/**
+	*	\brief	Measures how far a compressed curve strays from the keys it was made from
+	*	\param	const Curve& a_rCurve - compressed curve
+	*	\param	const vector<TimeStep>& a_rvecKeys - source keys
+	*	\return	FLOAT - largest angle difference at the source keys and halfway between them
+	*/
+
+	FLOAT AnimLibrary::CurveError(const Curve& a_rCurve, const vector<TimeStep>& a_rvecKeys)
+	{
+		UINT nKeys = (UINT)a_rvecKeys.size();
+
+		if (nKeys == 0)
+			return 0.0f;
+
+		FLOAT fError = 0.0f;
+		UINT nSourceKey = 0, nCurveKey = 0;
+
+		for (UINT i = 0; i < nKeys; ++i)
+		{
+			FLOAT afTimes[2] = { a_rvecKeys[i].m_fTime, a_rvecKeys[i].m_fTime };
+
+			if (i + 1 < nKeys)
+				afTimes[1] = (a_rvecKeys[i].m_fTime + a_rvecKeys[i + 1].m_fTime) * 0.5f;
+
+			for (UINT t = 0; t < 2; ++t)
+			{
+				FLOAT fSource = SampleKeys(&a_rvecKeys[0], nKeys, afTimes[t], nSourceKey);
+				FLOAT fCurve = SampleCurve(a_rCurve, &s_vecBlocks[0], afTimes[t], nCurveKey);
+				FLOAT fDiff = (FLOAT)fabs(fCurve - fSource);
+
+				if (fDiff > fError)
+					fError = fDiff;
+			}
+		}
+
+		return fError;
+	}
+
+	/**
+	*	\brief	Hashes the compressed data of a clip (FNV-1a over the curves and their blocks)
+	*	\param	const Clip& a_rClip - clip to hash, its blocks must be in s_vecBlocks
+	*	\return	UINT - hash of the clip
+	*/
+
+	UINT AnimLibrary::HashClip(const Clip& a_rClip)
+	{
+		UINT nHash = 2166136261u;
+
+		const Curve* apCurves[2] = { &a_rClip.oRot, &a_rClip.oTwist };
+
+		for (UINT c = 0; c < 2; ++c)
+		{
+			const Curve& rCurve = *apCurves[c];
+
+			// include the count so keys can't move between curves without changing the hash
+			nHash = (nHash ^ rCurve.m_nKeys) * 16777619u;
+
+			if (rCurve.m_nKeys == 0)
+				continue;
+
+			const unsigned char* pData = reinterpret_cast<const unsigned char*>(&s_vecBlocks[rCurve.m_nFirstBlock]);
+			size_t nBytes = ((rCurve.m_nKeys + CURVE_BLOCK_KEYS - 1) / CURVE_BLOCK_KEYS) * sizeof(CurveBlock);
+
+			for (size_t i = 0; i < nBytes; ++i)
+				nHash = (nHash ^ pData[i]) * 16777619u;
+		}
+
+		return nHash;
+	}
+
+	/**
+	*	\brief	Compares the compressed data of two clips
+	*	\param	const Clip& a_rClipA - first clip
+	*	\param	const Clip& a_rClipB - second clip
+	*	\return	BOOL - TRUE if both clips sample identically
+	*/
+
+	BOOL AnimLibrary::MatchClips(const Clip& a_rClipA, const Clip& a_rClipB)
+	{
+		if (a_rClipA.fLength != a_rClipB.fLength || a_rClipA.bSharedTimes != a_rClipB.bSharedTimes)
+			return FALSE;
+
+		const Curve* apCurvesA[2] = { &a_rClipA.oRot, &a_rClipA.oTwist };
+		const Curve* apCurvesB[2] = { &a_rClipB.oRot, &a_rClipB.oTwist };
+
+		for (UINT c = 0; c < 2; ++c)
+		{
+			const Curve& rCurveA = *apCurvesA[c];
+			const Curve& rCurveB = *apCurvesB[c];
+
+			if (rCurveA.m_nKeys != rCurveB.m_nKeys || rCurveA.m_fMin != rCurveB.m_fMin || rCurveA.m_fScale != rCurveB.m_fScale)
+				return FALSE;
+
+			if (rCurveA.m_nKeys == 0)
+				continue;
+
+			size_t nBytes = ((rCurveA.m_nKeys + CURVE_BLOCK_KEYS - 1) / CURVE_BLOCK_KEYS) * sizeof(CurveBlock);
+
+			if (memcmp(&s_vecBlocks[rCurveA.m_nFirstBlock], &s_vecBlocks[rCurveB.m_nFirstBlock], nBytes) != 0)
+				return FALSE;
+		}
+
+		return TRUE;
+	}
+}
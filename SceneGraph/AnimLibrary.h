@@ -0,0 +1,109 @@
+/**
+*	\class		SGLib::AnimLibrary
+*	\brief		Global store of immutable animation clips and interned animation names
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Every animation added to an SGLib::Articulated node is stored here once as a clip. The keys of all
+*	clips live in a single contiguous array and a clip is just a range within it, referred to by an
+*	integer clip ID. Adding a clip whose keys are identical to an existing one returns the existing ID,
+*	so a crowd of characters built from the same data costs the memory of one character's clips no
+*	matter how many nodes reference them or how often they are cloned.
+*
+*	Clips are compressed as they are added:
+*
+*		- angles are clamped to the limits of the joint, which sampling would do anyway
+*		- keys that linear interpolation between their neighbours reproduces to within the maximum
+*		  error are dropped, keys that share a time with a neighbour (steps) are always kept
+*		- the rest are stored as SGLib::Curve blocks, 16 bit angles and 8 bit time deltas
+*
+*	A block's time step is its widest gap over 254, so a block ends early instead of taking a gap more
+*	than 16 times its narrowest (a long hold beside densely sampled motion) which would leave the short
+*	gaps only a step or two each. The result is checked against the source keys and if quantization
+*	pushed it over the maximum error the fit is redone tighter, so no sample is ever further than
+*	SetMaxError() from the original.
+*
+*	How much smaller a clip gets depends on how densely it was keyed and how smooth its motion is.
+*	Sampled motion at the default error comes out 5x smaller at 30 Hz and over 10x at 60 Hz with
+*	holds, see Tests/AnimLibraryTest.cpp. Fast motion falls short of 4x because few of its keys can be
+*	dropped. Hand keyed clips such as the Enlightened demo's walk, five keys a track, have nothing to
+*	drop and grow, a partly used block and the clip description cost more than the keys. That is an
+*	accepted deviation from the 4-8x target, which is for sampled clips where the memory actually goes.
+*
+*	Animation names are interned by their contents into integer name IDs, so nodes look animations up
+*	with an integer compare and SetAnimationAll() only converts the name once for a whole hierarchy.
+*
+*	Clips are never modified or removed once added, IDs stay valid until Clear() is called. Sampling is
+*	read only and may be done from several threads at once, adding clips and names may not.
+*/
+
+#ifndef SGLIB_ANIMLIBRARY
+#define SGLIB_ANIMLIBRARY
+
+#pragma once
+
+#include "SGPlatform.h"
+#include "Keyframe.h"
+#include <vector>
+#include <map>
+#include <string>
+
+namespace SGLib
+{
+	class AnimLibrary
+	{
+	public:
+		static const UINT INVALID_ID = 0xffffffff;	///< returned when a clip or name does not exist
+
+		static UINT		AddClip			(const AnimContainer& a_rAnim, FLOAT a_fRotMin, FLOAT a_fRotMax, FLOAT a_fTwistMin, FLOAT a_fTwistMax);
+		static FLOAT	GetClipLength	(UINT a_nClip);
+		static void		SampleClip		(UINT a_nClip, FLOAT a_fTime, AnimCursor& a_rCursor, FLOAT& a_rfRot, FLOAT& a_rfTwist);
+
+		static UINT		GetNameID		(LPCTSTR a_sName);
+		static UINT		FindNameID		(LPCTSTR a_sName);
+		static LPCTSTR	GetName			(UINT a_nName);
+
+		static void		SetMaxError		(FLOAT a_fMaxError);
+		static FLOAT	GetMaxError		();
+
+		static UINT		GetNumClips		();
+		static UINT		GetNumKeys		();
+		static UINT		GetSourceBytes	();
+		static UINT		GetMemoryUsed	();
+		static void		Clear			();
+
+	private:
+		// compressed tracks of a clip
+		struct Clip
+		{
+			Curve	oRot;			///< rotation curve
+			Curve	oTwist;			///< twist curve
+			FLOAT	fLength;		///< time of the last key in either track
+			BOOL	bSharedTimes;	///< TRUE if both curves have keys at the same times
+		};
+
+		typedef std::basic_string<TCHAR> String;
+
+		static std::vector<CurveBlock>		s_vecBlocks;	///< key blocks of every clip
+		static std::vector<Clip>			s_vecClips;		///< clips indexed by clip ID
+		static std::multimap<UINT, UINT>	s_mapHashes;	///< clip hash to clip ID, used to find duplicates
+		static std::map<String, UINT>		s_mapNames;		///< name to name ID
+		static std::vector<LPCTSTR>			s_vecNames;		///< names indexed by name ID
+		static FLOAT						s_fMaxError;	///< largest angle error compression may introduce
+		static UINT							s_nKeys;		///< keys kept across all clips
+		static UINT							s_nSourceBytes;	///< size of the keys the clips were made from
+
+		static void		CompressTracks	(const std::vector<TimeStep>& a_rvecA, const std::vector<TimeStep>* a_pvecB, Curve& a_rCurveA, Curve* a_pCurveB);
+		static void		ReduceKeys		(const std::vector<TimeStep>& a_rvecA, const std::vector<TimeStep>* a_pvecB,
+										 FLOAT a_fErrorA, FLOAT a_fErrorB, std::vector<UINT>& a_rvecKept);
+		static BOOL		FitsSegment		(const std::vector<TimeStep>& a_rvecKeys, UINT a_nStart, UINT a_nEnd, FLOAT a_fError);
+		static void		EncodeCurve		(const std::vector<TimeStep>& a_rvecKeys, const std::vector<UINT>& a_rvecKept, Curve& a_rCurve);
+		static FLOAT	CurveError		(const Curve& a_rCurve, const std::vector<TimeStep>& a_rvecKeys);
+		static UINT		HashClip		(const Clip& a_rClip);
+		static BOOL		MatchClips		(const Clip& a_rClipA, const Clip& a_rClipB);
+
+		AnimLibrary();
+	};
+}
+
+#endif
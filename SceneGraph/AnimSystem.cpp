@@ -0,0 +1,478 @@
+#include "AnimSystem.h"
+#include "Skeleton.h"
+#include "TransformTrack.h"
+#include "Transform.h"
+#include <algorithm>
+
+using std::vector;
+using std::multimap;
+
+namespace SGLib
+{
+	UINT					AnimSystem::s_nFrame = 0;
+	Vector3					AnimSystem::s_vecView(0.0f, 0.0f, 0.0f);
+	FLOAT					AnimSystem::s_fLODDistance = 0.0f;
+	FLOAT					AnimSystem::s_fLODBias = 1.0f;
+	UINT					AnimSystem::s_nJointBudget = 0;
+	FLOAT					AnimSystem::s_fPhaseStep = 0.0f;
+	vector<PoseKey>			AnimSystem::s_vecKeys;
+	vector<FLOAT>			AnimSystem::s_vecAngles;
+	vector<AnimSystem::Pose>	AnimSystem::s_vecPoses;
+	multimap<UINT, UINT>	AnimSystem::s_mapPoses;
+	UINT					AnimSystem::s_anCounts[3] = { 0, 0, 0 };
+	UINT					AnimSystem::s_anLastCounts[3] = { 0, 0, 0 };
+	vector<Skeleton*>		AnimSystem::s_vecSkeletons;
+	vector<Transform*>		AnimSystem::s_vecTracks;
+	SpinLock				AnimSystem::s_oLock;
+
+	// how quickly the LOD bias follows the joint budget and how far it may go
+	static const FLOAT LOD_BIAS_STEP = 1.25f;
+	static const FLOAT LOD_BIAS_MAX = 64.0f;
+
+	/**
+	*	\brief	Starts a new animation frame, forgets the poses stored last frame and adjusts the LOD bias
+	*			to the joint budget
+	*/
+
+	void AnimSystem::BeginFrame()
+	{
+		++s_nFrame;
+
+		for (UINT i = 0; i < 3; ++i)
+		{
+			s_anLastCounts[i] = s_anCounts[i];
+			s_anCounts[i] = 0;
+		}
+
+		s_vecKeys.clear();
+		s_vecAngles.clear();
+		s_vecPoses.clear();
+		s_mapPoses.clear();
+
+		if (s_nJointBudget == 0)
+		{
+			s_fLODBias = 1.0f;
+			return;
+		}
+
+		// push everything further away while over budget and bring it back once well under
+		UINT nEvaluated = s_anLastCounts[0];
+
+		if (nEvaluated > s_nJointBudget)
+			s_fLODBias = (s_fLODBias * LOD_BIAS_STEP > LOD_BIAS_MAX) ? LOD_BIAS_MAX : s_fLODBias * LOD_BIAS_STEP;
+		else if (nEvaluated * 4 < s_nJointBudget * 3)
+			s_fLODBias = (s_fLODBias / LOD_BIAS_STEP < 1.0f) ? 1.0f : s_fLODBias / LOD_BIAS_STEP;
+	}
+
+	/**
+	*	\brief	Accessor for the current frame
+	*	\return	UINT - number of frames begun, wraps around
+	*/
+
+	UINT AnimSystem::GetFrame()
+	{
+		return s_nFrame;
+	}
+
+	/**
+	*	\brief	Animates every registered skeleton and samples every registered track, spread across the job
+	*			system's threads
+	*	\param	FLOAT a_fTimeDiff - time difference since last update call
+	*	\note	Called between BeginFrame() and the update pass. Each skeleton is then only placed under
+	*			its parent by Skeleton::Solve(), skeletons the update pass doesn't reach keep their pose
+	*			until it does. The skeletons whose pose changed and the transforms whose track was sampled
+	*			are woken afterwards on the calling thread, as waking writes to ancestors they may share.
+	*/
+
+	void AnimSystem::Animate(FLOAT a_fTimeDiff)
+	{
+		JobSystem::ParallelFor((UINT)s_vecSkeletons.size(), 1, AnimateRange, &a_fTimeDiff);
+
+		for (UINT i = 0; i < s_vecSkeletons.size(); ++i)
+			s_vecSkeletons[i]->WakeChanged();
+
+		JobSystem::ParallelFor((UINT)s_vecTracks.size(), TransformTrack::SAMPLE_BATCH, SampleRange, &a_fTimeDiff);
+
+		for (UINT i = 0; i < s_vecTracks.size(); ++i)
+			s_vecTracks[i]->WakeSampled();
+	}
+
+	/**
+	*	\brief	Job animating a range of the registered skeletons
+	*	\param	void* a_pData - the FLOAT time difference
+	*	\param	UINT a_nBegin - first skeleton
+	*	\param	UINT a_nEnd - one past the last skeleton
+	*/
+
+	void AnimSystem::AnimateRange(void* a_pData, UINT a_nBegin, UINT a_nEnd)
+	{
+		FLOAT fTimeDiff = *static_cast<FLOAT*>(a_pData);
+
+		for (UINT i = a_nBegin; i < a_nEnd; ++i)
+			s_vecSkeletons[i]->Animate(fTimeDiff);
+	}
+
+	/**
+	*	\brief	Job sampling the tracks of a range of the registered transforms
+	*	\param	void* a_pData - the FLOAT time difference
+	*	\param	UINT a_nBegin - first transform
+	*	\param	UINT a_nEnd - one past the last transform
+	*/
+
+	void AnimSystem::SampleRange(void* a_pData, UINT a_nBegin, UINT a_nEnd)
+	{
+		TransformTrack::SampleTransforms(&s_vecTracks[a_nBegin], a_nEnd - a_nBegin, *static_cast<FLOAT*>(a_pData));
+	}
+
+	/**
+	*	\brief	Adds a skeleton to those animated by Animate()
+	*	\param	Skeleton* a_pSkeleton - skeleton to add, nothing happens if it is already registered
+	*	\note	Not to be called while Animate() is running
+	*/
+
+	void AnimSystem::Register(Skeleton* a_pSkeleton)
+	{
+		if (a_pSkeleton && std::find(s_vecSkeletons.begin(), s_vecSkeletons.end(), a_pSkeleton) == s_vecSkeletons.end())
+			s_vecSkeletons.push_back(a_pSkeleton);
+	}
+
+	/**
+	*	\brief	Removes a skeleton from those animated by Animate()
+	*	\param	Skeleton* a_pSkeleton - skeleton to remove
+	*	\note	Not to be called while Animate() is running
+	*/
+
+	void AnimSystem::Unregister(Skeleton* a_pSkeleton)
+	{
+		vector<Skeleton*>::iterator iter = std::find(s_vecSkeletons.begin(), s_vecSkeletons.end(), a_pSkeleton);
+
+		if (iter != s_vecSkeletons.end())
+			s_vecSkeletons.erase(iter);
+	}
+
+	/**
+	*	\brief	Accessor for the number of registered skeletons
+	*	\return	UINT - skeletons animated by Animate()
+	*/
+
+	UINT AnimSystem::GetNumSkeletons()
+	{
+		return (UINT)s_vecSkeletons.size();
+	}
+
+	/**
+	*	\brief	Adds a transform to those whose tracks are sampled by Animate()
+	*	\param	Transform* a_pTransform - transform to add, nothing happens if it is already registered
+	*	\note	Not to be called while Animate() is running
+	*/
+
+	void AnimSystem::Register(Transform* a_pTransform)
+	{
+		if (a_pTransform && std::find(s_vecTracks.begin(), s_vecTracks.end(), a_pTransform) == s_vecTracks.end())
+			s_vecTracks.push_back(a_pTransform);
+	}
+
+	/**
+	*	\brief	Removes a transform from those whose tracks are sampled by Animate()
+	*	\param	Transform* a_pTransform - transform to remove
+	*	\note	Not to be called while Animate() is running
+	*/
+
+	void AnimSystem::Unregister(Transform* a_pTransform)
+	{
+		vector<Transform*>::iterator iter = std::find(s_vecTracks.begin(), s_vecTracks.end(), a_pTransform);
+
+		if (iter != s_vecTracks.end())
+			s_vecTracks.erase(iter);
+	}
+
+	/**
+	*	\brief	Accessor for the number of transforms playing a track
+	*	\return	UINT - transforms whose tracks are sampled by Animate()
+	*/
+
+	UINT AnimSystem::GetNumTracks()
+	{
+		return (UINT)s_vecTracks.size();
+	}
+
+	/**
+	*	\brief	Mutator for the position LOD distances are measured from, usually the camera's
+	*	\param	const Vector3& a_rvecPos - world position of the viewer
+	*/
+
+	void AnimSystem::SetViewPosition(const Vector3& a_rvecPos)
+	{
+		s_vecView = a_rvecPos;
+	}
+
+	/**
+	*	\brief	Mutator for the distance within which skeletons are evaluated every frame
+	*	\param	FLOAT a_fDistance - world distance, 0 turns level of detail off
+	*/
+
+	void AnimSystem::SetLODDistance(FLOAT a_fDistance)
+	{
+		s_fLODDistance = (a_fDistance < 0.0f) ? 0.0f : a_fDistance;
+	}
+
+	/**
+	*	\brief	Accessor for the distance within which skeletons are evaluated every frame
+	*	\return	FLOAT - world distance, 0 if level of detail is off
+	*/
+
+	FLOAT AnimSystem::GetLODDistance()
+	{
+		return s_fLODDistance;
+	}
+
+	/**
+	*	\brief	Mutator for the number of joints that should be evaluated each frame
+	*	\param	UINT a_nJoints - joint budget, 0 for unlimited
+	*	\note	Only has an effect while level of detail is on, shared and interpolated joints are not counted
+	*/
+
+	void AnimSystem::SetJointBudget(UINT a_nJoints)
+	{
+		s_nJointBudget = a_nJoints;
+	}
+
+	/**
+	*	\brief	Accessor for the number of joints that should be evaluated each frame
+	*	\return	UINT - joint budget, 0 for unlimited
+	*/
+
+	UINT AnimSystem::GetJointBudget()
+	{
+		return s_nJointBudget;
+	}
+
+	/**
+	*	\brief	Mutator for the step animation times are rounded to before sampling
+	*	\param	FLOAT a_fStep - time step, 0 samples the exact time
+	*	\note	Larger steps let more instances share a pose at the cost of smoothness
+	*/
+
+	void AnimSystem::SetPhaseStep(FLOAT a_fStep)
+	{
+		s_fPhaseStep = (a_fStep < 0.0f) ? 0.0f : a_fStep;
+	}
+
+	/**
+	*	\brief	Accessor for the step animation times are rounded to before sampling
+	*	\return	FLOAT - time step, 0 if exact times are sampled
+	*/
+
+	FLOAT AnimSystem::GetPhaseStep()
+	{
+		return s_fPhaseStep;
+	}
+
+	/**
+	*	\brief	Calculates how often a skeleton at a position should evaluate its animation
+	*	\param	const Vector3& a_rvecPos - world position of the skeleton
+	*	\return	UINT - frames between evaluations, a power of 2 from 1 to MAX_UPDATE_PERIOD
+	*/
+
+	UINT AnimSystem::GetUpdatePeriod(const Vector3& a_rvecPos)
+	{
+		if (s_fLODDistance <= 0.0f)
+			return 1;
+
+		Vector3 vecOffset = a_rvecPos - s_vecView;
+		FLOAT fDistSq = Vec3LengthSq(&vecOffset) * s_fLODBias * s_fLODBias;
+		FLOAT fLimitSq = s_fLODDistance * s_fLODDistance;
+
+		// halve the rate each time the distance doubles
+		UINT nPeriod = 1;
+		while (fDistSq > fLimitSq && nPeriod < MAX_UPDATE_PERIOD)
+		{
+			fLimitSq *= 4.0f;
+			nPeriod <<= 1;
+		}
+
+		return nPeriod;
+	}
+
+	/**
+	*	\brief	Rounds an animation time to the phase step
+	*	\param	FLOAT a_fTime - time into the animation
+	*	\param	FLOAT a_fLength - length of the animation
+	*	\return	FLOAT - rounded time within 0 and a_fLength, a_fTime if there is no phase step
+	*/
+
+	FLOAT AnimSystem::SnapTime(FLOAT a_fTime, FLOAT a_fLength)
+	{
+		if (s_fPhaseStep <= 0.0f)
+			return a_fTime;
+
+		FLOAT fTime = floor(a_fTime / s_fPhaseStep + 0.5f) * s_fPhaseStep;
+
+		if (fTime > a_fLength)
+			fTime = a_fLength;
+		else if (fTime < 0.0f)
+			fTime = 0.0f;
+
+		return fTime;
+	}
+
+	/**
+	*	\brief	Looks for a pose stored by another skeleton this frame and copies it
+	*	\param	const PoseKey* a_pKeys - what each link of the skeleton samples
+	*	\param	UINT a_nLinks - number of links
+	*	\param	FLOAT* a_pRot - receives the rotation angle of each link if the pose is found
+	*	\param	FLOAT* a_pTwist - receives the twist angle of each link if the pose is found
+	*	\return	BOOL - TRUE if the pose had been stored
+	*/
+
+	BOOL AnimSystem::FindPose(const PoseKey* a_pKeys, UINT a_nLinks, FLOAT* a_pRot, FLOAT* a_pTwist)
+	{
+		UINT nHash = HashKeys(a_pKeys, a_nLinks);
+		BOOL bFound = FALSE;
+
+		s_oLock.Lock();
+
+		std::pair<multimap<UINT, UINT>::iterator, multimap<UINT, UINT>::iterator> range = s_mapPoses.equal_range(nHash);
+
+		for (multimap<UINT, UINT>::iterator iter = range.first; iter != range.second; ++iter)
+		{
+			const Pose& rPose = s_vecPoses[iter->second];
+
+			if (rPose.nLinks == a_nLinks && memcmp(&s_vecKeys[rPose.nFirstKey], a_pKeys, a_nLinks * sizeof(PoseKey)) == 0)
+			{
+				memcpy(a_pRot, &s_vecAngles[rPose.nFirstAngle], a_nLinks * sizeof(FLOAT));
+				memcpy(a_pTwist, &s_vecAngles[rPose.nFirstAngle + a_nLinks], a_nLinks * sizeof(FLOAT));
+				bFound = TRUE;
+				break;
+			}
+		}
+
+		s_oLock.Unlock();
+
+		return bFound;
+	}
+
+	/**
+	*	\brief	Stores a pose for other skeletons to find this frame
+	*	\param	const PoseKey* a_pKeys - what each link of the skeleton sampled
+	*	\param	UINT a_nLinks - number of links
+	*	\param	const FLOAT* a_pRot - rotation angle of each link
+	*	\param	const FLOAT* a_pTwist - twist angle of each link
+	*	\note	Skeletons animated at the same time may both sample a pose, only the first to store it is kept
+	*/
+
+	void AnimSystem::StorePose(const PoseKey* a_pKeys, UINT a_nLinks, const FLOAT* a_pRot, const FLOAT* a_pTwist)
+	{
+		if (a_nLinks == 0)
+			return;
+
+		UINT nHash = HashKeys(a_pKeys, a_nLinks);
+
+		s_oLock.Lock();
+
+		std::pair<multimap<UINT, UINT>::iterator, multimap<UINT, UINT>::iterator> range = s_mapPoses.equal_range(nHash);
+
+		for (multimap<UINT, UINT>::iterator iter = range.first; iter != range.second; ++iter)
+		{
+			const Pose& rPose = s_vecPoses[iter->second];
+
+			if (rPose.nLinks == a_nLinks && memcmp(&s_vecKeys[rPose.nFirstKey], a_pKeys, a_nLinks * sizeof(PoseKey)) == 0)
+			{
+				s_oLock.Unlock();
+				return;
+			}
+		}
+
+		Pose oPose;
+		oPose.nFirstKey = (UINT)s_vecKeys.size();
+		oPose.nLinks = a_nLinks;
+		oPose.nFirstAngle = (UINT)s_vecAngles.size();
+
+		s_vecKeys.insert(s_vecKeys.end(), a_pKeys, a_pKeys + a_nLinks);
+		s_vecAngles.insert(s_vecAngles.end(), a_pRot, a_pRot + a_nLinks);
+		s_vecAngles.insert(s_vecAngles.end(), a_pTwist, a_pTwist + a_nLinks);
+
+		s_mapPoses.insert(std::make_pair(nHash, (UINT)s_vecPoses.size()));
+		s_vecPoses.push_back(oPose);
+
+		s_oLock.Unlock();
+	}
+
+	/**
+	*	\brief	Adds to this frame's joint counts
+	*	\param	UINT a_nEvaluated - joints whose animation was sampled
+	*	\param	UINT a_nShared - joints whose angles came from the pose cache
+	*	\param	UINT a_nInterpolated - joints interpolated between evaluations
+	*/
+
+	void AnimSystem::CountJoints(UINT a_nEvaluated, UINT a_nShared, UINT a_nInterpolated)
+	{
+		s_oLock.Lock();
+
+		s_anCounts[0] += a_nEvaluated;
+		s_anCounts[1] += a_nShared;
+		s_anCounts[2] += a_nInterpolated;
+
+		s_oLock.Unlock();
+	}
+
+	/**
+	*	\brief	Accessor for the number of joints evaluated last frame
+	*	\return	UINT - joints whose animation was sampled
+	*/
+
+	UINT AnimSystem::GetNumEvaluated()
+	{
+		return s_anLastCounts[0];
+	}
+
+	/**
+	*	\brief	Accessor for the number of joints shared last frame
+	*	\return	UINT - joints whose angles came from the pose cache
+	*/
+
+	UINT AnimSystem::GetNumShared()
+	{
+		return s_anLastCounts[1];
+	}
+
+	/**
+	*	\brief	Accessor for the number of joints interpolated last frame
+	*	\return	UINT - joints interpolated between evaluations
+	*/
+
+	UINT AnimSystem::GetNumInterpolated()
+	{
+		return s_anLastCounts[2];
+	}
+
+	/**
+	*	\brief	Accessor for the distance multiplier used to stay within the joint budget
+	*	\return	FLOAT - 1 when within budget, larger when skeletons are treated as further away
+	*/
+
+	FLOAT AnimSystem::GetLODBias()
+	{
+		return s_fLODBias;
+	}
+
+	/**
+	*	\brief	Hashes the keys of a pose (FNV-1a over the key data)
+	*	\param	const PoseKey* a_pKeys - what each link samples
+	*	\param	UINT a_nLinks - number of links
+	*	\return	UINT - hash of the keys
+	*/
+
+	UINT AnimSystem::HashKeys(const PoseKey* a_pKeys, UINT a_nLinks)
+	{
+		UINT nHash = 2166136261u;
+
+		const unsigned char* pData = reinterpret_cast<const unsigned char*>(a_pKeys);
+		size_t nBytes = a_nLinks * sizeof(PoseKey);
+
+		for (size_t i = 0; i < nBytes; ++i)
+			nHash = (nHash ^ pData[i]) * 16777619u;
+
+		return nHash;
+	}
+}
@@ -0,0 +1,132 @@
+/**
+*	\class		SGLib::AnimSystem
+*	\brief		Per frame animation level of detail, joint budget and shared pose cache for SGLib::Skeleton
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Skeletons ask the animation system how often they need to evaluate their animation and whether
+*	another skeleton has already evaluated the pose they want this frame.
+*
+*	Level of detail - a skeleton further than the LOD distance from the view position evaluates its
+*	animation every 2 frames, twice as far every 4 and so on up to MAX_UPDATE_PERIOD. In between it
+*	interpolates the angles from the pose it was showing towards the last one evaluated, so reduced rates
+*	lag by one period rather than stepping. Skeletons are spread across the frames of their period so
+*	they don't all evaluate on the same one.
+*
+*	Joint budget - if more joints were evaluated last frame than the budget allows every skeleton is
+*	treated as being further away, and as nearer again once the load drops, until the count settles
+*	under the budget.
+*
+*	Pose cache - a pose is described by the clip and time of every animated link (and the angles of
+*	the rest). The first skeleton to evaluate a pose in a frame stores it and every other skeleton
+*	asking for the same pose copies it, so a crowd playing Walk in lockstep costs one evaluation.
+*	SetPhaseStep() rounds the sampling time so instances that are merely close in phase share as well.
+*
+*	SGRenderer::Update() calls BeginFrame() before each update pass. Level of detail is off until
+*	SetLODDistance() is given a distance and SetViewPosition() is kept up to date.
+*
+*	Update 19/10/26 - Skeletons register themselves when built and SGRenderer::Update() calls Animate()
+*	after BeginFrame(), which animates every registered skeleton in parallel with SGLib::JobSystem before
+*	the update pass only has to place them under their parents. The pose cache and joint counts are
+*	guarded by a SGLib::SpinLock and FindPose() copies the pose out while holding it.
+*
+*	Update 19/10/26 - Transforms playing an SGLib::TransformTrack register themselves too and Animate()
+*	samples them in batches of TransformTrack::SAMPLE_BATCH after the skeletons.
+*/
+
+#ifndef SGLIB_ANIMSYSTEM
+#define SGLIB_ANIMSYSTEM
+
+#pragma once
+
+#include "SGMath.h"
+#include "JobSystem.h"
+#include <vector>
+#include <map>
+
+namespace SGLib
+{
+	// what a link contributes to a pose, the clip and time it samples or its angles if it isn't animating
+	struct PoseKey
+	{
+		UINT	m_nClip;	///< clip ID or AnimLibrary::INVALID_ID if the link isn't animating
+		FLOAT	m_fA;		///< time sampled or rotation angle
+		FLOAT	m_fB;		///< 0 or twist angle
+	};
+
+	class Skeleton;
+	class Transform;
+
+	class AnimSystem
+	{
+	public:
+		static const UINT MAX_UPDATE_PERIOD = 8;	///< most frames between evaluations of a skeleton
+
+		static void		BeginFrame		();
+		static UINT		GetFrame		();
+		static void		Animate			(FLOAT a_fTimeDiff);
+
+		static void		Register		(Skeleton* a_pSkeleton);
+		static void		Unregister		(Skeleton* a_pSkeleton);
+		static UINT		GetNumSkeletons	();
+		static void		Register		(Transform* a_pTransform);
+		static void		Unregister		(Transform* a_pTransform);
+		static UINT		GetNumTracks	();
+
+		static void		SetViewPosition	(const Vector3& a_rvecPos);
+		static void		SetLODDistance	(FLOAT a_fDistance);
+		static FLOAT	GetLODDistance	();
+		static void		SetJointBudget	(UINT a_nJoints);
+		static UINT		GetJointBudget	();
+		static void		SetPhaseStep	(FLOAT a_fStep);
+		static FLOAT	GetPhaseStep	();
+
+		static UINT		GetUpdatePeriod	(const Vector3& a_rvecPos);
+		static FLOAT	SnapTime		(FLOAT a_fTime, FLOAT a_fLength);
+
+		static BOOL			FindPose	(const PoseKey* a_pKeys, UINT a_nLinks, FLOAT* a_pRot, FLOAT* a_pTwist);
+		static void			StorePose	(const PoseKey* a_pKeys, UINT a_nLinks, const FLOAT* a_pRot, const FLOAT* a_pTwist);
+
+		static void		CountJoints		(UINT a_nEvaluated, UINT a_nShared, UINT a_nInterpolated);
+		static UINT		GetNumEvaluated	();
+		static UINT		GetNumShared	();
+		static UINT		GetNumInterpolated();
+		static FLOAT	GetLODBias		();
+
+	private:
+		// a pose stored this frame
+		struct Pose
+		{
+			UINT	nFirstKey;		///< index of the first key in s_vecKeys
+			UINT	nLinks;			///< number of links
+			UINT	nFirstAngle;	///< index of the rotation angles in s_vecAngles, the twist angles follow
+		};
+
+		static UINT							s_nFrame;			///< frames begun
+		static Vector3						s_vecView;			///< position LOD distances are measured from
+		static FLOAT						s_fLODDistance;		///< distance evaluated at full rate, 0 for always
+		static FLOAT						s_fLODBias;			///< distance multiplier raised to stay within the budget
+		static UINT							s_nJointBudget;		///< joints evaluated per frame, 0 for unlimited
+		static FLOAT						s_fPhaseStep;		///< sampling times are rounded to this, 0 for exact
+
+		static std::vector<PoseKey>			s_vecKeys;			///< keys of the poses stored this frame
+		static std::vector<FLOAT>			s_vecAngles;		///< angles of the poses stored this frame
+		static std::vector<Pose>			s_vecPoses;			///< poses stored this frame
+		static std::multimap<UINT, UINT>	s_mapPoses;			///< key hash to pose index
+
+		static UINT							s_anCounts[3];		///< joints evaluated, shared and interpolated this frame
+		static UINT							s_anLastCounts[3];	///< the same counts for the previous frame
+
+		static std::vector<Skeleton*>		s_vecSkeletons;		///< skeletons animated by Animate()
+		static std::vector<Transform*>		s_vecTracks;		///< transforms whose tracks are sampled by Animate()
+		static SpinLock						s_oLock;			///< guards the pose cache and counts during Animate()
+
+		static UINT		HashKeys		(const PoseKey* a_pKeys, UINT a_nLinks);
+		static void		AnimateRange	(void* a_pData, UINT a_nBegin, UINT a_nEnd);
+		static void		SampleRange		(void* a_pData, UINT a_nBegin, UINT a_nEnd);
+
+		AnimSystem();
+	};
+}
+
+#endif
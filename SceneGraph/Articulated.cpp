@@ -1,7 +1,8 @@
 #include "Articulated.h"
+#include "Skeleton.h"
+#include <algorithm>
 
 using std::vector;
-using std::map;
 
 namespace SGLib
 {
@@ -45,11 +46,14 @@ namespace SGLib
 									m_fTwistDefault(a_fTwistAngle),
 									m_fTimeOffset(0.0f),
 									m_fAnimLength(0.0f),
+									m_fAnimSpeed(1.0f),
 									m_bAnimRepeat(FALSE),
 									m_bAnimating(FALSE),
-									m_nCurrRotFrame(0),
-									m_nCurrTwistFrame(0),
-									m_sCurrAnimName(NULL)
+									m_sCurrAnimName(NULL),
+									m_nCurrAnimName(AnimLibrary::INVALID_ID),
+									m_nCurrClip(AnimLibrary::INVALID_ID),
+									m_pSkeleton(NULL),
+									m_bSolved(FALSE)
 	{
 		m_pReference = NULL;
 		CalculateMatrix();
@@ -60,8 +64,9 @@ namespace SGLib
 	*	\param	Articulated* a_pReference - pointer to articulated node that this node will mimic
 	*	\pre	a_pReference != NULL
 	*	\note	This constructor is used to allow many articulated nodes to reference a single geometry
-	*			mesh. All other variables are copied across (including animation containers) and as such,
-	*			their animation systems operate idependently of each other. 
+	*			mesh. All other variables are copied across (including animation bindings, the clips
+	*			themselves are shared through SGLib::AnimLibrary) and as such, their animation systems
+	*			operate idependently of each other. 
 	*/
 
 	Articulated::Articulated(	Articulated* a_pReference) :	
@@ -80,12 +85,15 @@ namespace SGLib
 									m_fTwistDefault(a_pReference->m_fTwistAngle),
 									m_fTimeOffset(0.0f),
 									m_fAnimLength(0.0f),
+									m_fAnimSpeed(1.0f),
 									m_bAnimRepeat(FALSE),
 									m_bAnimating(FALSE),
-									m_nCurrRotFrame(0),
-									m_nCurrTwistFrame(0),
 									m_sCurrAnimName(NULL),
-									m_mapAnimations(a_pReference->m_mapAnimations)
+									m_nCurrAnimName(AnimLibrary::INVALID_ID),
+									m_nCurrClip(AnimLibrary::INVALID_ID),
+									m_vecAnimations(a_pReference->m_vecAnimations),
+									m_pSkeleton(NULL),
+									m_bSolved(FALSE)
 	{
 		m_pReference = a_pReference;
 		CalculateMatrix();
@@ -93,11 +101,14 @@ namespace SGLib
 
 	/**
 	*	\brief	Articulated destructor
-	*	\note	Child and Sibling nodes are not touched and their destruction is left up to the user
+	*	\note	Child and Sibling nodes are not touched and their destruction is left up to the user. This
+	*			includes links solved by this node's skeleton, call ReleaseSkeleton() first if they will be
+	*			used without it.
 	*/
 
 	Articulated::~Articulated(void)
 	{
+		delete m_pSkeleton;
 	}
 
 	/**
@@ -133,50 +144,127 @@ namespace SGLib
 
 	void Articulated::Update(FLOAT a_fTimeDiff)
 	{
-		HRESULT hr;
+		// the root of a skeleton solves every link in it, including this one
+		if (m_pSkeleton)
+			m_pSkeleton->Solve(a_fTimeDiff, s_oMatrixWorld);
 
-		// if animating and animation exists
-		if (m_bAnimating && m_mapAnimations.find(m_sCurrAnimName) != m_mapAnimations.end())
+		// matrices already calculated by the skeleton, just set transform for next link
+		if (m_bSolved)
 		{
-			m_fTimeOffset += a_fTimeDiff;
+			m_oMatrixPrevious = s_oMatrixWorld;
+			ApplyLinkLength(m_oMatrix, s_oMatrixWorld);
+
+			// the skeleton wakes the link again when it moves
+			GoToSleep();
+			return;
+		}
+
+		// calculate new matrix if animation changed the angles
+		if (Animate(a_fTimeDiff))
+			CalculateMatrix();
+
+		// apply current matrix to geometry matrix
+		AffineMatrix matWorld;
+
+		m_oMatrixPrevious = s_oMatrixWorld;
+		AffineMultiply(&matWorld, &m_oDHMat, &m_oMatrixPrevious);
+		SetWorldMatrix(matWorld);
+
+		// apply link length and set transform for next link
+		ApplyLinkLength(m_oMatrix, s_oMatrixWorld);
+
+		// nothing left to do until the animation is started or the angles change
+		if (!m_bAnimating)
+			GoToSleep();
+	}
+
+	/**
+	*	\brief	Advances the current animation and samples the rotation and twist angles
+	*	\param	FLOAT a_fTimeDiff - time difference since last update call
+	*	\return	BOOL - TRUE if the angles were sampled, the DH matrix is not recalculated
+	*/
+
+	BOOL Articulated::Animate(FLOAT a_fTimeDiff)
+	{
+		if (!AdvanceAnimation(a_fTimeDiff))
+			return FALSE;
+
+		// get rotation and twist angle
+		SampleAnimation(m_fTimeOffset);
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Advances the time of the current animation without sampling it
+	*	\param	FLOAT a_fTimeDiff - time difference since last update call
+	*	\return	BOOL - TRUE if the link was animating, including the update an animation ends on
+	*/
+
+	BOOL Articulated::AdvanceAnimation(FLOAT a_fTimeDiff)
+	{
+		// if not animating or animation doesn't exist
+		if (!m_bAnimating || m_nCurrClip == AnimLibrary::INVALID_ID)
+			return FALSE;
+
+		m_fTimeOffset += a_fTimeDiff * m_fAnimSpeed;
 
-			// if animation time has elapsed
-			if (m_fTimeOffset > m_fAnimLength)
+		// if animation time has elapsed, either end when playing in reverse
+		if (m_fTimeOffset > m_fAnimLength || m_fTimeOffset < 0.0f)
+		{
+			// if animation on repeat, wrap time
+			if (m_bAnimRepeat && m_fAnimLength > 0.0f)
 			{
-				// if animation on repeat, reset time
-				if (m_bAnimRepeat)
-				{
-					while (m_fTimeOffset > m_fAnimLength)
-						m_fTimeOffset -= m_fAnimLength;
-
-					m_nCurrRotFrame = m_nCurrTwistFrame = 0;
-				}
-				else
-					m_bAnimating = FALSE;
+				m_fTimeOffset = fmod(m_fTimeOffset, m_fAnimLength);
+				if (m_fTimeOffset < 0.0f)
+					m_fTimeOffset += m_fAnimLength;
 			}
+			else
+			{
+				m_fTimeOffset = (m_fTimeOffset < 0.0f) ? 0.0f : m_fAnimLength;
+				m_bAnimating = FALSE;
+			}
+		}
+
+		return TRUE;
+	}
 
-			// get rotation and twist angle
-			m_fRotAngle = GetAngle(m_nCurrRotFrame, m_mapAnimations[m_sCurrAnimName].GetVecRot());
-			m_fTwistAngle = GetAngle(m_nCurrTwistFrame, m_mapAnimations[m_sCurrAnimName].GetVecTwist());
+	/**
+	*	\brief	Builds a skeleton from this link and the links below it so they are all solved in one pass
+	*	\return	UINT - number of links in the skeleton
+	*	\note	See SGLib::Skeleton. Must be called again if links are added, removed or frozen.
+	*/
 
-			ClampAngle(m_fRotAngle, m_fRotMin, m_fRotMax);
-			ClampAngle(m_fTwistAngle, m_fTwistMin, m_fTwistMax);
+	UINT Articulated::BuildSkeleton()
+	{
+		ReleaseSkeleton();
 
-			// calculate new matrix
-			CalculateMatrix();
-		}
+		m_pSkeleton = new Skeleton();
 
-		D3DXMATRIX matTransLength, matTemp;
+		return m_pSkeleton->Build(this);
+	}
 
-		// apply current matrix to geometry matrix
-		V(m_pD3DDevice->GetTransform(D3DTS_WORLD, &m_oMatrixPrevious))
-		D3DXMatrixMultiply(&m_oMatrix, &m_oDHMat, &m_oMatrixPrevious);
+	/**
+	*	\brief	Releases the skeleton built by BuildSkeleton() and lets every link update itself again
+	*/
 
-		// apply link length and set transform for next link
-		D3DXMatrixTranslation(&matTransLength, m_fLinkLength, 0.0f, 0.0f);
-		D3DXMatrixMultiply(&matTemp, &matTransLength, &m_oMatrix);
+	void Articulated::ReleaseSkeleton()
+	{
+		if (m_pSkeleton == NULL)
+			return;
 
-		V(m_pD3DDevice->SetTransform(D3DTS_WORLD, &matTemp))
+		vector<Node*> vecNodes = this->GetNodesOfType(ARTICULATED);
+		vector<Node*>::iterator iter;
+
+		for (iter = vecNodes.begin(); iter != vecNodes.end(); ++iter)
+		{
+			Articulated* pNode = dynamic_cast<Articulated*>(*iter);
+
+			pNode->m_bSolved = FALSE;
+			pNode->Wake();
+		}
+
+		delete m_pSkeleton;
+		m_pSkeleton = NULL;
 	}
 
 	/**
@@ -190,6 +278,53 @@ namespace SGLib
 		Geometry::PostUpdate();
 	}
 
+	/**
+	*	\brief	Stores the matrices Update() would have calculated and bakes the child hierarchy
+	*	\param	const AffineMatrix& a_rMatrixParent - world matrix set when this node is reached
+	*	\note	The current DH angles are baked, any animation will not be seen until Unfreeze() is called
+	*/
+
+	void Articulated::Bake(const AffineMatrix& a_rMatrixParent)
+	{
+		AffineMatrix matWorld;
+
+		m_oMatrixPrevious = a_rMatrixParent;
+		AffineMultiply(&matWorld, &m_oDHMat, &m_oMatrixPrevious);
+		SetWorldMatrix(matWorld);
+
+		Node::Bake(a_rMatrixParent);
+	}
+
+	/**
+	*	\brief	Calculates the world matrix this node leaves set for its child during Update()
+	*	\param	const AffineMatrix& a_rMatrixParent - world matrix set when this node is reached
+	*	\param	AffineMatrix& a_rMatrixChild - receives DH matrix offset by the link length
+	*/
+
+	void Articulated::CalculateChildWorld(const AffineMatrix& a_rMatrixParent, AffineMatrix& a_rMatrixChild) const
+	{
+		AffineMatrix matTemp;
+
+		AffineMultiply(&matTemp, &m_oDHMat, &a_rMatrixParent);
+		ApplyLinkLength(matTemp, a_rMatrixChild);
+	}
+
+	/**
+	*	\brief	Offsets a link matrix by the link length along its x axis to get the next link's matrix
+	*	\param	const AffineMatrix& a_rMatrixLink - DH matrix of this link in world space
+	*	\param	AffineMatrix& a_rMatrixOut - receives translation(link length, 0, 0) * a_rMatrixLink
+	*	\note	A translation on the left only moves the translation row, so this costs three multiplies
+	*			instead of a matrix product
+	*/
+
+	void Articulated::ApplyLinkLength(const AffineMatrix& a_rMatrixLink, AffineMatrix& a_rMatrixOut) const
+	{
+		a_rMatrixOut = a_rMatrixLink;
+
+		for (UINT i = 0; i < 3; ++i)
+			a_rMatrixOut.m[i][3] += m_fLinkLength * a_rMatrixLink.m[i][0];
+	}
+
 	/**
 	*	\brief	Accessor for object's type
 	*	\return	NodeType - returns SGLib::NodeType::ARTICULATED
@@ -257,9 +392,17 @@ namespace SGLib
 		// get all nodes of ARTICULATED type below this node in the scene graph
 		vector<Node*> vecNodes = this->GetNodesOfType(ARTICULATED);
 
+		// look the name up once for the whole hierarchy
+		UINT nAnimName = AnimLibrary::FindNameID(a_sAnimName);
+
 		// set animation for all nodes and store largest animation length
 		for (iter = vecNodes.begin(); iter != vecNodes.end(); ++iter)
-			fMaxAnimLength = max(fMaxAnimLength, dynamic_cast<Articulated*>(*iter)->SetAnimation(a_sAnimName, a_bRepeat));
+		{
+			Articulated* pNode = dynamic_cast<Articulated*>(*iter);
+
+			pNode->m_sCurrAnimName = a_sAnimName;
+			fMaxAnimLength = max(fMaxAnimLength, pNode->StartAnimation(nAnimName, a_bRepeat));
+		}
 
 		// if animation was found, set largest animation length for all nodes
 		if (fMaxAnimLength != -1.0f)
@@ -281,23 +424,57 @@ namespace SGLib
 
 	FLOAT Articulated::SetAnimation(LPCTSTR a_sAnimName, BOOL a_bRepeat)
 	{
-		m_bAnimating = FALSE;
 		m_sCurrAnimName = a_sAnimName;
+
+		return StartAnimation(AnimLibrary::FindNameID(a_sAnimName), a_bRepeat);
+	}
+
+	/**
+	*	\brief	Searches for animation by name ID and sets it if found
+	*	\param	UINT a_nAnimName - name ID of animation to activate
+	*	\param	BOOL a_bRepeat - specifies whether to put the animation on repeat
+	*	\return	FLOAT - the length of the animation - returns -1 if animation not found
+	*/
+
+	FLOAT Articulated::StartAnimation(UINT a_nAnimName, BOOL a_bRepeat)
+	{
+		m_bAnimating = FALSE;
+		m_nCurrAnimName = a_nAnimName;
 		m_fAnimLength = -1.0f;
 		m_fTimeOffset = 0.0f;
 		m_bAnimRepeat = a_bRepeat;
-		m_nCurrRotFrame = m_nCurrTwistFrame = 0;
+		m_oCursor.Reset();
+
+		m_nCurrClip = FindClip(a_nAnimName);
 
 		// if animation is found
-		if (m_mapAnimations.find(a_sAnimName) != m_mapAnimations.end())
+		if (m_nCurrClip != AnimLibrary::INVALID_ID)
 		{
-			m_fAnimLength = max(m_mapAnimations[a_sAnimName].m_vecRot.back().m_fTime, m_mapAnimations[a_sAnimName].m_vecTwist.back().m_fTime);
+			m_fAnimLength = AnimLibrary::GetClipLength(m_nCurrClip);
 			m_bAnimating = TRUE;
+			Wake();
 		}
 
 		return m_fAnimLength;
 	}
 
+	/**
+	*	\brief	Finds the clip bound to an animation name on this node
+	*	\param	UINT a_nAnimName - name ID of animation
+	*	\return	UINT - clip ID or AnimLibrary::INVALID_ID if this node has no such animation
+	*/
+
+	UINT Articulated::FindClip(UINT a_nAnimName) const
+	{
+		AnimBinding oKey = { a_nAnimName, AnimLibrary::INVALID_ID };
+		vector<AnimBinding>::const_iterator iterPos = std::lower_bound(m_vecAnimations.begin(), m_vecAnimations.end(), oKey);
+
+		if (iterPos != m_vecAnimations.end() && iterPos->nName == a_nAnimName)
+			return iterPos->nClip;
+
+		return AnimLibrary::INVALID_ID;
+	}
+
 	/**
 	*	\brief	Calls StopAnimation() on this object and all objects of this type below it in the hierarchy
 	*	\param	BOOL a_bReset - specifies whether to reset the angles to default
@@ -350,9 +527,108 @@ namespace SGLib
 
 	void Articulated::ContinueAnimation()
 	{
+		m_nCurrClip = FindClip(m_nCurrAnimName);
+
 		// if animation is found
-		if (m_mapAnimations.find(m_sCurrAnimName) != m_mapAnimations.end())
+		if (m_nCurrClip != AnimLibrary::INVALID_ID)
+		{
 			m_bAnimating = TRUE;
+			Wake();
+		}
+	}
+
+	/**
+	*	\brief	Calls SetAnimationTime() on this object and all objects of this type below it in the hierarchy
+	*	\param	FLOAT a_fTime - time into the animation to move to
+	*/
+
+	void Articulated::SetAnimationTimeAll(FLOAT a_fTime)
+	{
+		// get all nodes of ARTICULATED type below this node in the scene graph
+		vector<Node*> vecNodes = this->GetNodesOfType(ARTICULATED);
+		vector<Node*>::iterator iter;
+
+		// call SetAnimationTime() on all nodes
+		for (iter = vecNodes.begin(); iter != vecNodes.end(); ++iter)
+			dynamic_cast<Articulated*>(*iter)->SetAnimationTime(a_fTime);
+	}
+
+	/**
+	*	\brief	Moves the current animation to any time and samples the angles there
+	*	\param	FLOAT a_fTime - time into the animation, wrapped if the animation repeats otherwise clamped
+	*	\note	Works whether or not the animation is playing so a stopped animation can be scrubbed. The
+	*			keys are found from the last sample in O(log n) so there is no penalty for seeking backwards.
+	*/
+
+	void Articulated::SetAnimationTime(FLOAT a_fTime)
+	{
+		if (m_bAnimRepeat && m_fAnimLength > 0.0f)
+		{
+			a_fTime = fmod(a_fTime, m_fAnimLength);
+			if (a_fTime < 0.0f)
+				a_fTime += m_fAnimLength;
+		}
+		else if (a_fTime < 0.0f)
+			a_fTime = 0.0f;
+		else if (a_fTime > m_fAnimLength)
+			a_fTime = max(m_fAnimLength, 0.0f);
+
+		m_fTimeOffset = a_fTime;
+
+		if (m_nCurrClip != AnimLibrary::INVALID_ID)
+		{
+			SampleAnimation(m_fTimeOffset);
+			CalculateMatrix();
+			Wake();
+		}
+	}
+
+	/**
+	*	\brief	Accessor for current time into the animation
+	*	\return	FLOAT - time offset into the animation loop
+	*/
+
+	FLOAT Articulated::GetAnimationTime() const
+	{
+		return m_fTimeOffset;
+	}
+
+	/**
+	*	\brief	Calls SetAnimationSpeed() on this object and all objects of this type below it in the hierarchy
+	*	\param	FLOAT a_fSpeed - playback speed
+	*/
+
+	void Articulated::SetAnimationSpeedAll(FLOAT a_fSpeed)
+	{
+		// get all nodes of ARTICULATED type below this node in the scene graph
+		vector<Node*> vecNodes = this->GetNodesOfType(ARTICULATED);
+		vector<Node*>::iterator iter;
+
+		// call SetAnimationSpeed() on all nodes
+		for (iter = vecNodes.begin(); iter != vecNodes.end(); ++iter)
+			dynamic_cast<Articulated*>(*iter)->SetAnimationSpeed(a_fSpeed);
+	}
+
+	/**
+	*	\brief	Mutator for playback speed
+	*	\param	FLOAT a_fSpeed - multiplier applied to the time passed to Update(), 1 is normal speed and a
+	*							negative value plays the animation in reverse
+	*	\note	Use SetAnimationTime() to start a reversed animation from its end
+	*/
+
+	void Articulated::SetAnimationSpeed(FLOAT a_fSpeed)
+	{
+		m_fAnimSpeed = a_fSpeed;
+	}
+
+	/**
+	*	\brief	Accessor for playback speed
+	*	\return	FLOAT - multiplier applied to the time passed to Update()
+	*/
+
+	FLOAT Articulated::GetAnimationSpeed() const
+	{
+		return m_fAnimSpeed;
 	}
 
 	/**
@@ -384,11 +660,12 @@ namespace SGLib
 		// reset time offset
 		m_fTimeOffset = 0.0f;
 
-		// set frame numbers to 0
-		m_nCurrRotFrame = m_nCurrTwistFrame = 0;
+		// set cursor back to the first keys
+		m_oCursor.Reset();
 
 		// recalculate matrix
 		CalculateMatrix();
+		Wake();
 	}
 
 	/**
@@ -402,40 +679,47 @@ namespace SGLib
 	}
 
 	/**
-	*	\brief	Adds the animation to the map of animations of this node if the name doesn't already exist
+	*	\brief	Adds the animation to the animations of this node if the name doesn't already exist
 	*	\param	LPCTSTR a_sAnimName - name to identify this animation with
-	*	\param	AnimContainer& a_rAnim - reference to animation container that holds animation angles
+	*	\param	const AnimContainer& a_rAnim - reference to animation container that holds animation angles
 	*	\return	BOOL - specifies whether the animation was succesfully added
 	*	\note	There is not difference between this AddAnimation() and the other in this class, except the
-	*			function parameters
+	*			function parameters. The angles are compressed into SGLib::AnimLibrary within the limits of
+	*			this joint, a_rAnim is not referenced afterwards.
 	*/
 
-	BOOL Articulated::AddAnimation(LPCTSTR a_sAnimName, AnimContainer& a_rAnim)
+	BOOL Articulated::AddAnimation(LPCTSTR a_sAnimName, const AnimContainer& a_rAnim)
 	{
-		BOOL bResult = FALSE;
+		UINT nAnimName = AnimLibrary::GetNameID(a_sAnimName);
 
-		// if animation was not found
-		if (m_mapAnimations.find(a_sAnimName) == m_mapAnimations.end())
-		{
-			// add animation
-			m_mapAnimations[a_sAnimName] = a_rAnim;
-			bResult = TRUE;
-		}
+		AnimBinding oBinding = { nAnimName, AnimLibrary::INVALID_ID };
+		vector<AnimBinding>::iterator iterPos = std::lower_bound(m_vecAnimations.begin(), m_vecAnimations.end(), oBinding);
+
+		// if animation was already added
+		if (iterPos != m_vecAnimations.end() && iterPos->nName == nAnimName)
+			return FALSE;
+
+		// add animation
+		oBinding.nClip = AnimLibrary::AddClip(a_rAnim, m_fRotMin, m_fRotMax, m_fTwistMin, m_fTwistMax);
+		m_vecAnimations.insert(iterPos, oBinding);
 
-		return bResult;
+		if (nAnimName == m_nCurrAnimName)
+			m_nCurrClip = oBinding.nClip;
+
+		return TRUE;
 	}
 
 	/**
-	*	\brief	Adds the animation to the map of animations of this node if the name doesn't already exist
+	*	\brief	Adds the animation to the animations of this node if the name doesn't already exist
 	*	\param	LPCTSTR a_sAnimName - name to identify this animation with
-	*	\param	vector<TimeStep>& a_rvecRot - reference to vector of rotation TimeSteps
-	*	\param	vector<TimeStep>& a_rvecTwist - reference to vector of twist TimeSteps
+	*	\param	const vector<TimeStep>& a_rvecRot - reference to vector of rotation TimeSteps
+	*	\param	const vector<TimeStep>& a_rvecTwist - reference to vector of twist TimeSteps
 	*	\return	BOOL - specifies whether the animation was succesfully added
 	*	\note	There is not difference between this AddAnimation() and the other in this class, except the
 	*			function parameters
 	*/
 
-	BOOL Articulated::AddAnimation(LPCTSTR a_sAnimName, vector<TimeStep>& a_rvecRot, vector<TimeStep>& a_rvecTwist)
+	BOOL Articulated::AddAnimation(LPCTSTR a_sAnimName, const vector<TimeStep>& a_rvecRot, const vector<TimeStep>& a_rvecTwist)
 	{
 		// call other AddAnimation function by combining vectors into an animation container
 		return AddAnimation(a_sAnimName, AnimContainer(a_rvecRot, a_rvecTwist));
@@ -462,25 +746,32 @@ namespace SGLib
 	}
 
 	/**
-	*	\brief	Deletes the animation from the map of animation of this nodes
+	*	\brief	Deletes the animation from the animations of this node
 	*	\param	LPCTSTR a_sAnimName - Name of animation to delete
 	*	\return	BOOL - specifies whether the animation was found and delete
+	*	\note	Only the binding is removed, the clip stays in SGLib::AnimLibrary for other nodes
 	*/
 
 	BOOL Articulated::DeleteAnimation(LPCTSTR a_sAnimName)
 	{
-		BOOL bFound = FALSE;
+		UINT nAnimName = AnimLibrary::FindNameID(a_sAnimName);
 
-		map<LPCTSTR, AnimContainer>::iterator iterPos = m_mapAnimations.find(a_sAnimName);
+		AnimBinding oKey = { nAnimName, AnimLibrary::INVALID_ID };
+		vector<AnimBinding>::iterator iterPos = std::lower_bound(m_vecAnimations.begin(), m_vecAnimations.end(), oKey);
 
-		// if animation was found
-		if (iterPos != m_mapAnimations.end())
+		// if animation was not found
+		if (iterPos == m_vecAnimations.end() || iterPos->nName != nAnimName)
+			return FALSE;
+
+		if (nAnimName == m_nCurrAnimName)
 		{
-			m_mapAnimations.erase(iterPos);
-			bFound = TRUE;
+			m_nCurrClip = AnimLibrary::INVALID_ID;
+			m_bAnimating = FALSE;
 		}
 
-		return bFound;
+		m_vecAnimations.erase(iterPos);
+
+		return TRUE;
 	}
 
 	/**
@@ -511,67 +802,27 @@ namespace SGLib
 	/**
 	*	\brief	Calculates transpose matrix based on the DH notation algorithm and the link displacement, 
 	*			twist angle and rotation angle.
+	*	\note	Written directly from the closed form rather than multiplying rotation and translation
+	*			matrices, see Skeleton::DHMatrixArray()
 	*/
 
 	void Articulated::CalculateMatrix()
 	{
-		D3DXMATRIX matRot, matTwist, matTransDis;
-
-		// twist matrix
-		D3DXMatrixRotationX(&matTwist, m_fTwistAngle);
-
-		// displacement matrix
-		D3DXMatrixTranslation(&matTransDis, 0.0f, 0.0f, m_fLinkDisplacement);
-
-		// rotation matrix
-		D3DXMatrixRotationZ(&matRot, m_fRotAngle);
-
-		// combine them into m_oMatrix
-		D3DXMatrixMultiply(&m_oDHMat, &matRot, &matTwist);
-		D3DXMatrixMultiply(&m_oDHMat, &m_oDHMat, &matTransDis);
+		Skeleton::DHMatrix(&m_oDHMat, m_fRotAngle, m_fTwistAngle, m_fLinkDisplacement);
 	}
 
 	/**
-	*	\brief	Gets angle from vector of TimeSteps and current time offset into animation
-	*	\param	UINT& a_nCurrFrame - reference to current position within a_rvecAngles angle is being
-	*								 sourced from
-	*	\param	vector<TimeStep>& a_rvecAngles - vector of timesteps to resource angle from
-	*	\return	FLOAT - angle calculated based on time 
+	*	\brief	Samples the current animation and clamps the angles
+	*	\param	FLOAT a_fTime - time into the animation, usually m_fTimeOffset
+	*	\pre	m_nCurrClip != AnimLibrary::INVALID_ID
 	*/
 
-	FLOAT Articulated::GetAngle(UINT& a_nCurrFrame, const vector<TimeStep>& a_rvecAngles)
+	void Articulated::SampleAnimation(FLOAT a_fTime)
 	{
-		FLOAT fPrevFrameTime, fNextFrameTime, fPrevFrameAngle, fNextFrameAngle;
-		fPrevFrameTime = fNextFrameTime = fPrevFrameAngle = fNextFrameAngle = 0.0f;
-
-		// if current frame is last in vector, return last timestep angle
-		if (a_nCurrFrame+1 >= a_rvecAngles.size())
-			return a_rvecAngles[a_nCurrFrame].m_fAngle;
-
-		fNextFrameTime = a_rvecAngles[a_nCurrFrame+1].m_fTime;
-
-		// if time offset is greater than next frame time
-		while (m_fTimeOffset > fNextFrameTime)
-		{
-			// increment current frame
-			a_nCurrFrame++;
-
-			// if current frame is last in vector, return last timestep angle
-			if (a_nCurrFrame+1 >= a_rvecAngles.size())
-				return a_rvecAngles[a_nCurrFrame].m_fAngle;
-			
-			fNextFrameTime = a_rvecAngles[a_nCurrFrame+1].m_fTime;
-		}
-
-		fPrevFrameTime = a_rvecAngles[a_nCurrFrame].m_fTime;
-		fPrevFrameAngle = a_rvecAngles[a_nCurrFrame].m_fAngle;
-		fNextFrameAngle = a_rvecAngles[a_nCurrFrame+1].m_fAngle;
+		// get rotation and twist angle
+		AnimLibrary::SampleClip(m_nCurrClip, a_fTime, m_oCursor, m_fRotAngle, m_fTwistAngle);
 
-		// prevent possible divide by zero error
-		if (abs(fNextFrameTime - fPrevFrameTime) > std::numeric_limits<float>::epsilon())
-			// calculate angle based on current time offset
-			return ((fNextFrameAngle - fPrevFrameAngle) * ((m_fTimeOffset - fPrevFrameTime) / (fNextFrameTime - fPrevFrameTime))) + fPrevFrameAngle;	
-		else
-			return fNextFrameAngle;
+		ClampAngle(m_fRotAngle, m_fRotMin, m_fRotMax);
+		ClampAngle(m_fTwistAngle, m_fTwistMin, m_fTwistMax);
 	}
 }
\ No newline at end of file
@@ -26,6 +26,37 @@
 *	SGLib::AnimContainer is used to encapsulate a collection of TimeStep
 *
 *	Update 1/6/07 -	Fixed problems with the SetDefaults and SetDefaultsAll functions so they work correctly. 
+*
+*	Update 19/10/26 - The DH matrix is stored as an SGLib::AffineMatrix and the link length offset is applied
+*						directly to the translation instead of through a matrix product.
+*
+*	Update 19/10/26 - Keys are found with the cursor and galloping search in Keyframe.h instead of stepping
+*						forward one key at a time, so the animation can be played in reverse (negative
+*						speed) and seeked to any time with SetAnimationTime() without rescanning from the
+*						first key. TimeStep and AnimContainer moved to Keyframe.h.
+*
+*	Update 19/10/26 - Animations are stored once in SGLib::AnimLibrary. A node only keeps a small sorted
+*						array of name ID to clip ID bindings, so cloning a node with the reference
+*						constructor no longer copies any keys and animations are looked up by integer.
+*						Names are matched on their contents rather than their pointer.
+*
+*	Update 19/10/26 - BuildSkeleton() hands the matrices of this link and every link below it to an
+*						SGLib::Skeleton which solves them all in one batched pass from this link's Update().
+*						The DH matrix is written from its closed form instead of three matrices and two
+*						products.
+*
+*	Update 19/10/26 - Animations are compressed as they are added, using this joint's angle limits as
+*						the range the keys are quantized in. See SGLib::AnimLibrary::SetMaxError().
+*
+*	Update 19/10/26 - Skeletons evaluate their links' animation at a rate chosen by SGLib::AnimSystem and
+*						share poses with other skeletons sampling the same clips at the same time.
+*
+*	Update 19/10/26 - Skeletons are animated in parallel before the update pass and this link's Update()
+*						only places the animated links under its parent's world matrix.
+*
+*	Update 19/10/26 - A link sleeps out of the update pass while it is not animating. Starting, continuing or
+*						seeking an animation and resetting the angles wake it, and links in a skeleton are
+*						woken by the skeleton when their matrices change.
 */
 
 #ifndef SGLIB_ARTICULATED
@@ -33,44 +64,15 @@
 
 #pragma once
 
-#include "transform.h"
-#include "geometry.h"
+#include "dxstdafx.h"
+#include "Transform.h"
+#include "Geometry.h"
+#include "AnimLibrary.h"
 #include <vector>
-#include <map>
-#include <limits>
 
 namespace SGLib
 {
-	// identifies a time and angle used for animation
-	struct TimeStep
-	{
-		FLOAT m_fTime;
-		FLOAT m_fAngle;
-
-		TimeStep(FLOAT a_fTime, FLOAT a_fAngle) : m_fAngle(a_fAngle)
-		{
-			// don't allow m_fTime to be less than zero
-			m_fTime = (a_fTime < 0.0f) ?  0.0f : a_fTime; 
-		}
-	};
-
-	// encapsulated a map linking animation names to vectors of SGLib::TimeStep
-	struct AnimContainer
-	{
-		std::vector<TimeStep> m_vecRot;
-		std::vector<TimeStep> m_vecTwist;
-
-		AnimContainer(){}
-
-		AnimContainer(	std::vector<TimeStep>& a_pvecRot, 
-						std::vector<TimeStep>& a_pvecTwist) :
-						m_vecRot(a_pvecRot), 
-						m_vecTwist(a_pvecTwist) 
-		{}
-
-		std::vector<TimeStep>& GetVecRot(){return m_vecRot;}
-		std::vector<TimeStep>& GetVecTwist(){return m_vecTwist;}
-	};
+	class Skeleton;
 
 	class Articulated : public Transform, public Geometry
 	{
@@ -108,18 +110,32 @@ namespace SGLib
 		// current animation
 		FLOAT	m_fTimeOffset;			///< current time displacement into animation loop
 		FLOAT	m_fAnimLength;			///< length of animation
+		FLOAT	m_fAnimSpeed;			///< playback speed, negative plays the animation in reverse
 		BOOL	m_bAnimRepeat;			///< specifies whether to repeat animation when finished
 		BOOL	m_bAnimating;			///< if link is currently animating
-		UINT	m_nCurrRotFrame;		///< current position into rotation vector
-		UINT	m_nCurrTwistFrame;		///< current position into twist vector
+		AnimCursor	m_oCursor;			///< keys found by the last sample of the current animation
 		LPCTSTR	m_sCurrAnimName;		///< name of animation
-		D3DXMATRIX	m_oDHMat;			///< holds static matrix transformation that doesn't have to be updated every frame
+		UINT	m_nCurrAnimName;		///< name ID of animation
+		UINT	m_nCurrClip;			///< clip ID of animation, AnimLibrary::INVALID_ID if not found
+		AffineMatrix	m_oDHMat;		///< holds static matrix transformation that doesn't have to be updated every frame
+
+		// links an animation name to the clip holding its angles
+		struct AnimBinding
+		{
+			UINT nName;		///< name ID from AnimLibrary::GetNameID()
+			UINT nClip;		///< clip ID from AnimLibrary::AddClip()
+
+			bool operator< (const AnimBinding& a_rBinding) const { return nName < a_rBinding.nName; }
+		};
+
+		std::vector<AnimBinding> m_vecAnimations;	///< animations of this node sorted by name ID
 
-		std::map<LPCTSTR, AnimContainer> m_mapAnimations;	///< map that links animation name to animation angles
+		Skeleton*	m_pSkeleton;		///< skeleton solved from this link's Update(), NULL if this is not a root
+		BOOL		m_bSolved;			///< TRUE if this link's matrices are calculated by a skeleton
 
 	public:
-		BOOL	AddAnimation(LPCTSTR a_sAnimName, AnimContainer& a_rAnim); 
-		BOOL	AddAnimation(LPCTSTR a_sAnimName, std::vector<TimeStep>& a_rvecRot, std::vector<TimeStep>& a_rvecTwist); 
+		BOOL	AddAnimation(LPCTSTR a_sAnimName, const AnimContainer& a_rAnim); 
+		BOOL	AddAnimation(LPCTSTR a_sAnimName, const std::vector<TimeStep>& a_rvecRot, const std::vector<TimeStep>& a_rvecTwist); 
 
 		BOOL	DeleteAnimation(LPCTSTR a_sAnimName);
 		BOOL	DeleteAnimationAll(LPCTSTR a_sAnimName);
@@ -136,6 +152,17 @@ namespace SGLib
 		void	ContinueAnimation();
 		void	ContinueAnimationAll();
 
+		void	SetAnimationTime(FLOAT a_fTime);
+		void	SetAnimationTimeAll(FLOAT a_fTime);
+		FLOAT	GetAnimationTime() const;
+
+		void	SetAnimationSpeed(FLOAT a_fSpeed);
+		void	SetAnimationSpeedAll(FLOAT a_fSpeed);
+		FLOAT	GetAnimationSpeed() const;
+
+		UINT	BuildSkeleton();
+		void	ReleaseSkeleton();
+
 		// scene graph related functions
 		void	Render();
 		void	PostRender();
@@ -152,10 +179,22 @@ namespace SGLib
 		void	OnLostDevice();
 		void	OnDestroyDevice();
 
+		void	CalculateChildWorld(const AffineMatrix& a_rMatrixParent, AffineMatrix& a_rMatrixChild) const;
+
+	protected:
+		void	Bake(const AffineMatrix& a_rMatrixParent);
+
 	private:
+		friend class Skeleton;
+
 		void	CalculateMatrix();
+		void	ApplyLinkLength	(const AffineMatrix& a_rMatrixLink, AffineMatrix& a_rMatrixOut) const;
 		void	SetAnimLength	(FLOAT a_nAnimLength);
-		FLOAT	GetAngle		(UINT& a_nCurrFrame, const std::vector<TimeStep>& a_rvecAngles);
+		BOOL	Animate			(FLOAT a_fTimeDiff);
+		BOOL	AdvanceAnimation(FLOAT a_fTimeDiff);
+		void	SampleAnimation	(FLOAT a_fTime);
+		FLOAT	StartAnimation	(UINT a_nAnimName, BOOL a_bRepeat);
+		UINT	FindClip		(UINT a_nAnimName) const;
 		void	ClampAngle		(FLOAT& a_rfAngle, FLOAT a_fMinAngle, FLOAT a_fMaxAngle);
 	};
 }
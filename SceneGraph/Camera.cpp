@@ -12,9 +12,9 @@ namespace SGLib
 														m_bSimpleMovement(FALSE)
 	{
 		// init vectors to some default values
-		m_vecPos = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
-		m_vecUp = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-		m_vecLook = D3DXVECTOR3(0.0f, 0.0f, 1.0f);
+		m_vecPos = Vector3(0.0f, 0.0f, 0.0f);
+		m_vecUp = Vector3(0.0f, 1.0f, 0.0f);
+		m_vecLook = Vector3(0.0f, 0.0f, 1.0f);
 
 		// update view matrix
 		UpdateMatrix(); 
@@ -23,15 +23,15 @@ namespace SGLib
 	/**
 	*	\brief	Camera constructor
 	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
-	*	\param	D3DXVECTOR3& a_rvecPos - specifies camera position vector
-	*	\param	D3DXVECTOR3& a_rvecUp - specifies camera up vector
-	*	\param	D3DXVECTOR3& a_rvecLook - specifies camera look vector
+	*	\param	const Vector3& a_rvecPos - specifies camera position vector
+	*	\param	const Vector3& a_rvecUp - specifies camera up vector
+	*	\param	const Vector3& a_rvecLook - specifies camera look vector
 	*/
 
 	Camera::Camera(	LPDIRECT3DDEVICE9 a_pD3DDevice, 
-					D3DXVECTOR3& a_rvecPos, 
-					D3DXVECTOR3& a_rvecUp, 
-					D3DXVECTOR3& a_rvecLook) :	Node(a_pD3DDevice), 
+					const Vector3& a_rvecPos, 
+					const Vector3& a_rvecUp, 
+					const Vector3& a_rvecLook) :	Node(a_pD3DDevice), 
 												Transform(a_pD3DDevice), 
 												m_vecPos(a_rvecPos), 
 												m_vecUp(a_rvecUp), 
@@ -62,12 +62,12 @@ namespace SGLib
 
 	/**
 	*	\brief	Mutator for all camera vectors
-	*	\param	D3DXVECTOR3& a_rvecPos - new camera position vector
-	*	\param	D3DXVECTOR3& a_rvecUp - new camera up vector
-	*	\param	D3DXVECTOR3& a_rvecLook - new camera look vector
+	*	\param	const Vector3& a_rvecPos - new camera position vector
+	*	\param	const Vector3& a_rvecUp - new camera up vector
+	*	\param	const Vector3& a_rvecLook - new camera look vector
 	*/
 
-	void Camera::SetCamera(D3DXVECTOR3& a_rvecPos, D3DXVECTOR3& a_rvecUp, D3DXVECTOR3& a_rvecLook)
+	void Camera::SetCamera(const Vector3& a_rvecPos, const Vector3& a_rvecUp, const Vector3& a_rvecLook)
 	{
 		m_vecPos = a_rvecPos;
 		m_vecUp	= a_rvecUp;
@@ -78,10 +78,10 @@ namespace SGLib
 
 	/**
 	*	\brief	Mutator for camera position vector
-	*	\param	D3DXVECTOR3& a_vecrPos - new camera position vector
+	*	\param	const Vector3& a_vecrPos - new camera position vector
 	*/
 
-	void Camera::SetPos(D3DXVECTOR3& a_vecrPos)
+	void Camera::SetPos(const Vector3& a_vecrPos)
 	{
 		m_vecPos = a_vecrPos;
 		UpdateMatrix();
@@ -89,10 +89,10 @@ namespace SGLib
 
 	/**
 	*	\brief	Mutator for camera up vector
-	*	\param	D3DXVECTOR3& a_vecrUp - new camera up vector
+	*	\param	const Vector3& a_vecrUp - new camera up vector
 	*/
 
-	void Camera::SetUp(D3DXVECTOR3& a_vecrUp)
+	void Camera::SetUp(const Vector3& a_vecrUp)
 	{
 		m_vecUp = a_vecrUp;
 		UpdateMatrix();
@@ -100,10 +100,10 @@ namespace SGLib
 
 	/**
 	*	\brief	Mutator for camera look vector
-	*	\param	D3DXVECTOR3& a_vecrLook - new camera look vector
+	*	\param	const Vector3& a_vecrLook - new camera look vector
 	*/
 
-	void Camera::SetLook(D3DXVECTOR3& a_vecrLook)
+	void Camera::SetLook(const Vector3& a_vecrLook)
 	{
 		m_vecLook = a_vecrLook;
 		UpdateMatrix();
@@ -111,42 +111,43 @@ namespace SGLib
 
 	/**
 	*	\brief	Accessor for camera position vector
-	*	\return	D3DXVECTOR3 - returns camera position
+	*	\return	Vector3 - returns camera position
 	*/
 
-	D3DXVECTOR3 Camera::GetPos() const
+	Vector3 Camera::GetPos() const
 	{
 		return m_vecPos;
 	}
 
 	/**
 	*	\brief	Accessor for camera up vector
-	*	\return	D3DXVECTOR3 - returns camera up vector
+	*	\return	Vector3 - returns camera up vector
 	*/
 
-	D3DXVECTOR3 Camera::GetUp() const
+	Vector3 Camera::GetUp() const
 	{
 		return m_vecUp;
 	}
 
 	/**
 	*	\brief	Accessor for camera look vector
-	*	\return	D3DXVECTOR3 - returns camera look vector
+	*	\return	Vector3 - returns camera look vector
 	*/
 
-	D3DXVECTOR3 Camera::GetLook() const
+	Vector3 Camera::GetLook() const
 	{
 		return m_vecLook;
 	}
 
 	/**
 	*	\brief	Accessor for view matrix
-	*	\return	D3DXMATRIX - returns view matrix
+	*	\return	Matrix - returns view matrix
 	*/
 
-	D3DXMATRIX Camera::GetViewMatrix() const
+	Matrix Camera::GetViewMatrix() const
 	{
-		return m_oMatrix;
+		Matrix matView;
+		return *MatrixFromAffine(&matView, &m_oMatrix);
 	}
 
 	/**
@@ -168,12 +169,15 @@ namespace SGLib
 	void Camera::Render()
 	{
 		HRESULT	hr;
+		Matrix	matView;
 
 		// get current view matrix
-		V(m_pD3DDevice->GetTransform(D3DTS_VIEW, &m_oMatrixPrevious))
+		V(m_pD3DDevice->GetTransform(D3DTS_VIEW, matView.AsD3D()))
+		AffineFromMatrix(&m_oMatrixPrevious, &matView);
 
 		// set this nodes view matrix
-		V(m_pD3DDevice->SetTransform(D3DTS_VIEW, &m_oMatrix))
+		MatrixFromAffine(&matView, &m_oMatrix);
+		V(m_pD3DDevice->SetTransform(D3DTS_VIEW, matView.AsD3D()))
 	}
 
 	/**
@@ -186,9 +190,11 @@ namespace SGLib
 	void Camera::PostRender()
 	{
 		HRESULT hr;
+		Matrix	matView;
 
 		// set the old view matrix back
-		V(m_pD3DDevice->SetTransform(D3DTS_VIEW, &m_oMatrixPrevious))	
+		MatrixFromAffine(&matView, &m_oMatrixPrevious);
+		V(m_pD3DDevice->SetTransform(D3DTS_VIEW, matView.AsD3D()))	
 	}
 
 	/**
@@ -210,13 +216,13 @@ namespace SGLib
 				return;
 
 			// evaluate movement directions
-			D3DXVECTOR3 vFacing = m_vecLook - m_vecPos;
-			D3DXVec3Normalize(&vFacing, &vFacing);
+			Vector3 vFacing = m_vecLook - m_vecPos;
+			Vec3Normalize(&vFacing, &vFacing);
 			vFacing *= fMovementFactor;
 
-			D3DXVECTOR3 vStrafe;
-			D3DXVec3Cross(&vStrafe, &vFacing, &m_vecUp);
-			D3DXVec3Normalize(&vStrafe, &vStrafe);
+			Vector3 vStrafe;
+			Vec3Cross(&vStrafe, &vFacing, &m_vecUp);
+			Vec3Normalize(&vStrafe, &vStrafe);
 			vStrafe *= fMovementFactor;
 
 			FLOAT fTwist = 0.05f * fMovementFactor;
@@ -252,9 +258,9 @@ namespace SGLib
 			// turn right
 			if (cKeyStatus[VK_RIGHT]& 0x80 || cKeyStatus[VK_NUMPAD6]& 0x80)
 			{
-				D3DXVECTOR3 pos = m_vecPos + (cos(-fTwist) * vFacing);
-				D3DXVECTOR3 crossFacing;
-				D3DXVec3Cross(&crossFacing, &vFacing, &m_vecUp);
+				Vector3 pos = m_vecPos + (cos(-fTwist) * vFacing);
+				Vector3 crossFacing;
+				Vec3Cross(&crossFacing, &vFacing, &m_vecUp);
 
 				m_vecLook = pos + (sin(-fTwist) * crossFacing);
 			}
@@ -262,9 +268,9 @@ namespace SGLib
 			// turn left
 			if (cKeyStatus[VK_LEFT]& 0x80 || cKeyStatus[VK_NUMPAD4]& 0x80)
 			{
-				D3DXVECTOR3 pos = m_vecPos + (cos(fTwist) * vFacing);
-				D3DXVECTOR3 crossFacing;
-				D3DXVec3Cross(&crossFacing, &vFacing, &m_vecUp);
+				Vector3 pos = m_vecPos + (cos(fTwist) * vFacing);
+				Vector3 crossFacing;
+				Vec3Cross(&crossFacing, &vFacing, &m_vecUp);
 
 				m_vecLook = pos + (sin(fTwist) * crossFacing);;
 			}
@@ -273,12 +279,25 @@ namespace SGLib
 		}
 	}
 
+	/**
+	*	\brief	Only declared to avoid calling Transform::PostUpdate as the camera does not alter the world
+	*			matrix during Update()
+	*/
+
+	void Camera::PostUpdate()
+	{
+
+	}
+
 	/**
 	*	\brief	Updates view matrix with current camera vectors
 	*/
 
 	void Camera::UpdateMatrix()
 	{
-		D3DXMatrixLookAtLH(&m_oMatrix, &m_vecPos, &m_vecLook, &m_vecUp); 
+		Matrix matView;
+
+		MatrixLookAtLH(&matView, &m_vecPos, &m_vecLook, &m_vecUp); 
+		AffineFromMatrix(&m_oMatrix, &matView);
 	}
 }
\ No newline at end of file
@@ -6,6 +6,9 @@
 *	\version	1.0
 *
 *	The camera node specifies a view matrix and is often the first node in the scene graph.
+*
+*	Update 19/10/26 - The view matrix is kept in affine storage (see SGLib::Transform) and expanded when it
+*						is set on the device. PostUpdate() no longer falls through to Transform::PostUpdate().
 */
 
 #ifndef SGLIB_CAMERA
@@ -13,7 +16,8 @@
 
 #pragma once
 
-#include "transform.h"
+#include "dxstdafx.h"
+#include "Transform.h"
 
 namespace SGLib
 {
@@ -21,35 +25,36 @@ namespace SGLib
 	{
 	public:
 		Camera(LPDIRECT3DDEVICE9 a_pD3DDevice);
-		Camera(LPDIRECT3DDEVICE9 a_pD3DDevice, D3DXVECTOR3& a_rvecPos, D3DXVECTOR3& a_rvecUp, D3DXVECTOR3& a_rvecLook);
+		Camera(LPDIRECT3DDEVICE9 a_pD3DDevice, const Vector3& a_rvecPos, const Vector3& a_rvecUp, const Vector3& a_rvecLook);
 		~Camera(void);
 
 	protected:
-		D3DXVECTOR3	m_vecPos;			///< camera's position vector
-		D3DXVECTOR3	m_vecUp;			///< camera's up vector
-		D3DXVECTOR3	m_vecLook;			///< camera's look vector
+		Vector3		m_vecPos;			///< camera's position vector
+		Vector3		m_vecUp;			///< camera's up vector
+		Vector3		m_vecLook;			///< camera's look vector
 		BOOL		m_bSimpleMovement;	///< specifies whether simple camera movement is enabled
 
 	public:
 		// mutators
-		void	SetCamera	(D3DXVECTOR3& a_rvecPos, D3DXVECTOR3& a_rvecUp, D3DXVECTOR3& a_rvecLook);
-		void	SetPos		(D3DXVECTOR3& a_rvecPos);
-		void	SetUp		(D3DXVECTOR3& a_rvecUp);
-		void	SetLook		(D3DXVECTOR3& a_rvecLook);
+		void	SetCamera	(const Vector3& a_rvecPos, const Vector3& a_rvecUp, const Vector3& a_rvecLook);
+		void	SetPos		(const Vector3& a_rvecPos);
+		void	SetUp		(const Vector3& a_rvecUp);
+		void	SetLook		(const Vector3& a_rvecLook);
 
 		void	SetSimpleMovement	(BOOL a_bState);
 
 		// accessors
-		D3DXVECTOR3	GetPos() const;
-		D3DXVECTOR3	GetUp() const;
-		D3DXVECTOR3	GetLook() const;
-		D3DXMATRIX	GetViewMatrix() const;
+		Vector3		GetPos() const;
+		Vector3		GetUp() const;
+		Vector3		GetLook() const;
+		Matrix		GetViewMatrix() const;
 		NodeType	GetType() const;
 
 		// scene graph related functions
 		void	Render		();
 		void	PostRender	();
 		void	Update		(FLOAT a_fTimeDiff);
+		void	PostUpdate	();
 
 	private:
 		void	UpdateMatrix();
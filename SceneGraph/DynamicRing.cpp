@@ -0,0 +1,143 @@
+#include "DynamicRing.h"
+
+namespace SGLib
+{
+	DynamicRing* DynamicRing::s_pShared = NULL;
+
+	/**
+	*	\brief	DynamicRing constructor
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - device to create the buffer on
+	*	\param	UINT a_nBytes - size of the buffer, enough for a few frames of transient geometry
+	*	\param	DWORD a_dwUsage - usage flags added to D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, D3DUSAGE_POINTS
+	*			lets it hold point sprites
+	*/
+
+	DynamicRing::DynamicRing(LPDIRECT3DDEVICE9 a_pD3DDevice, UINT a_nBytes, DWORD a_dwUsage) :
+								MappedRing(a_nBytes),
+								m_pD3DDevice(a_pD3DDevice),
+								m_pVB(NULL),
+								m_dwUsage(a_dwUsage)
+	{
+		CreateBuffer();
+	}
+
+	/**
+	*	\brief	DynamicRing destructor
+	*	\note	Stops being the shared ring if it was
+	*/
+
+	DynamicRing::~DynamicRing()
+	{
+		Flush();
+		SAFE_RELEASE(m_pVB)
+
+		if (s_pShared == this)
+			s_pShared = NULL;
+	}
+
+	/**
+	*	\brief	Creates the vertex buffer and starts the ring over
+	*/
+
+	void DynamicRing::CreateBuffer()
+	{
+		if (FAILED(m_pD3DDevice->CreateVertexBuffer(m_oRing.GetCapacity(), D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY | m_dwUsage,
+													0, D3DPOOL_DEFAULT, &m_pVB, 0)))
+		{
+			OutputDebugString(L"Warning: Failed to create the dynamic ring buffer -> DynamicRing::CreateBuffer()\n");
+			m_pVB = NULL;
+		}
+
+		// whatever was in the old buffer is gone
+		m_oRing.Reset(m_oRing.GetCapacity());
+	}
+
+	/**
+	*	\brief	Whether there is a buffer to allocate from
+	*	\return	BOOL - FALSE while the device is lost
+	*/
+
+	BOOL DynamicRing::HasMemory() const
+	{
+		return m_pVB != NULL;
+	}
+
+	/**
+	*	\brief	Locks the whole buffer
+	*	\param	BOOL a_bDiscard - TRUE to lock with D3DLOCK_DISCARD after a wrap, D3DLOCK_NOOVERWRITE otherwise
+	*	\return	BYTE* - contents of the buffer, NULL if it could not be locked
+	*/
+
+	BYTE* DynamicRing::Map(BOOL a_bDiscard)
+	{
+		BYTE* pData;
+
+		if (FAILED(m_pVB->Lock(0, 0, (void**)&pData, a_bDiscard ? D3DLOCK_DISCARD : D3DLOCK_NOOVERWRITE)))
+			return NULL;
+
+		return pData;
+	}
+
+	/**
+	*	\brief	Unlocks the buffer
+	*/
+
+	void DynamicRing::Unmap()
+	{
+		m_pVB->Unlock();
+	}
+
+	/**
+	*	\brief	Accessor for the vertex buffer
+	*	\return	LPDIRECT3DVERTEXBUFFER9 - buffer to set as the stream source, NULL while the device is lost
+	*/
+
+	LPDIRECT3DVERTEXBUFFER9 DynamicRing::GetBuffer() const
+	{
+		return m_pVB;
+	}
+
+	/**
+	*	\brief	Called when the device has been reset - recreates the buffer
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - device after the reset
+	*/
+
+	void DynamicRing::OnResetDevice(LPDIRECT3DDEVICE9 a_pD3DDevice)
+	{
+		m_pD3DDevice = a_pD3DDevice;
+
+		if (m_pVB == NULL)
+			CreateBuffer();
+	}
+
+	/**
+	*	\brief	Called when the device has been lost - releases the buffer
+	*/
+
+	void DynamicRing::OnLostDevice()
+	{
+		Flush();
+		SAFE_RELEASE(m_pVB)
+	}
+
+	/**
+	*	\brief	Makes a ring the one used by the library's transient geometry
+	*	\param	DynamicRing* a_pRing - ring to share, NULL for none
+	*	\note	The ring is not owned, it must be set back to NULL or destroyed before it goes away
+	*/
+
+	void DynamicRing::SetShared(DynamicRing* a_pRing)
+	{
+		s_pShared = a_pRing;
+	}
+
+	/**
+	*	\brief	Accessor for the shared ring
+	*	\return	DynamicRing* - ring used by the library's transient geometry, NULL if there is none
+	*/
+
+	DynamicRing* DynamicRing::GetShared()
+	{
+		return s_pShared;
+	}
+}
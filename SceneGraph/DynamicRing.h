@@ -0,0 +1,72 @@
+/**
+*	\class		SGLib::DynamicRing
+*	\brief		One large dynamic vertex buffer that transient geometry is written into each frame
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Particles, billboards, debug lines and other geometry rebuilt every frame sub-allocate ranges of
+*	this buffer instead of each owning a dynamic buffer of its own. SGLib::RingAllocator decides where
+*	each range goes. The buffer is locked by the first Allocate() after a Flush() and stays locked
+*	while further ranges are handed out:
+*
+*		- with D3DLOCK_NOOVERWRITE while the ring is appending, as the GPU may still be reading the
+*		  ranges before the head but never the ones after it
+*		- with D3DLOCK_DISCARD when the ring wraps
+*
+*	Flush() unlocks it and must be called before anything drawn from the buffer. When the transient
+*	geometry of a frame is written in one go before drawing, as SGRenderer does for the particle
+*	systems, that is one lock a frame and two on the frame the ring wraps.
+*
+*	Allocate() returns the range's offset and the ring's generation. The range can be drawn again in
+*	later frames without writing it, as long as IsValid() still accepts the generation.
+*
+*	The locking is SGLib::MappedRing's, which the ring derives from, so a wrap unlocks the buffer under
+*	any pointer handed out before it. SGLib::RingUpload writes its ranges before such a wrap.
+*
+*	The buffer is in D3DPOOL_DEFAULT, so OnLostDevice() and OnResetDevice() must be called with the
+*	rest of the application's default pool resources. One ring can be made the shared ring with
+*	SetShared() for the library's own transient geometry.
+*/
+
+#ifndef SGLIB_DYNAMICRING
+#define SGLIB_DYNAMICRING
+
+#pragma once
+
+#include "dxstdafx.h"
+#include "MappedRing.h"
+
+namespace SGLib
+{
+	class DynamicRing : public MappedRing
+	{
+	public:
+		DynamicRing(LPDIRECT3DDEVICE9 a_pD3DDevice, UINT a_nBytes, DWORD a_dwUsage = D3DUSAGE_POINTS);
+		~DynamicRing();
+
+	protected:
+		LPDIRECT3DDEVICE9		m_pD3DDevice;	///< device the buffer belongs to
+		LPDIRECT3DVERTEXBUFFER9	m_pVB;			///< the ring's vertex buffer
+		DWORD					m_dwUsage;		///< usage flags besides D3DUSAGE_DYNAMIC and D3DUSAGE_WRITEONLY
+
+		static DynamicRing*		s_pShared;		///< ring used by the library's transient geometry
+
+	public:
+		LPDIRECT3DVERTEXBUFFER9	GetBuffer	() const;
+
+		void		OnResetDevice	(LPDIRECT3DDEVICE9 a_pD3DDevice);
+		void		OnLostDevice	();
+
+		static void				SetShared	(DynamicRing* a_pRing);
+		static DynamicRing*		GetShared	();
+
+	protected:
+		void		CreateBuffer	();
+
+		BOOL		HasMemory		() const;
+		BYTE*		Map				(BOOL a_bDiscard);
+		void		Unmap			();
+	};
+}
+
+#endif
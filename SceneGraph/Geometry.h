@@ -8,6 +8,9 @@
 *	This class provides default support for loading simple .x meshes. This node does not support
 *	meshes not loaded through the .x interface. All meshes created are loaded into managed memory
 *	so they don't have to be re-obtained when the device is reset, only when it is lost.
+*
+*	Update 19/10/26 - Added accessors for the mesh, materials and texture names so static geometry can be
+*						merged by SGLib::StaticBatch. Reference nodes now respect their own visibility.
 */
 
 #ifndef SGLIB_GEOMETRY
@@ -15,7 +18,9 @@
 
 #pragma once
 
-#include "node.h"
+#include "dxstdafx.h"
+#include "Node.h"
+#include <string>
 
 namespace SGLib
 {
@@ -37,10 +42,19 @@ namespace SGLib
 		LPCTSTR				m_sFileName;	///< filename used to load .x mesh
 		Geometry*			m_pReference;	///< points to the geometry reference node
 
+		std::vector<std::string>	m_vecTexNames;	///< texture filenames used in the mesh (empty if none)
+
 	public:
 		void		SetVisible(BOOL a_bVisible);
 		NodeType	GetType() const;
 
+		// accessors (reference nodes return the values of their reference)
+		BOOL				IsVisible() const;
+		LPD3DXMESH			GetMesh() const;
+		DWORD				GetNumMaterials() const;
+		const D3DMATERIAL9*	GetMaterials() const;
+		LPCSTR				GetTextureName(DWORD a_dwMat) const;
+
 		// geometry only requires operations to be carried out in the render function (not the PostRender, Update etc.)
 		void		Render();
 
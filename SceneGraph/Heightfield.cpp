@@ -0,0 +1,182 @@
+#include "Heightfield.h"
+
+namespace SGLib
+{
+	/**
+	*	\brief	Heightfield constructor
+	*	\note	The field is empty until Create() or HeightfieldFromFile() is called
+	*/
+
+	Heightfield::Heightfield() :	m_nWidth(0),
+									m_nDepth(0),
+									m_vecOrigin(0.0f, 0.0f, 0.0f),
+									m_fCellSize(1.0f),
+									m_fInvCellSize(1.0f)
+	{
+	}
+
+	/**
+	*	\brief	Heightfield destructor
+	*/
+
+	Heightfield::~Heightfield()
+	{
+	}
+
+	/**
+	*	\brief	Fills the field from an array of heights
+	*	\param	const FLOAT* a_pHeights - a_nWidth * a_nDepth heights, row by row along x
+	*	\param	UINT a_nWidth - samples along x, at least 2
+	*	\param	UINT a_nDepth - samples along z, at least 2
+	*	\param	const Vector3& a_rvecOrigin - world position of the first sample, its y is added to every height
+	*	\param	FLOAT a_fCellSize - distance between samples
+	*/
+
+	void Heightfield::Create(const FLOAT* a_pHeights, UINT a_nWidth, UINT a_nDepth, const Vector3& a_rvecOrigin, FLOAT a_fCellSize)
+	{
+		if (a_nWidth < 2 || a_nDepth < 2 || a_fCellSize <= 0.0f)
+		{
+			m_nWidth = 0;
+			m_nDepth = 0;
+			return;
+		}
+
+		m_nWidth = a_nWidth;
+		m_nDepth = a_nDepth;
+		m_vecOrigin = a_rvecOrigin;
+		m_fCellSize = a_fCellSize;
+		m_fInvCellSize = 1.0f / a_fCellSize;
+
+		m_arrHeights.Resize(a_nWidth * a_nDepth);
+
+		for (UINT i = 0; i < a_nWidth * a_nDepth; ++i)
+			m_arrHeights[i] = a_rvecOrigin.y + a_pHeights[i];
+	}
+
+	/**
+	*	\brief	Works out the height of the surface at a point
+	*	\param	FLOAT a_fX - world x
+	*	\param	FLOAT a_fZ - world z
+	*	\param	FLOAT* a_pfHeight - receives the world height of the surface
+	*	\return	BOOL - FALSE if the point is outside the field or the field is empty
+	*/
+
+	BOOL Heightfield::GetHeight(FLOAT a_fX, FLOAT a_fZ, FLOAT* a_pfHeight) const
+	{
+		// m_nWidth - 1 would wrap round for an empty field
+		if (m_nWidth == 0)
+			return FALSE;
+
+		FLOAT fX = (a_fX - m_vecOrigin.x) * m_fInvCellSize;
+		FLOAT fZ = (a_fZ - m_vecOrigin.z) * m_fInvCellSize;
+
+		// also rejects NaNs
+		if (!(fX >= 0.0f && fZ >= 0.0f && fX <= (FLOAT)(m_nWidth - 1) && fZ <= (FLOAT)(m_nDepth - 1)))
+			return FALSE;
+
+		// the far edges belong to the last cell
+		UINT nX = (UINT)fX;
+		UINT nZ = (UINT)fZ;
+		nX = (nX < m_nWidth - 2) ? nX : m_nWidth - 2;
+		nZ = (nZ < m_nDepth - 2) ? nZ : m_nDepth - 2;
+
+		FLOAT fU = fX - (FLOAT)nX;
+		FLOAT fV = fZ - (FLOAT)nZ;
+
+		const FLOAT* pRow = m_arrHeights.Data() + nZ * m_nWidth + nX;
+		FLOAT fNear = pRow[0] + (pRow[1] - pRow[0]) * fU;
+		FLOAT fFar = pRow[m_nWidth] + (pRow[m_nWidth + 1] - pRow[m_nWidth]) * fU;
+
+		*a_pfHeight = fNear + (fFar - fNear) * fV;
+
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Works out the normal of the surface at a point
+	*	\param	FLOAT a_fX - world x
+	*	\param	FLOAT a_fZ - world z
+	*	\param	Vector3* a_pvecNormal - receives the unit normal, pointing up
+	*	\return	BOOL - FALSE if the point is outside the field or the field is empty
+	*/
+
+	BOOL Heightfield::GetNormal(FLOAT a_fX, FLOAT a_fZ, Vector3* a_pvecNormal) const
+	{
+		if (m_nWidth == 0)
+			return FALSE;
+
+		FLOAT fX = (a_fX - m_vecOrigin.x) * m_fInvCellSize;
+		FLOAT fZ = (a_fZ - m_vecOrigin.z) * m_fInvCellSize;
+
+		if (!(fX >= 0.0f && fZ >= 0.0f && fX <= (FLOAT)(m_nWidth - 1) && fZ <= (FLOAT)(m_nDepth - 1)))
+			return FALSE;
+
+		UINT nX = (UINT)fX;
+		UINT nZ = (UINT)fZ;
+		nX = (nX < m_nWidth - 2) ? nX : m_nWidth - 2;
+		nZ = (nZ < m_nDepth - 2) ? nZ : m_nDepth - 2;
+
+		FLOAT fU = fX - (FLOAT)nX;
+		FLOAT fV = fZ - (FLOAT)nZ;
+
+		// slopes of the bilinear surface along x and z
+		const FLOAT* pRow = m_arrHeights.Data() + nZ * m_nWidth + nX;
+		FLOAT fSlopeX = ((pRow[1] - pRow[0]) * (1.0f - fV) + (pRow[m_nWidth + 1] - pRow[m_nWidth]) * fV) * m_fInvCellSize;
+		FLOAT fSlopeZ = ((pRow[m_nWidth] - pRow[0]) * (1.0f - fU) + (pRow[m_nWidth + 1] - pRow[1]) * fU) * m_fInvCellSize;
+
+		Vector3 vecNormal(-fSlopeX, 1.0f, -fSlopeZ);
+		Vec3Normalize(a_pvecNormal, &vecNormal);
+
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Whether the field has any heights
+	*	\return	BOOL - TRUE until Create() or HeightfieldFromFile() succeeds
+	*/
+
+	BOOL Heightfield::IsEmpty() const
+	{
+		return m_nWidth == 0;
+	}
+
+	/**
+	*	\brief	Accessor for the samples along x
+	*	\return	UINT - 0 if the field is empty
+	*/
+
+	UINT Heightfield::GetWidth() const
+	{
+		return m_nWidth;
+	}
+
+	/**
+	*	\brief	Accessor for the samples along z
+	*	\return	UINT - 0 if the field is empty
+	*/
+
+	UINT Heightfield::GetDepth() const
+	{
+		return m_nDepth;
+	}
+
+	/**
+	*	\brief	Accessor for the world position of the first sample
+	*	\return	const Vector3& - origin given to Create() or HeightfieldFromFile()
+	*/
+
+	const Vector3& Heightfield::GetOrigin() const
+	{
+		return m_vecOrigin;
+	}
+
+	/**
+	*	\brief	Accessor for the distance between samples
+	*	\return	FLOAT - cell size in world units
+	*/
+
+	FLOAT Heightfield::GetCellSize() const
+	{
+		return m_fCellSize;
+	}
+}
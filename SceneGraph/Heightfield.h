@@ -0,0 +1,54 @@
+/**
+*	\class		SGLib::Heightfield
+*	\brief		Regular grid of heights over the xz plane that can be sampled on the CPU
+*	\date		19/10/26
+*	\version	1.0
+*
+*	The heights are held at the corners of square cells of GetCellSize() world units, starting at
+*	GetOrigin() and running GetWidth() samples along x and GetDepth() along z. GetHeight() interpolates
+*	the four corners of the cell a point falls in bilinearly and GetNormal() is the normal of that
+*	surface, so the two agree wherever they are sampled. Points outside the grid have no height.
+*
+*	Nothing here depends on the device, see SGLib::ParticleCollider. HeightfieldFromFile() in
+*	HeightfieldLoader.h fills a field from a greyscale image such as the height maps painted for the
+*	terrain, decoding it with D3DX.
+*/
+
+#ifndef SGLIB_HEIGHTFIELD
+#define SGLIB_HEIGHTFIELD
+
+#pragma once
+
+#include "SGMath.h"
+
+namespace SGLib
+{
+	class Heightfield
+	{
+	public:
+		Heightfield();
+		~Heightfield();
+
+	protected:
+		AlignedArray<FLOAT>		m_arrHeights;	///< heights, row by row along x
+		UINT					m_nWidth;		///< samples along x
+		UINT					m_nDepth;		///< samples along z
+		Vector3					m_vecOrigin;	///< world position of the first sample at height 0
+		FLOAT					m_fCellSize;	///< distance between samples
+		FLOAT					m_fInvCellSize;	///< 1 / m_fCellSize
+
+	public:
+		void		Create		(const FLOAT* a_pHeights, UINT a_nWidth, UINT a_nDepth, const Vector3& a_rvecOrigin, FLOAT a_fCellSize);
+
+		BOOL		GetHeight	(FLOAT a_fX, FLOAT a_fZ, FLOAT* a_pfHeight) const;
+		BOOL		GetNormal	(FLOAT a_fX, FLOAT a_fZ, Vector3* a_pvecNormal) const;
+
+		BOOL		IsEmpty		() const;
+		UINT		GetWidth	() const;
+		UINT		GetDepth	() const;
+		const Vector3&	GetOrigin() const;
+		FLOAT		GetCellSize	() const;
+	};
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include "HeightfieldLoader.h"
+
+namespace SGLib
+{
+	/**
+	*	\brief	Fills a heightfield from a greyscale image
+	*	\param	Heightfield* a_pField - field to fill, left as it was if the image can't be read
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - device used to decode the image
+	*	\param	LPCTSTR a_sFileName - image to load, its first row lies along the origin's z
+	*	\param	const Vector3& a_rvecOrigin - world position of the first pixel at black
+	*	\param	FLOAT a_fCellSize - distance between pixels in world units
+	*	\param	FLOAT a_fHeightScale - height of white above black
+	*	\return	BOOL - TRUE if the image was loaded
+	*/
+
+	BOOL HeightfieldFromFile(Heightfield* a_pField, LPDIRECT3DDEVICE9 a_pD3DDevice, LPCTSTR a_sFileName,
+							 const Vector3& a_rvecOrigin, FLOAT a_fCellSize, FLOAT a_fHeightScale)
+	{
+		LPDIRECT3DTEXTURE9 pTexture = NULL;
+
+		// decoded to 8 bit luminance at its own size, in memory the device never touches
+		if (FAILED(D3DXCreateTextureFromFileEx(	a_pD3DDevice, a_sFileName, D3DX_DEFAULT_NONPOW2, D3DX_DEFAULT_NONPOW2, 1, 0,
+												D3DFMT_L8, D3DPOOL_SCRATCH, D3DX_FILTER_NONE, D3DX_DEFAULT, 0, NULL, NULL, &pTexture)))
+		{
+			OutputDebugString(L"Warning: Failed to load the height map -> HeightfieldFromFile()\n");
+			return FALSE;
+		}
+
+		D3DSURFACE_DESC oDesc;
+		D3DLOCKED_RECT oRect;
+
+		if (FAILED(pTexture->GetLevelDesc(0, &oDesc)) || FAILED(pTexture->LockRect(0, &oRect, NULL, D3DLOCK_READONLY)))
+		{
+			OutputDebugString(L"Warning: Failed to read the height map -> HeightfieldFromFile()\n");
+			SAFE_RELEASE(pTexture)
+			return FALSE;
+		}
+
+		AlignedArray<FLOAT> arrHeights(oDesc.Width * oDesc.Height);
+		FLOAT fScale = a_fHeightScale / 255.0f;
+
+		for (UINT nZ = 0; nZ < oDesc.Height; ++nZ)
+		{
+			const BYTE* pRow = static_cast<const BYTE*>(oRect.pBits) + nZ * oRect.Pitch;
+
+			for (UINT nX = 0; nX < oDesc.Width; ++nX)
+				arrHeights[nZ * oDesc.Width + nX] = pRow[nX] * fScale;
+		}
+
+		pTexture->UnlockRect(0);
+		SAFE_RELEASE(pTexture)
+
+		a_pField->Create(arrHeights.Data(), oDesc.Width, oDesc.Height, a_rvecOrigin, a_fCellSize);
+
+		return !a_pField->IsEmpty();
+	}
+}
@@ -0,0 +1,26 @@
+/**
+*	\file		HeightfieldLoader.h
+*	\brief		Fills an SGLib::Heightfield from a greyscale image decoded with D3DX
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Kept apart from SGLib::Heightfield so the field and SGLib::ParticleCollider build without DirectX.
+*	Black is the origin's height and white a_fHeightScale above it. The device is only used to decode
+*	the image, the heights are kept in system memory so nothing needs doing when the device is lost.
+*/
+
+#ifndef SGLIB_HEIGHTFIELDLOADER
+#define SGLIB_HEIGHTFIELDLOADER
+
+#pragma once
+
+#include "dxstdafx.h"
+#include "Heightfield.h"
+
+namespace SGLib
+{
+	BOOL	HeightfieldFromFile	(Heightfield* a_pField, LPDIRECT3DDEVICE9 a_pD3DDevice, LPCTSTR a_sFileName,
+								 const Vector3& a_rvecOrigin, FLOAT a_fCellSize, FLOAT a_fHeightScale);
+}
+
+#endif
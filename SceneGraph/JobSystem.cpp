@@ -0,0 +1,281 @@
+#include "JobSystem.h"
+
+namespace SGLib
+{
+	JobSystem::Thread*		JobSystem::s_pThreads = NULL;
+	UINT					JobSystem::s_nWorkers = 0;
+	BOOL					JobSystem::s_bStarted = FALSE;
+	JobSystem::Semaphore	JobSystem::s_hWake = NULL;
+	JobSystem::Semaphore	JobSystem::s_hDone = NULL;
+	volatile LONG			JobSystem::s_nBusy = 0;
+	volatile LONG			JobSystem::s_nQuit = 0;
+	volatile LONG			JobSystem::s_nNext = 0;
+	volatile LONG			JobSystem::s_nActive = 0;
+	JobSystem::JobFunc		JobSystem::s_pFunc = NULL;
+	void*					JobSystem::s_pData = NULL;
+	UINT					JobSystem::s_nCount = 0;
+	UINT					JobSystem::s_nGrain = 1;
+
+	// most workers the pool will start whatever the processor count
+	static const UINT MAX_WORKERS = 31;
+
+	// the little the pool needs from the platform's threads
+#if defined(_WIN32)
+	static UINT ProcessorCount()
+	{
+		SYSTEM_INFO oInfo;
+		GetSystemInfo(&oInfo);
+		return (UINT)oInfo.dwNumberOfProcessors;
+	}
+
+	static HANDLE	CreateWaitSemaphore	(UINT a_nMax)					{ return CreateSemaphore(NULL, 0, (LONG)a_nMax, NULL); }
+	static void		DestroySemaphore	(HANDLE a_hSemaphore)			{ CloseHandle(a_hSemaphore); }
+	static void		SignalSemaphore		(HANDLE a_hSemaphore, UINT a_nCount)	{ ReleaseSemaphore(a_hSemaphore, (LONG)a_nCount, NULL); }
+	static void		WaitSemaphore		(HANDLE a_hSemaphore)			{ WaitForSingleObject(a_hSemaphore, INFINITE); }
+#else
+	static UINT ProcessorCount()
+	{
+		long nCount = sysconf(_SC_NPROCESSORS_ONLN);
+		return (nCount > 0) ? (UINT)nCount : 1;
+	}
+
+	static sem_t* CreateWaitSemaphore(UINT a_nMax)
+	{
+		sem_t* pSemaphore = new sem_t;
+
+		if (sem_init(pSemaphore, 0, 0) != 0)
+		{
+			delete pSemaphore;
+			return NULL;
+		}
+
+		return pSemaphore;
+	}
+
+	static void DestroySemaphore(sem_t* a_pSemaphore)
+	{
+		sem_destroy(a_pSemaphore);
+		delete a_pSemaphore;
+	}
+
+	static void SignalSemaphore(sem_t* a_pSemaphore, UINT a_nCount)
+	{
+		for (UINT i = 0; i < a_nCount; ++i)
+			sem_post(a_pSemaphore);
+	}
+
+	// a signal can interrupt the wait, which just starts it again
+	static void WaitSemaphore(sem_t* a_pSemaphore)
+	{
+		while (sem_wait(a_pSemaphore) != 0)
+			;
+	}
+#endif
+
+	/**
+	*	\brief	Starts the worker threads
+	*	\param	UINT a_nWorkers - number of workers, DEFAULT_WORKERS for one per processor besides the caller
+	*	\note	Does nothing if the pool is already running. With 0 workers every loop runs inline.
+	*/
+
+	void JobSystem::Init(UINT a_nWorkers)
+	{
+		if (s_bStarted)
+			return;
+
+		s_bStarted = TRUE;
+
+		if (a_nWorkers == DEFAULT_WORKERS)
+		{
+			UINT nProcessors = ProcessorCount();
+			a_nWorkers = (nProcessors > 1) ? nProcessors - 1 : 0;
+		}
+
+		if (a_nWorkers > MAX_WORKERS)
+			a_nWorkers = MAX_WORKERS;
+
+		if (a_nWorkers == 0)
+			return;
+
+		s_nQuit = 0;
+		s_hWake = CreateWaitSemaphore(a_nWorkers);
+		s_hDone = CreateWaitSemaphore(1);
+
+		if (!s_hWake || !s_hDone)
+		{
+			OutputDebugString(L"Warning: JobSystem failed to create its semaphores, loops will run inline\n");
+			Shutdown();
+			s_bStarted = TRUE;
+			return;
+		}
+
+		s_pThreads = new Thread[a_nWorkers];
+
+		for (UINT i = 0; i < a_nWorkers; ++i)
+		{
+#if defined(_WIN32)
+			s_pThreads[s_nWorkers] = CreateThread(NULL, 0, WorkerMain, NULL, 0, NULL);
+			BOOL bStarted = (s_pThreads[s_nWorkers] != NULL);
+#else
+			BOOL bStarted = (pthread_create(&s_pThreads[s_nWorkers], NULL, WorkerMain, NULL) == 0);
+#endif
+			if (bStarted)
+				++s_nWorkers;
+		}
+	}
+
+	/**
+	*	\brief	Stops the worker threads and releases their handles
+	*	\pre	No loop is running
+	*	\note	The next ParallelFor() starts the pool again
+	*/
+
+	void JobSystem::Shutdown()
+	{
+		if (s_nWorkers)
+		{
+			InterlockedExchange(&s_nQuit, 1);
+			SignalSemaphore(s_hWake, s_nWorkers);
+
+			for (UINT i = 0; i < s_nWorkers; ++i)
+			{
+#if defined(_WIN32)
+				WaitForSingleObject(s_pThreads[i], INFINITE);
+				CloseHandle(s_pThreads[i]);
+#else
+				pthread_join(s_pThreads[i], NULL);
+#endif
+			}
+		}
+
+		delete [] s_pThreads;
+		s_pThreads = NULL;
+
+		if (s_hWake)
+			DestroySemaphore(s_hWake);
+		if (s_hDone)
+			DestroySemaphore(s_hDone);
+
+		s_hWake = NULL;
+		s_hDone = NULL;
+		s_nWorkers = 0;
+		s_bStarted = FALSE;
+	}
+
+	/**
+	*	\brief	Accessor for the number of worker threads
+	*	\return	UINT - workers running, the thread calling ParallelFor() is not counted
+	*/
+
+	UINT JobSystem::GetNumWorkers()
+	{
+		return s_nWorkers;
+	}
+
+	/**
+	*	\brief	Runs a job over every item of a loop, spread across the calling thread and the workers
+	*	\param	UINT a_nCount - number of items
+	*	\param	UINT a_nGrain - items per range, ranges smaller than this are only made at the end of the loop
+	*	\param	JobFunc a_pFunc - job run on each range
+	*	\param	void* a_pData - data handed to the job
+	*	\post	Every item has been run when this returns
+	*/
+
+	void JobSystem::ParallelFor(UINT a_nCount, UINT a_nGrain, JobFunc a_pFunc, void* a_pData)
+	{
+		if (a_nCount == 0 || !a_pFunc)
+			return;
+
+		if (a_nGrain == 0)
+			a_nGrain = 1;
+
+		if (!s_bStarted)
+			Init();
+
+		// small loops, loops started from a job and loops from a second thread run inline
+		if (s_nWorkers == 0 || a_nCount <= a_nGrain || InterlockedExchange(&s_nBusy, 1) != 0)
+		{
+			a_pFunc(a_pData, 0, a_nCount);
+			return;
+		}
+
+		s_pFunc = a_pFunc;
+		s_pData = a_pData;
+		s_nCount = a_nCount;
+		s_nGrain = a_nGrain;
+		s_nNext = 0;
+
+		// only wake as many workers as there are ranges for besides the one this thread takes
+		UINT nRanges = (a_nCount + a_nGrain - 1) / a_nGrain;
+		UINT nHelpers = (nRanges - 1 < s_nWorkers) ? nRanges - 1 : s_nWorkers;
+
+		InterlockedExchange(&s_nActive, (LONG)nHelpers + 1);
+		SignalSemaphore(s_hWake, nHelpers);
+
+		RunRanges();
+
+		if (InterlockedDecrement(&s_nActive) != 0)
+			WaitSemaphore(s_hDone);
+
+		InterlockedExchange(&s_nBusy, 0);
+	}
+
+	/**
+	*	\brief	Claims and runs ranges of the current loop until there are none left
+	*/
+
+	void JobSystem::RunRanges()
+	{
+		for (;;)
+		{
+			UINT nBegin = (UINT)InterlockedExchangeAdd(&s_nNext, (LONG)s_nGrain);
+
+			if (nBegin >= s_nCount)
+				break;
+
+			UINT nEnd = (s_nCount - nBegin > s_nGrain) ? nBegin + s_nGrain : s_nCount;
+			s_pFunc(s_pData, nBegin, nEnd);
+		}
+	}
+
+	/**
+	*	\brief	Body of every worker thread, sleeps until a loop needs it and then helps run its ranges
+	*/
+
+	void JobSystem::WorkerLoop()
+	{
+		for (;;)
+		{
+			WaitSemaphore(s_hWake);
+
+			if (s_nQuit)
+				break;
+
+			RunRanges();
+
+			// the last thread out lets the caller return
+			if (InterlockedDecrement(&s_nActive) == 0)
+				SignalSemaphore(s_hDone, 1);
+		}
+	}
+
+	/**
+	*	\brief	Entry point of the worker threads
+	*	\param	LPVOID a_pParam - unused
+	*	\return	DWORD - 0
+	*/
+
+#if defined(_WIN32)
+	DWORD WINAPI JobSystem::WorkerMain(LPVOID a_pParam)
+	{
+		WorkerLoop();
+		return 0;
+	}
+#else
+	void* JobSystem::WorkerMain(void* a_pParam)
+	{
+		WorkerLoop();
+		return NULL;
+	}
+#endif
+}
@@ -0,0 +1,104 @@
+/**
+*	\class		SGLib::JobSystem
+*	\brief		Small pool of worker threads that split loops over ranges of items
+*	\date		19/10/26
+*	\version	1.0
+*
+*	ParallelFor() cuts a loop of a_nCount items into ranges of a_nGrain items and runs a_pFunc on each
+*	range. The calling thread works through ranges alongside the workers and only returns once every
+*	range has finished, so the data handed to the job can live on the caller's stack.
+*
+*	Ranges are claimed with an interlocked add on a shared counter, so fast threads simply take more of
+*	them and no range is run twice. The job must only write to the items of the range it is given.
+*
+*	There is one pool shared by the whole library. If it is already running a loop (including a
+*	ParallelFor() made from inside a job) or the loop fits in a single range, the loop runs inline on
+*	the calling thread. The pool is started by the first ParallelFor() or by Init(), with one worker
+*	per processor besides the calling thread, and should be stopped with Shutdown() before exiting.
+*
+*	Jobs that have to share something (a cache, a counter) can guard it with an SGLib::SpinLock, which
+*	is meant for sections a few instructions long.
+*
+*	The workers are Win32 threads on Windows and POSIX threads elsewhere, nothing here needs DirectX.
+*/
+
+#ifndef SGLIB_JOBSYSTEM
+#define SGLIB_JOBSYSTEM
+
+#pragma once
+
+#include "SGPlatform.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+namespace SGLib
+{
+	// lock for short sections shared between jobs, a waiting thread gives up its time slice while it spins
+	class SpinLock
+	{
+	public:
+		SpinLock() : m_nLocked(0) {}
+
+		void	Lock()		{ while (InterlockedExchange(&m_nLocked, 1) != 0) Sleep(0); }
+		void	Unlock()	{ InterlockedExchange(&m_nLocked, 0); }
+
+	private:
+		volatile LONG	m_nLocked;	///< 1 while held
+	};
+
+	class JobSystem
+	{
+	public:
+		// runs the items a_nBegin up to (not including) a_nEnd of a loop
+		typedef void (*JobFunc)(void* a_pData, UINT a_nBegin, UINT a_nEnd);
+
+		static const UINT DEFAULT_WORKERS = 0xFFFFFFFF;	///< one worker per processor besides the caller
+
+		static void		Init			(UINT a_nWorkers = DEFAULT_WORKERS);
+		static void		Shutdown		();
+		static UINT		GetNumWorkers	();
+
+		static void		ParallelFor		(UINT a_nCount, UINT a_nGrain, JobFunc a_pFunc, void* a_pData);
+
+	private:
+#if defined(_WIN32)
+		typedef HANDLE			Thread;
+		typedef HANDLE			Semaphore;
+#else
+		typedef pthread_t		Thread;
+		typedef sem_t*			Semaphore;
+#endif
+
+		static Thread*			s_pThreads;		///< worker threads
+		static UINT				s_nWorkers;		///< number of worker threads
+		static BOOL				s_bStarted;		///< TRUE once Init() has run
+		static Semaphore		s_hWake;		///< released once per worker needed by a loop
+		static Semaphore		s_hDone;		///< released when the last thread working on a loop finishes
+		static volatile LONG	s_nBusy;		///< 1 while a loop owns the pool
+		static volatile LONG	s_nQuit;		///< 1 when the workers should exit
+		static volatile LONG	s_nNext;		///< first item of the next range to claim
+		static volatile LONG	s_nActive;		///< threads yet to finish the current loop
+
+		// current loop
+		static JobFunc			s_pFunc;		///< job run on each range
+		static void*			s_pData;		///< data handed to the job
+		static UINT				s_nCount;		///< number of items
+		static UINT				s_nGrain;		///< items per range
+
+		static void		RunRanges		();
+		static void		WorkerLoop		();
+
+#if defined(_WIN32)
+		static DWORD WINAPI	WorkerMain	(LPVOID a_pParam);
+#else
+		static void*	WorkerMain		(void* a_pParam);
+#endif
+
+		JobSystem();
+	};
+}
+
+#endif
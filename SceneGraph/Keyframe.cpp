@@ -0,0 +1,240 @@
+#include "Keyframe.h"
+#include <limits>
+
+#if defined(SGLIB_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace SGLib
+{
+	/**
+	*	\brief	Calculates how far a time lies between two keys
+	*	\param	const TimeStep& a_rPrev - key at or before a_fTime
+	*	\param	const TimeStep& a_rNext - key after a_rPrev
+	*	\param	FLOAT a_fTime - time being sampled
+	*	\return	FLOAT - interpolation weight, 0 at a_rPrev and 1 at a_rNext
+	*/
+
+	static FLOAT KeyWeight(const TimeStep& a_rPrev, const TimeStep& a_rNext, FLOAT a_fTime)
+	{
+		FLOAT fSpan = a_rNext.m_fTime - a_rPrev.m_fTime;
+
+		// prevent possible divide by zero error
+		if (fabs(fSpan) > std::numeric_limits<float>::epsilon())
+			return (a_fTime - a_rPrev.m_fTime) / fSpan;
+		else
+			return 1.0f;
+	}
+
+	/**
+	*	\brief	Samples a track of keys at a time
+	*	\param	const TimeStep* a_pKeys - keys sorted by time
+	*	\param	UINT a_nKeys - number of keys, must be greater than 0
+	*	\param	FLOAT a_fTime - time to sample
+	*	\param	UINT& a_rnKey - cursor into a_pKeys, used as the starting point of the search and
+	*						   updated to the key found
+	*	\return	FLOAT - angle interpolated between the keys either side of a_fTime, the first or last angle
+	*			if a_fTime is outside the track
+	*/
+
+	FLOAT SampleKeys(const TimeStep* a_pKeys, UINT a_nKeys, FLOAT a_fTime, UINT& a_rnKey)
+	{
+		a_rnKey = FindKey(a_pKeys, a_nKeys, a_fTime, a_rnKey);
+
+		const TimeStep& rPrev = a_pKeys[a_rnKey];
+
+		// before the first key or past the last
+		if (a_rnKey + 1 >= a_nKeys || a_fTime <= rPrev.m_fTime)
+			return rPrev.m_fAngle;
+
+		const TimeStep& rNext = a_pKeys[a_rnKey + 1];
+
+		return rPrev.m_fAngle + (rNext.m_fAngle - rPrev.m_fAngle) * KeyWeight(rPrev, rNext, a_fTime);
+	}
+
+	/**
+	*	\brief	Decodes the times of every key in a block of a compressed curve
+	*	\param	FLOAT* a_pTimes - receives CURVE_BLOCK_KEYS times, unused keys repeat the last used one
+	*	\param	const CurveBlock& a_rBlock - block to decode
+	*	\note	The SIMD and scalar paths give identical results
+	*/
+
+	void DecodeCurveTimes(FLOAT* a_pTimes, const CurveBlock& a_rBlock)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		// widen the eight deltas to 16 bits and prefix sum them, at most 8 * 255 so they can't overflow
+		__m128i xZero = _mm_setzero_si128();
+		__m128i xSteps = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a_rBlock.m_aDelta)), xZero);
+
+		xSteps = _mm_add_epi16(xSteps, _mm_slli_si128(xSteps, 2));
+		xSteps = _mm_add_epi16(xSteps, _mm_slli_si128(xSteps, 4));
+		xSteps = _mm_add_epi16(xSteps, _mm_slli_si128(xSteps, 8));
+
+		__m128 xTick = _mm_set1_ps(a_rBlock.m_fTick);
+		__m128 xTime = _mm_set1_ps(a_rBlock.m_fTime);
+
+		__m128 xLo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(xSteps, xZero));
+		__m128 xHi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(xSteps, xZero));
+
+		_mm_storeu_ps(a_pTimes, _mm_add_ps(xTime, _mm_mul_ps(xLo, xTick)));
+		_mm_storeu_ps(a_pTimes + 4, _mm_add_ps(xTime, _mm_mul_ps(xHi, xTick)));
+#else
+		UINT nSteps = 0;
+
+		for (UINT i = 0; i < CURVE_BLOCK_KEYS; ++i)
+		{
+			nSteps += a_rBlock.m_aDelta[i];
+			a_pTimes[i] = a_rBlock.m_fTime + (FLOAT)nSteps * a_rBlock.m_fTick;
+		}
+#endif
+	}
+
+	/**
+	*	\brief	Decodes one angle of a compressed curve
+	*	\param	const Curve& a_rCurve - curve the angle belongs to
+	*	\param	const CurveBlock* a_pBlocks - block array the curve indexes
+	*	\param	UINT a_nKey - index of the key within the curve
+	*	\return	FLOAT - angle of the key
+	*/
+
+	static FLOAT CurveAngle(const Curve& a_rCurve, const CurveBlock* a_pBlocks, UINT a_nKey)
+	{
+		const CurveBlock& rBlock = a_pBlocks[a_rCurve.m_nFirstBlock + a_nKey / CURVE_BLOCK_KEYS];
+
+		return a_rCurve.m_fMin + (FLOAT)rBlock.m_aAngle[a_nKey % CURVE_BLOCK_KEYS] * a_rCurve.m_fScale;
+	}
+
+	/**
+	*	\brief	Finds the last key of a compressed curve at or before a time
+	*	\param	const Curve& a_rCurve - curve to search, must have at least one key
+	*	\param	const CurveBlock* a_pBlocks - block array the curve indexes
+	*	\param	FLOAT a_fTime - time to search for
+	*	\param	UINT a_nHint - key returned by the previous search of this curve
+	*	\param	FLOAT& a_rfWeight - receives how far a_fTime lies towards the next key, 0 if there is none
+	*	\return	UINT - index of the key, 0 if a_fTime is before the first key
+	*/
+
+	static UINT FindCurveKey(const Curve& a_rCurve, const CurveBlock* a_pBlocks, FLOAT a_fTime, UINT a_nHint, FLOAT& a_rfWeight)
+	{
+		const CurveBlock* pBlocks = a_pBlocks + a_rCurve.m_nFirstBlock;
+		UINT nBlocks = (a_rCurve.m_nKeys + CURVE_BLOCK_KEYS - 1) / CURVE_BLOCK_KEYS;
+
+		// the first key of every block is stored exactly so the blocks are searched like keys
+		UINT nBlock = FindKey(pBlocks, nBlocks, a_fTime, a_nHint / CURVE_BLOCK_KEYS);
+		UINT nFirst = nBlock * CURVE_BLOCK_KEYS;
+		UINT nCount = a_rCurve.m_nKeys - nFirst;
+
+		if (nCount > CURVE_BLOCK_KEYS)
+			nCount = CURVE_BLOCK_KEYS;
+
+		FLOAT aTimes[CURVE_BLOCK_KEYS];
+		DecodeCurveTimes(aTimes, pBlocks[nBlock]);
+
+		UINT nKey = 0;
+		while (nKey + 1 < nCount && aTimes[nKey + 1] <= a_fTime)
+			++nKey;
+
+		a_rfWeight = 0.0f;
+
+		// before the first key or past the last
+		if (nFirst + nKey + 1 >= a_rCurve.m_nKeys || a_fTime <= aTimes[nKey])
+			return nFirst + nKey;
+
+		FLOAT fNext = (nKey + 1 < nCount) ? aTimes[nKey + 1] : pBlocks[nBlock + 1].m_fTime;
+		FLOAT fSpan = fNext - aTimes[nKey];
+
+		// prevent possible divide by zero error
+		if (fabs(fSpan) > std::numeric_limits<float>::epsilon())
+			a_rfWeight = (a_fTime - aTimes[nKey]) / fSpan;
+		else
+			a_rfWeight = 1.0f;
+
+		return nFirst + nKey;
+	}
+
+	/**
+	*	\brief	Samples a compressed curve at a time
+	*	\param	const Curve& a_rCurve - curve to sample, must have at least one key
+	*	\param	const CurveBlock* a_pBlocks - block array the curve indexes
+	*	\param	FLOAT a_fTime - time to sample
+	*	\param	UINT& a_rnKey - cursor into the curve, used as the starting point of the search and
+	*						   updated to the key found
+	*	\return	FLOAT - angle interpolated between the keys either side of a_fTime, the first or last angle
+	*			if a_fTime is outside the curve
+	*/
+
+	FLOAT SampleCurve(const Curve& a_rCurve, const CurveBlock* a_pBlocks, FLOAT a_fTime, UINT& a_rnKey)
+	{
+		FLOAT fWeight;
+		UINT nKey = a_rnKey = FindCurveKey(a_rCurve, a_pBlocks, a_fTime, a_rnKey, fWeight);
+
+		FLOAT fPrev = CurveAngle(a_rCurve, a_pBlocks, nKey);
+
+		if (fWeight == 0.0f)
+			return fPrev;
+
+		return fPrev + (CurveAngle(a_rCurve, a_pBlocks, nKey + 1) - fPrev) * fWeight;
+	}
+
+	/**
+	*	\brief	Samples two compressed curves that have keys at the same times with a single search
+	*	\param	const Curve& a_rCurveA - first curve, must have at least one key
+	*	\param	const Curve& a_rCurveB - second curve, same key times as a_rCurveA
+	*	\param	const CurveBlock* a_pBlocks - block array both curves index
+	*	\param	FLOAT a_fTime - time to sample
+	*	\param	UINT& a_rnKey - cursor shared by both curves
+	*	\param	FLOAT& a_rfA - receives the angle of the first curve
+	*	\param	FLOAT& a_rfB - receives the angle of the second curve
+	*/
+
+	void SampleCurvePair(const Curve& a_rCurveA, const Curve& a_rCurveB, const CurveBlock* a_pBlocks, FLOAT a_fTime,
+						 UINT& a_rnKey, FLOAT& a_rfA, FLOAT& a_rfB)
+	{
+		// one weight serves both curves
+		FLOAT fWeight;
+		UINT nKey = a_rnKey = FindCurveKey(a_rCurveA, a_pBlocks, a_fTime, a_rnKey, fWeight);
+
+		a_rfA = CurveAngle(a_rCurveA, a_pBlocks, nKey);
+		a_rfB = CurveAngle(a_rCurveB, a_pBlocks, nKey);
+
+		if (fWeight == 0.0f)
+			return;
+
+		a_rfA += (CurveAngle(a_rCurveA, a_pBlocks, nKey + 1) - a_rfA) * fWeight;
+		a_rfB += (CurveAngle(a_rCurveB, a_pBlocks, nKey + 1) - a_rfB) * fWeight;
+	}
+
+	/**
+	*	\brief	Checks whether the rotation and twist tracks have keys at the same times
+	*	\return	BOOL - TRUE if both tracks are the same non zero length with matching key times
+	*/
+
+	BOOL AnimContainer::HasSharedTimes() const
+	{
+		if (m_vecRot.size() != m_vecTwist.size() || m_vecRot.empty())
+			return FALSE;
+
+		for (UINT i = 0; i < m_vecRot.size(); ++i)
+			if (m_vecRot[i].m_fTime != m_vecTwist[i].m_fTime)
+				return FALSE;
+
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Calculates the length of the animation
+	*	\return	FLOAT - time of the last key in either track
+	*/
+
+	FLOAT AnimContainer::GetLength() const
+	{
+		FLOAT fLength = 0.0f;
+
+		if (!m_vecRot.empty())
+			fLength = m_vecRot.back().m_fTime;
+		if (!m_vecTwist.empty() && m_vecTwist.back().m_fTime > fLength)
+			fLength = m_vecTwist.back().m_fTime;
+
+		return fLength;
+	}
+}
@@ -0,0 +1,198 @@
+/**
+*	\file		Keyframe.h
+*	\brief		Keyframe tracks used by SGLib::Articulated and the search used to sample them
+*	\date		19/10/26
+*	\version	1.0
+*
+*	A track is a vector of keys sorted by time. Sampling a track at a time means finding the last key
+*	at or before that time and interpolating towards the one after it. FindKey() does the search
+*	starting from the key found by the previous sample (the cursor):
+*
+*		- during normal playback the answer is the cursor or the key after it, which costs one or two
+*		  comparisons
+*		- otherwise it gallops away from the cursor in steps of 1, 2, 4, ... keys in whichever direction
+*		  the time lies and then binary searches the last step
+*
+*	so a sample costs O(1) amortised while playing forwards or backwards and O(log n) when seeking
+*	anywhere in the clip, with no need to rescan from the start after looping or scrubbing.
+*
+*	SGLib::AnimContainer holds the rotation and twist tracks of one animation while it is being authored.
+*	Once added to a node the keys are compressed into a SGLib::Curve and stored in SGLib::AnimLibrary.
+*	A curve keeps its keys in blocks of CURVE_BLOCK_KEYS:
+*
+*		- the time of the first key as a float, the others as 8 bit deltas from the key before in
+*		  steps of the block's tick, so the blocks themselves are searched with FindKey()
+*		- every angle as 16 bits spread between the smallest and largest angle of the curve
+*
+*	which is 4 bytes a key instead of 8. SampleCurve() decodes the times of the block it lands in with
+*	SIMD and only the two angles it needs.
+*
+*	A block may end early by repeating its last key, with a delta of 0, when the gap to the next key
+*	is far wider than the ones before it.
+*/
+
+#ifndef SGLIB_KEYFRAME
+#define SGLIB_KEYFRAME
+
+#pragma once
+
+#include "SGMath.h"
+#include <vector>
+
+namespace SGLib
+{
+	// identifies a time and angle used for animation
+	struct TimeStep
+	{
+		FLOAT m_fTime;
+		FLOAT m_fAngle;
+
+		TimeStep(FLOAT a_fTime, FLOAT a_fAngle) : m_fAngle(a_fAngle)
+		{
+			// don't allow m_fTime to be less than zero
+			m_fTime = (a_fTime < 0.0f) ?  0.0f : a_fTime;
+		}
+	};
+
+	// position of a sampler within the tracks of an animation clip, kept between samples
+	struct AnimCursor
+	{
+		UINT m_nRotKey;		///< key at or before the last time sampled in the rotation track
+		UINT m_nTwistKey;	///< key at or before the last time sampled in the twist track
+
+		AnimCursor() : m_nRotKey(0), m_nTwistKey(0) {}
+
+		void Reset() { m_nRotKey = m_nTwistKey = 0; }
+	};
+
+	/**
+	*	\brief	Finds the last key at or before a time
+	*	\param	const Key* a_pKeys - keys sorted by their m_fTime member
+	*	\param	UINT a_nKeys - number of keys, must be greater than 0
+	*	\param	FLOAT a_fTime - time to search for
+	*	\param	UINT a_nHint - key returned by the previous search of this track
+	*	\return	UINT - index of the key, 0 if a_fTime is before the first key
+	*	\note	Gallops from a_nHint towards a_fTime then binary searches, see the file description
+	*/
+
+	template <class Key>
+	UINT FindKey(const Key* a_pKeys, UINT a_nKeys, FLOAT a_fTime, UINT a_nHint)
+	{
+		UINT nLast = a_nKeys - 1;
+		UINT nLo, nHi, nStep = 1;
+
+		if (a_nHint > nLast)
+			a_nHint = nLast;
+
+		if (a_pKeys[a_nHint].m_fTime <= a_fTime)
+		{
+			// moving forwards, usually still within the same key or into the next one
+			if (a_nHint == nLast || a_fTime < a_pKeys[a_nHint + 1].m_fTime)
+				return a_nHint;
+
+			// gallop forwards until a key after a_fTime is found, a_nKeys stands in for the end
+			nLo = a_nHint + 1;
+			for (;;)
+			{
+				nHi = nLo + nStep;
+				if (nHi > nLast)
+				{
+					nHi = a_nKeys;
+					break;
+				}
+				if (a_fTime < a_pKeys[nHi].m_fTime)
+					break;
+
+				nLo = nHi;
+				nStep <<= 1;
+			}
+		}
+		else
+		{
+			// moving backwards, gallop until a key at or before a_fTime is found
+			nHi = a_nHint;
+			for (;;)
+			{
+				if (nStep > nHi)
+				{
+					nLo = 0;
+					break;
+				}
+
+				nLo = nHi - nStep;
+				if (a_pKeys[nLo].m_fTime <= a_fTime)
+					break;
+
+				nHi = nLo;
+				nStep <<= 1;
+			}
+
+			// before the first key
+			if (a_fTime < a_pKeys[nLo].m_fTime)
+				return 0;
+		}
+
+		// a_pKeys[nLo] is at or before a_fTime and a_pKeys[nHi] after it
+		while (nHi - nLo > 1)
+		{
+			UINT nMid = nLo + ((nHi - nLo) >> 1);
+
+			if (a_pKeys[nMid].m_fTime <= a_fTime)
+				nLo = nMid;
+			else
+				nHi = nMid;
+		}
+
+		return nLo;
+	}
+
+	FLOAT	SampleKeys		(const TimeStep* a_pKeys, UINT a_nKeys, FLOAT a_fTime, UINT& a_rnKey);
+
+	const UINT CURVE_BLOCK_KEYS = 8;	///< keys in each block of a compressed curve, DecodeCurveTimes() relies on it being 8
+
+	// CURVE_BLOCK_KEYS consecutive keys of a compressed curve
+	struct CurveBlock
+	{
+		FLOAT			m_fTime;					///< time of the first key
+		FLOAT			m_fTick;					///< time of one delta step
+		unsigned char	m_aDelta[CURVE_BLOCK_KEYS];	///< steps from the key before, the first is always 0
+		unsigned short	m_aAngle[CURVE_BLOCK_KEYS];	///< angles quantized between the curve's minimum and maximum
+	};
+
+	// range of blocks holding the keys of one compressed track
+	struct Curve
+	{
+		UINT	m_nFirstBlock;	///< index of the first block
+		UINT	m_nKeys;		///< number of keys including repeats, the last block may be partly used
+		FLOAT	m_fMin;			///< angle a quantized 0 stands for
+		FLOAT	m_fScale;		///< angle of one quantization step
+	};
+
+	void	DecodeCurveTimes	(FLOAT* a_pTimes, const CurveBlock& a_rBlock);
+	FLOAT	SampleCurve			(const Curve& a_rCurve, const CurveBlock* a_pBlocks, FLOAT a_fTime, UINT& a_rnKey);
+	void	SampleCurvePair		(const Curve& a_rCurveA, const Curve& a_rCurveB, const CurveBlock* a_pBlocks, FLOAT a_fTime,
+								 UINT& a_rnKey, FLOAT& a_rfA, FLOAT& a_rfB);
+
+	// encapsulates the rotation and twist keys of one animation
+	struct AnimContainer
+	{
+		std::vector<TimeStep> m_vecRot;
+		std::vector<TimeStep> m_vecTwist;
+
+		AnimContainer(){}
+
+		AnimContainer(	const std::vector<TimeStep>& a_pvecRot,
+						const std::vector<TimeStep>& a_pvecTwist) :
+						m_vecRot(a_pvecRot),
+						m_vecTwist(a_pvecTwist)
+		{}
+
+		std::vector<TimeStep>& GetVecRot(){return m_vecRot;}
+		std::vector<TimeStep>& GetVecTwist(){return m_vecTwist;}
+
+		BOOL	HasSharedTimes() const;
+		FLOAT	GetLength() const;
+	};
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include "MappedRing.h"
+
+namespace SGLib
+{
+	/**
+	*	\brief	MappedRing constructor
+	*	\param	UINT a_nBytes - size of the memory behind the ring
+	*/
+
+	MappedRing::MappedRing(UINT a_nBytes) :	m_oRing(a_nBytes),
+											m_pData(NULL),
+											m_nLocks(0),
+											m_nLastLocks(0)
+	{
+	}
+
+	/**
+	*	\brief	MappedRing destructor
+	*	\note	Derived classes Flush() in their own destructor, while Unmap() can still reach them
+	*/
+
+	MappedRing::~MappedRing()
+	{
+	}
+
+	/**
+	*	\brief	Starts a new frame of allocations
+	*	\note	Call once a frame before the first Allocate(), the ring may wrap early so the frame fits
+	*/
+
+	void MappedRing::BeginFrame()
+	{
+		m_oRing.BeginFrame();
+
+		m_nLastLocks = m_nLocks;
+		m_nLocks = 0;
+	}
+
+	/**
+	*	\brief	Allocates a range of the ring and returns where to write it
+	*	\param	UINT a_nSize - bytes wanted
+	*	\param	UINT a_nStride - vertex size, the offset is a multiple of it
+	*	\param	UINT* a_pnOffset - receives the offset of the range in bytes
+	*	\param	UINT* a_pnGeneration - receives the generation to check the range with IsValid(), may be NULL
+	*	\return	BYTE* - where to write the range, NULL if it is larger than the ring or the memory could
+	*			not be mapped
+	*	\note	Maps the memory if it isn't already, Flush() before reading from it. A wrap unmaps the
+	*			memory first, so the pointers returned before it must not be written any more.
+	*/
+
+	BYTE* MappedRing::Allocate(UINT a_nSize, UINT a_nStride, UINT* a_pnOffset, UINT* a_pnGeneration)
+	{
+		if (!HasMemory())
+			return NULL;
+
+		RingAllocator::Result eResult = m_oRing.Allocate(a_nSize, a_nStride, a_pnOffset);
+
+		if (eResult == RingAllocator::RING_FAILED)
+			return NULL;
+
+		// the ranges written under the old mapping are read from the memory being discarded
+		if (eResult == RingAllocator::RING_WRAP && m_pData)
+			Flush();
+
+		if (!m_pData)
+		{
+			m_pData = Map(eResult == RingAllocator::RING_WRAP);
+
+			if (!m_pData)
+				return NULL;
+
+			++m_nLocks;
+		}
+
+		if (a_pnGeneration)
+			*a_pnGeneration = m_oRing.GetGeneration();
+
+		return m_pData + *a_pnOffset;
+	}
+
+	/**
+	*	\brief	Whether allocating a range would wrap the ring, and so unmap it
+	*	\param	UINT a_nSize - bytes that would be allocated
+	*	\param	UINT a_nStride - the stride they would be allocated with
+	*	\return	BOOL - TRUE if the pointers handed out so far must be written before allocating them
+	*/
+
+	BOOL MappedRing::WillWrap(UINT a_nSize, UINT a_nStride) const
+	{
+		return m_oRing.WillWrap(a_nSize, a_nStride);
+	}
+
+	/**
+	*	\brief	Unmaps the memory so what has been written can be read
+	*/
+
+	void MappedRing::Flush()
+	{
+		if (m_pData)
+		{
+			Unmap();
+			m_pData = NULL;
+		}
+	}
+
+	/**
+	*	\brief	Whether a range is still intact
+	*	\param	UINT a_nGeneration - generation returned when the range was allocated
+	*	\return	BOOL - TRUE if the range can still be read without writing it again
+	*/
+
+	BOOL MappedRing::IsValid(UINT a_nGeneration) const
+	{
+		return HasMemory() && m_oRing.IsValid(a_nGeneration);
+	}
+
+	/**
+	*	\brief	Accessor for the size of the ring
+	*	\return	UINT - size in bytes
+	*/
+
+	UINT MappedRing::GetCapacity() const
+	{
+		return m_oRing.GetCapacity();
+	}
+
+	/**
+	*	\brief	Accessor for the number of mappings in the last frame
+	*	\return	UINT - mappings between the last two BeginFrame() calls
+	*/
+
+	UINT MappedRing::GetNumLocks() const
+	{
+		return m_nLastLocks;
+	}
+
+	/**
+	*	\brief	Accessor for the allocator
+	*	\return	const RingAllocator& - allocator placing the ranges, for its frame statistics
+	*/
+
+	const RingAllocator& MappedRing::GetAllocator() const
+	{
+		return m_oRing;
+	}
+}
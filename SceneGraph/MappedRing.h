@@ -0,0 +1,59 @@
+/**
+*	\class		SGLib::MappedRing
+*	\brief		A ring of memory that ranges are written into while it is mapped, without a device
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Holds the SGLib::RingAllocator and the mapping of the memory behind it, leaving derived classes to
+*	say how the memory is mapped. SGLib::DynamicRing maps a dynamic vertex buffer. The memory is mapped
+*	by the first Allocate() after a Flush() and stays mapped while further ranges are handed out:
+*
+*		- without discarding while the ring is appending, as nothing reads the ranges after the head
+*		- discarding when the ring wraps, which ends the mapping before it
+*
+*	A wrap therefore leaves every pointer handed out before it pointing at memory that is no longer
+*	mapped. Callers that hold on to pointers while allocating more, such as SGLib::RingUpload, must
+*	finish writing them before an allocation that WillWrap().
+*/
+
+#ifndef SGLIB_MAPPEDRING
+#define SGLIB_MAPPEDRING
+
+#pragma once
+
+#include "RingAllocator.h"
+
+namespace SGLib
+{
+	class MappedRing
+	{
+	public:
+		MappedRing(UINT a_nBytes);
+		virtual ~MappedRing();
+
+	protected:
+		RingAllocator			m_oRing;		///< where each range goes
+		BYTE*					m_pData;		///< mapped memory, NULL when unmapped
+		UINT					m_nLocks;		///< mappings since BeginFrame()
+		UINT					m_nLastLocks;	///< mappings in the previous frame
+
+	public:
+		void		BeginFrame		();
+		BYTE*		Allocate		(UINT a_nSize, UINT a_nStride, UINT* a_pnOffset, UINT* a_pnGeneration);
+		BOOL		WillWrap		(UINT a_nSize, UINT a_nStride) const;
+		void		Flush			();
+		BOOL		IsValid			(UINT a_nGeneration) const;
+
+		UINT		GetCapacity		() const;
+		UINT		GetNumLocks		() const;
+		const RingAllocator&	GetAllocator() const;
+
+	protected:
+		// the memory behind the ring, override all three
+		virtual BOOL	HasMemory		() const = 0;
+		virtual BYTE*	Map				(BOOL a_bDiscard) = 0;
+		virtual void	Unmap			() = 0;
+	};
+}
+
+#endif
@@ -2,6 +2,8 @@
 
 namespace SGLib
 {
+	UINT Node::s_nRatePhase = 0;
+
 	/**
 	*	\brief	Node constructor
 	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
@@ -10,7 +12,15 @@ namespace SGLib
 	Node::Node(LPDIRECT3DDEVICE9 a_pD3DDevice) :	m_pD3DDevice(a_pD3DDevice), 
 													m_pSibling(NULL), 
 													m_pChild(NULL), 
-													m_sDescription(NULL)
+													m_sDescription(NULL),
+													m_bStatic(FALSE),
+													m_pParent(NULL),
+													m_bAwake(TRUE),
+													m_bAwakeBelow(FALSE),
+													m_bMoved(FALSE),
+													m_enUpdateRate(UPDATE_EVERY_FRAME),
+													m_nRateFrames(0),
+													m_fRateTime(0.0f)
 	{
 	}
 
@@ -21,6 +31,12 @@ namespace SGLib
 
 	Node::~Node(void)
 	{
+		// children must not wake through a deleted parent
+		for (Node* pNode = m_pChild; pNode; pNode = pNode->m_pSibling)
+		{
+			if (pNode->m_pParent == this)
+				pNode->m_pParent = NULL;
+		}
 	}
 
 	/**
@@ -39,6 +55,9 @@ namespace SGLib
 
 		m_pChild = a_pChild;
 
+		SetParent(pTempNode, NULL);
+		SetParent(m_pChild, this);
+
 		return pTempNode;
 	}
 
@@ -58,6 +77,9 @@ namespace SGLib
 
 		m_pSibling = a_pSibling;
 
+		SetParent(pTempNode, NULL);
+		SetParent(m_pSibling, m_pParent);
+
 		return pTempNode;
 	}
 
@@ -110,6 +132,7 @@ namespace SGLib
 		if (!m_pChild)
 		{
 			m_pChild = a_pChild;
+			SetParent(m_pChild, this);
 			return;
 		}
 
@@ -128,6 +151,7 @@ namespace SGLib
 
 		// set new child
 		m_pChild = a_pChild;
+		SetParent(m_pChild, this);
 	}
 
 	/**
@@ -145,6 +169,7 @@ namespace SGLib
 		if (!m_pSibling)
 		{
 			m_pSibling = a_pSibling;
+			SetParent(m_pSibling, m_pParent);
 			return;
 		}
 
@@ -163,6 +188,7 @@ namespace SGLib
 
 		// set new sibling
 		m_pSibling = a_pSibling;
+		SetParent(m_pSibling, m_pParent);
 	}
 
 	/**
@@ -183,6 +209,9 @@ namespace SGLib
 		
 		// set new child
 		m_pChild = pNodeChildChild;
+
+		SetParent(pTempChild, NULL);
+		SetParent(m_pChild, this);
 		
 		return pTempChild;
 	}
@@ -206,6 +235,9 @@ namespace SGLib
 		// set new sibling
 		m_pSibling = pNodeSiblingSibling;
 
+		SetParent(pTempSibling, NULL);
+		SetParent(m_pSibling, m_pParent);
+
 		return pTempSibling;
 	}
 
@@ -302,6 +334,128 @@ namespace SGLib
 		m_pD3DDevice = a_pD3DDevice;
 	}
 
+	/**
+	*	\brief	Bakes the world matrices of this node and its child hierarchy and marks them all as static
+	*	\param	const Matrix& a_rMatrixWorld - world matrix this node sits under (identity for the root)
+	*	\note	Static nodes are skipped by SGLib::SGRenderer::UpdateNode() so they must not be animating. This
+	*			node's siblings are not touched. Call Unfreeze() before editing anything in the hierarchy.
+	*/
+
+	void Node::Freeze(const Matrix& a_rMatrixWorld)
+	{
+		Bake(AffineMatrix(a_rMatrixWorld));
+	}
+
+	/**
+	*	\brief	Returns this node and its child hierarchy to the per-frame update pass
+	*/
+
+	void Node::Unfreeze()
+	{
+		m_bStatic = FALSE;
+		Wake();
+
+		for (Node* pNode = m_pChild; pNode; pNode = pNode->GetSibling())
+			pNode->Unfreeze();
+	}
+
+	/**
+	*	\brief	Marks this node static and bakes its child hierarchy with the world matrix this node 
+	*			would have set during Update()
+	*	\param	const AffineMatrix& a_rMatrixParent - world matrix set when this node is reached
+	*/
+
+	void Node::Bake(const AffineMatrix& a_rMatrixParent)
+	{
+		AffineMatrix matChild;
+
+		m_bStatic = TRUE;
+
+		CalculateChildWorld(a_rMatrixParent, matChild);
+
+		// child and all of its siblings are updated under the same world matrix
+		for (Node* pNode = m_pChild; pNode; pNode = pNode->GetSibling())
+			pNode->Bake(matChild);
+	}
+
+	/**
+	*	\brief	Puts this node back into the update pass
+	*	\note	Called by anything that gives a sleeping node work to do. Marks every node on the path down
+	*			from the root so the renderer finds this one. Several threads may wake nodes at once as
+	*			the flags are only ever set here, never cleared.
+	*/
+
+	void Node::Wake()
+	{
+		m_bAwake = TRUE;
+		WakeParent();
+	}
+
+	/**
+	*	\brief	Sets how often this node and its child hierarchy are updated
+	*	\param	UpdateRate a_enUpdateRate - frames between updates
+	*	\note	Nodes given the same rate are started on different frames so their updates are spread out.
+	*			Updates other than every frame are held back while the renderer's update budget is spent.
+	*/
+
+	void Node::SetUpdateRate(UpdateRate a_enUpdateRate)
+	{
+		m_enUpdateRate = a_enUpdateRate;
+		m_nRateFrames = s_nRatePhase++ % (UINT)a_enUpdateRate;
+	}
+
+	/**
+	*	\brief	Takes this node out of the update pass until Wake() is called
+	*	\note	Call from Update() once the node has nothing left to do. It is still updated while it is
+	*			on the path to an awake node or its parent moves. Not named Sleep() as that would hide the
+	*			Win32 function from every derived class.
+	*/
+
+	void Node::GoToSleep()
+	{
+		m_bAwake = FALSE;
+	}
+
+	/**
+	*	\brief	Marks the path from the root down to this node as leading to an awake node
+	*/
+
+	void Node::WakeParent()
+	{
+		// stops at the first node already marked, the path above it is marked too
+		for (Node* pNode = m_pParent; pNode && !pNode->m_bAwakeBelow; pNode = pNode->m_pParent)
+			pNode->m_bAwakeBelow = TRUE;
+	}
+
+	/**
+	*	\brief	Sets the parent of a node and all of its siblings
+	*	\param	Node* a_pFirst - first node of the chain, may be NULL
+	*	\param	Node* a_pParent - node whose child chain it now is, NULL if it was removed
+	*	\note	The new parent's path is marked if any node of the chain is awake or leads to one.
+	*/
+
+	void Node::SetParent(Node* a_pFirst, Node* a_pParent)
+	{
+		for (Node* pNode = a_pFirst; pNode; pNode = pNode->m_pSibling)
+		{
+			pNode->m_pParent = a_pParent;
+
+			if (pNode->m_bAwake || pNode->m_bAwakeBelow)
+				pNode->WakeParent();
+		}
+	}
+
+	/**
+	*	\brief	Calculates the world matrix this node leaves set for its child during Update()
+	*	\param	const AffineMatrix& a_rMatrixParent - world matrix set when this node is reached
+	*	\param	AffineMatrix& a_rMatrixChild - receives world matrix used by the child hierarchy
+	*/
+
+	void Node::CalculateChildWorld(const AffineMatrix& a_rMatrixParent, AffineMatrix& a_rMatrixChild) const
+	{
+		a_rMatrixChild = a_rMatrixParent;
+	}
+
 	/**
 	*	\brief	Accessor for child pointer
 	*	\return	Node* - if sibling exists, returns pointer to it, otherwise returns NULL
@@ -342,6 +496,46 @@ namespace SGLib
 		return m_pD3DDevice;
 	}
 
+	/**
+	*	\brief	Accessor for static flag
+	*	\return	BOOL - TRUE if this node has been frozen out of the update pass
+	*/
+
+	BOOL Node::IsStatic() const
+	{
+		return m_bStatic;
+	}
+
+	/**
+	*	\brief	Accessor for awake flag
+	*	\return	BOOL - TRUE if this node still has work to do in Update()
+	*/
+
+	BOOL Node::IsAwake() const
+	{
+		return m_bAwake;
+	}
+
+	/**
+	*	\brief	Accessor for update rate
+	*	\return	UpdateRate - frames between updates of this node
+	*/
+
+	UpdateRate Node::GetUpdateRate() const
+	{
+		return m_enUpdateRate;
+	}
+
+	/**
+	*	\brief	Accessor for parent pointer
+	*	\return	Node* - node whose child chain this node is in, NULL if it has none
+	*/
+
+	Node* Node::GetParent() const
+	{
+		return m_pParent;
+	}
+
 	/**
 	*	\brief	Called when the DIRECT3DDEVICE has been created to allocated D3DPOOL_MANAGED resources
 	*	\param	LPDIRECT3DDEVICE9 - pointer to new DIRECT3DDEVICE
@@ -419,10 +613,13 @@ namespace SGLib
 	/**
 	*	\brief	Updates object based on elapsed time. Updates scene graph in preperation of render call
 	*	\param	FLOAT a_fTimeDiff - elapsed time since last update call
+	*	\note	A plain node has nothing to update so it goes to sleep, derived classes that do work every
+	*			frame override this without calling it
 	*/
 
 	void Node::Update(FLOAT a_fTimeDiff)
 	{
+		GoToSleep();
 	}
 
 	/**
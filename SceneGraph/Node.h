@@ -19,6 +19,31 @@
 *	The functions PostRender(); and PostUpdate(); are added functions that allow the scene graph
 *	to flow properly. They undo any changes (usually to the device) made by their respective 
 *	predeseccors.
+*
+*	Update 19/10/26 - Subtrees can now be frozen. Freeze() bakes the world matrices of every node in the
+*						hierarchy and marks it static so the renderer no longer calls Update() on it.
+*
+*	Update 19/10/26 - The library now uses its own math types from SGMath.h (Matrix, Vector3, Plane) in
+*						place of the D3DX ones. They share the D3DX memory layout and convert implicitly,
+*						so applications using D3DX can keep passing their own types in.
+*
+*	Update 19/10/26 - Nodes now sleep when they have nothing left to do and the renderer skips them in the
+*						update pass. A node is awake when created and the base Update() puts it to sleep,
+*						so derived classes that do work every frame stay awake by not calling it and ones
+*						that settle call GoToSleep() once they have. Wake() puts a node back into the pass
+*						and is called by whatever gives it work again (see Transform, Articulated and
+*						ParticleSystem). Each node keeps a pointer to its parent, the node whose child
+*						chain it is in, so waking marks the path down from the root. The renderer only
+*						follows paths that lead to an awake node or to a transform that moved.
+*
+*	Update 19/10/26 - SetUpdateRate() lets a node and its child hierarchy be updated every 2nd, 4th or 8th
+*						frame instead of every frame. The frames are spread between nodes, the renderer
+*						fits them into its update budget (see SGLib::SGRenderer::SetUpdateBudget()) and
+*						Update() is passed all the time since the node was last updated.
+*
+*	Update 19/10/26 - This header no longer includes the DirectX headers, only SGPlatform.h, so the
+*						hierarchy and its scheduling build without them. Nodes that draw include
+*						dxstdafx.h in their own headers.
 */
 
 #ifndef SGLIB_NODE
@@ -26,13 +51,14 @@
 
 #pragma once
 
-#include "dxstdafx.h"
-
-#include <d3d9.h>
-#include <d3dx9.h>
+#include "SGMath.h"
 #include <vector>
 #include <stack>
 
+// nodes only hold on to the device, the classes that use it include dxstdafx.h
+struct IDirect3DDevice9;
+typedef struct IDirect3DDevice9* LPDIRECT3DDEVICE9;
+
 namespace SGLib
 {
 	// defines different basic types used within the scene graph
@@ -48,8 +74,21 @@ namespace SGLib
 		TRANSFORM
 	};
 
+	// how often a node and its child hierarchy are updated, the value is the frames between updates
+	enum UpdateRate
+	{
+		UPDATE_EVERY_FRAME	= 1,
+		UPDATE_HALF_RATE	= 2,
+		UPDATE_QUARTER_RATE	= 4,
+		UPDATE_EIGHTH_RATE	= 8
+	};
+
+	class SGRenderer;
+
 	class Node
 	{
+		friend class SGRenderer;
+
 	public:
 		Node(LPDIRECT3DDEVICE9 a_pD3DDevice);
 		virtual ~Node(void);
@@ -59,6 +98,16 @@ namespace SGLib
 		Node*					m_pChild;		///< pointer to child node
 		Node*					m_pSibling;		///< pointer to sibling node
 		LPDIRECT3DDEVICE9		m_pD3DDevice;	///< pointer to direct3ddevice used for directx operations
+		BOOL					m_bStatic;		///< specifies whether this node has been frozen out of the update pass
+		Node*					m_pParent;		///< node whose child chain this node is in, NULL for the root
+		BOOL					m_bAwake;		///< TRUE while this node has work to do in Update()
+		BOOL					m_bAwakeBelow;	///< TRUE while an awake node is somewhere in the child hierarchy
+		BOOL					m_bMoved;		///< set by Update() when the world matrix left for the child changed
+		UpdateRate				m_enUpdateRate;	///< how often this node is updated
+		UINT					m_nRateFrames;	///< frames this node has been reached since it was last updated
+		FLOAT					m_fRateTime;	///< time passed since this node was last updated
+
+		static UINT				s_nRatePhase;	///< spreads nodes of the same rate across frames
 
 	public:
 		// mutators
@@ -73,15 +122,31 @@ namespace SGLib
 		void	SetDescription	(LPCTSTR a_sDescription);
 		void	SetDevice		(LPDIRECT3DDEVICE9 a_pD3DDevice);
 
+		// static subtree baking
+		void	Freeze			(const Matrix& a_rMatrixWorld);
+		void	Unfreeze		();
+
+		// update scheduling
+		void	Wake			();
+		void	SetUpdateRate	(UpdateRate a_enUpdateRate);
+
 		// accessors
 		Node*				GetNode		(LPCTSTR a_sDescription);
 		Node*				GetSibling	() const;
 		Node*				GetChild	() const;
 		LPCTSTR				GetDescription	() const;
 		LPDIRECT3DDEVICE9	GetDevice	() const;
+		BOOL				IsStatic	() const;
+		BOOL				IsAwake		() const;
+		UpdateRate			GetUpdateRate	() const;
+		Node*				GetParent	() const;
 		virtual NodeType	GetType		() const = 0;
 		std::vector<Node*>	GetNodesOfType(NodeType a_enType);
 
+		// implemented here to pass the world matrix straight through, derived classes that alter the
+		// world matrix during Update() need to override this and Bake()
+		virtual void		CalculateChildWorld(const AffineMatrix& a_rMatrixParent, AffineMatrix& a_rMatrixChild) const;
+
 		// functions that deal with situations regarding changes in a device's state
 		virtual void		OnCreateDevice(LPDIRECT3DDEVICE9 a_pD3DDevice);	// used to create any D3DPOOL_MANAGED resources
 		virtual void		OnResetDevice(LPDIRECT3DDEVICE9 a_pD3DDevice);	// used to create any D3DPOOL_DEFAULT resources
@@ -97,6 +162,14 @@ namespace SGLib
 		virtual void		Update		(FLOAT a_fTimeDiff);
 		virtual void		PostUpdate	();
 
+	protected:
+		virtual void		Bake		(const AffineMatrix& a_rMatrixParent);
+		void				GoToSleep	();
+		void				WakeParent	();
+
+		static void			SetParent	(Node* a_pFirst, Node* a_pParent);
+
+	public:
 		/**
 		*	\brief	Template function that recursively searches this node's hierarchy and returns a vector of
 		*			Type* pointing to all nodes that are of type Type (including this). 
@@ -0,0 +1,573 @@
+#include "ParticleCollider.h"
+#include <algorithm>
+
+namespace SGLib
+{
+	// x' = dot(m[0], (x, y, z, 1)) and so on, see SGLib::AffineMatrix
+	static inline void TransformPoint(Vector3* a_pOut, const Vector3& a_rvecIn, const AffineMatrix& a_rM)
+	{
+		FLOAT fX = a_rvecIn.x, fY = a_rvecIn.y, fZ = a_rvecIn.z;
+
+		a_pOut->x = a_rM.m[0][0] * fX + a_rM.m[0][1] * fY + a_rM.m[0][2] * fZ + a_rM.m[0][3];
+		a_pOut->y = a_rM.m[1][0] * fX + a_rM.m[1][1] * fY + a_rM.m[1][2] * fZ + a_rM.m[1][3];
+		a_pOut->z = a_rM.m[2][0] * fX + a_rM.m[2][1] * fY + a_rM.m[2][2] * fZ + a_rM.m[2][3];
+	}
+
+	static inline void TransformDirection(Vector3* a_pOut, const Vector3& a_rvecIn, const AffineMatrix& a_rM)
+	{
+		FLOAT fX = a_rvecIn.x, fY = a_rvecIn.y, fZ = a_rvecIn.z;
+
+		a_pOut->x = a_rM.m[0][0] * fX + a_rM.m[0][1] * fY + a_rM.m[0][2] * fZ;
+		a_pOut->y = a_rM.m[1][0] * fX + a_rM.m[1][1] * fY + a_rM.m[1][2] * fZ;
+		a_pOut->z = a_rM.m[2][0] * fX + a_rM.m[2][1] * fY + a_rM.m[2][2] * fZ;
+	}
+
+	/**
+	*	\brief	ParticleCollider constructor
+	*	\param	FLOAT a_fCellSize - size of the spatial hash cells, about the size of the colliders
+	*/
+
+	ParticleCollider::ParticleCollider(FLOAT a_fCellSize) :	m_fCellSize(1.0f),
+															m_fInvCellSize(1.0f),
+															m_nBucketMask(0),
+															m_bDirty(TRUE)
+	{
+		SetCellSize(a_fCellSize);
+	}
+
+	/**
+	*	\brief	ParticleCollider destructor
+	*/
+
+	ParticleCollider::~ParticleCollider()
+	{
+	}
+
+	/**
+	*	\brief	Adds a plane that particles stay in front of
+	*	\param	const Plane& a_rPlane - plane ax + by + cz + d = 0 in world space, (a, b, c) points to the free side
+	*	\param	Response a_eResponse - RESPONSE_BOUNCE or RESPONSE_KILL
+	*	\param	FLOAT a_fRestitution - share of the speed along the normal kept by a bounce
+	*	\param	FLOAT a_fFriction - share of the speed along the plane lost by a bounce
+	*	\return	UINT - index of the collider
+	*/
+
+	UINT ParticleCollider::AddPlane(const Plane& a_rPlane, Response a_eResponse, FLOAT a_fRestitution, FLOAT a_fFriction)
+	{
+		Collider oCollider;
+		oCollider.eShape = SHAPE_PLANE;
+		oCollider.eResponse = a_eResponse;
+		oCollider.fRestitution = a_fRestitution;
+		oCollider.fFriction = a_fFriction;
+		oCollider.vecA = Vector3(a_rPlane.a, a_rPlane.b, a_rPlane.c);
+		oCollider.vecB = Vector3(0.0f, 0.0f, 0.0f);
+		oCollider.fValue = a_rPlane.d;
+		oCollider.pField = NULL;
+
+		// distances are measured along a unit normal
+		FLOAT fLength = Vec3Length(&oCollider.vecA);
+
+		if (fLength > 0.0f)
+		{
+			oCollider.vecA /= fLength;
+			oCollider.fValue /= fLength;
+		}
+
+		return Add(oCollider);
+	}
+
+	/**
+	*	\brief	Adds a solid sphere
+	*	\param	const Vector3& a_rvecCentre - centre in world space
+	*	\param	FLOAT a_fRadius - radius
+	*	\param	Response a_eResponse - RESPONSE_BOUNCE or RESPONSE_KILL
+	*	\param	FLOAT a_fRestitution - share of the speed along the normal kept by a bounce
+	*	\param	FLOAT a_fFriction - share of the speed along the surface lost by a bounce
+	*	\return	UINT - index of the collider
+	*/
+
+	UINT ParticleCollider::AddSphere(const Vector3& a_rvecCentre, FLOAT a_fRadius, Response a_eResponse, FLOAT a_fRestitution, FLOAT a_fFriction)
+	{
+		Collider oCollider;
+		oCollider.eShape = SHAPE_SPHERE;
+		oCollider.eResponse = a_eResponse;
+		oCollider.fRestitution = a_fRestitution;
+		oCollider.fFriction = a_fFriction;
+		oCollider.vecA = a_rvecCentre;
+		oCollider.vecB = Vector3(0.0f, 0.0f, 0.0f);
+		oCollider.fValue = a_fRadius;
+		oCollider.pField = NULL;
+
+		return Add(oCollider);
+	}
+
+	/**
+	*	\brief	Adds a solid axis aligned box
+	*	\param	const Vector3& a_rvecMin - lowest corner in world space
+	*	\param	const Vector3& a_rvecMax - highest corner in world space
+	*	\param	Response a_eResponse - RESPONSE_BOUNCE or RESPONSE_KILL
+	*	\param	FLOAT a_fRestitution - share of the speed along the normal kept by a bounce
+	*	\param	FLOAT a_fFriction - share of the speed along the face lost by a bounce
+	*	\return	UINT - index of the collider
+	*/
+
+	UINT ParticleCollider::AddBox(const Vector3& a_rvecMin, const Vector3& a_rvecMax, Response a_eResponse, FLOAT a_fRestitution, FLOAT a_fFriction)
+	{
+		Collider oCollider;
+		oCollider.eShape = SHAPE_BOX;
+		oCollider.eResponse = a_eResponse;
+		oCollider.fRestitution = a_fRestitution;
+		oCollider.fFriction = a_fFriction;
+		oCollider.vecA = a_rvecMin;
+		oCollider.vecB = a_rvecMax;
+		oCollider.fValue = 0.0f;
+		oCollider.pField = NULL;
+
+		return Add(oCollider);
+	}
+
+	/**
+	*	\brief	Adds a terrain that particles stay above
+	*	\param	const Heightfield* a_pField - terrain, not owned and must outlive the collider
+	*	\param	Response a_eResponse - RESPONSE_BOUNCE or RESPONSE_KILL
+	*	\param	FLOAT a_fRestitution - share of the speed along the normal kept by a bounce
+	*	\param	FLOAT a_fFriction - share of the speed along the ground lost by a bounce
+	*	\return	UINT - index of the collider, NO_COLLIDER if the field is missing or empty
+	*	\note	Particles outside the terrain's grid do not collide with it. A field whose Create() or
+	*			HeightfieldFromFile() failed is refused.
+	*/
+
+	UINT ParticleCollider::AddHeightfield(const Heightfield* a_pField, Response a_eResponse, FLOAT a_fRestitution, FLOAT a_fFriction)
+	{
+		if (!a_pField || a_pField->IsEmpty())
+		{
+			OutputDebugString(L"Warning: Empty heightfield not added -> ParticleCollider::AddHeightfield()\n");
+			return NO_COLLIDER;
+		}
+
+		Collider oCollider;
+		oCollider.eShape = SHAPE_HEIGHTFIELD;
+		oCollider.eResponse = a_eResponse;
+		oCollider.fRestitution = a_fRestitution;
+		oCollider.fFriction = a_fFriction;
+		oCollider.vecA = Vector3(0.0f, 0.0f, 0.0f);
+		oCollider.vecB = Vector3(0.0f, 0.0f, 0.0f);
+		oCollider.fValue = 0.0f;
+		oCollider.pField = a_pField;
+
+		return Add(oCollider);
+	}
+
+	/**
+	*	\brief	Removes every collider
+	*/
+
+	void ParticleCollider::Clear()
+	{
+		m_vecColliders.clear();
+		m_bDirty = TRUE;
+	}
+
+	/**
+	*	\brief	Mutator for the size of the spatial hash cells
+	*	\param	FLOAT a_fCellSize - cell size in world units, about the size of the colliders
+	*/
+
+	void ParticleCollider::SetCellSize(FLOAT a_fCellSize)
+	{
+		if (a_fCellSize > 0.0f)
+		{
+			m_fCellSize = a_fCellSize;
+			m_fInvCellSize = 1.0f / a_fCellSize;
+			m_bDirty = TRUE;
+		}
+	}
+
+	/**
+	*	\brief	Accessor for the size of the spatial hash cells
+	*	\return	FLOAT - cell size in world units
+	*/
+
+	FLOAT ParticleCollider::GetCellSize() const
+	{
+		return m_fCellSize;
+	}
+
+	/**
+	*	\brief	Accessor for the number of colliders
+	*	\return	UINT - colliders added since the last Clear()
+	*/
+
+	UINT ParticleCollider::GetNumColliders() const
+	{
+		return (UINT)m_vecColliders.size();
+	}
+
+	/**
+	*	\brief	Enters the spheres and boxes into the spatial hash
+	*	\note	Does nothing unless the colliders have changed. Called by ParticleStage::Run() before the
+	*			jobs start, not to be called while Collide() may be running.
+	*/
+
+	void ParticleCollider::Build()
+	{
+		if (!m_bDirty)
+			return;
+
+		m_bDirty = FALSE;
+		m_vecGlobal.clear();
+		m_vecEntries.clear();
+
+		// the cells each collider overlaps, or it is tested against everything
+		std::vector<INT> vecCells(m_vecColliders.size() * 6, 0);
+		std::vector<BOOL> vecHashed(m_vecColliders.size(), FALSE);
+		UINT nEntries = 0;
+
+		for (UINT i = 0; i < m_vecColliders.size(); ++i)
+		{
+			const Collider& rCollider = m_vecColliders[i];
+			Vector3 vecMin, vecMax;
+
+			if (rCollider.eShape == SHAPE_SPHERE)
+			{
+				Vector3 vecRadius(rCollider.fValue, rCollider.fValue, rCollider.fValue);
+				vecMin = rCollider.vecA - vecRadius;
+				vecMax = rCollider.vecA + vecRadius;
+			}
+			else if (rCollider.eShape == SHAPE_BOX)
+			{
+				vecMin = rCollider.vecA;
+				vecMax = rCollider.vecB;
+			}
+			else
+			{
+				m_vecGlobal.push_back(i);
+				continue;
+			}
+
+			INT* pCells = &vecCells[i * 6];
+			pCells[0] = (INT)floorf(vecMin.x * m_fInvCellSize);
+			pCells[1] = (INT)floorf(vecMin.y * m_fInvCellSize);
+			pCells[2] = (INT)floorf(vecMin.z * m_fInvCellSize);
+			pCells[3] = (INT)floorf(vecMax.x * m_fInvCellSize);
+			pCells[4] = (INT)floorf(vecMax.y * m_fInvCellSize);
+			pCells[5] = (INT)floorf(vecMax.z * m_fInvCellSize);
+
+			// measured in floats so a huge collider can't overflow the count
+			FLOAT fCells = (FLOAT)(pCells[3] - pCells[0] + 1) * (FLOAT)(pCells[4] - pCells[1] + 1) * (FLOAT)(pCells[5] - pCells[2] + 1);
+
+			if (fCells > (FLOAT)MAX_CELLS)
+			{
+				m_vecGlobal.push_back(i);
+				continue;
+			}
+
+			vecHashed[i] = TRUE;
+			nEntries += (UINT)fCells;
+		}
+
+		// at least twice as many buckets as entries keeps unrelated cells from sharing buckets
+		UINT nBuckets = 16;
+
+		while (nBuckets < nEntries * 2)
+			nBuckets *= 2;
+
+		m_nBucketMask = nBuckets - 1;
+		m_vecBucketStart.assign(nBuckets + 1, 0);
+		m_vecEntries.resize(nEntries);
+
+		// counted, then filled in, so each bucket's entries are contiguous
+		for (UINT nPass = 0; nPass < 2; ++nPass)
+		{
+			for (UINT i = 0; i < m_vecColliders.size(); ++i)
+			{
+				if (!vecHashed[i])
+					continue;
+
+				const INT* pCells = &vecCells[i * 6];
+
+				for (INT nZ = pCells[2]; nZ <= pCells[5]; ++nZ)
+				{
+					for (INT nY = pCells[1]; nY <= pCells[4]; ++nY)
+					{
+						for (INT nX = pCells[0]; nX <= pCells[3]; ++nX)
+						{
+							UINT nBucket = HashCell(nX, nY, nZ) & m_nBucketMask;
+
+							if (nPass == 0)
+								++m_vecBucketStart[nBucket + 1];
+							else
+								m_vecEntries[m_vecBucketStart[nBucket]++] = i;
+						}
+					}
+				}
+			}
+
+			if (nPass == 0)
+			{
+				// counts to the start of each bucket
+				for (UINT nBucket = 0; nBucket < nBuckets; ++nBucket)
+					m_vecBucketStart[nBucket + 1] += m_vecBucketStart[nBucket];
+			}
+			else
+			{
+				// filling moved each start onto the next bucket's
+				for (UINT nBucket = nBuckets; nBucket > 0; --nBucket)
+					m_vecBucketStart[nBucket] = m_vecBucketStart[nBucket - 1];
+
+				m_vecBucketStart[0] = 0;
+			}
+		}
+	}
+
+	/**
+	*	\brief	Collides a range of a store's particles with the colliders
+	*	\param	ParticleStore& a_rStore - particles to collide, their positions and velocities are changed
+	*	\param	UINT a_nBegin - first slot
+	*	\param	UINT a_nEnd - one past the last slot
+	*	\param	const AffineMatrix* a_pToWorld - takes the store's positions into world space, NULL if they are
+	*	\param	const AffineMatrix* a_pToLocal - inverse of a_pToWorld, NULL if it is
+	*	\param	UINT* a_pDead - the range's dead slots in ascending order, room for a_nEnd - a_nBegin
+	*	\param	UINT a_nDead - number of dead slots listed
+	*	\return	UINT - number of dead slots listed once those killed by RESPONSE_KILL colliders are added,
+	*			still in ascending order
+	*	\note	Particles already listed as dead are skipped. Nothing collides until Build() has been called
+	*			since the colliders last changed. Only reads the colliders, so ranges can be collided in
+	*			parallel.
+	*/
+
+	UINT ParticleCollider::Collide(ParticleStore& a_rStore, UINT a_nBegin, UINT a_nEnd, const AffineMatrix* a_pToWorld,
+								   const AffineMatrix* a_pToLocal, UINT* a_pDead, UINT a_nDead) const
+	{
+		if (m_vecColliders.empty() || m_bDirty)
+			return a_nDead;
+
+		FLOAT* pPos[3] = { a_rStore.GetStream(ParticleStore::POS_X), a_rStore.GetStream(ParticleStore::POS_Y), a_rStore.GetStream(ParticleStore::POS_Z) };
+		FLOAT* pVel[3] = { a_rStore.GetStream(ParticleStore::VEL_X), a_rStore.GetStream(ParticleStore::VEL_Y), a_rStore.GetStream(ParticleStore::VEL_Z) };
+
+		const UINT* pGlobal = m_vecGlobal.empty() ? NULL : &m_vecGlobal[0];
+		const UINT nGlobal = (UINT)m_vecGlobal.size();
+		const UINT* pEntries = m_vecEntries.empty() ? NULL : &m_vecEntries[0];
+		const UINT* pBucketStart = &m_vecBucketStart[0];
+
+		UINT nNextDead = 0;
+		UINT nKilled = 0;
+
+		for (UINT i = a_nBegin; i < a_nEnd; ++i)
+		{
+			if (nNextDead < a_nDead && a_pDead[nNextDead] == i)
+			{
+				++nNextDead;
+				continue;
+			}
+
+			Vector3 vecPos(pPos[0][i], pPos[1][i], pPos[2][i]);
+
+			if (a_pToWorld)
+				TransformPoint(&vecPos, vecPos, *a_pToWorld);
+
+			// everything the particle could touch, the global colliders then those in its cell's bucket
+			UINT nBucket = HashCell((INT)floorf(vecPos.x * m_fInvCellSize), (INT)floorf(vecPos.y * m_fInvCellSize),
+									(INT)floorf(vecPos.z * m_fInvCellSize)) & m_nBucketMask;
+			UINT nFirstEntry = pBucketStart[nBucket];
+			UINT nTests = nGlobal + pBucketStart[nBucket + 1] - nFirstEntry;
+
+			Vector3 vecVel;
+			BOOL bVelocity = FALSE;
+			BOOL bMoved = FALSE;
+			BOOL bKilled = FALSE;
+
+			for (UINT nTest = 0; nTest < nTests && !bKilled; ++nTest)
+			{
+				UINT nCollider = (nTest < nGlobal) ? pGlobal[nTest] : pEntries[nFirstEntry + nTest - nGlobal];
+				const Collider& rCollider = m_vecColliders[nCollider];
+				Vector3 vecNormal;
+
+				if (!Penetrate(rCollider, &vecPos, &vecNormal))
+					continue;
+
+				if (rCollider.eResponse == RESPONSE_KILL)
+				{
+					bKilled = TRUE;
+					break;
+				}
+
+				bMoved = TRUE;
+
+				if (!bVelocity)
+				{
+					vecVel = Vector3(pVel[0][i], pVel[1][i], pVel[2][i]);
+
+					if (a_pToWorld)
+						TransformDirection(&vecVel, vecVel, *a_pToWorld);
+
+					bVelocity = TRUE;
+				}
+
+				// only a particle heading into the surface is turned round
+				FLOAT fNormalSpeed = Vec3Dot(&vecVel, &vecNormal);
+
+				if (fNormalSpeed < 0.0f)
+				{
+					Vector3 vecNormalVel = vecNormal * fNormalSpeed;
+					Vector3 vecSurfaceVel = vecVel - vecNormalVel;
+
+					vecVel = vecSurfaceVel * (1.0f - rCollider.fFriction) - vecNormalVel * rCollider.fRestitution;
+				}
+			}
+
+			if (bKilled)
+			{
+				// after the existing list, merged into it below
+				a_pDead[a_nDead + nKilled++] = i;
+				continue;
+			}
+
+			if (bMoved)
+			{
+				if (a_pToLocal)
+				{
+					TransformPoint(&vecPos, vecPos, *a_pToLocal);
+					TransformDirection(&vecVel, vecVel, *a_pToLocal);
+				}
+
+				pPos[0][i] = vecPos.x;
+				pPos[1][i] = vecPos.y;
+				pPos[2][i] = vecPos.z;
+				pVel[0][i] = vecVel.x;
+				pVel[1][i] = vecVel.y;
+				pVel[2][i] = vecVel.z;
+			}
+		}
+
+		if (nKilled > 0)
+			std::inplace_merge(a_pDead, a_pDead + a_nDead, a_pDead + a_nDead + nKilled);
+
+		return a_nDead + nKilled;
+	}
+
+	/**
+	*	\brief	Adds a collider and marks the hash for rebuilding
+	*	\param	const Collider& a_rCollider - collider to add
+	*	\return	UINT - index of the collider
+	*/
+
+	UINT ParticleCollider::Add(const Collider& a_rCollider)
+	{
+		m_vecColliders.push_back(a_rCollider);
+		m_bDirty = TRUE;
+
+		return (UINT)m_vecColliders.size() - 1;
+	}
+
+	/**
+	*	\brief	Pushes a point inside a collider out to its surface
+	*	\param	const Collider& a_rCollider - collider to test
+	*	\param	Vector3* a_pvecPos - world position, moved onto the surface if it is inside
+	*	\param	Vector3* a_pvecNormal - receives the surface normal where it was pushed out
+	*	\return	BOOL - TRUE if the point was inside
+	*/
+
+	BOOL ParticleCollider::Penetrate(const Collider& a_rCollider, Vector3* a_pvecPos, Vector3* a_pvecNormal) const
+	{
+		switch (a_rCollider.eShape)
+		{
+		case SHAPE_PLANE:
+			{
+				FLOAT fDistance = Vec3Dot(&a_rCollider.vecA, a_pvecPos) + a_rCollider.fValue;
+
+				if (fDistance >= 0.0f)
+					return FALSE;
+
+				*a_pvecPos -= a_rCollider.vecA * fDistance;
+				*a_pvecNormal = a_rCollider.vecA;
+				return TRUE;
+			}
+
+		case SHAPE_SPHERE:
+			{
+				Vector3 vecOffset = *a_pvecPos - a_rCollider.vecA;
+				FLOAT fLengthSq = Vec3LengthSq(&vecOffset);
+
+				if (fLengthSq >= a_rCollider.fValue * a_rCollider.fValue)
+					return FALSE;
+
+				// a point at the very centre leaves through the top
+				FLOAT fLength = sqrtf(fLengthSq);
+				*a_pvecNormal = (fLength > 0.0f) ? vecOffset / fLength : Vector3(0.0f, 1.0f, 0.0f);
+				*a_pvecPos = a_rCollider.vecA + *a_pvecNormal * a_rCollider.fValue;
+				return TRUE;
+			}
+
+		case SHAPE_BOX:
+			{
+				const Vector3& rvecMin = a_rCollider.vecA;
+				const Vector3& rvecMax = a_rCollider.vecB;
+
+				if (a_pvecPos->x <= rvecMin.x || a_pvecPos->x >= rvecMax.x ||
+					a_pvecPos->y <= rvecMin.y || a_pvecPos->y >= rvecMax.y ||
+					a_pvecPos->z <= rvecMin.z || a_pvecPos->z >= rvecMax.z)
+					return FALSE;
+
+				// out through the nearest face
+				FLOAT afDepth[6] = {	a_pvecPos->x - rvecMin.x, rvecMax.x - a_pvecPos->x,
+										a_pvecPos->y - rvecMin.y, rvecMax.y - a_pvecPos->y,
+										a_pvecPos->z - rvecMin.z, rvecMax.z - a_pvecPos->z };
+				UINT nFace = 0;
+
+				for (UINT j = 1; j < 6; ++j)
+				{
+					if (afDepth[j] < afDepth[nFace])
+						nFace = j;
+				}
+
+				FLOAT* pfPos = &a_pvecPos->x;
+				FLOAT* pfNormal = &a_pvecNormal->x;
+				UINT nAxis = nFace / 2;
+
+				*a_pvecNormal = Vector3(0.0f, 0.0f, 0.0f);
+
+				if (nFace & 1)
+				{
+					pfPos[nAxis] = (&rvecMax.x)[nAxis];
+					pfNormal[nAxis] = 1.0f;
+				}
+				else
+				{
+					pfPos[nAxis] = (&rvecMin.x)[nAxis];
+					pfNormal[nAxis] = -1.0f;
+				}
+
+				return TRUE;
+			}
+
+		case SHAPE_HEIGHTFIELD:
+			{
+				FLOAT fHeight;
+
+				if (!a_rCollider.pField->GetHeight(a_pvecPos->x, a_pvecPos->z, &fHeight) || a_pvecPos->y >= fHeight)
+					return FALSE;
+
+				// straight up, which stays on the terrain's grid
+				a_pvecPos->y = fHeight;
+				a_rCollider.pField->GetNormal(a_pvecPos->x, a_pvecPos->z, a_pvecNormal);
+				return TRUE;
+			}
+		}
+
+		return FALSE;
+	}
+
+	/**
+	*	\brief	Hashes the coordinates of a cell
+	*	\param	INT a_nX - cell along x
+	*	\param	INT a_nY - cell along y
+	*	\param	INT a_nZ - cell along z
+	*	\return	UINT - hash, masked to a bucket by the caller
+	*/
+
+	UINT ParticleCollider::HashCell(INT a_nX, INT a_nY, INT a_nZ)
+	{
+		return ((UINT)a_nX * 73856093u) ^ ((UINT)a_nY * 19349663u) ^ ((UINT)a_nZ * 83492791u);
+	}
+}
@@ -0,0 +1,116 @@
+/**
+*	\class		SGLib::ParticleCollider
+*	\brief		Static world colliders that particles bounce off or die against, with a spatial hash broad-phase
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Holds the static geometry particles should not pass through, in world space:
+*
+*		- planes, such as a flat ground or a wall
+*		- spheres
+*		- axis aligned boxes, such as the bounds of a building
+*		- SGLib::Heightfield terrains, which are not owned
+*
+*	Each collider has its own response. RESPONSE_BOUNCE pushes the particle back out to the surface and
+*	reflects its velocity, keeping fRestitution of the speed along the normal and losing fFriction of
+*	the speed along the surface. RESPONSE_KILL kills the particle.
+*
+*	Spheres and boxes are entered into a uniform spatial hash of cubic cells GetCellSize() across, so
+*	each particle only tests the colliders entered under its own cell and the cost stays linear in the
+*	number of particles however many colliders there are. A cell size about the size of the colliders
+*	works best. Planes, heightfields and colliders overlapping more than MAX_CELLS cells are tested
+*	against every particle. Build() enters the colliders into the hash after they have changed.
+*
+*	ParticleSystem::SetCollider() makes a system collide, and SGLib::ParticleStage calls Collide() for
+*	each chunk straight after moving it. The test is against the particle's position after the move, so
+*	a particle moving further than a collider's thickness in one update can pass through it.
+*	Collide() only reads the colliders, so one collider can be shared by many systems and threads.
+*	Nothing here depends on the device.
+*/
+
+#ifndef SGLIB_PARTICLECOLLIDER
+#define SGLIB_PARTICLECOLLIDER
+
+#pragma once
+
+#include "SGMath.h"
+#include "ParticleStore.h"
+#include "Heightfield.h"
+#include <vector>
+
+namespace SGLib
+{
+	class ParticleCollider
+	{
+	public:
+		enum Response
+		{
+			RESPONSE_BOUNCE,	///< push the particle out and reflect its velocity
+			RESPONSE_KILL		///< kill the particle
+		};
+
+		static const UINT MAX_CELLS = 64;	///< colliders overlapping more cells than this skip the hash
+		static const UINT NO_COLLIDER = 0xFFFFFFFF;	///< returned when a collider is refused
+
+		ParticleCollider(FLOAT a_fCellSize = 10.0f);
+		~ParticleCollider();
+
+	protected:
+		enum Shape
+		{
+			SHAPE_PLANE,
+			SHAPE_SPHERE,
+			SHAPE_BOX,
+			SHAPE_HEIGHTFIELD
+		};
+
+		// one static collider
+		struct Collider
+		{
+			Shape				eShape;			///< what vecA, vecB and fValue describe
+			Response			eResponse;		///< what happens to a particle that hits it
+			FLOAT				fRestitution;	///< share of the speed along the normal kept by a bounce
+			FLOAT				fFriction;		///< share of the speed along the surface lost by a bounce
+			Vector3				vecA;			///< plane normal, sphere centre or box minimum
+			Vector3				vecB;			///< box maximum
+			FLOAT				fValue;			///< plane distance or sphere radius
+			const Heightfield*	pField;			///< terrain for SHAPE_HEIGHTFIELD
+		};
+
+		std::vector<Collider>	m_vecColliders;		///< every collider
+		std::vector<UINT>		m_vecGlobal;		///< colliders tested against every particle
+		std::vector<UINT>		m_vecBucketStart;	///< first entry of each hash bucket, then one past the last entry
+		std::vector<UINT>		m_vecEntries;		///< colliders entered under the cells of each bucket
+		FLOAT					m_fCellSize;		///< size of a hash cell
+		FLOAT					m_fInvCellSize;		///< 1 / m_fCellSize
+		UINT					m_nBucketMask;		///< number of buckets - 1
+		BOOL					m_bDirty;			///< colliders changed since Build()
+
+	public:
+		UINT		AddPlane		(const Plane& a_rPlane, Response a_eResponse = RESPONSE_BOUNCE,
+									 FLOAT a_fRestitution = 0.5f, FLOAT a_fFriction = 0.1f);
+		UINT		AddSphere		(const Vector3& a_rvecCentre, FLOAT a_fRadius, Response a_eResponse = RESPONSE_BOUNCE,
+									 FLOAT a_fRestitution = 0.5f, FLOAT a_fFriction = 0.1f);
+		UINT		AddBox			(const Vector3& a_rvecMin, const Vector3& a_rvecMax, Response a_eResponse = RESPONSE_BOUNCE,
+									 FLOAT a_fRestitution = 0.5f, FLOAT a_fFriction = 0.1f);
+		UINT		AddHeightfield	(const Heightfield* a_pField, Response a_eResponse = RESPONSE_BOUNCE,
+									 FLOAT a_fRestitution = 0.5f, FLOAT a_fFriction = 0.1f);
+		void		Clear			();
+
+		void		SetCellSize		(FLOAT a_fCellSize);
+		FLOAT		GetCellSize		() const;
+		UINT		GetNumColliders	() const;
+
+		void		Build			();
+		UINT		Collide			(ParticleStore& a_rStore, UINT a_nBegin, UINT a_nEnd, const AffineMatrix* a_pToWorld,
+									 const AffineMatrix* a_pToLocal, UINT* a_pDead, UINT a_nDead) const;
+
+	protected:
+		UINT		Add				(const Collider& a_rCollider);
+		BOOL		Penetrate		(const Collider& a_rCollider, Vector3* a_pvecPos, Vector3* a_pvecNormal) const;
+
+		static UINT	HashCell		(INT a_nX, INT a_nY, INT a_nZ);
+	};
+}
+
+#endif
@@ -0,0 +1,468 @@
+#include "ParticleEmitter.h"
+#include "Keyframe.h"
+
+using std::vector;
+
+namespace SGLib
+{
+	UINT ParticleEmitter::s_nNextSeed = 1;
+
+	/**
+	*	\brief	Mixes the bits of a 32 bit value so that consecutive inputs give unrelated outputs
+	*	\param	UINT a_nValue - value to mix
+	*	\return	UINT - mixed value
+	*/
+
+	static inline UINT HashBits(UINT a_nValue)
+	{
+		a_nValue ^= a_nValue >> 16;
+		a_nValue *= 0x7feb352dU;
+		a_nValue ^= a_nValue >> 15;
+		a_nValue *= 0x846ca68bU;
+		a_nValue ^= a_nValue >> 16;
+
+		return a_nValue;
+	}
+
+	/**
+	*	\brief	Turns the top 24 bits of a hash into a float
+	*	\param	UINT a_nHash - hash from HashBits()
+	*	\return	FLOAT - value from 0 up to but not including 1
+	*/
+
+	static inline FLOAT HashToUnit(UINT a_nHash)
+	{
+		return (FLOAT)(a_nHash >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/**
+	*	\brief	ParticleEmitter constructor
+	*	\param	FLOAT a_fRate - particles per second, 0 or less emits nothing but bursts
+	*	\note	Every emitter is given a different seed, use SetSeed() to repeat a sequence
+	*/
+
+	ParticleEmitter::ParticleEmitter(FLOAT a_fRate) :	m_fRate(a_fRate > 0.0f ? a_fRate : 0.0f),
+														m_fDuration(0.0f),
+														m_bLoop(FALSE),
+														m_fTime(0.0f),
+														m_fOwed(0.0f),
+														m_nKey(0),
+														m_nBurst(0),
+														m_nSeed(s_nNextSeed++),
+														m_nCounter(0)
+	{
+	}
+
+	/**
+	*	\brief	ParticleEmitter destructor
+	*/
+
+	ParticleEmitter::~ParticleEmitter()
+	{
+	}
+
+	/**
+	*	\brief	Advances the emitter's time and works out how many particles are due
+	*	\param	FLOAT a_fTimeDiff - time to advance by
+	*	\return	UINT - whole particles due from the rate plus every burst passed, the fraction left over
+	*			is carried into the next call
+	*	\note	A step that crosses the end of a looping emitter's cycle is split there, so the rate curve
+	*			and bursts of every cycle it covers are counted
+	*/
+
+	UINT ParticleEmitter::Advance(FLOAT a_fTimeDiff)
+	{
+		UINT nCount = 0;
+
+		while (a_fTimeDiff > 0.0f)
+		{
+			FLOAT fStep = a_fTimeDiff;
+			BOOL bEnd = FALSE;
+
+			if (m_fDuration > 0.0f)
+			{
+				// finished, or the duration was shortened past the emitter's time
+				if (m_fTime >= m_fDuration)
+				{
+					if (!m_bLoop)
+						break;
+
+					m_fTime = 0.0f;
+					m_nKey = 0;
+					m_nBurst = 0;
+				}
+
+				if (fStep >= m_fDuration - m_fTime)
+				{
+					fStep = m_fDuration - m_fTime;
+					bEnd = TRUE;
+				}
+			}
+
+			FLOAT fEnd = bEnd ? m_fDuration : m_fTime + fStep;
+
+			if (m_fRate > 0.0f)
+				m_fOwed += IntegrateRate(m_fTime, fEnd);
+
+			// bursts at or after the start of the step and before its end, the end of the cycle included
+			while (m_nBurst < m_vecBursts.size() &&
+				   (m_vecBursts[m_nBurst].m_fTime < fEnd || (bEnd && m_vecBursts[m_nBurst].m_fTime <= fEnd)))
+			{
+				nCount += m_vecBursts[m_nBurst].m_nCount;
+				++m_nBurst;
+			}
+
+			m_fTime = fEnd;
+			a_fTimeDiff -= fStep;
+
+			if (bEnd)
+			{
+				if (!m_bLoop)
+					break;
+
+				m_fTime = 0.0f;
+				m_nKey = 0;
+				m_nBurst = 0;
+			}
+		}
+
+		UINT nWhole = (UINT)m_fOwed;
+		m_fOwed -= (FLOAT)nWhole;
+
+		return nCount + nWhole;
+	}
+
+	/**
+	*	\brief	Integrates the rate curve over part of a cycle
+	*	\param	FLOAT a_fStart - start of the range
+	*	\param	FLOAT a_fEnd - end of the range, not before a_fStart
+	*	\return	FLOAT - particles emitted over the range
+	*	\note	The curve is linear between keys and held flat before the first and after the last, so each
+	*			piece is integrated exactly with the trapezium rule
+	*/
+
+	FLOAT ParticleEmitter::IntegrateRate(FLOAT a_fStart, FLOAT a_fEnd)
+	{
+		if (m_vecKeys.empty())
+			return m_fRate * (a_fEnd - a_fStart);
+
+		const EmitterKey* pKeys = &m_vecKeys[0];
+		UINT nKeys = (UINT)m_vecKeys.size();
+		FLOAT fSum = 0.0f;
+		FLOAT fFrom = a_fStart;
+
+		m_nKey = FindKey(pKeys, nKeys, fFrom, m_nKey);
+
+		while (fFrom < a_fEnd)
+		{
+			FLOAT fTo;
+
+			if (fFrom < pKeys[0].m_fTime)
+			{
+				// held at the first key
+				fTo = (pKeys[0].m_fTime < a_fEnd) ? pKeys[0].m_fTime : a_fEnd;
+				fSum += pKeys[0].m_fScale * (fTo - fFrom);
+			}
+			else if (m_nKey + 1 >= nKeys)
+			{
+				// held at the last key
+				fTo = a_fEnd;
+				fSum += pKeys[m_nKey].m_fScale * (fTo - fFrom);
+			}
+			else
+			{
+				const EmitterKey& rKey = pKeys[m_nKey];
+				const EmitterKey& rNext = pKeys[m_nKey + 1];
+				FLOAT fSlope = (rNext.m_fScale - rKey.m_fScale) / (rNext.m_fTime - rKey.m_fTime);
+
+				fTo = (rNext.m_fTime < a_fEnd) ? rNext.m_fTime : a_fEnd;
+				fSum += 0.5f * (fTo - fFrom) * (2.0f * rKey.m_fScale + fSlope * ((fFrom - rKey.m_fTime) + (fTo - rKey.m_fTime)));
+
+				if (fTo == rNext.m_fTime)
+					++m_nKey;
+			}
+
+			fFrom = fTo;
+		}
+
+		return m_fRate * fSum;
+	}
+
+	/**
+	*	\brief	Goes back to the start of the first cycle, so the bursts fire again
+	*	\note	Does not reset the random numbers, see SetSeed()
+	*/
+
+	void ParticleEmitter::Restart()
+	{
+		m_fTime = 0.0f;
+		m_fOwed = 0.0f;
+		m_nKey = 0;
+		m_nBurst = 0;
+	}
+
+	/**
+	*	\brief	Whether Advance() can still return particles
+	*	\return	BOOL - FALSE once a non looping emitter has passed its duration or an endless one has no
+	*			rate and has fired every burst
+	*/
+
+	BOOL ParticleEmitter::IsActive() const
+	{
+		if (m_fDuration > 0.0f)
+		{
+			if (m_bLoop)
+				return m_fRate > 0.0f || !m_vecBursts.empty();
+
+			if (m_fTime >= m_fDuration)
+				return FALSE;
+		}
+
+		return m_fRate > 0.0f || m_nBurst < m_vecBursts.size();
+	}
+
+	/**
+	*	\brief	Mutator for the rate
+	*	\param	FLOAT a_fRate - particles per second before the rate curve, 0 or less emits nothing but bursts
+	*/
+
+	void ParticleEmitter::SetRate(FLOAT a_fRate)
+	{
+		m_fRate = (a_fRate > 0.0f) ? a_fRate : 0.0f;
+	}
+
+	/**
+	*	\brief	Accessor for the rate
+	*	\return	FLOAT - particles per second before the rate curve
+	*/
+
+	FLOAT ParticleEmitter::GetRate() const
+	{
+		return m_fRate;
+	}
+
+	/**
+	*	\brief	Inserts a key into the rate curve keeping it sorted by time
+	*	\param	FLOAT a_fTime - time within the cycle, clamped to 0
+	*	\param	FLOAT a_fScale - multiplier of the rate at that time, clamped to 0
+	*	\note	A key at the same time as an existing one replaces it
+	*/
+
+	void ParticleEmitter::AddRateKey(FLOAT a_fTime, FLOAT a_fScale)
+	{
+		EmitterKey oKey;
+		oKey.m_fTime = (a_fTime < 0.0f) ? 0.0f : a_fTime;
+		oKey.m_fScale = (a_fScale < 0.0f) ? 0.0f : a_fScale;
+
+		vector<EmitterKey>::iterator iter = m_vecKeys.begin();
+
+		while (iter != m_vecKeys.end() && iter->m_fTime < oKey.m_fTime)
+			++iter;
+
+		if (iter != m_vecKeys.end() && iter->m_fTime == oKey.m_fTime)
+			*iter = oKey;
+		else
+			m_vecKeys.insert(iter, oKey);
+
+		m_nKey = 0;
+	}
+
+	/**
+	*	\brief	Removes the rate curve, the rate is used as it is
+	*/
+
+	void ParticleEmitter::ClearRateKeys()
+	{
+		m_vecKeys.clear();
+		m_nKey = 0;
+	}
+
+	/**
+	*	\brief	Samples the rate curve
+	*	\param	FLOAT a_fTime - time within the cycle
+	*	\return	FLOAT - particles per second at that time
+	*/
+
+	FLOAT ParticleEmitter::GetRateAt(FLOAT a_fTime) const
+	{
+		if (m_vecKeys.empty())
+			return m_fRate;
+
+		UINT nKeys = (UINT)m_vecKeys.size();
+		UINT nKey = FindKey(&m_vecKeys[0], nKeys, a_fTime, m_nKey);
+		const EmitterKey& rKey = m_vecKeys[nKey];
+
+		if (a_fTime <= rKey.m_fTime || nKey + 1 >= nKeys)
+			return m_fRate * rKey.m_fScale;
+
+		const EmitterKey& rNext = m_vecKeys[nKey + 1];
+		FLOAT fBlend = (a_fTime - rKey.m_fTime) / (rNext.m_fTime - rKey.m_fTime);
+
+		return m_fRate * (rKey.m_fScale + (rNext.m_fScale - rKey.m_fScale) * fBlend);
+	}
+
+	/**
+	*	\brief	Adds a burst keeping the bursts sorted by time
+	*	\param	FLOAT a_fTime - time within the cycle, clamped to 0
+	*	\param	UINT a_nCount - particles emitted at once
+	*	\note	A burst added before the emitter's current time does not fire until the next cycle
+	*/
+
+	void ParticleEmitter::AddBurst(FLOAT a_fTime, UINT a_nCount)
+	{
+		EmitterBurst oBurst;
+		oBurst.m_fTime = (a_fTime < 0.0f) ? 0.0f : a_fTime;
+		oBurst.m_nCount = a_nCount;
+
+		vector<EmitterBurst>::iterator iter = m_vecBursts.begin();
+		UINT nIndex = 0;
+
+		while (iter != m_vecBursts.end() && iter->m_fTime <= oBurst.m_fTime)
+		{
+			++iter;
+			++nIndex;
+		}
+
+		m_vecBursts.insert(iter, oBurst);
+
+		if (nIndex < m_nBurst || (nIndex == m_nBurst && oBurst.m_fTime < m_fTime))
+			++m_nBurst;
+	}
+
+	/**
+	*	\brief	Removes every burst
+	*/
+
+	void ParticleEmitter::ClearBursts()
+	{
+		m_vecBursts.clear();
+		m_nBurst = 0;
+	}
+
+	/**
+	*	\brief	Mutator for the length of a cycle
+	*	\param	FLOAT a_fDuration - length of a cycle, 0 or less to run for ever
+	*	\param	BOOL a_bLoop - start a new cycle once the duration has passed rather than stop
+	*/
+
+	void ParticleEmitter::SetDuration(FLOAT a_fDuration, BOOL a_bLoop)
+	{
+		m_fDuration = (a_fDuration > 0.0f) ? a_fDuration : 0.0f;
+		m_bLoop = a_bLoop;
+	}
+
+	/**
+	*	\brief	Accessor for the length of a cycle
+	*	\return	FLOAT - length of a cycle, 0 if the emitter runs for ever
+	*/
+
+	FLOAT ParticleEmitter::GetDuration() const
+	{
+		return m_fDuration;
+	}
+
+	/**
+	*	\brief	Accessor for whether the emitter loops
+	*	\return	BOOL - TRUE if a new cycle starts once the duration has passed
+	*/
+
+	BOOL ParticleEmitter::IsLooping() const
+	{
+		return m_bLoop;
+	}
+
+	/**
+	*	\brief	Accessor for the emitter's time
+	*	\return	FLOAT - time within the current cycle
+	*/
+
+	FLOAT ParticleEmitter::GetTime() const
+	{
+		return m_fTime;
+	}
+
+	/**
+	*	\brief	Mutator for the seed of the random numbers
+	*	\param	UINT a_nSeed - seed, the same seed always gives the same sequence
+	*/
+
+	void ParticleEmitter::SetSeed(UINT a_nSeed)
+	{
+		m_nSeed = a_nSeed;
+		m_nCounter = 0;
+	}
+
+	/**
+	*	\brief	Accessor for the seed of the random numbers
+	*	\return	UINT - seed
+	*/
+
+	UINT ParticleEmitter::GetSeed() const
+	{
+		return m_nSeed;
+	}
+
+	/**
+	*	\brief	Draws one random number
+	*	\return	FLOAT - value from 0 up to but not including 1
+	*/
+
+	FLOAT ParticleEmitter::Random()
+	{
+		return HashToUnit(HashBits(HashBits(m_nSeed) + m_nCounter++));
+	}
+
+	/**
+	*	\brief	Fills a range of a stream with random numbers spread evenly between two values
+	*	\param	FLOAT* a_pOut - receives the values
+	*	\param	UINT a_nCount - number of values
+	*	\param	FLOAT a_fMin - smallest value
+	*	\param	FLOAT a_fMax - largest value
+	*	\note	Each value only depends on the seed and its position in the sequence, so the loop has no
+	*			dependency between iterations
+	*/
+
+	void ParticleEmitter::Uniform(FLOAT* a_pOut, UINT a_nCount, FLOAT a_fMin, FLOAT a_fMax)
+	{
+		UINT nBase = HashBits(m_nSeed) + m_nCounter;
+		FLOAT fRange = a_fMax - a_fMin;
+
+		for (UINT i = 0; i < a_nCount; ++i)
+			a_pOut[i] = a_fMin + fRange * HashToUnit(HashBits(nBase + i));
+
+		m_nCounter += a_nCount;
+	}
+
+	/**
+	*	\brief	Fills ranges of three streams with random vectors pointing evenly in every direction
+	*	\param	FLOAT* a_pX - receives the x components
+	*	\param	FLOAT* a_pY - receives the y components
+	*	\param	FLOAT* a_pZ - receives the z components
+	*	\param	UINT a_nCount - number of vectors
+	*	\param	FLOAT a_fMinLength - shortest length
+	*	\param	FLOAT a_fMaxLength - longest length
+	*	\note	The lengths are spread evenly between the two, not the volume between the two spheres
+	*/
+
+	void ParticleEmitter::UniformDirections(FLOAT* a_pX, FLOAT* a_pY, FLOAT* a_pZ, UINT a_nCount,
+											FLOAT a_fMinLength, FLOAT a_fMaxLength)
+	{
+		UINT nBase = HashBits(m_nSeed) + m_nCounter;
+		FLOAT fRange = a_fMaxLength - a_fMinLength;
+
+		for (UINT i = 0; i < a_nCount; ++i)
+		{
+			// a uniform height and angle around the axis are uniform over the sphere
+			FLOAT fZ = 1.0f - 2.0f * HashToUnit(HashBits(nBase + 3 * i));
+			FLOAT fAngle = 2.0f * SG_PI * HashToUnit(HashBits(nBase + 3 * i + 1));
+			FLOAT fLength = a_fMinLength + fRange * HashToUnit(HashBits(nBase + 3 * i + 2));
+			FLOAT fRadius = sqrtf(1.0f - fZ * fZ) * fLength;
+
+			a_pX[i] = fRadius * cosf(fAngle);
+			a_pY[i] = fRadius * sinf(fAngle);
+			a_pZ[i] = fZ * fLength;
+		}
+
+		m_nCounter += 3 * a_nCount;
+	}
+}
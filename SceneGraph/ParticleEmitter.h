@@ -0,0 +1,101 @@
+/**
+*	\class		SGLib::ParticleEmitter
+*	\brief		Decides how many particles a system emits each update and supplies the random numbers used to
+*				initialise them
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Each SGLib::ParticleSystem owns one emitter, so the fraction of a particle carried between updates
+*	belongs to that system alone. Advance() returns the whole number of particles due over a time step,
+*	made up of:
+*
+*		- a continuous rate in particles per second
+*		- an optional rate curve, keys that scale the rate over the emitter's time and are interpolated
+*		  linearly. The curve is integrated exactly over each step, so the count does not depend on
+*		  how the time is split between updates
+*		- bursts, a number of particles emitted at once when the emitter's time passes a given time
+*
+*	An emitter with a duration runs for that long and then either stops or, when looping, starts again
+*	from 0 and fires its bursts again. An emitter without one runs for ever and fires each burst once.
+*
+*	The random numbers come from hashing a per emitter seed with a counter instead of a shared generator,
+*	so systems do not disturb each other's sequences and a system started with the same seed and fed
+*	the same time steps emits exactly the same particles. Uniform() and UniformDirections() fill whole
+*	ranges of a stream at once for SGLib::ParticleSystem::InitParticles(). Nothing here depends on the
+*	device.
+*/
+
+#ifndef SGLIB_PARTICLEEMITTER
+#define SGLIB_PARTICLEEMITTER
+
+#pragma once
+
+#include "SGMath.h"
+#include <vector>
+
+namespace SGLib
+{
+	// scales the emitter's rate from this time on, interpolated towards the next key
+	struct EmitterKey
+	{
+		FLOAT	m_fTime;	///< time within the emitter's cycle
+		FLOAT	m_fScale;	///< multiplier of the rate
+	};
+
+	// particles emitted at once when the emitter's time reaches m_fTime
+	struct EmitterBurst
+	{
+		FLOAT	m_fTime;	///< time within the emitter's cycle
+		UINT	m_nCount;	///< particles emitted
+	};
+
+	class ParticleEmitter
+	{
+	public:
+		ParticleEmitter(FLOAT a_fRate = 0.0f);
+		~ParticleEmitter();
+
+	protected:
+		FLOAT						m_fRate;		///< particles per second
+		std::vector<EmitterKey>		m_vecKeys;		///< rate curve sorted by time, the rate is not scaled if empty
+		std::vector<EmitterBurst>	m_vecBursts;	///< bursts sorted by time
+		FLOAT						m_fDuration;	///< length of a cycle, 0 to run for ever
+		BOOL						m_bLoop;		///< start again once the duration has passed
+		FLOAT						m_fTime;		///< time within the current cycle
+		FLOAT						m_fOwed;		///< fraction of a particle carried into the next update
+		UINT						m_nKey;			///< cursor into m_vecKeys, see FindKey()
+		UINT						m_nBurst;		///< next burst to fire this cycle
+		UINT						m_nSeed;		///< seed of the random numbers
+		UINT						m_nCounter;		///< random numbers drawn since the seed was set
+
+		static UINT					s_nNextSeed;	///< gives each emitter its own default seed
+
+	public:
+		UINT		Advance				(FLOAT a_fTimeDiff);
+		void		Restart				();
+		BOOL		IsActive			() const;
+
+		void		SetRate				(FLOAT a_fRate);
+		FLOAT		GetRate				() const;
+		void		AddRateKey			(FLOAT a_fTime, FLOAT a_fScale);
+		void		ClearRateKeys		();
+		FLOAT		GetRateAt			(FLOAT a_fTime) const;
+		void		AddBurst			(FLOAT a_fTime, UINT a_nCount);
+		void		ClearBursts			();
+		void		SetDuration			(FLOAT a_fDuration, BOOL a_bLoop);
+		FLOAT		GetDuration			() const;
+		BOOL		IsLooping			() const;
+		FLOAT		GetTime				() const;
+
+		void		SetSeed				(UINT a_nSeed);
+		UINT		GetSeed				() const;
+		FLOAT		Random				();
+		void		Uniform				(FLOAT* a_pOut, UINT a_nCount, FLOAT a_fMin, FLOAT a_fMax);
+		void		UniformDirections	(FLOAT* a_pX, FLOAT* a_pY, FLOAT* a_pZ, UINT a_nCount, FLOAT a_fMinLength, FLOAT a_fMaxLength);
+
+	protected:
+		FLOAT		IntegrateRate		(FLOAT a_fStart, FLOAT a_fEnd);
+	};
+}
+
+#endif
@@ -0,0 +1,519 @@
+#include "ParticleSimulation.h"
+#include "ParticleStage.h"
+#include <cmath>
+#include <cstring>
+
+namespace SGLib
+{
+	// vertices whose half floats are converted together by FillVertices()
+	static const UINT FILL_BLOCK = 64;
+
+	// largest integer a position or size is encoded as
+	static const FLOAT ENCODE_RANGE = 32767.0f;
+
+	/**
+	*	\brief	Rounds a value to the nearest integer an encoded position or size can hold
+	*	\param	FLOAT a_fValue - value in integer steps
+	*	\return	short - nearest integer, clamped to +-ENCODE_RANGE
+	*/
+
+	static inline short EncodeShort(FLOAT a_fValue)
+	{
+		a_fValue = (a_fValue < ENCODE_RANGE) ? a_fValue : ENCODE_RANGE;
+		a_fValue = (a_fValue > -ENCODE_RANGE) ? a_fValue : -ENCODE_RANGE;
+
+		// offset to be positive, where truncating rounds down
+		return (short)((INT)(a_fValue + (ENCODE_RANGE + 1.5f)) - (INT)(ENCODE_RANGE + 1.0f));
+	}
+
+	/**
+	*	\brief	ParticleSimulation constructor
+	*	\param	const Vector3& a_rvecAccel - acceleration set for each particle
+	*	\param	INT a_nMaxParticles - max number of particles permitted at any one time
+	*	\param	FLOAT a_fParticleTime - time delay on particle creation, sets the emitter's rate
+	*	\post	The store, sort and vertices are sized for a_nMaxParticles
+	*/
+
+	ParticleSimulation::ParticleSimulation(const Vector3& a_rvecAccel, INT a_nMaxParticles, FLOAT a_fParticleTime) :
+												m_fTime(0.0f),
+												m_vecAccel(a_rvecAccel),
+												m_nMaxParticles(a_nMaxParticles),
+												m_oEmitter(a_fParticleTime > 0.0f ? 1.0f / a_fParticleTime : 0.0f),
+												m_fPendingTime(0.0f),
+												m_bQueued(FALSE),
+												m_nVertices(0),
+												m_vecSortDir(0.0f, 0.0f, 0.0f),
+												m_fSortOffset(0.0f),
+												m_pCollider(NULL),
+												m_bWorldIsLocal(TRUE),
+												m_vecBoundsMin(0.0f, 0.0f, 0.0f),
+												m_vecBoundsMax(0.0f, 0.0f, 0.0f),
+												m_fMaxSize(0.0f),
+												m_vecDecodeOffset(0.0f, 0.0f, 0.0f),
+												m_vecDecodeScale(0.0f, 0.0f, 0.0f),
+												m_fDecodeSize(0.0f),
+												m_vecWorldMin(0.0f, 0.0f, 0.0f),
+												m_vecWorldMax(0.0f, 0.0f, 0.0f),
+												m_fBoundsMargin(0.0f)
+	{
+		m_oParticles.Resize(m_nMaxParticles);
+		m_vecVertices.resize(m_nMaxParticles);
+		m_oSort.Resize(m_nMaxParticles);
+		AffineIdentity(&m_oMatrixWorld);
+		AffineIdentity(&m_oMatrixLocal);
+	}
+
+	/**
+	*	\brief	ParticleSimulation destructor
+	*	\note	Takes the simulation out of ParticleStage if it is still queued
+	*/
+
+	ParticleSimulation::~ParticleSimulation()
+	{
+		if (m_bQueued)
+			ParticleStage::Dequeue(this);
+	}
+
+	/**
+	*	\brief	Queues the simulation to be stepped by ParticleStage::Run()
+	*	\param	FLOAT a_fTimeDiff - time to step by, added to any still pending
+	*	\param	const AffineMatrix& a_rMatWorld - takes the particles into world space, for the colliders,
+	*			the world box and the sort
+	*	\return	BOOL - FALSE if the emitter has nothing left to emit and no particles are alive, in which
+	*			case the time is added to the simulation's and nothing is queued
+	*	\note	The live particles are moved, aged and killed by SGLib::ParticleStore::IntegrateRange(),
+	*			then the particles the emitter has due are emitted in one batch and the particles are
+	*			sorted if there is a sort mode. The view they are sorted for is picked up here.
+	*/
+
+	BOOL ParticleSimulation::Step(FLOAT a_fTimeDiff, const AffineMatrix& a_rMatWorld)
+	{
+		if (!m_bQueued && !m_oEmitter.IsActive() && m_oParticles.GetNumAlive() == 0)
+		{
+			m_fTime += m_fPendingTime + a_fTimeDiff;
+			m_fPendingTime = 0.0f;
+			m_nVertices = 0;
+
+			return FALSE;
+		}
+
+		if (m_oSort.GetMode() != ParticleSort::SORT_NONE)
+		{
+			// depth = dot(world position - eye, dir), taken into the system's space
+			const Vector3& rvecDir = ParticleStage::GetViewDirection();
+			const Vector3& rvecEye = ParticleStage::GetViewPosition();
+
+			m_vecSortDir.x = a_rMatWorld(0, 0) * rvecDir.x + a_rMatWorld(0, 1) * rvecDir.y + a_rMatWorld(0, 2) * rvecDir.z;
+			m_vecSortDir.y = a_rMatWorld(1, 0) * rvecDir.x + a_rMatWorld(1, 1) * rvecDir.y + a_rMatWorld(1, 2) * rvecDir.z;
+			m_vecSortDir.z = a_rMatWorld(2, 0) * rvecDir.x + a_rMatWorld(2, 1) * rvecDir.y + a_rMatWorld(2, 2) * rvecDir.z;
+			m_fSortOffset = a_rMatWorld(3, 0) * rvecDir.x + a_rMatWorld(3, 1) * rvecDir.y + a_rMatWorld(3, 2) * rvecDir.z - Vec3Dot(&rvecEye, &rvecDir);
+		}
+
+		// the colliders and the world box are in world space, the particles in the system's
+		if (a_rMatWorld != m_oMatrixWorld)
+		{
+			AffineMatrix oIdentity;
+			AffineIdentity(&oIdentity);
+
+			m_oMatrixWorld = a_rMatWorld;
+			AffineInverse(&m_oMatrixLocal, NULL, &m_oMatrixWorld);
+			m_bWorldIsLocal = (m_oMatrixWorld == oIdentity);
+		}
+
+		m_fPendingTime += a_fTimeDiff;
+		ParticleStage::Queue(this);
+
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Accessor for the number of particles alive
+	*	\return	UINT - particles alive after the last update, plus any added since
+	*/
+
+	UINT ParticleSimulation::GetNumParticles() const
+	{
+		return m_oParticles.GetNumAlive();
+	}
+
+	/**
+	*	\brief	Writes every live particle in the vertex format
+	*	\param	ParticleVertex* a_pVertices - receives the particles, room for GetNumParticles() of them
+	*	\return	UINT - number of particles written
+	*	\note	Positions and sizes are encoded in the box measured by the last ParticleStage::Run(), those
+	*			outside it are clamped to its faces
+	*/
+
+	UINT ParticleSimulation::FillVertices(ParticleVertex* a_pVertices) const
+	{
+		UINT nCount = m_oParticles.GetNumAlive();
+
+		FillVertices(a_pVertices, 0, nCount);
+
+		return nCount;
+	}
+
+	/**
+	*	\brief	Writes a range of the live particles in the vertex format
+	*	\param	ParticleVertex* a_pVertices - receives the particles
+	*	\param	UINT a_nBegin - first vertex
+	*	\param	UINT a_nEnd - one past the last vertex, no more than GetNumParticles()
+	*	\param	const UINT* a_pOrder - slot each vertex is written from, NULL to write each particle at the
+	*			index of its slot
+	*	\note	The velocities, masses, ages and lives of FILL_BLOCK vertices are gathered and converted to
+	*			half floats in one call, so the conversion runs on whole SIMD registers
+	*/
+
+	void ParticleSimulation::FillVertices(ParticleVertex* a_pVertices, UINT a_nBegin, UINT a_nEnd, const UINT* a_pOrder) const
+	{
+		const FLOAT* pPos[3] = {	m_oParticles.GetStream(ParticleStore::POS_X), m_oParticles.GetStream(ParticleStore::POS_Y),
+									m_oParticles.GetStream(ParticleStore::POS_Z) };
+		const FLOAT* pHalfStreams[6] = {	m_oParticles.GetStream(ParticleStore::VEL_X), m_oParticles.GetStream(ParticleStore::VEL_Y),
+											m_oParticles.GetStream(ParticleStore::VEL_Z), m_oParticles.GetStream(ParticleStore::MASS),
+											m_oParticles.GetStream(ParticleStore::AGE), m_oParticles.GetStream(ParticleStore::LIFE) };
+		const FLOAT* pSize = m_oParticles.GetStream(ParticleStore::SIZE);
+		const UINT* pColours = m_oParticles.GetColours();
+
+		// integer steps per unit, a flat axis encodes everything at its centre
+		const FLOAT* pfOffset = &m_vecDecodeOffset.x;
+		const FLOAT* pfScale = &m_vecDecodeScale.x;
+		FLOAT afInvScale[3];
+
+		for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+			afInvScale[nAxis] = (pfScale[nAxis] > 0.0f) ? 1.0f / pfScale[nAxis] : 0.0f;
+
+		FLOAT fInvSize = (m_fDecodeSize > 0.0f) ? 1.0f / m_fDecodeSize : 0.0f;
+
+		FLOAT afHalves[FILL_BLOCK * 6];
+		unsigned short anHalves[FILL_BLOCK * 6];
+
+		for (UINT nBlock = a_nBegin; nBlock < a_nEnd; nBlock += FILL_BLOCK)
+		{
+			UINT nCount = (a_nEnd - nBlock > FILL_BLOCK) ? FILL_BLOCK : a_nEnd - nBlock;
+
+			for (UINT j = 0; j < nCount; ++j)
+			{
+				UINT i = a_pOrder ? a_pOrder[nBlock + j] : nBlock + j;
+
+				for (UINT k = 0; k < 6; ++k)
+					afHalves[j * 6 + k] = pHalfStreams[k][i];
+			}
+
+			Float32To16Array(anHalves, afHalves, nCount * 6);
+
+			for (UINT j = 0; j < nCount; ++j)
+			{
+				ParticleVertex& rVertex = a_pVertices[nBlock + j];
+				UINT i = a_pOrder ? a_pOrder[nBlock + j] : nBlock + j;
+
+				for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+					rVertex.aPosSize[nAxis] = EncodeShort((pPos[nAxis][i] - pfOffset[nAxis]) * afInvScale[nAxis]);
+
+				rVertex.aPosSize[3] = EncodeShort(pSize[i] * fInvSize);
+
+				const unsigned short* pHalf = &anHalves[j * 6];
+				rVertex.aVelMass[0] = pHalf[0];
+				rVertex.aVelMass[1] = pHalf[1];
+				rVertex.aVelMass[2] = pHalf[2];
+				rVertex.aVelMass[3] = pHalf[3];
+				rVertex.aAgeLife[0] = pHalf[4];
+				rVertex.aAgeLife[1] = pHalf[5];
+				rVertex.colInitial = pColours[i];
+			}
+		}
+	}
+
+	/**
+	*	\brief	Decodes a vertex on the CPU the way DecodeParticle() does in the shader
+	*	\param	const ParticleVertex& a_rVertex - vertex written since the last ParticleStage::Run()
+	*	\param	Particle* a_pParticle - receives the particle, vecInitPos and vecInitVec are the current
+	*			position and velocity and fInitTime is the system's time less the age
+	*/
+
+	void ParticleSimulation::DecodeVertex(const ParticleVertex& a_rVertex, Particle* a_pParticle) const
+	{
+		a_pParticle->vecInitPos = Vector3(	m_vecDecodeOffset.x + a_rVertex.aPosSize[0] * m_vecDecodeScale.x,
+											m_vecDecodeOffset.y + a_rVertex.aPosSize[1] * m_vecDecodeScale.y,
+											m_vecDecodeOffset.z + a_rVertex.aPosSize[2] * m_vecDecodeScale.z);
+		a_pParticle->vecInitVec = Vector3(	ScalarFloat16To32(a_rVertex.aVelMass[0]), ScalarFloat16To32(a_rVertex.aVelMass[1]),
+											ScalarFloat16To32(a_rVertex.aVelMass[2]));
+		a_pParticle->fInitSize = a_rVertex.aPosSize[3] * m_fDecodeSize;
+		a_pParticle->fInitTime = m_fTime - ScalarFloat16To32(a_rVertex.aAgeLife[0]);
+		a_pParticle->fLifeTime = ScalarFloat16To32(a_rVertex.aAgeLife[1]);
+		a_pParticle->fMass = ScalarFloat16To32(a_rVertex.aVelMass[3]);
+		a_pParticle->colInitial = a_rVertex.colInitial;
+	}
+
+	/**
+	*	\brief	Accessor for the vertices written by the last ParticleStage::Run()
+	*	\return	const ParticleVertex* - live particles in the vertex format, GetNumVertices() of them
+	*/
+
+	const ParticleVertex* ParticleSimulation::GetVertices() const
+	{
+		return m_vecVertices.empty() ? NULL : &m_vecVertices[0];
+	}
+
+	/**
+	*	\brief	Accessor for the number of vertices written by the last ParticleStage::Run()
+	*	\return	UINT - particles in GetVertices()
+	*/
+
+	UINT ParticleSimulation::GetNumVertices() const
+	{
+		return m_nVertices;
+	}
+
+	/**
+	*	\brief	Accessor for the particle storage
+	*	\return	const ParticleStore& - particles of the system, the live ones packed at the front
+	*/
+
+	const ParticleStore& ParticleSimulation::GetParticles() const
+	{
+		return m_oParticles;
+	}
+
+	/**
+	*	\brief	Accessor for the box around the live particles
+	*	\param	Vector3* a_pvecMin - receives the minimum corner in the system's space
+	*	\param	Vector3* a_pvecMax - receives the maximum corner in the system's space
+	*	\note	Measured by the last ParticleStage::Run(), it also holds the particles that died in it
+	*/
+
+	void ParticleSimulation::GetBounds(Vector3* a_pvecMin, Vector3* a_pvecMax) const
+	{
+		*a_pvecMin = m_vecBoundsMin;
+		*a_pvecMax = m_vecBoundsMax;
+	}
+
+	/**
+	*	\brief	Mutator for the box around the live particles, which is also the box the vertices are
+	*			encoded in
+	*	\param	const Vector3& a_rvecMin - minimum corner in the system's space
+	*	\param	const Vector3& a_rvecMax - maximum corner in the system's space
+	*	\param	FLOAT a_fMaxSize - largest size
+	*	\note	Called by ParticleStage::Run() before the vertices are written. Every vertex shares the
+	*			box, so positions are encoded to within its size / 65534 along each axis. The world box
+	*			is the smallest box around the corners of this one under the update world matrix.
+	*/
+
+	void ParticleSimulation::SetBounds(const Vector3& a_rvecMin, const Vector3& a_rvecMax, FLOAT a_fMaxSize)
+	{
+		m_vecBoundsMin = a_rvecMin;
+		m_vecBoundsMax = a_rvecMax;
+		m_fMaxSize = a_fMaxSize;
+
+		m_vecDecodeOffset = (a_rvecMin + a_rvecMax) * 0.5f;
+		m_vecDecodeScale = (a_rvecMax - a_rvecMin) * (0.5f / ENCODE_RANGE);
+		m_fDecodeSize = (a_fMaxSize > 0.0f) ? a_fMaxSize / ENCODE_RANGE : 0.0f;
+
+		// centre and half extent of the box, the extent along each world axis sums the local axes onto it
+		Vector3 vecCentre;
+		Vector3 vecExtent = (a_rvecMax - a_rvecMin) * 0.5f;
+		Vec3TransformCoord(&vecCentre, &m_vecDecodeOffset, &m_oMatrixWorld);
+
+		Vector3 vecWorldExtent;
+		vecWorldExtent.x = fabsf(m_oMatrixWorld(0, 0)) * vecExtent.x + fabsf(m_oMatrixWorld(1, 0)) * vecExtent.y + fabsf(m_oMatrixWorld(2, 0)) * vecExtent.z + m_fBoundsMargin;
+		vecWorldExtent.y = fabsf(m_oMatrixWorld(0, 1)) * vecExtent.x + fabsf(m_oMatrixWorld(1, 1)) * vecExtent.y + fabsf(m_oMatrixWorld(2, 1)) * vecExtent.z + m_fBoundsMargin;
+		vecWorldExtent.z = fabsf(m_oMatrixWorld(0, 2)) * vecExtent.x + fabsf(m_oMatrixWorld(1, 2)) * vecExtent.y + fabsf(m_oMatrixWorld(2, 2)) * vecExtent.z + m_fBoundsMargin;
+
+		m_vecWorldMin = vecCentre - vecWorldExtent;
+		m_vecWorldMax = vecCentre + vecWorldExtent;
+	}
+
+	/**
+	*	\brief	Accessor for the box around the live particles in world space
+	*	\param	Vector3* a_pvecMin - receives the minimum corner
+	*	\param	Vector3* a_pvecMax - receives the maximum corner
+	*	\note	Holds the box of GetBounds() under the world matrix of the last Step(), widened
+	*			by the bounds margin, so it holds every vertex the system draws
+	*/
+
+	void ParticleSimulation::GetWorldBounds(Vector3* a_pvecMin, Vector3* a_pvecMax) const
+	{
+		*a_pvecMin = m_vecWorldMin;
+		*a_pvecMax = m_vecWorldMax;
+	}
+
+	/**
+	*	\brief	Mutator for how far the world box reaches past the particles' positions
+	*	\param	FLOAT a_fMargin - distance in world units, about half the largest sprite's size
+	*	\note	Takes effect from the next ParticleStage::Run(). Without a margin the edges of sprites
+	*			whose centres are just outside the view can be culled.
+	*/
+
+	void ParticleSimulation::SetBoundsMargin(FLOAT a_fMargin)
+	{
+		m_fBoundsMargin = (a_fMargin > 0.0f) ? a_fMargin : 0.0f;
+	}
+
+	/**
+	*	\brief	Accessor for how far the world box reaches past the particles' positions
+	*	\return	FLOAT - margin in world units, 0 by default
+	*/
+
+	FLOAT ParticleSimulation::GetBoundsMargin() const
+	{
+		return m_fBoundsMargin;
+	}
+
+	/**
+	*	\brief	Mutator for how the vertices are ordered
+	*	\param	ParticleSort::Mode a_eMode - SORT_NONE to draw in slot order, SORT_FULL or SORT_INCREMENTAL to
+	*			draw back to front
+	*	\param	UINT a_nKeyBits - 16 for faster keys spread over the system's depth range, 32 for exact keys
+	*	\note	Takes effect from the next ParticleStage::Run()
+	*/
+
+	void ParticleSimulation::SetSortMode(ParticleSort::Mode a_eMode, UINT a_nKeyBits)
+	{
+		m_oSort.SetMode(a_eMode, a_nKeyBits);
+	}
+
+	/**
+	*	\brief	Accessor for how the vertices are ordered
+	*	\return	ParticleSort::Mode - mode given to SetSortMode()
+	*/
+
+	ParticleSort::Mode ParticleSimulation::GetSortMode() const
+	{
+		return m_oSort.GetMode();
+	}
+
+	/**
+	*	\brief	Accessor for the sort
+	*	\return	const ParticleSort& - order of the last vertices written and whether it was repaired
+	*/
+
+	const ParticleSort& ParticleSimulation::GetSort() const
+	{
+		return m_oSort;
+	}
+
+	/**
+	*	\brief	Mutator for what the particles collide with
+	*	\param	ParticleCollider* a_pCollider - world space colliders, not owned and may be shared, NULL for none
+	*	\note	Takes effect from the next ParticleStage::Run()
+	*/
+
+	void ParticleSimulation::SetCollider(ParticleCollider* a_pCollider)
+	{
+		m_pCollider = a_pCollider;
+	}
+
+	/**
+	*	\brief	Accessor for what the particles collide with
+	*	\return	ParticleCollider* - colliders given to SetCollider(), NULL for none
+	*/
+
+	ParticleCollider* ParticleSimulation::GetCollider() const
+	{
+		return m_pCollider;
+	}
+
+	/**
+	*	\brief	Accessor for the emitter that schedules the system's particles
+	*	\return	ParticleEmitter& - the system's emitter
+	*	\note	A ParticleSystem that has gone to sleep does not advance its emitter, call its Wake() after
+	*			changing it
+	*/
+
+	ParticleEmitter& ParticleSimulation::GetEmitter()
+	{
+		return m_oEmitter;
+	}
+
+	/**
+	*	\brief	Adds particles after the last live one and initialises them
+	*	\param	UINT a_nCount - particles wanted
+	*	\return	UINT - particles added
+	*	\note	Used by ParticleStage from worker threads. ParticleSystem::Emit() also wakes the system,
+	*			which would touch its parents from here
+	*/
+
+	UINT ParticleSimulation::EmitParticles(UINT a_nCount)
+	{
+		UINT nFirst;
+		UINT nAdded = m_oParticles.Allocate(a_nCount, &nFirst);
+
+		if (nAdded > 0)
+			InitParticles(nFirst, nAdded);
+
+		return nAdded;
+	}
+
+	/**
+	*	\brief	Initialises a range of newly allocated slots
+	*	\param	UINT a_nFirst - slot of the first particle
+	*	\param	UINT a_nCount - number of particles, in the slots following a_nFirst
+	*	\note	Derived classes should override this to write every stream of m_oParticles for the whole
+	*			range at once. This version fills in a Particle with InitParticle() for each slot, with
+	*			fInitTime defaulting to the current time, and stores it with SGLib::ParticleStore::Set().
+	*/
+
+	void ParticleSimulation::InitParticles(UINT a_nFirst, UINT a_nCount)
+	{
+		for (UINT nSlot = a_nFirst; nSlot < a_nFirst + a_nCount; ++nSlot)
+		{
+			Particle oPart;
+			memset(&oPart, 0, sizeof(Particle));
+			oPart.fInitTime = m_fTime;
+
+			InitParticle(&oPart);
+
+			m_oParticles.Set(nSlot, oPart.vecInitPos, oPart.vecInitVec, m_fTime - oPart.fInitTime, oPart.fLifeTime,
+							 oPart.fInitSize, oPart.fMass, oPart.colInitial);
+		}
+	}
+
+	/**
+	*	\brief	Initialises a single particle for the default InitParticles()
+	*	\param	Particle* a_pPart - particle to fill in, zeroed apart from fInitTime
+	*	\note	Does nothing, so a particle left with no life time dies on the next update. Derived classes
+	*			override either this or InitParticles().
+	*/
+
+	void ParticleSimulation::InitParticle(Particle* a_pPart)
+	{
+	}
+
+	/**
+	*	\brief	Accessor for the time the simulation has been running
+	*	\return	FLOAT - time stepped by every Run() so far
+	*/
+
+	FLOAT ParticleSimulation::GetTime()
+	{
+		return m_fTime;
+	}
+
+	/**
+	*	\brief	Converts vertices to the format with 32 bit floats
+	*	\param	ParticleVertexWide* a_pOut - receives the vertices, room for a_nCount
+	*	\param	const ParticleVertex* a_pIn - vertices to convert
+	*	\param	UINT a_nCount - number of vertices
+	*	\note	Every half float converts exactly, so a shader reads the same values from either format
+	*/
+
+	void ParticleSimulation::WidenVertices(ParticleVertexWide* a_pOut, const ParticleVertex* a_pIn, UINT a_nCount)
+	{
+		for (UINT i = 0; i < a_nCount; ++i)
+		{
+			memcpy(a_pOut[i].aPosSize, a_pIn[i].aPosSize, sizeof(a_pIn[i].aPosSize));
+			Float16To32Array(a_pOut[i].aVelMass, a_pIn[i].aVelMass, 4);
+			Float16To32Array(a_pOut[i].aAgeLife, a_pIn[i].aAgeLife, 2);
+			a_pOut[i].colInitial = a_pIn[i].colInitial;
+		}
+	}
+
+	/**
+	*	\brief	Called by ParticleStage::Run() once the vertices have been rewritten
+	*	\note	Runs on the thread that called Run(), after every job has finished. Does nothing here,
+	*			SGLib::ParticleSystem lists itself to be copied into the shared ring.
+	*/
+
+	void ParticleSimulation::OnSimulated()
+	{
+	}
+}
@@ -0,0 +1,142 @@
+/**
+*	\class		SGLib::ParticleSimulation
+*	\brief		The particles of a particle system and everything done to them on the CPU, without a device
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Holds the store, emitter, sort and collider of a particle effect and the vertices written from them,
+*	which is everything SGLib::ParticleStage works on. SGLib::ParticleSystem adds the node, the effect
+*	and the buffers the vertices are drawn from, so the simulation can be run and checked without
+*	DirectX.
+*
+*	Step() queues the simulation with the stage and Run() then moves, collides, kills, emits, sorts and
+*	writes the vertices. Derived classes initialise their new particles by overriding InitParticles() or
+*	InitParticle(), and hear that their vertices have been rewritten through OnSimulated().
+*
+*	Update 19/10/26 - WidenVertices() converts the vertices to SGLib::ParticleVertexWide, which has the
+*						same layout with 32 bit floats in place of the half floats, for devices whose
+*						declarations can't read half floats.
+*/
+
+#ifndef SGLIB_PARTICLESIMULATION
+#define SGLIB_PARTICLESIMULATION
+
+#pragma once
+
+#include "SGMath.h"
+#include "ParticleStore.h"
+#include "ParticleEmitter.h"
+#include "ParticleSort.h"
+#include "ParticleCollider.h"
+#include <vector>
+
+namespace SGLib
+{
+	// particle variables filled in by InitParticle()
+	struct Particle
+	{
+		Vector3		vecInitPos;	///< initial particle position
+		Vector3		vecInitVec;	///< initial particle velocity
+		FLOAT		fInitSize;	///< initial pixel size
+		FLOAT		fInitTime;	///< time created (with relation to particle system time)
+		FLOAT		fLifeTime;	///< life time
+		FLOAT		fMass;		///< particle mass
+		DWORD		colInitial;	///< initial particle colour, as a D3DCOLOR
+	};
+
+	// particle vertex format, decoded by the shader with DecodeParticle() from ParticleDecode.fxh
+	struct ParticleVertex
+	{
+		short			aPosSize[4];	///< position in the system's decode box, size as a share of the largest
+		unsigned short	aVelMass[4];	///< half float velocity and mass
+		unsigned short	aAgeLife[2];	///< half float age and life time
+		DWORD			colInitial;		///< particle colour, as a D3DCOLOR
+	};
+
+	// ParticleVertex with its half floats widened, for devices without D3DDECLTYPE_FLOAT16_2 and _4
+	struct ParticleVertexWide
+	{
+		short			aPosSize[4];	///< position in the system's decode box, size as a share of the largest
+		FLOAT			aVelMass[4];	///< velocity and mass
+		FLOAT			aAgeLife[2];	///< age and life time
+		DWORD			colInitial;		///< particle colour, as a D3DCOLOR
+	};
+
+	class ParticleSimulation
+	{
+		friend class ParticleStage;
+
+	public:
+		ParticleSimulation(const Vector3& a_rvecAccel, INT a_nMaxParticles, FLOAT a_fParticleTime);
+
+		virtual ~ParticleSimulation();
+
+	protected:
+		FLOAT					m_fTime;					///< time that the effect has been running
+		Vector3					m_vecAccel;					///< acceleration applied to all particles
+		INT						m_nMaxParticles;			///< max no of particles at any one time
+
+		ParticleStore			m_oParticles;				///< particles associated with this node, live ones packed at the front
+		ParticleEmitter			m_oEmitter;					///< decides when particles are emitted
+		FLOAT					m_fPendingTime;				///< time passed since the system was last simulated
+		BOOL					m_bQueued;					///< TRUE while waiting for ParticleStage::Run()
+		std::vector<ParticleVertex>	m_vecVertices;			///< live particles in the vertex format, written by ParticleStage
+		UINT					m_nVertices;				///< particles in m_vecVertices
+		ParticleSort			m_oSort;					///< orders the vertices back to front
+		Vector3					m_vecSortDir;				///< view direction in the system's space
+		FLOAT					m_fSortOffset;				///< added to dot(position, m_vecSortDir) to give the depth
+		ParticleCollider*		m_pCollider;				///< what the particles collide with, not owned
+		AffineMatrix			m_oMatrixWorld;				///< takes the particles into world space
+		AffineMatrix			m_oMatrixLocal;				///< inverse of m_oMatrixWorld
+		BOOL					m_bWorldIsLocal;			///< TRUE if m_oMatrixWorld is the identity
+		Vector3					m_vecBoundsMin;				///< minimum of the live particles' positions at the last Run()
+		Vector3					m_vecBoundsMax;				///< maximum of the live particles' positions at the last Run()
+		FLOAT					m_fMaxSize;					///< largest size of the live particles at the last Run()
+		Vector3					m_vecDecodeOffset;			///< centre of the box positions are encoded in
+		Vector3					m_vecDecodeScale;			///< position of one integer step along each axis
+		FLOAT					m_fDecodeSize;				///< size of one integer step
+		Vector3					m_vecWorldMin;				///< minimum of the box around m_vecBoundsMin and m_vecBoundsMax in world space
+		Vector3					m_vecWorldMax;				///< maximum of the box around m_vecBoundsMin and m_vecBoundsMax in world space
+		FLOAT					m_fBoundsMargin;			///< added to every side of the world box
+
+	public:
+		BOOL		Step(FLOAT a_fTimeDiff, const AffineMatrix& a_rMatWorld);
+
+		UINT		GetNumParticles() const;
+		UINT		FillVertices(ParticleVertex* a_pVertices) const;
+		void		FillVertices(ParticleVertex* a_pVertices, UINT a_nBegin, UINT a_nEnd, const UINT* a_pOrder = NULL) const;
+		void		DecodeVertex(const ParticleVertex& a_rVertex, Particle* a_pParticle) const;
+		const ParticleVertex*	GetVertices() const;
+		UINT		GetNumVertices() const;
+		const ParticleStore&	GetParticles() const;
+		void		GetBounds(Vector3* a_pvecMin, Vector3* a_pvecMax) const;
+
+		void		GetWorldBounds(Vector3* a_pvecMin, Vector3* a_pvecMax) const;
+		void		SetBoundsMargin(FLOAT a_fMargin);
+		FLOAT		GetBoundsMargin() const;
+
+		void		SetSortMode(ParticleSort::Mode a_eMode, UINT a_nKeyBits = 32);
+		ParticleSort::Mode	GetSortMode() const;
+		const ParticleSort&	GetSort() const;
+
+		void		SetCollider(ParticleCollider* a_pCollider);
+		ParticleCollider*	GetCollider() const;
+
+		FLOAT		GetTime();
+		ParticleEmitter&	GetEmitter();
+
+		static void	WidenVertices(ParticleVertexWide* a_pOut, const ParticleVertex* a_pIn, UINT a_nCount);
+
+		// initialise newly emitted particles, override one of them
+		virtual void	InitParticles(UINT a_nFirst, UINT a_nCount);
+		virtual void	InitParticle(Particle* a_pPart);
+
+	protected:
+		UINT		EmitParticles(UINT a_nCount);
+		void		SetBounds(const Vector3& a_rvecMin, const Vector3& a_rvecMax, FLOAT a_fMaxSize);
+
+		virtual void	OnSimulated();
+	};
+}
+
+#endif
@@ -0,0 +1,611 @@
+#include "ParticleSort.h"
+
+#if defined(SGLIB_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(SGLIB_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace SGLib
+{
+	/**
+	*	\brief	ParticleSort constructor
+	*	\note	Sorting is off until SetMode() is called
+	*/
+
+	ParticleSort::ParticleSort() :	m_eMode(SORT_NONE),
+									m_nKeyBits(32),
+									m_nSorted(0),
+									m_bRepaired(FALSE),
+									m_nMovedFrom(0)
+	{
+	}
+
+	/**
+	*	\brief	ParticleSort destructor
+	*/
+
+	ParticleSort::~ParticleSort()
+	{
+	}
+
+	/**
+	*	\brief	Mutator for how the particles are sorted
+	*	\param	Mode a_eMode - SORT_NONE, SORT_FULL or SORT_INCREMENTAL
+	*	\param	UINT a_nKeyBits - 16 for keys spread over the system's depth range, 32 for exact keys
+	*	\note	The next Sort() starts from scratch
+	*/
+
+	void ParticleSort::SetMode(Mode a_eMode, UINT a_nKeyBits)
+	{
+		m_eMode = a_eMode;
+		m_nKeyBits = (a_nKeyBits <= 16) ? 16 : 32;
+		m_nSorted = 0;
+	}
+
+	/**
+	*	\brief	Accessor for how the particles are sorted
+	*	\return	Mode - SORT_NONE, SORT_FULL or SORT_INCREMENTAL
+	*/
+
+	ParticleSort::Mode ParticleSort::GetMode() const
+	{
+		return m_eMode;
+	}
+
+	/**
+	*	\brief	Accessor for the key precision
+	*	\return	UINT - 16 or 32
+	*/
+
+	UINT ParticleSort::GetKeyBits() const
+	{
+		return m_nKeyBits;
+	}
+
+	/**
+	*	\brief	Allocates room to sort a store
+	*	\param	UINT a_nCapacity - capacity of the store, padding is added to match it
+	*/
+
+	void ParticleSort::Resize(UINT a_nCapacity)
+	{
+		UINT nPadded = (a_nCapacity + ParticleStore::PARTICLE_BLOCK - 1) / ParticleStore::PARTICLE_BLOCK * ParticleStore::PARTICLE_BLOCK;
+
+		m_arrSlotKeys.Resize(nPadded);
+		m_arrKeys.Resize(nPadded);
+		m_arrOrder.Resize(nPadded);
+		m_arrKeysTemp.Resize(nPadded);
+		m_arrOrderTemp.Resize(nPadded);
+		m_arrSeen.Resize((a_nCapacity + 31) / 32);
+		m_arrMoved.Resize((a_nCapacity + 31) / 32);
+
+		if (a_nCapacity)
+			memset(m_arrMoved.Data(), 0, (a_nCapacity + 31) / 32 * sizeof(UINT));
+
+		m_nSorted = 0;
+	}
+
+	/**
+	*	\brief	Notes slots that have been given another particle since the last Sort()
+	*	\param	const UINT* a_pSlots - slots of the dead particles killed, as listed by ParticleStore::IntegrateRange()
+	*	\param	UINT a_nCount - number of slots
+	*	\note	Only a hint for SORT_INCREMENTAL, which sorts these slots with the new particles rather
+	*			than repairing their places. A slot changed without being noted is still sorted correctly.
+	*/
+
+	void ParticleSort::MarkMoved(const UINT* a_pSlots, UINT a_nCount)
+	{
+		if (m_eMode != SORT_INCREMENTAL || m_nSorted == 0)
+			return;
+
+		UINT* pMoved = m_arrMoved.Data();
+
+		for (UINT i = 0; i < a_nCount; ++i)
+			pMoved[a_pSlots[i] >> 5] |= 1u << (a_pSlots[i] & 31);
+	}
+
+	/**
+	*	\brief	Notes that every slot from one on may have been given another particle since the last Sort()
+	*	\param	UINT a_nSlot - first slot, the live count once the dead are killed and before emitting
+	*	\note	Only a hint for SORT_INCREMENTAL, see MarkMoved()
+	*/
+
+	void ParticleSort::MarkMovedFrom(UINT a_nSlot)
+	{
+		if (a_nSlot < m_nMovedFrom)
+			m_nMovedFrom = a_nSlot;
+	}
+
+	/**
+	*	\brief	Orders the live particles of a store from the farthest to the nearest
+	*	\param	const ParticleStore& a_rStore - store to sort, Resize() must have been given its capacity
+	*	\param	const Vector3& a_rvecDir - view direction in the space of the positions
+	*	\param	FLOAT a_fOffset - added to dot(position, a_rvecDir) to give the depth
+	*	\note	Does nothing with SORT_NONE
+	*/
+
+	void ParticleSort::Sort(const ParticleStore& a_rStore, const Vector3& a_rvecDir, FLOAT a_fOffset)
+	{
+		UINT nCount = a_rStore.GetNumAlive();
+
+		m_bRepaired = FALSE;
+
+		if (m_eMode == SORT_NONE || nCount == 0)
+		{
+			m_nSorted = 0;
+			m_nMovedFrom = a_rStore.GetCapacity();
+			return;
+		}
+
+		const FLOAT* pPosX = a_rStore.GetStream(ParticleStore::POS_X);
+		const FLOAT* pPosY = a_rStore.GetStream(ParticleStore::POS_Y);
+		const FLOAT* pPosZ = a_rStore.GetStream(ParticleStore::POS_Z);
+
+		if (m_eMode == SORT_INCREMENTAL)
+		{
+			DepthKeys(m_arrSlotKeys.Data(), pPosX, pPosY, pPosZ, nCount, a_rvecDir, a_fOffset, m_nKeyBits);
+
+			m_bRepaired = Repair(nCount);
+
+			// the marks are only needed once
+			memset(m_arrMoved.Data(), 0, m_arrMoved.Size() * sizeof(UINT));
+			m_nMovedFrom = a_rStore.GetCapacity();
+
+			if (!m_bRepaired)
+			{
+				memcpy(m_arrKeys.Data(), m_arrSlotKeys.Data(), nCount * sizeof(UINT));
+				SortAll(nCount);
+			}
+		}
+		else
+		{
+			DepthKeys(m_arrKeys.Data(), pPosX, pPosY, pPosZ, nCount, a_rvecDir, a_fOffset, m_nKeyBits);
+			SortAll(nCount);
+		}
+
+		m_nSorted = nCount;
+	}
+
+	/**
+	*	\brief	Accessor for the order from the last Sort()
+	*	\return	const UINT* - GetNumSorted() slots, the farthest first
+	*/
+
+	const UINT* ParticleSort::GetOrder() const
+	{
+		return m_arrOrder.Data();
+	}
+
+	/**
+	*	\brief	Accessor for the number of slots ordered by the last Sort()
+	*	\return	UINT - live particles when it ran, 0 with SORT_NONE
+	*/
+
+	UINT ParticleSort::GetNumSorted() const
+	{
+		return m_nSorted;
+	}
+
+	/**
+	*	\brief	Whether the last Sort() got away with repairing the previous order
+	*	\return	BOOL - TRUE if SORT_INCREMENTAL did not have to radix sort the whole system
+	*/
+
+	BOOL ParticleSort::WasRepaired() const
+	{
+		return m_bRepaired;
+	}
+
+	/**
+	*	\brief	Works out the sort key of each particle from its depth along a direction
+	*	\param	UINT* a_pKeys - receives the keys, room for a_nCount rounded up to ParticleStore::PARTICLE_BLOCK
+	*	\param	const FLOAT* a_pPosX - x positions, a stream of a ParticleStore
+	*	\param	const FLOAT* a_pPosY - y positions
+	*	\param	const FLOAT* a_pPosZ - z positions
+	*	\param	UINT a_nCount - number of particles
+	*	\param	const Vector3& a_rvecDir - view direction
+	*	\param	FLOAT a_fOffset - added to dot(position, a_rvecDir) to give the depth
+	*	\param	UINT a_nKeyBits - 32 for the depth's float bits, 16 for the depth spread over 0 to 65535
+	*			between the farthest and the nearest particle
+	*	\note	The farther the particle the smaller its key. The padding after the last particle gets keys as
+	*			well, which costs less than a tail loop. The SIMD paths perform the same operations in the
+	*			same order as the scalar path so they give identical keys.
+	*/
+
+	void ParticleSort::DepthKeys(UINT* a_pKeys, const FLOAT* a_pPosX, const FLOAT* a_pPosY, const FLOAT* a_pPosZ, UINT a_nCount,
+								 const Vector3& a_rvecDir, FLOAT a_fOffset, UINT a_nKeyBits)
+	{
+		UINT nEnd = (a_nCount + ParticleStore::PARTICLE_BLOCK - 1) / ParticleStore::PARTICLE_BLOCK * ParticleStore::PARTICLE_BLOCK;
+		FLOAT* pDepth = reinterpret_cast<FLOAT*>(a_pKeys);
+		UINT i = 0;
+
+		// the depths are written over the keys first
+#if defined(SGLIB_SIMD_AVX2)
+		__m256 vDirX8 = _mm256_set1_ps(a_rvecDir.x);
+		__m256 vDirY8 = _mm256_set1_ps(a_rvecDir.y);
+		__m256 vDirZ8 = _mm256_set1_ps(a_rvecDir.z);
+		__m256 vOffset8 = _mm256_set1_ps(a_fOffset);
+
+		for (; i < nEnd; i += 8)
+		{
+			__m256 vDepth = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a_pPosX + i), vDirX8), _mm256_mul_ps(_mm256_loadu_ps(a_pPosY + i), vDirY8));
+			vDepth = _mm256_add_ps(_mm256_add_ps(vDepth, _mm256_mul_ps(_mm256_loadu_ps(a_pPosZ + i), vDirZ8)), vOffset8);
+
+			_mm256_storeu_ps(pDepth + i, vDepth);
+		}
+#elif defined(SGLIB_SIMD_SSE2)
+		__m128 vDirX = _mm_set1_ps(a_rvecDir.x);
+		__m128 vDirY = _mm_set1_ps(a_rvecDir.y);
+		__m128 vDirZ = _mm_set1_ps(a_rvecDir.z);
+		__m128 vOffset = _mm_set1_ps(a_fOffset);
+
+		for (; i < nEnd; i += 4)
+		{
+			__m128 vDepth = _mm_add_ps(_mm_mul_ps(_mm_load_ps(a_pPosX + i), vDirX), _mm_mul_ps(_mm_load_ps(a_pPosY + i), vDirY));
+			vDepth = _mm_add_ps(_mm_add_ps(vDepth, _mm_mul_ps(_mm_load_ps(a_pPosZ + i), vDirZ)), vOffset);
+
+			_mm_store_ps(pDepth + i, vDepth);
+		}
+#endif
+
+		for (; i < nEnd; ++i)
+			pDepth[i] = ((a_pPosX[i] * a_rvecDir.x + a_pPosY[i] * a_rvecDir.y) + a_pPosZ[i] * a_rvecDir.z) + a_fOffset;
+
+		if (a_nKeyBits > 16)
+		{
+			// flipping the sign bit of positive floats and every bit of negative ones makes them order as
+			// unsigned integers, inverting that puts the farthest first
+			i = 0;
+
+#if defined(SGLIB_SIMD_AVX2)
+			__m256i vSign8 = _mm256_set1_epi32(0x80000000);
+			__m256i vOnes8 = _mm256_set1_epi32(-1);
+
+			for (; i < nEnd; i += 8)
+			{
+				__m256i vBits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_pKeys + i));
+				__m256i vMask = _mm256_or_si256(_mm256_srai_epi32(vBits, 31), vSign8);
+
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(a_pKeys + i), _mm256_xor_si256(vBits, _mm256_xor_si256(vMask, vOnes8)));
+			}
+#elif defined(SGLIB_SIMD_SSE2)
+			__m128i vSign = _mm_set1_epi32(0x80000000);
+			__m128i vOnes = _mm_set1_epi32(-1);
+
+			for (; i < nEnd; i += 4)
+			{
+				__m128i vBits = _mm_load_si128(reinterpret_cast<const __m128i*>(a_pKeys + i));
+				__m128i vMask = _mm_or_si128(_mm_srai_epi32(vBits, 31), vSign);
+
+				_mm_store_si128(reinterpret_cast<__m128i*>(a_pKeys + i), _mm_xor_si128(vBits, _mm_xor_si128(vMask, vOnes)));
+			}
+#endif
+
+			for (; i < nEnd; ++i)
+			{
+				UINT nMask = (UINT)((INT)a_pKeys[i] >> 31) | 0x80000000;
+				a_pKeys[i] = a_pKeys[i] ^ ~nMask;
+			}
+
+			return;
+		}
+
+		// the range of the live particles only, the padding may lie outside it
+		FLOAT fMin = pDepth[0];
+		FLOAT fMax = pDepth[0];
+		i = 0;
+
+#if defined(SGLIB_SIMD_SSE2)
+		if (a_nCount >= 4)
+		{
+			__m128 vMin = _mm_load_ps(pDepth);
+			__m128 vMax = vMin;
+
+			for (i = 4; i + 4 <= a_nCount; i += 4)
+			{
+				__m128 vDepth = _mm_load_ps(pDepth + i);
+				vMin = _mm_min_ps(vMin, vDepth);
+				vMax = _mm_max_ps(vMax, vDepth);
+			}
+
+			FLOAT afMin[4];
+			FLOAT afMax[4];
+			_mm_storeu_ps(afMin, vMin);
+			_mm_storeu_ps(afMax, vMax);
+
+			for (UINT j = 0; j < 4; ++j)
+			{
+				fMin = (afMin[j] < fMin) ? afMin[j] : fMin;
+				fMax = (afMax[j] > fMax) ? afMax[j] : fMax;
+			}
+		}
+#endif
+
+		for (; i < a_nCount; ++i)
+		{
+			fMin = (pDepth[i] < fMin) ? pDepth[i] : fMin;
+			fMax = (pDepth[i] > fMax) ? pDepth[i] : fMax;
+		}
+
+		FLOAT fScale = (fMax > fMin) ? 65535.0f / (fMax - fMin) : 0.0f;
+		i = 0;
+
+#if defined(SGLIB_SIMD_AVX2)
+		__m256 vMax8 = _mm256_set1_ps(fMax);
+		__m256 vScale8 = _mm256_set1_ps(fScale);
+		__m256 vTop8 = _mm256_set1_ps(65535.0f);
+
+		for (; i < nEnd; i += 8)
+		{
+			__m256 vKey = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(vMax8, _mm256_loadu_ps(pDepth + i)), vScale8), vTop8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(a_pKeys + i), _mm256_cvttps_epi32(vKey));
+		}
+#elif defined(SGLIB_SIMD_SSE2)
+		__m128 vMax = _mm_set1_ps(fMax);
+		__m128 vScale = _mm_set1_ps(fScale);
+		__m128 vTop = _mm_set1_ps(65535.0f);
+
+		for (; i < nEnd; i += 4)
+		{
+			__m128 vKey = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(vMax, _mm_load_ps(pDepth + i)), vScale), vTop);
+			_mm_store_si128(reinterpret_cast<__m128i*>(a_pKeys + i), _mm_cvttps_epi32(vKey));
+		}
+#endif
+
+		for (; i < nEnd; ++i)
+		{
+			FLOAT fKey = (fMax - pDepth[i]) * fScale;
+			a_pKeys[i] = (UINT)(INT)((fKey < 65535.0f) ? fKey : 65535.0f);
+		}
+	}
+
+	/**
+	*	\brief	Stable least significant digit radix sort of keys and the values that go with them
+	*	\param	UINT* a_pKeys - keys to sort, sorted on return
+	*	\param	UINT* a_pValues - values moved with the keys
+	*	\param	UINT a_nCount - number of keys
+	*	\param	UINT a_nKeyBits - 16 or 32, 16 bit keys must have their top bits clear
+	*	\param	UINT* a_pKeysTemp - scratch, room for a_nCount
+	*	\param	UINT* a_pValuesTemp - scratch, room for a_nCount
+	*	\note	All the digits are counted in one pass over the keys. A digit that is the same for every
+	*			key is skipped, so depths packed into a narrow range cost fewer passes.
+	*/
+
+	void ParticleSort::RadixSort(UINT* a_pKeys, UINT* a_pValues, UINT a_nCount, UINT a_nKeyBits, UINT* a_pKeysTemp, UINT* a_pValuesTemp)
+	{
+		if (a_nCount < 2)
+			return;
+
+		UINT nPasses = (a_nKeyBits <= 16) ? 2 : 4;
+		UINT anCounts[4][256];
+
+		memset(anCounts, 0, sizeof(anCounts));
+
+		if (nPasses == 2)
+		{
+			for (UINT i = 0; i < a_nCount; ++i)
+			{
+				UINT nKey = a_pKeys[i];
+
+				++anCounts[0][nKey & 0xFF];
+				++anCounts[1][(nKey >> 8) & 0xFF];
+			}
+		}
+		else
+		{
+			for (UINT i = 0; i < a_nCount; ++i)
+			{
+				UINT nKey = a_pKeys[i];
+
+				++anCounts[0][nKey & 0xFF];
+				++anCounts[1][(nKey >> 8) & 0xFF];
+				++anCounts[2][(nKey >> 16) & 0xFF];
+				++anCounts[3][nKey >> 24];
+			}
+		}
+
+		UINT* pKeys = a_pKeys;
+		UINT* pValues = a_pValues;
+		UINT* pKeysOut = a_pKeysTemp;
+		UINT* pValuesOut = a_pValuesTemp;
+
+		for (UINT nPass = 0; nPass < nPasses; ++nPass)
+		{
+			UINT nShift = nPass * 8;
+			UINT* pCounts = anCounts[nPass];
+
+			if (pCounts[(pKeys[0] >> nShift) & 0xFF] == a_nCount)
+				continue;
+
+			// counts to the offset each digit starts at
+			UINT nOffset = 0;
+
+			for (UINT nDigit = 0; nDigit < 256; ++nDigit)
+			{
+				UINT nDigitCount = pCounts[nDigit];
+				pCounts[nDigit] = nOffset;
+				nOffset += nDigitCount;
+			}
+
+			for (UINT i = 0; i < a_nCount; ++i)
+			{
+				UINT nKey = pKeys[i];
+				UINT nDest = pCounts[(nKey >> nShift) & 0xFF]++;
+
+				pKeysOut[nDest] = nKey;
+				pValuesOut[nDest] = pValues[i];
+			}
+
+			UINT* pSwap = pKeys;
+			pKeys = pKeysOut;
+			pKeysOut = pSwap;
+
+			pSwap = pValues;
+			pValues = pValuesOut;
+			pValuesOut = pSwap;
+		}
+
+		if (pKeys != a_pKeys)
+		{
+			memcpy(a_pKeys, pKeys, a_nCount * sizeof(UINT));
+			memcpy(a_pValues, pValues, a_nCount * sizeof(UINT));
+		}
+	}
+
+	/**
+	*	\brief	Radix sorts every slot by the keys in m_arrKeys
+	*	\param	UINT a_nCount - live particles
+	*/
+
+	void ParticleSort::SortAll(UINT a_nCount)
+	{
+		UINT* pOrder = m_arrOrder.Data();
+
+		for (UINT i = 0; i < a_nCount; ++i)
+			pOrder[i] = i;
+
+		RadixSort(m_arrKeys.Data(), pOrder, a_nCount, m_nKeyBits, m_arrKeysTemp.Data(), m_arrOrderTemp.Data());
+	}
+
+	/**
+	*	\brief	Brings the previous order up to date with the keys in m_arrSlotKeys
+	*	\param	UINT a_nCount - live particles
+	*	\return	BOOL - FALSE if too many particles were out of place, the order is then left in pieces
+	*	\note	Slots that are no longer live or have been marked as moved are dropped. The rest are insertion sorted, each moving at
+	*			most REPAIR_MOVES places. Particles further out of place than that, and the slots missing
+	*			from the previous order as they hold particles emitted since, are radix sorted on their
+	*			own and merged in after the placed particles at the same key.
+	*/
+
+	BOOL ParticleSort::Repair(UINT a_nCount)
+	{
+		UINT* pOrder = m_arrOrder.Data();
+		UINT* pKeys = m_arrKeys.Data();
+		const UINT* pSlotKeys = m_arrSlotKeys.Data();
+		UINT* pSeen = m_arrSeen.Data();
+		const UINT* pMoved = m_arrMoved.Data();
+
+		memset(pSeen, 0, (a_nCount + 31) / 32 * sizeof(UINT));
+
+		UINT nKept = 0;
+
+		for (UINT i = 0; i < m_nSorted; ++i)
+		{
+			UINT nSlot = pOrder[i];
+
+			if (nSlot < a_nCount && nSlot < m_nMovedFrom && !(pMoved[nSlot >> 5] & (1u << (nSlot & 31))))
+			{
+				pSeen[nSlot >> 5] |= 1u << (nSlot & 31);
+				pOrder[nKept] = nSlot;
+				pKeys[nKept] = pSlotKeys[nSlot];
+				++nKept;
+			}
+		}
+
+		// insertion sort, a particle that would have to move more than REPAIR_MOVES places is set aside
+		// to be sorted with the new ones, usually one moved into the slot of a dead particle
+		UINT* pAsideKeys = m_arrKeysTemp.Data();
+		UINT* pAsideOrder = m_arrOrderTemp.Data();
+		UINT nAside = 0;
+		UINT nPlaced = 0;
+
+		for (UINT i = 0; i < nKept; ++i)
+		{
+			UINT nKey = pKeys[i];
+			UINT nSlot = pOrder[i];
+			UINT j = nPlaced;
+
+			while (j > 0 && pKeys[j - 1] > nKey && nPlaced - j < REPAIR_MOVES)
+				--j;
+
+			if (j > 0 && pKeys[j - 1] > nKey)
+			{
+				pAsideKeys[nAside] = nKey;
+				pAsideOrder[nAside++] = nSlot;
+				continue;
+			}
+
+			for (UINT k = nPlaced; k > j; --k)
+			{
+				pKeys[k] = pKeys[k - 1];
+				pOrder[k] = pOrder[k - 1];
+			}
+
+			pKeys[j] = nKey;
+			pOrder[j] = nSlot;
+			++nPlaced;
+		}
+
+		if (nAside * REPAIR_SHARE > nKept)
+			return FALSE;
+
+		// the particles set aside and those emitted since follow the placed ones
+		UINT* pNewOrder = pOrder + nPlaced;
+		UINT* pNewKeys = pKeys + nPlaced;
+		UINT nNew = nAside;
+
+		memcpy(pNewKeys, pAsideKeys, nAside * sizeof(UINT));
+		memcpy(pNewOrder, pAsideOrder, nAside * sizeof(UINT));
+
+		for (UINT nBase = 0; nBase < a_nCount; nBase += 32)
+		{
+			UINT nBits = pSeen[nBase >> 5];
+
+			if (nBits == 0xFFFFFFFF)
+				continue;
+
+			UINT nLast = (a_nCount - nBase > 32) ? nBase + 32 : a_nCount;
+
+			for (UINT nSlot = nBase; nSlot < nLast; ++nSlot)
+			{
+				if (!(nBits & (1u << (nSlot & 31))))
+				{
+					pNewOrder[nNew] = nSlot;
+					pNewKeys[nNew] = pSlotKeys[nSlot];
+					++nNew;
+				}
+			}
+		}
+
+		if (nNew == 0)
+			return TRUE;
+
+		RadixSort(pNewKeys, pNewOrder, nNew, m_nKeyBits, m_arrKeysTemp.Data(), m_arrOrderTemp.Data());
+
+		if (nPlaced == 0)
+			return TRUE;
+
+		// merged from the back, so only the placed particles after the first new one are moved
+		UINT* pNewKeysCopy = m_arrKeysTemp.Data();
+		UINT* pNewOrderCopy = m_arrOrderTemp.Data();
+
+		memcpy(pNewKeysCopy, pNewKeys, nNew * sizeof(UINT));
+		memcpy(pNewOrderCopy, pNewOrder, nNew * sizeof(UINT));
+
+		UINT nA = nPlaced;
+		UINT nB = nNew;
+		UINT nOut = nPlaced + nNew;
+
+		while (nB > 0)
+		{
+			if (nA > 0 && pKeys[nA - 1] > pNewKeysCopy[nB - 1])
+			{
+				--nA;
+				--nOut;
+				pKeys[nOut] = pKeys[nA];
+				pOrder[nOut] = pOrder[nA];
+			}
+			else
+			{
+				--nB;
+				--nOut;
+				pKeys[nOut] = pNewKeysCopy[nB];
+				pOrder[nOut] = pNewOrderCopy[nB];
+			}
+		}
+
+		return TRUE;
+	}
+}
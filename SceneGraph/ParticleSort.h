@@ -0,0 +1,97 @@
+/**
+*	\class		SGLib::ParticleSort
+*	\brief		Orders a particle store back to front along the view direction with a radix sort
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Alpha blended particles have to be drawn from the farthest to the nearest. Sort() works out each live
+*	particle's depth along the view direction from the store's position streams in one SIMD pass,
+*	turns it into an integer key that is smaller the farther away the particle is and sorts the slots
+*	by key with a least significant digit radix sort, 8 bits a pass:
+*
+*		- 32 bit keys are the depth's float bits made to order as unsigned integers, exact but 4 passes
+*		- 16 bit keys are the depth spread linearly over the system's nearest and farthest particle,
+*		  2 passes and close enough for most effects
+*
+*	A pass whose digit is the same for every key is skipped, and the sort is stable so particles at the
+*	same depth keep their order from frame to frame. GetOrder() then lists the slots to draw, first to
+*	last, and ParticleStage writes the vertices in that order.
+*
+*	SORT_INCREMENTAL amortises the sort across frames. Particles only move a little each frame, so the
+*	last frame's order is nearly right for this one. It is taken again without the slots that are no
+*	longer live and repaired with an insertion sort that moves a particle at most REPAIR_MOVES places.
+*	Particles further out of place are set aside and radix sorted with the particles emitted since, then
+*	merged in. A slot that a kill has moved another particle into, or that an emission has reused, would
+*	be far out of place, so ParticleStage reports them with MarkMoved() and MarkMovedFrom() and they are
+*	sorted as new particles from the start. When more than one particle in
+*	REPAIR_SHARE is set aside, after a cut or a quick turn of the camera, the whole system is radix
+*	sorted instead.
+*
+*	The order only depends on the positions and the view, so it is the same whichever thread sorts.
+*	Nothing here depends on the device.
+*/
+
+#ifndef SGLIB_PARTICLESORT
+#define SGLIB_PARTICLESORT
+
+#pragma once
+
+#include "SGMath.h"
+#include "ParticleStore.h"
+
+namespace SGLib
+{
+	class ParticleSort
+	{
+	public:
+		enum Mode
+		{
+			SORT_NONE,			///< draw the particles in slot order
+			SORT_FULL,			///< radix sort every frame
+			SORT_INCREMENTAL	///< repair the last frame's order, radix sort when that fails
+		};
+
+		static const UINT REPAIR_MOVES = 8;	///< places the insertion sort moves a particle before setting it aside
+		static const UINT REPAIR_SHARE = 4;	///< SORT_INCREMENTAL radix sorts everything once more than one in this many is set aside
+
+		ParticleSort();
+		~ParticleSort();
+
+	protected:
+		Mode					m_eMode;		///< how the particles are sorted
+		UINT					m_nKeyBits;		///< 16 or 32
+		UINT					m_nSorted;		///< slots in m_arrOrder
+		BOOL					m_bRepaired;	///< TRUE if the last Sort() repaired the previous order
+		AlignedArray<UINT>		m_arrSlotKeys;	///< key of each slot, for SORT_INCREMENTAL
+		AlignedArray<UINT>		m_arrKeys;		///< keys in the order of m_arrOrder
+		AlignedArray<UINT>		m_arrOrder;		///< slots from back to front
+		AlignedArray<UINT>		m_arrKeysTemp;	///< radix sort and merge scratch
+		AlignedArray<UINT>		m_arrOrderTemp;	///< radix sort and merge scratch
+		AlignedArray<UINT>		m_arrSeen;		///< one bit per slot already in the repaired order
+		AlignedArray<UINT>		m_arrMoved;		///< one bit per slot given another particle since the last Sort()
+		UINT					m_nMovedFrom;	///< every slot from this one on holds another particle
+
+	public:
+		void		SetMode		(Mode a_eMode, UINT a_nKeyBits = 32);
+		Mode		GetMode		() const;
+		UINT		GetKeyBits	() const;
+		void		Resize		(UINT a_nCapacity);
+
+		void		MarkMoved	(const UINT* a_pSlots, UINT a_nCount);
+		void		MarkMovedFrom(UINT a_nSlot);
+		void		Sort		(const ParticleStore& a_rStore, const Vector3& a_rvecDir, FLOAT a_fOffset);
+		const UINT*	GetOrder	() const;
+		UINT		GetNumSorted() const;
+		BOOL		WasRepaired	() const;
+
+		static void	DepthKeys	(UINT* a_pKeys, const FLOAT* a_pPosX, const FLOAT* a_pPosY, const FLOAT* a_pPosZ, UINT a_nCount,
+								 const Vector3& a_rvecDir, FLOAT a_fOffset, UINT a_nKeyBits);
+		static void	RadixSort	(UINT* a_pKeys, UINT* a_pValues, UINT a_nCount, UINT a_nKeyBits, UINT* a_pKeysTemp, UINT* a_pValuesTemp);
+
+	protected:
+		void		SortAll		(UINT a_nCount);
+		BOOL		Repair		(UINT a_nCount);
+	};
+}
+
+#endif
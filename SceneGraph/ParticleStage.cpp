@@ -0,0 +1,295 @@
+#include "ParticleStage.h"
+#include "ParticleSimulation.h"
+#include <algorithm>
+#include <cfloat>
+
+using std::vector;
+
+namespace SGLib
+{
+	vector<ParticleSimulation*>			ParticleStage::s_vecQueued;
+	vector<ParticleStage::Entry>	ParticleStage::s_vecEntries;
+	vector<ParticleStage::Chunk>	ParticleStage::s_vecChunks;
+	vector<UINT>					ParticleStage::s_vecDead;
+	Vector3							ParticleStage::s_vecViewPos(0.0f, 0.0f, 0.0f);
+	Vector3							ParticleStage::s_vecViewDir(0.0f, 0.0f, 1.0f);
+
+	/**
+	*	\brief	Adds a system to those simulated by the next Run()
+	*	\param	ParticleSimulation* a_pSystem - system to add, nothing happens if it is already queued
+	*	\note	Called by ParticleSimulation::Step(), not to be called while Run() is running
+	*/
+
+	void ParticleStage::Queue(ParticleSimulation* a_pSystem)
+	{
+		if (a_pSystem && !a_pSystem->m_bQueued)
+		{
+			a_pSystem->m_bQueued = TRUE;
+			s_vecQueued.push_back(a_pSystem);
+		}
+	}
+
+	/**
+	*	\brief	Removes a system from those simulated by the next Run(), its pending time is kept
+	*	\param	ParticleSimulation* a_pSystem - system to remove
+	*	\note	Called by the ParticleSimulation destructor, not to be called while Run() is running
+	*/
+
+	void ParticleStage::Dequeue(ParticleSimulation* a_pSystem)
+	{
+		vector<ParticleSimulation*>::iterator iter = std::find(s_vecQueued.begin(), s_vecQueued.end(), a_pSystem);
+
+		if (iter != s_vecQueued.end())
+		{
+			(*iter)->m_bQueued = FALSE;
+			s_vecQueued.erase(iter);
+		}
+	}
+
+	/**
+	*	\brief	Accessor for the number of systems waiting for Run()
+	*	\return	UINT - systems updated since the last Run()
+	*/
+
+	UINT ParticleStage::GetNumQueued()
+	{
+		return (UINT)s_vecQueued.size();
+	}
+
+	/**
+	*	\brief	Simulates every queued system by its pending time and writes its vertices
+	*	\note	Called by SGRenderer::Update() after the update pass. Each system's OnSimulated() is called
+	*			on this thread once every job has finished.
+	*/
+
+	void ParticleStage::Run()
+	{
+		if (s_vecQueued.empty())
+			return;
+
+		s_vecEntries.resize(s_vecQueued.size());
+		s_vecChunks.clear();
+
+		for (UINT i = 0; i < s_vecEntries.size(); ++i)
+		{
+			Entry& rEntry = s_vecEntries[i];
+			rEntry.pSystem = s_vecQueued[i];
+			rEntry.nFirstChunk = (UINT)s_vecChunks.size();
+			rEntry.nChunks = BuildChunks(i);
+
+			// the colliders are only read from here on, possibly by several systems at once
+			if (rEntry.pSystem->m_pCollider)
+				rEntry.pSystem->m_pCollider->Build();
+		}
+
+		s_vecQueued.clear();
+
+		// every chunk gets room to list all of its particles as dead
+		UINT nDeadRoom = 0;
+
+		for (UINT i = 0; i < s_vecChunks.size(); ++i)
+		{
+			s_vecChunks[i].nFirstDead = nDeadRoom;
+			nDeadRoom += s_vecChunks[i].nEnd - s_vecChunks[i].nBegin;
+		}
+
+		if (s_vecDead.size() < nDeadRoom)
+			s_vecDead.resize(nDeadRoom);
+
+		JobSystem::ParallelFor((UINT)s_vecChunks.size(), 1, IntegrateRange, NULL);
+		JobSystem::ParallelFor((UINT)s_vecEntries.size(), 1, FinishRange, NULL);
+
+		// the live particles have changed, so chunk them again for the vertices
+		s_vecChunks.clear();
+
+		for (UINT i = 0; i < s_vecEntries.size(); ++i)
+			BuildChunks(i);
+
+		JobSystem::ParallelFor((UINT)s_vecChunks.size(), 1, FillRange, NULL);
+
+		for (UINT i = 0; i < s_vecEntries.size(); ++i)
+			s_vecEntries[i].pSystem->OnSimulated();
+	}
+
+	/**
+	*	\brief	Mutator for the view the sorted systems are ordered for
+	*	\param	const Vector3& a_rvecPos - camera position in world space
+	*	\param	const Vector3& a_rvecDir - direction the camera looks along in world space, normalised
+	*	\note	Systems pick the view up in their Update(), so set it before the update pass
+	*/
+
+	void ParticleStage::SetView(const Vector3& a_rvecPos, const Vector3& a_rvecDir)
+	{
+		s_vecViewPos = a_rvecPos;
+		s_vecViewDir = a_rvecDir;
+	}
+
+	/**
+	*	\brief	Accessor for the view position
+	*	\return	const Vector3& - camera position given to SetView()
+	*/
+
+	const Vector3& ParticleStage::GetViewPosition()
+	{
+		return s_vecViewPos;
+	}
+
+	/**
+	*	\brief	Accessor for the view direction
+	*	\return	const Vector3& - camera direction given to SetView()
+	*/
+
+	const Vector3& ParticleStage::GetViewDirection()
+	{
+		return s_vecViewDir;
+	}
+
+	/**
+	*	\brief	Cuts the live particles of a system into chunks and adds them to s_vecChunks
+	*	\param	UINT a_nEntry - index of the system in s_vecEntries
+	*	\return	UINT - number of chunks added
+	*/
+
+	UINT ParticleStage::BuildChunks(UINT a_nEntry)
+	{
+		ParticleSimulation* pSystem = s_vecEntries[a_nEntry].pSystem;
+		UINT nAlive = pSystem->m_oParticles.GetNumAlive();
+		UINT nChunks = 0;
+
+		for (UINT nBegin = 0; nBegin < nAlive; nBegin += CHUNK_SIZE)
+		{
+			Chunk oChunk;
+			oChunk.pSystem = pSystem;
+			oChunk.nBegin = nBegin;
+			oChunk.nEnd = (nAlive - nBegin > CHUNK_SIZE) ? nBegin + CHUNK_SIZE : nAlive;
+			oChunk.nDead = 0;
+			oChunk.nFirstDead = 0;
+
+			s_vecChunks.push_back(oChunk);
+			++nChunks;
+		}
+
+		return nChunks;
+	}
+
+	/**
+	*	\brief	Job moving, ageing and colliding a range of chunks
+	*	\param	void* a_pData - not used
+	*	\param	UINT a_nBegin - first chunk
+	*	\param	UINT a_nEnd - one past the last chunk
+	*/
+
+	void ParticleStage::IntegrateRange(void* a_pData, UINT a_nBegin, UINT a_nEnd)
+	{
+		for (UINT i = a_nBegin; i < a_nEnd; ++i)
+		{
+			Chunk& rChunk = s_vecChunks[i];
+			ParticleSimulation* pSystem = rChunk.pSystem;
+
+			rChunk.nDead = pSystem->m_oParticles.IntegrateRange(rChunk.nBegin, rChunk.nEnd, pSystem->m_fPendingTime,
+																pSystem->m_vecAccel, &s_vecDead[rChunk.nFirstDead]);
+
+			if (pSystem->m_pCollider)
+			{
+				const AffineMatrix* pToWorld = pSystem->m_bWorldIsLocal ? NULL : &pSystem->m_oMatrixWorld;
+				const AffineMatrix* pToLocal = pSystem->m_bWorldIsLocal ? NULL : &pSystem->m_oMatrixLocal;
+
+				rChunk.nDead = pSystem->m_pCollider->Collide(pSystem->m_oParticles, rChunk.nBegin, rChunk.nEnd, pToWorld, pToLocal,
+															 &s_vecDead[rChunk.nFirstDead], rChunk.nDead);
+			}
+
+			// measured before the kills, so the box also holds the dead
+			rChunk.vecMin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+			rChunk.vecMax = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			rChunk.fMaxSize = 0.0f;
+			pSystem->m_oParticles.ExpandBounds(rChunk.nBegin, rChunk.nEnd, &rChunk.vecMin, &rChunk.vecMax, &rChunk.fMaxSize);
+		}
+	}
+
+	/**
+	*	\brief	Job killing the dead of a range of systems, emitting their new particles, measuring their
+	*			bounds and sorting them
+	*	\param	void* a_pData - not used
+	*	\param	UINT a_nBegin - first system
+	*	\param	UINT a_nEnd - one past the last system
+	*	\note	Each chunk lists its dead in ascending order, so killing the chunks from the last kills the
+	*			whole system's dead from the back
+	*/
+
+	void ParticleStage::FinishRange(void* a_pData, UINT a_nBegin, UINT a_nEnd)
+	{
+		for (UINT i = a_nBegin; i < a_nEnd; ++i)
+		{
+			const Entry& rEntry = s_vecEntries[i];
+			ParticleSimulation* pSystem = rEntry.pSystem;
+
+			Vector3 vecMin(FLT_MAX, FLT_MAX, FLT_MAX);
+			Vector3 vecMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			FLOAT fMaxSize = 0.0f;
+
+			for (UINT j = rEntry.nChunks; j > 0; --j)
+			{
+				const Chunk& rChunk = s_vecChunks[rEntry.nFirstChunk + j - 1];
+
+				Vec3Minimize(&vecMin, &vecMin, &rChunk.vecMin);
+				Vec3Maximize(&vecMax, &vecMax, &rChunk.vecMax);
+				fMaxSize = (rChunk.fMaxSize > fMaxSize) ? rChunk.fMaxSize : fMaxSize;
+
+				if (rChunk.nDead > 0)
+				{
+					pSystem->m_oSort.MarkMoved(&s_vecDead[rChunk.nFirstDead], rChunk.nDead);
+					pSystem->m_oParticles.KillSlots(&s_vecDead[rChunk.nFirstDead], rChunk.nDead);
+				}
+			}
+
+			// the dead's slots and those past the survivors hold other particles now
+			pSystem->m_oSort.MarkMovedFrom(pSystem->m_oParticles.GetNumAlive());
+
+			FLOAT fTimeDiff = pSystem->m_fPendingTime;
+
+			pSystem->m_fTime += fTimeDiff;
+			pSystem->m_fPendingTime = 0.0f;
+			pSystem->m_bQueued = FALSE;
+
+			UINT nDue = pSystem->m_oEmitter.Advance(fTimeDiff);
+			UINT nSurvivors = pSystem->m_oParticles.GetNumAlive();
+
+			if (nDue > 0)
+				pSystem->EmitParticles(nDue);
+
+			// the box the vertices are encoded in, which needs the new particles too
+			pSystem->m_oParticles.ExpandBounds(nSurvivors, pSystem->m_oParticles.GetNumAlive(), &vecMin, &vecMax, &fMaxSize);
+
+			if (pSystem->m_oParticles.GetNumAlive() == 0)
+				vecMin = vecMax = Vector3(0.0f, 0.0f, 0.0f);
+
+			pSystem->SetBounds(vecMin, vecMax, fMaxSize);
+
+			pSystem->m_oSort.Sort(pSystem->m_oParticles, pSystem->m_vecSortDir, pSystem->m_fSortOffset);
+
+			pSystem->m_nVertices = pSystem->m_oParticles.GetNumAlive();
+		}
+	}
+
+	/**
+	*	\brief	Job writing the vertices of a range of chunks
+	*	\param	void* a_pData - not used
+	*	\param	UINT a_nBegin - first chunk
+	*	\param	UINT a_nEnd - one past the last chunk
+	*	\note	The chunks of a sorted system are ranges of vertices, each written from the slot its
+	*			order lists
+	*/
+
+	void ParticleStage::FillRange(void* a_pData, UINT a_nBegin, UINT a_nEnd)
+	{
+		for (UINT i = a_nBegin; i < a_nEnd; ++i)
+		{
+			const Chunk& rChunk = s_vecChunks[i];
+			ParticleSimulation* pSystem = rChunk.pSystem;
+
+			const UINT* pOrder = (pSystem->m_oSort.GetNumSorted() > 0) ? pSystem->m_oSort.GetOrder() : NULL;
+
+			pSystem->FillVertices(&pSystem->m_vecVertices[0], rChunk.nBegin, rChunk.nEnd, pOrder);
+		}
+	}
+}
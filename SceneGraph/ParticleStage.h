@@ -0,0 +1,118 @@
+/**
+*	\class		SGLib::ParticleStage
+*	\brief		Simulates every particle system updated in a frame at once, spread across the job system
+*	\date		19/10/26
+*	\version	1.0
+*
+*	SGLib::ParticleSystem::Update() no longer simulates the system inside the scene traversal. It adds
+*	the time difference to the system's pending time and queues the system here, and
+*	SGRenderer::Update() calls Run() once the traversal has finished. Run() works through three
+*	parallel loops with SGLib::JobSystem:
+*
+*		1. every system's live particles are cut into chunks of CHUNK_SIZE and each chunk is moved
+*		   and aged with SGLib::ParticleStore::IntegrateRange(), which lists its dead without killing
+*		   them
+*		2. each system kills its dead, advances its time and emits the particles its emitter has due
+*		   through InitParticles()
+*		3. the live particles are cut into chunks again and each chunk is written in the vertex format
+*		   into the system's vertex array, sized for m_nMaxParticles when the system is made
+*
+*	so large systems are split between threads as well as the systems themselves, and the renderer
+*	only has to copy GetVertices() into its vertex buffer.
+*
+*	Chunks start on a multiple of CHUNK_SIZE, every particle is moved by the same operations whichever
+*	chunk it is in and the dead are killed in the same order whichever thread found them, so the result
+*	only depends on the systems' emitter seeds and the time differences, not on the number of threads.
+*	InitParticles() runs on a worker thread and must only touch its own system.
+*
+*	Code that updates particle systems without an SGRenderer calls Run() itself after their updates.
+*
+*	Update 19/10/26 - Upload() copies the vertices of every system simulated by the last Run() into a
+*						SGLib::DynamicRing under one lock, allocating the ranges in turn and copying
+*						them in parallel. SGRenderer calls it with the shared ring before drawing.
+*
+*	Update 19/10/26 - Systems with a sort mode are ordered back to front along the direction given to
+*						SetView() by their SGLib::ParticleSort at the end of step 2, and step 3 writes
+*						their vertices in that order. Call SetView() with the camera before the update
+*						pass, as is done with AnimSystem::SetViewPosition().
+*
+*	Update 19/10/26 - Each chunk of a system with an SGLib::ParticleCollider is collided straight after
+*						it is moved in step 1, and the particles killed by the colliders join the
+*						chunk's dead. Run() builds the colliders' spatial hashes before the jobs start.
+*
+*	Update 19/10/26 - Step 1 also measures the box around each chunk's positions and step 2 merges them
+*						with the new particles' into the system's bounds, which the vertices of step 3
+*						are encoded in. See ParticleSystem::SetBounds().
+*
+*	Update 19/10/26 - The stage works on SGLib::ParticleSimulation, the device free part of a particle
+*						system, so it runs and can be tested without DirectX. Run() calls each
+*						simulation's OnSimulated() once its vertices are written, and the copy into
+*						the shared ring has moved to ParticleSystem::UploadSimulated().
+*/
+
+#ifndef SGLIB_PARTICLESTAGE
+#define SGLIB_PARTICLESTAGE
+
+#pragma once
+
+#include "SGMath.h"
+#include "JobSystem.h"
+#include <vector>
+
+namespace SGLib
+{
+	class ParticleSimulation;
+
+	class ParticleStage
+	{
+	public:
+		static const UINT CHUNK_SIZE = 4096;	///< particles per job, a multiple of ParticleStore::PARTICLE_BLOCK
+
+		static void		Queue		(ParticleSimulation* a_pSystem);
+		static void		Dequeue		(ParticleSimulation* a_pSystem);
+		static UINT		GetNumQueued();
+		static void		Run			();
+
+		static void				SetView			(const Vector3& a_rvecPos, const Vector3& a_rvecDir);
+		static const Vector3&	GetViewPosition	();
+		static const Vector3&	GetViewDirection();
+
+	private:
+		// a range of one system's particles handled by one job
+		struct Chunk
+		{
+			ParticleSimulation*	pSystem;	///< system the particles belong to
+			UINT			nBegin;		///< first slot
+			UINT			nEnd;		///< one past the last slot
+			UINT			nDead;		///< particles found dead by IntegrateRange()
+			UINT			nFirstDead;	///< where the dead slots are listed in s_vecDead
+			Vector3			vecMin;		///< minimum of the positions after IntegrateRange()
+			Vector3			vecMax;		///< maximum of the positions after IntegrateRange()
+			FLOAT			fMaxSize;	///< largest size
+		};
+
+		// a queued system and the chunks its particles were integrated in
+		struct Entry
+		{
+			ParticleSimulation*	pSystem;	///< system to simulate
+			UINT			nFirstChunk;///< first of its chunks in s_vecChunks
+			UINT			nChunks;	///< number of chunks
+		};
+
+		static std::vector<ParticleSimulation*>	s_vecQueued;	///< systems updated since the last Run()
+		static std::vector<Entry>			s_vecEntries;	///< systems being run
+		static std::vector<Chunk>			s_vecChunks;	///< chunks of the current loop
+		static std::vector<UINT>			s_vecDead;		///< dead slots listed by every chunk
+		static Vector3						s_vecViewPos;	///< position depths are measured from
+		static Vector3						s_vecViewDir;	///< direction depths are measured along
+
+		static UINT		BuildChunks		(UINT a_nEntry);
+		static void		IntegrateRange	(void* a_pData, UINT a_nBegin, UINT a_nEnd);
+		static void		FinishRange		(void* a_pData, UINT a_nBegin, UINT a_nEnd);
+		static void		FillRange		(void* a_pData, UINT a_nBegin, UINT a_nEnd);
+
+		ParticleStage();
+	};
+}
+
+#endif
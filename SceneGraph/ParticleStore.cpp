@@ -0,0 +1,418 @@
+#include "ParticleStore.h"
+
+#if defined(SGLIB_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(SGLIB_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace SGLib
+{
+	/**
+	*	\brief	ParticleStore constructor
+	*/
+
+	ParticleStore::ParticleStore() :	m_nCapacity(0),
+										m_nPadded(0),
+										m_nAlive(0)
+	{
+	}
+
+	/**
+	*	\brief	ParticleStore destructor
+	*/
+
+	ParticleStore::~ParticleStore()
+	{
+	}
+
+	/**
+	*	\brief	Allocates the slots and kills every particle
+	*	\param	UINT a_nCapacity - most particles alive at once
+	*/
+
+	void ParticleStore::Resize(UINT a_nCapacity)
+	{
+		m_nCapacity = a_nCapacity;
+		m_nPadded = (a_nCapacity + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK * PARTICLE_BLOCK;
+
+		for (UINT i = 0; i < NUM_STREAMS; ++i)
+		{
+			m_aarrStreams[i].Resize(m_nPadded);
+			if (m_nPadded)
+				memset(m_aarrStreams[i].Data(), 0, m_nPadded * sizeof(FLOAT));
+		}
+
+		m_arrColours.Resize(m_nPadded);
+		if (m_nPadded)
+			memset(m_arrColours.Data(), 0, m_nPadded * sizeof(UINT));
+
+		m_arrDead.Resize(m_nCapacity);
+		m_nAlive = 0;
+	}
+
+	/**
+	*	\brief	Adds particles to the end of the live range
+	*	\param	UINT a_nCount - particles wanted
+	*	\param	UINT* a_pnFirst - receives the slot of the first, the rest follow it
+	*	\return	UINT - particles added, fewer than a_nCount if the store is full
+	*	\note	The new slots hold whatever was last in them and must be filled with Set() before the next
+	*			Integrate() or Kill()
+	*/
+
+	UINT ParticleStore::Allocate(UINT a_nCount, UINT* a_pnFirst)
+	{
+		if (a_nCount > m_nCapacity - m_nAlive)
+			a_nCount = m_nCapacity - m_nAlive;
+
+		*a_pnFirst = m_nAlive;
+		m_nAlive += a_nCount;
+
+		return a_nCount;
+	}
+
+	/**
+	*	\brief	Stores a newly emitted particle in a slot
+	*	\param	UINT a_nSlot - slot to store it in, usually one handed out by Allocate()
+	*	\param	const Vector3& a_rvecPos - position
+	*	\param	const Vector3& a_rvecVel - velocity
+	*	\param	FLOAT a_fAge - time since it was emitted, normally 0
+	*	\param	FLOAT a_fLife - age it dies at
+	*	\param	FLOAT a_fSize - size
+	*	\param	FLOAT a_fMass - mass
+	*	\param	UINT a_nColour - colour as a D3DCOLOR
+	*/
+
+	void ParticleStore::Set(UINT a_nSlot, const Vector3& a_rvecPos, const Vector3& a_rvecVel, FLOAT a_fAge,
+							FLOAT a_fLife, FLOAT a_fSize, FLOAT a_fMass, UINT a_nColour)
+	{
+		m_aarrStreams[POS_X][a_nSlot] = a_rvecPos.x;
+		m_aarrStreams[POS_Y][a_nSlot] = a_rvecPos.y;
+		m_aarrStreams[POS_Z][a_nSlot] = a_rvecPos.z;
+		m_aarrStreams[VEL_X][a_nSlot] = a_rvecVel.x;
+		m_aarrStreams[VEL_Y][a_nSlot] = a_rvecVel.y;
+		m_aarrStreams[VEL_Z][a_nSlot] = a_rvecVel.z;
+		m_aarrStreams[AGE][a_nSlot] = a_fAge;
+		m_aarrStreams[LIFE][a_nSlot] = a_fLife;
+		m_aarrStreams[SIZE][a_nSlot] = a_fSize;
+		m_aarrStreams[MASS][a_nSlot] = a_fMass;
+		m_arrColours[a_nSlot] = a_nColour;
+	}
+
+	/**
+	*	\brief	Kills the particle in a slot by moving the last live particle into it
+	*	\param	UINT a_nSlot - slot of a live particle
+	*/
+
+	void ParticleStore::Kill(UINT a_nSlot)
+	{
+		UINT nLast = --m_nAlive;
+
+		if (a_nSlot == nLast)
+			return;
+
+		for (UINT i = 0; i < NUM_STREAMS; ++i)
+			m_aarrStreams[i][a_nSlot] = m_aarrStreams[i][nLast];
+
+		m_arrColours[a_nSlot] = m_arrColours[nLast];
+	}
+
+	/**
+	*	\brief	Kills every particle
+	*/
+
+	void ParticleStore::KillAll()
+	{
+		m_nAlive = 0;
+	}
+
+	/**
+	*	\brief	Moves every live particle under a constant acceleration, ages it and kills it once its age
+	*			has passed its life
+	*	\param	FLOAT a_fTimeDiff - time to advance by
+	*	\param	const Vector3& a_rvecAccel - acceleration applied to every particle
+	*	\return	UINT - number of particles killed
+	*/
+
+	UINT ParticleStore::Integrate(FLOAT a_fTimeDiff, const Vector3& a_rvecAccel)
+	{
+		UINT nDead = IntegrateRange(0, m_nAlive, a_fTimeDiff, a_rvecAccel, m_arrDead.Data());
+
+		KillSlots(m_arrDead.Data(), nDead);
+
+		return nDead;
+	}
+
+	/**
+	*	\brief	Moves and ages a range of the live particles and lists those whose age has passed their life
+	*			without killing them
+	*	\param	UINT a_nBegin - first slot, a multiple of PARTICLE_BLOCK
+	*	\param	UINT a_nEnd - one past the last slot, no more than GetNumAlive()
+	*	\param	FLOAT a_fTimeDiff - time to advance by
+	*	\param	const Vector3& a_rvecAccel - acceleration applied to every particle
+	*	\param	UINT* a_pDead - receives the dead slots in ascending order, room for a_nEnd - a_nBegin
+	*	\return	UINT - number of dead slots listed
+	*	\note	The slots after a_nEnd up to the end of its block are moved as well, which costs less than
+	*			a tail loop, so ranges that run in parallel must not share a block. Each particle is moved
+	*			by the same operations whichever range it is in, so splitting the live particles into
+	*			ranges gives the same result as one range. The AVX2 path uses unaligned loads as the
+	*			streams are only 16 byte aligned.
+	*/
+
+	UINT ParticleStore::IntegrateRange(UINT a_nBegin, UINT a_nEnd, FLOAT a_fTimeDiff, const Vector3& a_rvecAccel, UINT* a_pDead)
+	{
+		UINT nEnd = (a_nEnd + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK * PARTICLE_BLOCK;
+		UINT* pDead = a_pDead;
+
+		FLOAT* pPos[3] = { m_aarrStreams[POS_X].Data(), m_aarrStreams[POS_Y].Data(), m_aarrStreams[POS_Z].Data() };
+		FLOAT* pVel[3] = { m_aarrStreams[VEL_X].Data(), m_aarrStreams[VEL_Y].Data(), m_aarrStreams[VEL_Z].Data() };
+		FLOAT* pAge = m_aarrStreams[AGE].Data();
+		const FLOAT* pLife = m_aarrStreams[LIFE].Data();
+
+		// a t^2 / 2 and a t are the same for every particle
+		FLOAT fHalfTimeSq = 0.5f * a_fTimeDiff * a_fTimeDiff;
+		FLOAT afAccelPos[3] = { a_rvecAccel.x * fHalfTimeSq, a_rvecAccel.y * fHalfTimeSq, a_rvecAccel.z * fHalfTimeSq };
+		FLOAT afAccelVel[3] = { a_rvecAccel.x * a_fTimeDiff, a_rvecAccel.y * a_fTimeDiff, a_rvecAccel.z * a_fTimeDiff };
+
+		UINT nDead = 0;
+		UINT i = a_nBegin;
+
+#if defined(SGLIB_SIMD_AVX2)
+		__m256 vTime8 = _mm256_set1_ps(a_fTimeDiff);
+
+		for (; i < nEnd; i += 8)
+		{
+			for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+			{
+				__m256 vPos = _mm256_loadu_ps(pPos[nAxis] + i);
+				__m256 vVel = _mm256_loadu_ps(pVel[nAxis] + i);
+
+				vPos = _mm256_add_ps(_mm256_add_ps(vPos, _mm256_mul_ps(vVel, vTime8)), _mm256_set1_ps(afAccelPos[nAxis]));
+				vVel = _mm256_add_ps(vVel, _mm256_set1_ps(afAccelVel[nAxis]));
+
+				_mm256_storeu_ps(pPos[nAxis] + i, vPos);
+				_mm256_storeu_ps(pVel[nAxis] + i, vVel);
+			}
+
+			__m256 vAge = _mm256_add_ps(_mm256_loadu_ps(pAge + i), vTime8);
+			_mm256_storeu_ps(pAge + i, vAge);
+
+			// one bit per particle past its life
+			int nMask = _mm256_movemask_ps(_mm256_cmp_ps(vAge, _mm256_loadu_ps(pLife + i), _CMP_GT_OQ));
+
+			for (UINT nSlot = i; nMask; ++nSlot, nMask >>= 1)
+			{
+				if ((nMask & 1) && nSlot < a_nEnd)
+					pDead[nDead++] = nSlot;
+			}
+		}
+#elif defined(SGLIB_SIMD_SSE2)
+		__m128 vTime = _mm_set1_ps(a_fTimeDiff);
+
+		for (; i < nEnd; i += 4)
+		{
+			for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+			{
+				__m128 vPos = _mm_load_ps(pPos[nAxis] + i);
+				__m128 vVel = _mm_load_ps(pVel[nAxis] + i);
+
+				vPos = _mm_add_ps(_mm_add_ps(vPos, _mm_mul_ps(vVel, vTime)), _mm_set1_ps(afAccelPos[nAxis]));
+				vVel = _mm_add_ps(vVel, _mm_set1_ps(afAccelVel[nAxis]));
+
+				_mm_store_ps(pPos[nAxis] + i, vPos);
+				_mm_store_ps(pVel[nAxis] + i, vVel);
+			}
+
+			__m128 vAge = _mm_add_ps(_mm_load_ps(pAge + i), vTime);
+			_mm_store_ps(pAge + i, vAge);
+
+			// one bit per particle past its life
+			int nMask = _mm_movemask_ps(_mm_cmpgt_ps(vAge, _mm_load_ps(pLife + i)));
+
+			for (UINT nSlot = i; nMask; ++nSlot, nMask >>= 1)
+			{
+				if ((nMask & 1) && nSlot < a_nEnd)
+					pDead[nDead++] = nSlot;
+			}
+		}
+#endif
+
+		for (; i < nEnd; ++i)
+		{
+			for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+			{
+				pPos[nAxis][i] = (pPos[nAxis][i] + pVel[nAxis][i] * a_fTimeDiff) + afAccelPos[nAxis];
+				pVel[nAxis][i] = pVel[nAxis][i] + afAccelVel[nAxis];
+			}
+
+			pAge[i] = pAge[i] + a_fTimeDiff;
+
+			if (pAge[i] > pLife[i] && i < a_nEnd)
+				pDead[nDead++] = i;
+		}
+
+		return nDead;
+	}
+
+	/**
+	*	\brief	Kills a list of particles
+	*	\param	const UINT* a_pSlots - slots of live particles in ascending order, as listed by IntegrateRange()
+	*	\param	UINT a_nCount - number of slots
+	*/
+
+	void ParticleStore::KillSlots(const UINT* a_pSlots, UINT a_nCount)
+	{
+		// from the back so the particle moved into each slot is one already known to be alive
+		for (UINT j = a_nCount; j > 0; --j)
+			Kill(a_pSlots[j - 1]);
+	}
+
+	/**
+	*	\brief	Grows a box to hold the positions of a range of particles and a size to their largest
+	*	\param	UINT a_nBegin - first slot
+	*	\param	UINT a_nEnd - one past the last slot
+	*	\param	Vector3* a_pvecMin - minimum corner, lowered to the range's
+	*	\param	Vector3* a_pvecMax - maximum corner, raised to the range's
+	*	\param	FLOAT* a_pfMaxSize - size, raised to the range's largest
+	*	\note	The range can start anywhere, so the loads are unaligned. Minimums and maximums are exact,
+	*			so every path gives the same box.
+	*/
+
+	void ParticleStore::ExpandBounds(UINT a_nBegin, UINT a_nEnd, Vector3* a_pvecMin, Vector3* a_pvecMax, FLOAT* a_pfMaxSize) const
+	{
+		const FLOAT* pPos[3] = { m_aarrStreams[POS_X].Data(), m_aarrStreams[POS_Y].Data(), m_aarrStreams[POS_Z].Data() };
+		const FLOAT* pSize = m_aarrStreams[SIZE].Data();
+
+		FLOAT afMin[3] = { a_pvecMin->x, a_pvecMin->y, a_pvecMin->z };
+		FLOAT afMax[3] = { a_pvecMax->x, a_pvecMax->y, a_pvecMax->z };
+		FLOAT fMaxSize = *a_pfMaxSize;
+		UINT i = a_nBegin;
+
+#if defined(SGLIB_SIMD_SSE2)
+		if (a_nEnd >= a_nBegin + 4)
+		{
+			__m128 avMin[3], avMax[3];
+			__m128 vMaxSize = _mm_set1_ps(fMaxSize);
+
+			for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+			{
+				avMin[nAxis] = _mm_set1_ps(afMin[nAxis]);
+				avMax[nAxis] = _mm_set1_ps(afMax[nAxis]);
+			}
+
+			for (; i + 4 <= a_nEnd; i += 4)
+			{
+				for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+				{
+					__m128 vPos = _mm_loadu_ps(pPos[nAxis] + i);
+					avMin[nAxis] = _mm_min_ps(avMin[nAxis], vPos);
+					avMax[nAxis] = _mm_max_ps(avMax[nAxis], vPos);
+				}
+
+				vMaxSize = _mm_max_ps(vMaxSize, _mm_loadu_ps(pSize + i));
+			}
+
+			// fold the lanes together
+			FLOAT afLanes[3][2][4];
+			FLOAT afSizes[4];
+
+			for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+			{
+				_mm_storeu_ps(afLanes[nAxis][0], avMin[nAxis]);
+				_mm_storeu_ps(afLanes[nAxis][1], avMax[nAxis]);
+			}
+
+			_mm_storeu_ps(afSizes, vMaxSize);
+
+			for (UINT j = 0; j < 4; ++j)
+			{
+				for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+				{
+					afMin[nAxis] = (afLanes[nAxis][0][j] < afMin[nAxis]) ? afLanes[nAxis][0][j] : afMin[nAxis];
+					afMax[nAxis] = (afLanes[nAxis][1][j] > afMax[nAxis]) ? afLanes[nAxis][1][j] : afMax[nAxis];
+				}
+
+				fMaxSize = (afSizes[j] > fMaxSize) ? afSizes[j] : fMaxSize;
+			}
+		}
+#endif
+
+		for (; i < a_nEnd; ++i)
+		{
+			for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+			{
+				afMin[nAxis] = (pPos[nAxis][i] < afMin[nAxis]) ? pPos[nAxis][i] : afMin[nAxis];
+				afMax[nAxis] = (pPos[nAxis][i] > afMax[nAxis]) ? pPos[nAxis][i] : afMax[nAxis];
+			}
+
+			fMaxSize = (pSize[i] > fMaxSize) ? pSize[i] : fMaxSize;
+		}
+
+		*a_pvecMin = Vector3(afMin[0], afMin[1], afMin[2]);
+		*a_pvecMax = Vector3(afMax[0], afMax[1], afMax[2]);
+		*a_pfMaxSize = fMaxSize;
+	}
+
+	/**
+	*	\brief	Accessor for the number of live particles
+	*	\return	UINT - live particles, they are in slots 0 to GetNumAlive() - 1
+	*/
+
+	UINT ParticleStore::GetNumAlive() const
+	{
+		return m_nAlive;
+	}
+
+	/**
+	*	\brief	Accessor for the number of slots
+	*	\return	UINT - slots asked for in Resize(), not counting the padding
+	*/
+
+	UINT ParticleStore::GetCapacity() const
+	{
+		return m_nCapacity;
+	}
+
+	/**
+	*	\brief	Accessor for one attribute of every slot
+	*	\param	Stream a_eStream - attribute to get
+	*	\return	FLOAT* - 16 byte aligned array of GetCapacity() values plus padding, the first GetNumAlive() are live
+	*/
+
+	FLOAT* ParticleStore::GetStream(Stream a_eStream)
+	{
+		return m_aarrStreams[a_eStream].Data();
+	}
+
+	/**
+	*	\brief	Accessor for one attribute of every slot
+	*	\param	Stream a_eStream - attribute to get
+	*	\return	const FLOAT* - 16 byte aligned array of GetCapacity() values plus padding, the first GetNumAlive() are live
+	*/
+
+	const FLOAT* ParticleStore::GetStream(Stream a_eStream) const
+	{
+		return m_aarrStreams[a_eStream].Data();
+	}
+
+	/**
+	*	\brief	Accessor for the colour of every slot
+	*	\return	UINT* - colours as D3DCOLORs
+	*/
+
+	UINT* ParticleStore::GetColours()
+	{
+		return m_arrColours.Data();
+	}
+
+	/**
+	*	\brief	Accessor for the colour of every slot
+	*	\return	const UINT* - colours as D3DCOLORs
+	*/
+
+	const UINT* ParticleStore::GetColours() const
+	{
+		return m_arrColours.Data();
+	}
+}
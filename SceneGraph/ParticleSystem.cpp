@@ -1,73 +1,81 @@
 #include "ParticleSystem.h"
+#include "Transform.h"
+#include <algorithm>
 
 using std::vector;
 
 namespace SGLib
 {
+	// ParticleVertex as seen by DecodeParticle() in ParticleDecode.fxh
+	static const D3DVERTEXELEMENT9 s_aParticleDecl[] =
+	{
+		{ 0, 0,  D3DDECLTYPE_SHORT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },		// position, size
+		{ 0, 8,  D3DDECLTYPE_FLOAT16_4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },	// velocity, mass
+		{ 0, 16, D3DDECLTYPE_FLOAT16_2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },	// age, life time
+		{ 0, 20, D3DDECLTYPE_D3DCOLOR, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_COLOR, 0 },		// colour
+		D3DDECL_END()
+	};
+
+	// ParticleVertexWide, read by the same DecodeParticle() on devices without half float declarations
+	static const D3DVERTEXELEMENT9 s_aParticleDeclWide[] =
+	{
+		{ 0, 0,  D3DDECLTYPE_SHORT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },		// position, size
+		{ 0, 8,  D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },		// velocity, mass
+		{ 0, 24, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },		// age, life time
+		{ 0, 32, D3DDECLTYPE_D3DCOLOR, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_COLOR, 0 },		// colour
+		D3DDECL_END()
+	};
+
+	vector<ParticleSystem*>	ParticleSystem::s_vecUploads;
+
 	/**
 	*	\brief	ParticleSystem constructor
 	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
 	*	\param	LPCTSTR a_sFileName - effect file name
 	*	\param	std::string a_fTechName - technique to use within effect
 	*	\param	std::string a_fTexName - name of texture object
-	*	\param	D3DXVECTOR3& a_rvecAccel - acceleration set for each particle
+	*	\param	const Vector3& a_rvecAccel - acceleration set for each particle
 	*	\param	INT a_nMaxParticles - max number of particles permitted at any one time
-	*	\param	FLOAT a_fParticleTime - time delay on particle creation
+	*	\param	FLOAT a_fParticleTime - time delay on particle creation, sets the emitter's rate
 	*	\post	Creates and does a basic initialization of the particles within the system
 	*	\note	This method initalizes the particle vector, creates the texture, creates the
-	*			vertex decleration associated with the Particle struct and creates the vertex
-	*			buffer.
+	*			vertex decleration associated with the ParticleVertex struct and creates the vertex
+	*			buffer if there is no shared SGLib::DynamicRing.
 	*/
 
 	ParticleSystem::ParticleSystem(	LPDIRECT3DDEVICE9 a_pD3DDevice, 
 									LPCTSTR a_sFileName, 
 									LPCSTR a_sTechName, 
 									LPCTSTR a_sTexName,
-									D3DXVECTOR3& a_rvecAccel, 
+									const Vector3& a_rvecAccel, 
 									INT a_nMaxParticles, 
 									FLOAT a_fParticleTime) :
 										Shader(a_pD3DDevice, a_sFileName),
+										ParticleSimulation(a_rvecAccel, a_nMaxParticles, a_fParticleTime),
 										m_pTexture(NULL),
 										m_sTechName(a_sTechName),
 										m_sTexName(a_sTexName),
 										m_pVB(NULL),
 										m_pParticleDecl(NULL),
-										m_vecAccel(a_rvecAccel),
-										m_nMaxParticles(a_nMaxParticles),
-										m_fParticleTime(a_fParticleTime),
-										m_fTime(0.0f)
+										m_nRingOffset(0),
+										m_nRingGeneration(0),
+										m_nVertexStride(sizeof(ParticleVertex)),
+										m_enOffscreenRate(UPDATE_EVERY_FRAME),
+										m_nOffscreenFrames(s_nRatePhase++),
+										m_fOffscreenTime(0.0f),
+										m_bCulled(FALSE)
 	{
-		m_vecParticles.resize(m_nMaxParticles);
-		m_vecAliveParticles.reserve(m_nMaxParticles);
-		m_vecDeadParticles.reserve(m_nMaxParticles);
-
-		for (int i = 0; i < m_nMaxParticles; ++i)
-		{
-			m_vecParticles[i].fLifeTime = -1.0f;
-			m_vecParticles[i].fInitTime = 0.0f;
-		}
-
 		// create texture
-		D3DXCreateTextureFromFile(m_pD3DDevice, m_sTexName, &m_pTexture);
-
-		// define particle vertex structure
-		D3DVERTEXELEMENT9 VertexArray[] =
-		{
-			{0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},	// position
-			{0, 12, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0},	// velocity
-			{0, 24, D3DDECLTYPE_FLOAT1, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1},	// size
-			{0, 28, D3DDECLTYPE_FLOAT1, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 2},	// init time
-			{0, 32, D3DDECLTYPE_FLOAT1, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 3},	// life time
-			{0, 36, D3DDECLTYPE_FLOAT1, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 4},	// mass
-			{0, 40, D3DDECLTYPE_D3DCOLOR, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_COLOR, 0},	// colour
-			D3DDECL_END()
-		};
+		if (m_sTexName)
+			D3DXCreateTextureFromFile(m_pD3DDevice, m_sTexName, &m_pTexture);
 
-		m_pD3DDevice->CreateVertexDeclaration(VertexArray, &m_pParticleDecl);
+		// create particle vertex decleration, which also decides the vertex size
+		CreateDeclaration();
 
-		// create vertex buffer and declaration
-		m_pD3DDevice->CreateVertexBuffer(	m_nMaxParticles*sizeof(SGLib::Particle), D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY | D3DUSAGE_POINTS,
-											0, D3DPOOL_DEFAULT, &m_pVB, 0);
+		// create vertex buffer unless the vertices go into the shared ring
+		if (!DynamicRing::GetShared())
+			m_pD3DDevice->CreateVertexBuffer(	m_nMaxParticles*m_nVertexStride, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY | D3DUSAGE_POINTS,
+												0, D3DPOOL_DEFAULT, &m_pVB, 0);
 	}
 
 	/**
@@ -77,6 +85,11 @@ namespace SGLib
 
 	ParticleSystem::~ParticleSystem(void)
 	{
+		vector<ParticleSystem*>::iterator iter = std::find(s_vecUploads.begin(), s_vecUploads.end(), this);
+
+		if (iter != s_vecUploads.end())
+			s_vecUploads.erase(iter);
+
 		SAFE_RELEASE(m_pTexture)
 		SAFE_RELEASE(m_pVB)
 		SAFE_RELEASE(m_pParticleDecl)
@@ -93,22 +106,62 @@ namespace SGLib
 		Shader::OnCreateDevice(a_pD3DDevice);
 
 		// create texture
-		D3DXCreateTextureFromFile(m_pD3DDevice, m_sTexName, &m_pTexture);
+		if (m_sTexName)
+			D3DXCreateTextureFromFile(m_pD3DDevice, m_sTexName, &m_pTexture);
+
+		// create particle vertex decleration
+		CreateDeclaration();
+	}
+
+	/**
+	*	\brief	Creates the vertex declaration for the device's capabilities
+	*	\note	Devices without D3DDTCAPS_FLOAT16_4 and D3DDTCAPS_FLOAT16_2 are given the declaration of
+	*			ParticleVertexWide and the vertices are widened as they are copied. The new device may
+	*			differ from the last, so the stride is chosen again each time. A failure is reported and
+	*			leaves the system drawing nothing.
+	*/
+
+	void ParticleSystem::CreateDeclaration()
+	{
+		SAFE_RELEASE(m_pParticleDecl)
 
-		// define particle vertex structure
-		D3DVERTEXELEMENT9 VertexArray[] =
+		D3DCAPS9 oCaps;
+		memset(&oCaps, 0, sizeof(oCaps));
+
+		BOOL bHalves = FALSE;
+
+		if (SUCCEEDED(m_pD3DDevice->GetDeviceCaps(&oCaps)))
+			bHalves = (oCaps.DeclTypes & (D3DDTCAPS_FLOAT16_4 | D3DDTCAPS_FLOAT16_2)) == (D3DDTCAPS_FLOAT16_4 | D3DDTCAPS_FLOAT16_2);
+
+		if (!bHalves)
+			OutputDebugString(L"Warning: No half float vertex declarations, particle vertices will be widened -> ParticleSystem::CreateDeclaration()\n");
+
+		UINT nStride = bHalves ? sizeof(ParticleVertex) : sizeof(ParticleVertexWide);
+
+		// the vertex buffer was sized for the old stride
+		if (nStride != m_nVertexStride)
+			SAFE_RELEASE(m_pVB)
+
+		m_nVertexStride = nStride;
+
+		if (FAILED(m_pD3DDevice->CreateVertexDeclaration(bHalves ? s_aParticleDecl : s_aParticleDeclWide, &m_pParticleDecl)))
 		{
-			{0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},	// position
-			{0, 12, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0},	// velocity
-			{0, 24, D3DDECLTYPE_FLOAT1, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1},	// size
-			{0, 28, D3DDECLTYPE_FLOAT1, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 2},	// init time
-			{0, 32, D3DDECLTYPE_FLOAT1, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 3},	// life time
-			{0, 36, D3DDECLTYPE_FLOAT1, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 4},	// mass
-			{0, 40, D3DDECLTYPE_D3DCOLOR, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_COLOR, 0},	// colour
-			D3DDECL_END()
-		};
+			OutputDebugString(L"Warning: Failed to create the particle vertex declaration -> ParticleSystem::CreateDeclaration()\n");
+			m_pParticleDecl = NULL;
+		}
+	}
 
-		m_pD3DDevice->CreateVertexDeclaration(VertexArray, &m_pParticleDecl);
+	/**
+	*	\brief	Writes the vertices in the format of the declaration
+	*	\param	BYTE* a_pDest - receives GetNumVertices() vertices of the vertex stride
+	*/
+
+	void ParticleSystem::CopyVertices(BYTE* a_pDest) const
+	{
+		if (m_nVertexStride == sizeof(ParticleVertex))
+			memcpy(a_pDest, &m_vecVertices[0], m_nVertices * sizeof(ParticleVertex));
+		else
+			WidenVertices(reinterpret_cast<ParticleVertexWide*>(a_pDest), &m_vecVertices[0], m_nVertices);
 	}
 
 	/**
@@ -146,23 +199,166 @@ namespace SGLib
 
 		Shader::OnResetDevice(a_pD3DDevice);
 
-		if (m_pVB == NULL)
-			V(m_pD3DDevice->CreateVertexBuffer(	m_nMaxParticles*sizeof(Particle), D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY | D3DUSAGE_POINTS,
+		if (m_pVB == NULL && !DynamicRing::GetShared())
+			V(m_pD3DDevice->CreateVertexBuffer(	m_nMaxParticles*m_nVertexStride, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY | D3DUSAGE_POINTS,
 												0, D3DPOOL_DEFAULT, &m_pVB, 0)) 
 	}
 
 	/**
-	*	\brief	[] operator - used to reference into the alive particles within the system
-	*	\param	UINT a_nPos - position of particle returned
-	*	\return	Particle* - returns a Particle pointer at position a_nPos in the alive vector
+	*	\brief	Copies the vertices into a ring buffer
+	*	\param	DynamicRing* a_pRing - ring to copy into, it is left locked
+	*	\return	BOOL - TRUE if they were copied, FALSE if there are none or the ring has no room
+	*	\note	Used by SetVertexStream() for a system that UploadSimulated() didn't copy
 	*/
 
-	Particle* ParticleSystem::operator [](UINT a_nPos)
+	BOOL ParticleSystem::UploadVertices(DynamicRing* a_pRing)
 	{
-		if (a_nPos < m_vecAliveParticles.size())
-			return m_vecAliveParticles[a_nPos];
+		m_nRingGeneration = 0;
+
+		if (m_nVertices == 0)
+			return FALSE;
+
+		BYTE* pData = a_pRing->Allocate(m_nVertices * m_nVertexStride, m_nVertexStride, &m_nRingOffset, &m_nRingGeneration);
+
+		if (!pData)
+		{
+			m_nRingGeneration = 0;
+			return FALSE;
+		}
+
+		CopyVertices(pData);
+
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Sets the vertex declaration and the stream source to the buffer holding the vertices
+	*	\param	UINT* a_pnStart - receives the first vertex to draw, GetNumVertices() are drawn from it
+	*	\return	BOOL - FALSE if there is nothing to draw
+	*	\note	Vertices in the shared ring since it last wrapped are drawn where they are. Otherwise they
+	*			are copied into the ring again, or into the system's own buffer if there is no ring.
+	*/
+
+	BOOL ParticleSystem::SetVertexStream(UINT* a_pnStart)
+	{
+		HRESULT hr;
+
+		if (m_nVertices == 0 || !m_pParticleDecl)
+			return FALSE;
+
+		DynamicRing* pRing = DynamicRing::GetShared();
+		LPDIRECT3DVERTEXBUFFER9 pVB = m_pVB;
+
+		if (pRing)
+		{
+			if (!pRing->IsValid(m_nRingGeneration))
+			{
+				BOOL bUploaded = UploadVertices(pRing);
+				pRing->Flush();
+
+				if (!bUploaded)
+					return FALSE;
+			}
+
+			pVB = pRing->GetBuffer();
+			*a_pnStart = m_nRingOffset / m_nVertexStride;
+		}
 		else
-			return NULL;
+		{
+			void* pData;
+
+			if (!m_pVB || FAILED(m_pVB->Lock(0, m_nVertices * m_nVertexStride, &pData, D3DLOCK_DISCARD)))
+				return FALSE;
+
+			CopyVertices(static_cast<BYTE*>(pData));
+			m_pVB->Unlock();
+
+			*a_pnStart = 0;
+		}
+
+		V(m_pD3DDevice->SetVertexDeclaration(m_pParticleDecl))
+		V(m_pD3DDevice->SetStreamSource(0, pVB, 0, m_nVertexStride))
+
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Sets the constants DecodeParticle() in ParticleDecode.fxh decodes the vertices with
+	*	\note	Call in Render() before drawing, g_particleDecodeOffset and g_particleDecodeScale are set
+	*			in the system's effect
+	*/
+
+	void ParticleSystem::SetDecodeParameters()
+	{
+		if (!m_pEffect)
+			return;
+
+		FLOAT afOffset[4] = { m_vecDecodeOffset.x, m_vecDecodeOffset.y, m_vecDecodeOffset.z, 0.0f };
+		FLOAT afScale[4] = { m_vecDecodeScale.x, m_vecDecodeScale.y, m_vecDecodeScale.z, m_fDecodeSize };
+
+		m_pEffect->SetValue("g_particleDecodeOffset", afOffset, sizeof(afOffset));
+		m_pEffect->SetValue("g_particleDecodeScale", afScale, sizeof(afScale));
+	}
+
+	/**
+	*	\brief	Mutator for the update rate of the system while it is out of view
+	*	\param	UpdateRate a_enRate - rate to drop to, UPDATE_EVERY_FRAME to keep the system's own rate
+	*	\note	Only the simulation is held back, by Update(), while the last UpdateVisibility() culled the
+	*			system. The rate given to Node::SetUpdateRate() is left alone, as is the child hierarchy.
+	*			A rate no lower than the system's own changes nothing. The time missed is still
+	*			simulated, in fewer larger steps.
+	*/
+
+	void ParticleSystem::SetOffscreenRate(UpdateRate a_enRate)
+	{
+		m_enOffscreenRate = a_enRate;
+	}
+
+	/**
+	*	\brief	Accessor for the update rate of the system while it is out of view
+	*	\return	UpdateRate - rate given to SetOffscreenRate(), UPDATE_EVERY_FRAME by default
+	*/
+
+	UpdateRate ParticleSystem::GetOffscreenRate() const
+	{
+		return m_enOffscreenRate;
+	}
+
+	/**
+	*	\brief	Tests the world box against the view frustum of the device
+	*	\return	BOOL - TRUE if the system is in view and should be drawn
+	*	\pre	The device's view and projection transforms are those the system is drawn with
+	*	\note	Called by SGRenderer before Render(). While it returns FALSE Update() simulates the system
+	*			at its off screen rate, see SetOffscreenRate().
+	*/
+
+	BOOL ParticleSystem::UpdateVisibility()
+	{
+		HRESULT hr;
+		Matrix oMatView, oMatProj, oMatClip;
+
+		V(m_pD3DDevice->GetTransform(D3DTS_VIEW, oMatView.AsD3D()))
+		V(m_pD3DDevice->GetTransform(D3DTS_PROJECTION, oMatProj.AsD3D()))
+
+		MatrixMultiply(&oMatClip, &oMatView, &oMatProj);
+
+		// the box is in world space so the frustum is too
+		Frustum oFrustum;
+		FrustumFromMatrix(&oFrustum, &oMatClip);
+
+		m_bCulled = !FrustumTestAABB(&oFrustum, &m_vecWorldMin, &m_vecWorldMax);
+
+		return !m_bCulled;
+	}
+
+	/**
+	*	\brief	Accessor for whether the system was out of view
+	*	\return	BOOL - TRUE if the last UpdateVisibility() culled the system
+	*/
+
+	BOOL ParticleSystem::IsCulled() const
+	{
+		return m_bCulled;
 	}
 
 	/**
@@ -183,56 +379,144 @@ namespace SGLib
 	void ParticleSystem::SetTime(FLOAT a_fTime)
 	{
 		m_fTime = a_fTime;
+		Wake();
+	}
+
+	/**
+	*	\brief	Accessor for time between particle creation
+	*	\return	FLOAT - time between particles at the emitter's rate, 0 if it has no rate
+	*/
+
+	FLOAT ParticleSystem::GetParticleTime()
+	{
+		FLOAT fRate = m_oEmitter.GetRate();
+
+		return (fRate > 0.0f) ? 1.0f / fRate : 0.0f;
+	}
+
+	/**
+	*	\brief	Mutator for time between particle creation
+	*	\param	FLOAT a_fParticleTime - time between particles, 0 or less stops the continuous emission
+	*	\note	Sets the emitter's rate to one particle every a_fParticleTime
+	*/
+
+	void ParticleSystem::SetParticleTime(FLOAT a_fParticleTime)
+	{
+		m_oEmitter.SetRate(a_fParticleTime > 0.0f ? 1.0f / a_fParticleTime : 0.0f);
+
+		if (m_oEmitter.IsActive())
+			Wake();
 	}
 
 	/**
 	*	\brief	Set a particle to alive if there exists a dead one and initializes it
-	*	\note	This method has been directly referenced from Frank D. Luna's book
+	*	\note	This method has been directly referenced from Frank D. Luna's book. Same as Emit(1).
 	*/
 
 	void ParticleSystem::AddParticle()
 	{
-		if (m_vecDeadParticles.size() > 0)
+		Emit(1);
+	}
+
+	/**
+	*	\brief	Adds particles after the last live one and initialises them together
+	*	\param	UINT a_nCount - particles wanted
+	*	\return	UINT - particles added, fewer than a_nCount once the system has m_nMaxParticles alive
+	*	\note	They are simulated and written to the vertices by the next ParticleStage::Run()
+	*/
+
+	UINT ParticleSystem::Emit(UINT a_nCount)
+	{
+		UINT nAdded = EmitParticles(a_nCount);
+
+		if (nAdded > 0)
+			Wake();
+
+		return nAdded;
+	}
+
+	/**
+	*	\brief	Copies the vertices of every system simulated since the last call into a ring
+	*	\param	DynamicRing* a_pRing - ring to copy into, it is left locked for the caller to Flush()
+	*	\note	Called by SGRenderer before drawing. The ranges are allocated in turn and copied in
+	*			parallel by SGLib::RingUpload, which copies the ranges it holds before a wrap unlocks the
+	*			ring under them. Systems that aren't simulated keep drawing the range they were last
+	*			copied to for as long as it is valid, and systems culled in the last frame copy themselves
+	*			when they are drawn.
+	*/
+
+	void ParticleSystem::UploadSimulated(DynamicRing* a_pRing)
+	{
+		RingUpload oUpload(a_pRing, WriteVertices);
+
+		for (UINT i = 0; i < s_vecUploads.size(); ++i)
 		{
-			Particle* pPart = m_vecDeadParticles.back();
-			InitParticle(pPart);
+			ParticleSystem* pSystem = s_vecUploads[i];
+
+			// culled systems copy themselves if they come into view
+			if (pSystem->m_nVertices == 0 || pSystem->m_bCulled || !pSystem->m_pParticleDecl)
+				continue;
 
-			m_vecDeadParticles.pop_back();
-			m_vecAliveParticles.push_back(pPart);
+			UINT nStride = pSystem->m_nVertexStride;
+
+			if (!oUpload.Add(pSystem, pSystem->m_nVertices * nStride, nStride, &pSystem->m_nRingOffset, &pSystem->m_nRingGeneration))
+				pSystem->m_nRingGeneration = 0;
 		}
+
+		s_vecUploads.clear();
+
+		oUpload.Run();
+	}
+
+	/**
+	*	\brief	Writes a system's vertices into its range of the ring for SGLib::RingUpload
+	*	\param	const void* a_pSource - the ParticleSystem
+	*	\param	BYTE* a_pDest - its range
+	*/
+
+	void ParticleSystem::WriteVertices(const void* a_pSource, BYTE* a_pDest)
+	{
+		static_cast<const ParticleSystem*>(a_pSource)->CopyVertices(a_pDest);
 	}
 
 	/**
-	*	\brief	Updates the position of each particle based on their individual variables and the time difference
+	*	\brief	Lists the system for the next UploadSimulated() once ParticleStage::Run() has rewritten its
+	*			vertices
+	*	\note	The copy in the ring is out of date until then, or until SetVertexStream() if that is missed
+	*/
+
+	void ParticleSystem::OnSimulated()
+	{
+		m_nRingGeneration = 0;
+
+		if (std::find(s_vecUploads.begin(), s_vecUploads.end(), this) == s_vecUploads.end())
+			s_vecUploads.push_back(this);
+	}
+
+	/**
+	*	\brief	Queues the system to be simulated by ParticleStage::Run() after the update pass
 	*	\param	FLOAT a_fTimeDiff - time difference between update calls
-	*	\note	This method has been directly referenced from Frank D. Luna's book
+	*	\note	Steps the simulation under the update world matrix, see ParticleSimulation::Step(). The
+	*			system goes to sleep once the emitter has nothing left to emit and no particles are alive.
+	*			While culled only one in every off screen rate's worth of updates steps, with the time
+	*			held back by the others, see SetOffscreenRate().
 	*/
 
 	void ParticleSystem::Update(FLOAT a_fTimeDiff)
 	{
-		m_fTime += a_fTimeDiff;
+		a_fTimeDiff += m_fOffscreenTime;
+		m_fOffscreenTime = 0.0f;
 
-		m_vecDeadParticles.resize(0);
-		m_vecAliveParticles.resize(0);
+		// updates of the system's own rate that fit in one at the off screen rate
+		UINT nHold = (UINT)m_enOffscreenRate / (UINT)GetUpdateRate();
 
-		for (int i = 0; i < m_nMaxParticles; ++i)
+		if (m_bCulled && nHold > 1 && ++m_nOffscreenFrames % nHold != 0)
 		{
-			if ((m_fTime - m_vecParticles[i].fInitTime) > m_vecParticles[i].fLifeTime)
-				m_vecDeadParticles.push_back(&m_vecParticles[i]);
-			else
-				m_vecAliveParticles.push_back(&m_vecParticles[i]);
+			m_fOffscreenTime = a_fTimeDiff;
+			return;
 		}
 
-		if (m_fParticleTime > 0.0f)
-		{
-			static float fTimeAccum = 0.0f;
-			fTimeAccum += a_fTimeDiff;
-
-			while (fTimeAccum >= m_fParticleTime)
-			{
-				AddParticle();
-				fTimeAccum -= m_fParticleTime;
-			}
-		}
+		if (!Step(a_fTimeDiff, Transform::GetUpdateWorld()))
+			GoToSleep();
 	}
-}
\ No newline at end of file
+}
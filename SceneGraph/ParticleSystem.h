@@ -14,6 +14,83 @@
 *	Update 23/5/07 - This class has been upgraded to improve usability. There is now no transformation
 *						matrix associated with this node as it functionalitiy doubled up on the of the 
 *						SGLIB::Transform. 
+*
+*	Update 19/10/26 - The system sleeps out of the update pass once it has stopped emitting and its last
+*						particle has died. AddParticle(), SetTime() and SetParticleTime() wake it again.
+*
+*	Update 19/10/26 - Particles are held in an SGLib::ParticleStore, one aligned array per attribute, and
+*						moved on the CPU by its SIMD Integrate() under the system's acceleration. The
+*						Particle struct is still what InitParticle() fills in and the vertex format, but
+*						FillVertices() writes the current position and velocity into vecInitPos and
+*						vecInitVec and sets fInitTime so the time since it is the particle's age, so
+*						shaders should draw the particle where it is rather than integrate it again.
+*
+*	Update 19/10/26 - The live particles are kept packed at the front of the store, so adding and killing a
+*						particle are O(1) and Update() only touches live particles. A system with no live
+*						particles costs nothing beyond its emission, whatever its maximum.
+*
+*	Update 19/10/26 - Emission is scheduled by the system's own SGLib::ParticleEmitter (a rate, a rate
+*						curve and bursts) instead of an accumulator shared by every system. The particles
+*						due each update are allocated together and initialised in one call to
+*						InitParticles() over their contiguous range of slots, which derived classes
+*						should override to fill the store's streams directly, using the emitter's
+*						Uniform() and UniformDirections() for the random spreads. Its default calls
+*						InitParticle() once per particle as before.
+*
+*	Update 19/10/26 - Update() only queues the system with SGLib::ParticleStage, which simulates every
+*						system updated in the frame in parallel once the update pass has finished and
+*						writes their vertices into arrays made with the system. Render() should upload
+*						GetVertices() rather than call FillVertices().
+*
+*	Update 19/10/26 - When a shared SGLib::DynamicRing is set, the vertices are copied into it by
+*						SGRenderer before the scene is drawn, every system in the same lock, and the
+*						system keeps no vertex buffer of its own. Render() calls SetVertexStream() to
+*						bind whichever buffer holds its vertices and draws from the start vertex it
+*						returns. Without a shared ring the system still uses its own buffer.
+*
+*	Update 19/10/26 - SetSortMode() has the vertices written back to front along the view given to
+*						ParticleStage::SetView(), sorted by the system's SGLib::ParticleSort. Update()
+*						takes the view into the system's space with the update world matrix, so the
+*						positions are sorted where they are. Sorting is off by default, additive
+*						effects don't need it.
+*
+*	Update 19/10/26 - SetCollider() makes the particles collide with an SGLib::ParticleCollider's
+*						planes, spheres, boxes and terrains straight after they are moved. Update()
+*						keeps the update world matrix and its inverse, so the world space colliders
+*						work whatever the system's transform.
+*
+*	Update 19/10/26 - The vertices are written in the 24 byte SGLib::ParticleVertex format instead of
+*						the 44 byte Particle, which is now only what InitParticle() fills in. Positions
+*						and sizes are 16 bit integers in a box around the live particles that the
+*						whole system shares, velocities, masses and times are half floats. Effects
+*						decode them with DecodeParticle() from ParticleDecode.fxh, after Render() has
+*						called SetDecodeParameters().
+*
+*	Update 19/10/26 - The box around the live particles is also kept in world space, under the update
+*						world matrix, and SGRenderer only calls Render() when UpdateVisibility() finds
+*						it inside the view frustum. SetBoundsMargin() widens the box by the sprites'
+*						size and SetOffscreenRate() lowers the update rate of a system while it is
+*						culled, so effects out of view cost little to simulate and nothing to draw.
+*
+*	Update 19/10/26 - The particles, emitter, sort, collider and vertices have moved to the device free
+*						SGLib::ParticleSimulation the system derives from, along with Particle and
+*						ParticleVertex. Update() steps it under the update world matrix, and the
+*						system keeps the effect, the buffers and the culling. UploadSimulated()
+*						replaces ParticleStage::Upload().
+*
+*	Update 19/10/26 - Devices whose D3DCAPS9::DeclTypes lack FLOAT16_4 or FLOAT16_2 get a declaration of
+*						SGLib::ParticleVertexWide instead, with 32 bit floats, and the vertices are
+*						widened as they are copied into the buffer. ParticleDecode.fxh reads both. A
+*						system made with no texture name draws without a texture.
+*
+*	Update 19/10/26 - The off screen rate no longer calls SetUpdateRate() from UpdateVisibility(), which
+*						ran in the render pass and overwrote the rate the node was given. Update()
+*						holds the simulation back itself while the system is culled, so the node's
+*						own rate is the only one stored and the child hierarchy keeps it.
+*
+*	Update 19/10/26 - UploadSimulated() copies through SGLib::RingUpload, which copies the ranges it
+*						has allocated before a wrap unlocks the ring, instead of allocating every
+*						range first and copying through pointers a wrap could leave dangling.
 */
 
 #ifndef SGLIB_PARTICLESYSTEM
@@ -22,28 +99,20 @@
 #pragma once
 
 #include "Shader.h"
+#include "ParticleSimulation.h"
+#include "ParticleStage.h"
+#include "DynamicRing.h"
+#include "RingUpload.h"
 #include <vector>
 #include <string>
 
 namespace SGLib
 {
-	// particle variables avaliable to the shader
-	struct Particle
-	{
-		D3DXVECTOR3	vecInitPos;	///< initial particle position
-		D3DXVECTOR3	vecInitVec;	///< initial particle velocity
-		FLOAT		fInitSize;	///< initial pixel size
-		FLOAT		fInitTime;	///< time created (with relation to particle system time)
-		FLOAT		fLifeTime;	///< life time
-		FLOAT		fMass;		///< particle mass
-		D3DCOLOR	colInitial;	///< initial particle colour
-	};
-
-	class ParticleSystem : public Shader
+	class ParticleSystem : public Shader, public ParticleSimulation
 	{
 	public:
 		ParticleSystem(	LPDIRECT3DDEVICE9 a_pD3DDevice, LPCTSTR a_sFileName, LPCSTR a_sTechName, LPCTSTR a_sTexName,
-						D3DXVECTOR3& a_rvecAccel, INT a_nMaxParticles, FLOAT a_fParticleTime);
+						const Vector3& a_rvecAccel, INT a_nMaxParticles, FLOAT a_fParticleTime);
 
 		virtual ~ParticleSystem(void);
 
@@ -51,29 +120,39 @@ namespace SGLib
 		LPDIRECT3DTEXTURE9				m_pTexture;			///< texture used for rendering the sprites
 		LPCSTR							m_sTechName;		///< technique used in the effect
 		LPCTSTR							m_sTexName;			///< filename for texture
-		LPDIRECT3DVERTEXBUFFER9			m_pVB;				///< vertex buffer holding particle positions
+		LPDIRECT3DVERTEXBUFFER9			m_pVB;				///< own vertex buffer, only made when there is no shared ring
 		LPDIRECT3DVERTEXDECLARATION9	m_pParticleDecl;	///< particle vertex decleration
-		FLOAT							m_fTime;			///< time that the effect has been running
-		D3DXVECTOR3						m_vecAccel;			///< acceleration applied to all particles
-		INT								m_nMaxParticles;	///< max no of particles at any one time
-		FLOAT							m_fParticleTime;	///< time between particle creation
+		UINT					m_nRingOffset;				///< where the vertices are in the shared ring, in bytes
+		UINT					m_nRingGeneration;			///< ring generation they were written in, 0 if they are not there
+		UINT					m_nVertexStride;			///< size of ParticleVertex, or of ParticleVertexWide without half float declarations
+		UpdateRate				m_enOffscreenRate;			///< update rate while culled, UPDATE_EVERY_FRAME to keep the rate
+		UINT					m_nOffscreenFrames;			///< counts updates while culled, starting at a phase from Node::s_nRatePhase
+		FLOAT					m_fOffscreenTime;			///< time passed in the updates held back while culled
+		BOOL					m_bCulled;					///< TRUE if the last UpdateVisibility() found the system out of view
 
-		std::vector<Particle>	m_vecParticles;				///< particles associated with this node
-		std::vector<Particle*>	m_vecAliveParticles;		///< particles currently active
-		std::vector<Particle*>	m_vecDeadParticles;			///< particles not active
+		static std::vector<ParticleSystem*>	s_vecUploads;	///< systems simulated since the last UploadSimulated()
 
 	public:
-		// operator used to index into alive particles
-		Particle*	operator[] (UINT a_nPos);
+		BOOL		UploadVertices(DynamicRing* a_pRing);
+		BOOL		SetVertexStream(UINT* a_pnStart);
+		void		SetDecodeParameters();
+
+		void		SetOffscreenRate(UpdateRate a_enRate);
+		UpdateRate	GetOffscreenRate() const;
+		BOOL		UpdateVisibility();
+		BOOL		IsCulled() const;
 
-		FLOAT		GetTime();
 		void		SetTime(FLOAT a_fTime);
+		FLOAT		GetParticleTime();
+		void		SetParticleTime(FLOAT a_fParticleTime);
 		void		AddParticle();
+		UINT		Emit(UINT a_nCount);
+
+		static void	UploadSimulated(DynamicRing* a_pRing);
 
 		virtual	void	Update(FLOAT a_fTimeDiff);
 
 		// pure virtual functions that must be instantiated
-		virtual void	InitParticle(Particle* a_pPart) = 0;
 		virtual void	Render() = 0;
 
 		// device handling functions
@@ -83,6 +162,13 @@ namespace SGLib
 		void	OnDestroyDevice();
 
 		NodeType	GetType() const;
+
+	protected:
+		void		CreateDeclaration();
+		void		CopyVertices(BYTE* a_pDest) const;
+		void		OnSimulated();
+
+		static void	WriteVertices(const void* a_pSource, BYTE* a_pDest);
 	};
 }
 
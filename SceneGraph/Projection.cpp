@@ -5,19 +5,19 @@ namespace SGLib
 	/**
 	*	\brief	Projection constructor - sets projection matrix with a_rMatrixProj
 	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
-	*	\param	D3DXMATRIX& a_rMatrixProj - reference to matrix used for projection
+	*	\param	const Matrix& a_rMatrixProj - reference to matrix used for projection
 	*/
 
 	Projection::Projection(	LPDIRECT3DDEVICE9 a_pD3DDevice, 
-							D3DXMATRIX& a_rMatrixProj) :
+							const Matrix& a_rMatrixProj) :
 								Node(a_pD3DDevice), 
 								Transform(a_pD3DDevice)
 	{
-		m_oMatrix = a_rMatrixProj;
+		m_oMatrixProj = a_rMatrixProj;
 	}
 
 	/**
-	*	\brief	Projection constructor - uses D3DXMatrixPerspectiveFovLH to create projection matrix
+	*	\brief	Projection constructor - uses MatrixPerspectiveFovLH to create projection matrix
 	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
 	*	\param	FLOAT a_fFov - field of view
 	*	\param	FLOAT a_fAspect - width/height aspect ratio
@@ -33,7 +33,7 @@ namespace SGLib
 								Node(a_pD3DDevice), 
 								Transform(a_pD3DDevice)
 	{
-		D3DXMatrixPerspectiveFovLH(&m_oMatrix, a_fFov, a_fAspect, a_fNear, a_fFar);
+		MatrixPerspectiveFovLH(&m_oMatrixProj, a_fFov, a_fAspect, a_fNear, a_fFar);
 	}
 
 	/**
@@ -60,13 +60,13 @@ namespace SGLib
 	*	\return	NodeType - returns SGLib::NodeType::PROJECTION
 	*/
 
-	void Projection::SetProjMatrix(D3DXMATRIX& a_rMatrixProj)
+	void Projection::SetProjMatrix(const Matrix& a_rMatrixProj)
 	{
-		m_oMatrix = a_rMatrixProj;
+		m_oMatrixProj = a_rMatrixProj;
 	}
 
 	/**
-	*	\brief	Sets projection matrix using D3DXMatrixPerspectiveFovLH
+	*	\brief	Sets projection matrix using MatrixPerspectiveFovLH
 	*	\param	FLOAT a_fFov - field of view
 	*	\param	FLOAT a_fAspect - width/height aspect ratio
 	*	\param	FLOAT a_fNear - near clipping plane
@@ -75,7 +75,7 @@ namespace SGLib
 
 	void Projection::ResetMatrix(FLOAT a_fFov, FLOAT a_fAspect, FLOAT a_fNear, FLOAT a_fFar)
 	{
-		D3DXMatrixPerspectiveFovLH(&m_oMatrix, a_fFov, a_fAspect, a_fNear, a_fFar);
+		MatrixPerspectiveFovLH(&m_oMatrixProj, a_fFov, a_fAspect, a_fNear, a_fFar);
 	}
 
 	/**
@@ -88,9 +88,9 @@ namespace SGLib
 	{
 		HRESULT	hr;
 
-		V(m_pD3DDevice->GetTransform(D3DTS_PROJECTION, &m_oMatrixPrevious))
+		V(m_pD3DDevice->GetTransform(D3DTS_PROJECTION, m_oMatrixProjPrevious.AsD3D()))
 
-		V(m_pD3DDevice->SetTransform(D3DTS_PROJECTION, &m_oMatrix))
+		V(m_pD3DDevice->SetTransform(D3DTS_PROJECTION, m_oMatrixProj.AsD3D()))
 	}
 
 	/**
@@ -104,17 +104,18 @@ namespace SGLib
 	{
 		HRESULT hr;
 
-		V(m_pD3DDevice->SetTransform(D3DTS_PROJECTION, &m_oMatrixPrevious))
+		V(m_pD3DDevice->SetTransform(D3DTS_PROJECTION, m_oMatrixProjPrevious.AsD3D()))
 	}
 
 	/**
 	*	\brief	Only declared to avoid calling Transform::Update as the projection matrix functions slightly
 	*			differently than a regular transform matrix
+	*	\note	There is nothing to update so the node sleeps
 	*/
 
 	void Projection::Update(FLOAT a_fTimeDiff)
 	{
-
+		GoToSleep();
 	}
 
 	/**
@@ -7,6 +7,9 @@
 *
 *	The projection node specifies a projection matrix is recommended to only occur once within the scene graph
 *	and reside high up the hierarchy.
+*
+*	Update 19/10/26 - The projection is the one place a full 4x4 matrix is required, it is now held in its own
+*						members as SGLib::Transform only stores affine matrices.
 */
 
 #ifndef SGLIB_PROJECTION
@@ -14,19 +17,24 @@
 
 #pragma once
 
-#include "transform.h"
+#include "dxstdafx.h"
+#include "Transform.h"
 
 namespace SGLib
 {
 	class Projection : public Transform
 	{
 	public:
-		Projection	(LPDIRECT3DDEVICE9 a_pD3DDevice, D3DXMATRIX& a_oMatrixProj);
-		Projection	(LPDIRECT3DDEVICE9 a_pD3DDevice, FLOAT a_fFov, FLOAT a_fAspect, FLOAT a_fNear, FLOAT a_fFar);	// constructor for D3DXMatrixPerspectiveFovRH call
+		Projection	(LPDIRECT3DDEVICE9 a_pD3DDevice, const Matrix& a_oMatrixProj);
+		Projection	(LPDIRECT3DDEVICE9 a_pD3DDevice, FLOAT a_fFov, FLOAT a_fAspect, FLOAT a_fNear, FLOAT a_fFar);	// constructor for MatrixPerspectiveFovLH call
 		~Projection	(void);
 
+	protected:
+		Matrix	m_oMatrixProj;			///< projection matrix
+		Matrix	m_oMatrixProjPrevious;	///< previous projection matrix
+
 	public:
-		void	SetProjMatrix	(D3DXMATRIX& a_rMatrixProj);
+		void	SetProjMatrix	(const Matrix& a_rMatrixProj);
 		void	ResetMatrix		(FLOAT a_fFov, FLOAT a_fAspect, FLOAT a_fNear, FLOAT a_fFar);
 
 		// scene graph
@@ -0,0 +1,183 @@
+#include "RingAllocator.h"
+
+namespace SGLib
+{
+	/**
+	*	\brief	RingAllocator constructor
+	*	\param	UINT a_nCapacity - size of the ring in bytes
+	*/
+
+	RingAllocator::RingAllocator(UINT a_nCapacity) :	m_nCapacity(a_nCapacity),
+														m_nHead(0),
+														m_nGeneration(0),
+														m_bWrapPending(TRUE),
+														m_nFrameBytes(0),
+														m_nLastFrameBytes(0),
+														m_nFrameWraps(0)
+	{
+	}
+
+	/**
+	*	\brief	RingAllocator destructor
+	*/
+
+	RingAllocator::~RingAllocator()
+	{
+	}
+
+	/**
+	*	\brief	Changes the size of the ring and invalidates every range allocated so far
+	*	\param	UINT a_nCapacity - size of the ring in bytes
+	*	\note	Also used when the buffer behind the ring has been recreated
+	*/
+
+	void RingAllocator::Reset(UINT a_nCapacity)
+	{
+		m_nCapacity = a_nCapacity;
+		m_nHead = 0;
+		m_bWrapPending = TRUE;
+
+		// generation 0 is never valid
+		if (++m_nGeneration == 0)
+			m_nGeneration = 1;
+	}
+
+	/**
+	*	\brief	Starts counting a new frame's allocations and wraps early if the last frame's would not
+	*			fit in the bytes left
+	*/
+
+	void RingAllocator::BeginFrame()
+	{
+		m_nLastFrameBytes = m_nFrameBytes;
+		m_nFrameBytes = 0;
+		m_nFrameWraps = 0;
+
+		if (m_nCapacity - m_nHead < m_nLastFrameBytes)
+			m_bWrapPending = TRUE;
+	}
+
+	/**
+	*	\brief	Allocates a range of the ring
+	*	\param	UINT a_nSize - bytes wanted
+	*	\param	UINT a_nStride - the offset is a multiple of this, usually the vertex size
+	*	\param	UINT* a_pnOffset - receives the offset of the range in bytes
+	*	\return	Result - RING_APPEND or RING_WRAP, or RING_FAILED if a_nSize is 0 or larger than the ring
+	*/
+
+	RingAllocator::Result RingAllocator::Allocate(UINT a_nSize, UINT a_nStride, UINT* a_pnOffset)
+	{
+		if (a_nSize == 0 || a_nSize > m_nCapacity)
+			return RING_FAILED;
+
+		if (a_nStride == 0)
+			a_nStride = 1;
+
+		UINT nOffset = (m_nHead + a_nStride - 1) / a_nStride * a_nStride;
+		Result eResult = RING_APPEND;
+
+		if (WillWrap(a_nSize, a_nStride))
+		{
+			nOffset = 0;
+			eResult = RING_WRAP;
+
+			m_bWrapPending = FALSE;
+			++m_nFrameWraps;
+
+			if (++m_nGeneration == 0)
+				m_nGeneration = 1;
+
+			m_nHead = 0;
+		}
+
+		// padding before the range counts towards the frame's bytes
+		m_nFrameBytes += nOffset + a_nSize - m_nHead;
+		m_nHead = nOffset + a_nSize;
+
+		*a_pnOffset = nOffset;
+
+		return eResult;
+	}
+
+	/**
+	*	\brief	Whether allocating a range would wrap the ring
+	*	\param	UINT a_nSize - bytes that would be allocated
+	*	\param	UINT a_nStride - the stride they would be allocated with
+	*	\return	BOOL - TRUE if Allocate() would return RING_WRAP for them
+	*	\note	Lets a caller finish with the ranges it already holds before the wrap invalidates them
+	*/
+
+	BOOL RingAllocator::WillWrap(UINT a_nSize, UINT a_nStride) const
+	{
+		if (a_nSize == 0 || a_nSize > m_nCapacity)
+			return FALSE;
+
+		if (a_nStride == 0)
+			a_nStride = 1;
+
+		UINT nOffset = (m_nHead + a_nStride - 1) / a_nStride * a_nStride;
+
+		return m_bWrapPending || nOffset > m_nCapacity || a_nSize > m_nCapacity - nOffset;
+	}
+
+	/**
+	*	\brief	Whether a range is still intact
+	*	\param	UINT a_nGeneration - generation when the range was allocated
+	*	\return	BOOL - TRUE if the ring has not wrapped since
+	*/
+
+	BOOL RingAllocator::IsValid(UINT a_nGeneration) const
+	{
+		return a_nGeneration != 0 && a_nGeneration == m_nGeneration;
+	}
+
+	/**
+	*	\brief	Accessor for the size of the ring
+	*	\return	UINT - size in bytes
+	*/
+
+	UINT RingAllocator::GetCapacity() const
+	{
+		return m_nCapacity;
+	}
+
+	/**
+	*	\brief	Accessor for the end of the last allocation
+	*	\return	UINT - offset in bytes where the next allocation would start, before alignment
+	*/
+
+	UINT RingAllocator::GetHead() const
+	{
+		return m_nHead;
+	}
+
+	/**
+	*	\brief	Accessor for the current generation
+	*	\return	UINT - stored with each range and checked with IsValid(), never 0 once something is allocated
+	*/
+
+	UINT RingAllocator::GetGeneration() const
+	{
+		return m_nGeneration;
+	}
+
+	/**
+	*	\brief	Accessor for the bytes allocated this frame
+	*	\return	UINT - bytes since BeginFrame(), padding included
+	*/
+
+	UINT RingAllocator::GetFrameBytes() const
+	{
+		return m_nFrameBytes;
+	}
+
+	/**
+	*	\brief	Accessor for the wraps this frame
+	*	\return	UINT - wraps since BeginFrame(), each costs a discarding lock
+	*/
+
+	UINT RingAllocator::GetFrameWraps() const
+	{
+		return m_nFrameWraps;
+	}
+}
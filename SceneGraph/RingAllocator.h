@@ -0,0 +1,75 @@
+/**
+*	\class		SGLib::RingAllocator
+*	\brief		Hands out ranges of a ring of bytes, the bookkeeping behind SGLib::DynamicRing
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Allocations are appended after the last one (the head) until one doesn't fit, when the ring wraps
+*	and the allocation starts again at 0. Allocate() says which of the two happened, as the buffer
+*	behind the ring has to be locked differently:
+*
+*		RING_APPEND	- the range has never been written since the last wrap, lock with D3DLOCK_NOOVERWRITE
+*		RING_WRAP	- the ring started over, lock with D3DLOCK_DISCARD so the driver hands out new memory
+*					  instead of waiting for the GPU to finish with the old
+*
+*	Every wrap advances the generation. A range stays intact as long as the generation it was
+*	allocated in is current, so a caller that keeps its offset and generation can draw the same range
+*	again in later frames and only needs to write it again once the generation has moved on.
+*
+*	BeginFrame() wraps early when the bytes left are fewer than the last frame used, so allocations
+*	made in one frame are rarely split by a wrap. A wrap in the middle of a frame invalidates the
+*	ranges allocated before it in that frame, and their owners see it from the generation.
+*	WillWrap() tells beforehand whether an allocation would wrap, for callers still writing earlier
+*	ranges.
+*
+*	Offsets are aligned to the stride asked for, so offset / stride is a vertex index. Nothing here
+*	depends on the device.
+*/
+
+#ifndef SGLIB_RINGALLOCATOR
+#define SGLIB_RINGALLOCATOR
+
+#pragma once
+
+#include "SGMath.h"
+
+namespace SGLib
+{
+	class RingAllocator
+	{
+	public:
+		enum Result
+		{
+			RING_FAILED,	///< larger than the ring, nothing allocated
+			RING_APPEND,	///< placed after the previous allocation
+			RING_WRAP		///< placed at 0 after the ring wrapped
+		};
+
+		RingAllocator(UINT a_nCapacity = 0);
+		~RingAllocator();
+
+	protected:
+		UINT	m_nCapacity;		///< size of the ring in bytes
+		UINT	m_nHead;			///< first byte after the last allocation
+		UINT	m_nGeneration;		///< wraps so far
+		BOOL	m_bWrapPending;		///< the next allocation starts at 0
+		UINT	m_nFrameBytes;		///< bytes allocated since BeginFrame(), padding included
+		UINT	m_nLastFrameBytes;	///< the same count for the previous frame
+		UINT	m_nFrameWraps;		///< wraps since BeginFrame()
+
+	public:
+		void		Reset			(UINT a_nCapacity);
+		void		BeginFrame		();
+		Result		Allocate		(UINT a_nSize, UINT a_nStride, UINT* a_pnOffset);
+		BOOL		WillWrap		(UINT a_nSize, UINT a_nStride) const;
+		BOOL		IsValid			(UINT a_nGeneration) const;
+
+		UINT		GetCapacity		() const;
+		UINT		GetHead			() const;
+		UINT		GetGeneration	() const;
+		UINT		GetFrameBytes	() const;
+		UINT		GetFrameWraps	() const;
+	};
+}
+
+#endif
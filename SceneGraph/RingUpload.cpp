@@ -0,0 +1,97 @@
+#include "RingUpload.h"
+#include "JobSystem.h"
+
+namespace SGLib
+{
+	/**
+	*	\brief	RingUpload constructor
+	*	\param	MappedRing* a_pRing - ring to allocate the ranges from
+	*	\param	WriteFunc a_pWrite - writes one source's range, called from several threads at once
+	*/
+
+	RingUpload::RingUpload(MappedRing* a_pRing, WriteFunc a_pWrite) :	m_pRing(a_pRing),
+																		m_pWrite(a_pWrite),
+																		m_nRuns(0)
+	{
+	}
+
+	/**
+	*	\brief	RingUpload destructor
+	*	\note	Writes whatever hasn't been written yet, the ring is left mapped for the caller to Flush()
+	*/
+
+	RingUpload::~RingUpload()
+	{
+		Run();
+	}
+
+	/**
+	*	\brief	Allocates a source's range, to be written by the next Run()
+	*	\param	const void* a_pSource - passed to the write function
+	*	\param	UINT a_nSize - bytes wanted
+	*	\param	UINT a_nStride - vertex size, the offset is a multiple of it
+	*	\param	UINT* a_pnOffset - receives the offset of the range in bytes
+	*	\param	UINT* a_pnGeneration - receives the generation to check the range with, may be NULL
+	*	\return	BYTE* - where the range will be written, NULL if it could not be allocated
+	*	\note	Runs the writes kept so far first if the allocation wraps the ring
+	*/
+
+	BYTE* RingUpload::Add(const void* a_pSource, UINT a_nSize, UINT a_nStride, UINT* a_pnOffset, UINT* a_pnGeneration)
+	{
+		if (!m_vecWrites.empty() && m_pRing->WillWrap(a_nSize, a_nStride))
+			Run();
+
+		BYTE* pDest = m_pRing->Allocate(a_nSize, a_nStride, a_pnOffset, a_pnGeneration);
+
+		if (pDest)
+		{
+			Write oWrite;
+			oWrite.pSource = a_pSource;
+			oWrite.pDest = pDest;
+
+			m_vecWrites.push_back(oWrite);
+		}
+
+		return pDest;
+	}
+
+	/**
+	*	\brief	Writes every range allocated since the last call in parallel
+	*/
+
+	void RingUpload::Run()
+	{
+		if (m_vecWrites.empty())
+			return;
+
+		JobSystem::ParallelFor((UINT)m_vecWrites.size(), 1, WriteRange, this);
+
+		m_vecWrites.clear();
+		++m_nRuns;
+	}
+
+	/**
+	*	\brief	Accessor for the number of runs
+	*	\return	UINT - Run() calls that wrote something, more than one if the ring wrapped part way
+	*/
+
+	UINT RingUpload::GetNumRuns() const
+	{
+		return m_nRuns;
+	}
+
+	/**
+	*	\brief	Job writing a range of the kept ranges
+	*	\param	void* a_pData - the RingUpload
+	*	\param	UINT a_nBegin - first range
+	*	\param	UINT a_nEnd - one past the last range
+	*/
+
+	void RingUpload::WriteRange(void* a_pData, UINT a_nBegin, UINT a_nEnd)
+	{
+		const RingUpload* pUpload = static_cast<const RingUpload*>(a_pData);
+
+		for (UINT i = a_nBegin; i < a_nEnd; ++i)
+			pUpload->m_pWrite(pUpload->m_vecWrites[i].pSource, pUpload->m_vecWrites[i].pDest);
+	}
+}
@@ -0,0 +1,58 @@
+/**
+*	\class		SGLib::RingUpload
+*	\brief		Allocates the ranges of many sources in a SGLib::MappedRing and writes them in parallel
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Add() allocates a source's range in turn and keeps the pointer, Run() then calls the write function
+*	for every range kept so far with SGLib::JobSystem. Before an allocation that would wrap the ring,
+*	and so unmap the memory under the kept pointers, Add() runs the writes kept so far, so nothing is
+*	written after its mapping has ended. The ranges written before a wrap are invalid afterwards and
+*	their owners see it from the generation, as with any wrap.
+*
+*	Nothing here depends on the device.
+*/
+
+#ifndef SGLIB_RINGUPLOAD
+#define SGLIB_RINGUPLOAD
+
+#pragma once
+
+#include "MappedRing.h"
+#include <vector>
+
+namespace SGLib
+{
+	class RingUpload
+	{
+	public:
+		// writes a source's range, a_pDest has the bytes asked for in Add()
+		typedef void (*WriteFunc)(const void* a_pSource, BYTE* a_pDest);
+
+		RingUpload(MappedRing* a_pRing, WriteFunc a_pWrite);
+		~RingUpload();
+
+	protected:
+		// a source's range kept until Run()
+		struct Write
+		{
+			const void*		pSource;	///< passed to the write function
+			BYTE*			pDest;		///< where to write the range
+		};
+
+		MappedRing*			m_pRing;		///< ring the ranges are allocated from, not owned
+		WriteFunc			m_pWrite;		///< writes one range
+		std::vector<Write>	m_vecWrites;	///< ranges allocated since the last Run()
+		UINT				m_nRuns;		///< Run() calls that had something to write
+
+	public:
+		BYTE*		Add				(const void* a_pSource, UINT a_nSize, UINT a_nStride, UINT* a_pnOffset, UINT* a_pnGeneration);
+		void		Run				();
+		UINT		GetNumRuns		() const;
+
+	protected:
+		static void	WriteRange		(void* a_pData, UINT a_nBegin, UINT a_nEnd);
+	};
+}
+
+#endif
@@ -1,13 +1,30 @@
 #pragma once
 
+#include "AnimLibrary.h"
+#include "AnimSystem.h"
 #include "Articulated.h"
 #include "Camera.h"
+#include "DynamicRing.h"
 #include "Geometry.h"
+#include "JobSystem.h"
+#include "Keyframe.h"
 #include "Node.h"
+#include "ParticleCollider.h"
+#include "ParticleEmitter.h"
+#include "ParticleSimulation.h"
+#include "ParticleSort.h"
+#include "ParticleStage.h"
+#include "ParticleStore.h"
 #include "ParticleSystem.h"
 #include "Projection.h"
+#include "RingAllocator.h"
+#include "SGMath.h"
 #include "Shader.h"
+#include "Skeleton.h"
+#include "SkinnedGeometry.h"
 #include "State.h"
+#include "StaticBatch.h"
 #include "Transform.h"
+#include "TransformTrack.h"
 #include "SGRenderer.h"
 
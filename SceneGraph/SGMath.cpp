@@ -0,0 +1,1957 @@
+#include "SGMath.h"
+
+#if defined(SGLIB_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(SGLIB_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace SGLib
+{
+	//--------------------------------------------------------------------------------------
+	// scalar reference implementations
+	//--------------------------------------------------------------------------------------
+
+	namespace Reference
+	{
+		/**
+		*	\brief	Transforms a point by a matrix and projects the result back into w = 1
+		*	\param	Vector3* a_pOut - receives the transformed point (may equal a_pV)
+		*	\param	const Vector3* a_pV - point to transform
+		*	\param	const Matrix* a_pM - transformation matrix
+		*	\return	Vector3* - a_pOut
+		*/
+
+		Vector3* Vec3TransformCoord(Vector3* a_pOut, const Vector3* a_pV, const Matrix* a_pM)
+		{
+			const FLOAT fX = a_pV->x, fY = a_pV->y, fZ = a_pV->z;
+
+			FLOAT fOutX = fX * a_pM->_11 + fY * a_pM->_21 + fZ * a_pM->_31 + a_pM->_41;
+			FLOAT fOutY = fX * a_pM->_12 + fY * a_pM->_22 + fZ * a_pM->_32 + a_pM->_42;
+			FLOAT fOutZ = fX * a_pM->_13 + fY * a_pM->_23 + fZ * a_pM->_33 + a_pM->_43;
+			FLOAT fOutW = fX * a_pM->_14 + fY * a_pM->_24 + fZ * a_pM->_34 + a_pM->_44;
+
+			a_pOut->x = fOutX / fOutW;
+			a_pOut->y = fOutY / fOutW;
+			a_pOut->z = fOutZ / fOutW;
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	Transforms a direction by the upper 3x3 of a matrix (translation is ignored)
+		*	\param	Vector3* a_pOut - receives the transformed direction (may equal a_pV)
+		*	\param	const Vector3* a_pV - direction to transform
+		*	\param	const Matrix* a_pM - transformation matrix
+		*	\return	Vector3* - a_pOut
+		*/
+
+		Vector3* Vec3TransformNormal(Vector3* a_pOut, const Vector3* a_pV, const Matrix* a_pM)
+		{
+			const FLOAT fX = a_pV->x, fY = a_pV->y, fZ = a_pV->z;
+
+			a_pOut->x = fX * a_pM->_11 + fY * a_pM->_21 + fZ * a_pM->_31;
+			a_pOut->y = fX * a_pM->_12 + fY * a_pM->_22 + fZ * a_pM->_32;
+			a_pOut->z = fX * a_pM->_13 + fY * a_pM->_23 + fZ * a_pM->_33;
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	Transforms a four component vector by a matrix
+		*	\param	Vector4* a_pOut - receives the transformed vector (may equal a_pV)
+		*	\param	const Vector4* a_pV - vector to transform
+		*	\param	const Matrix* a_pM - transformation matrix
+		*	\return	Vector4* - a_pOut
+		*/
+
+		Vector4* Vec4Transform(Vector4* a_pOut, const Vector4* a_pV, const Matrix* a_pM)
+		{
+			const FLOAT fX = a_pV->x, fY = a_pV->y, fZ = a_pV->z, fW = a_pV->w;
+
+			a_pOut->x = fX * a_pM->_11 + fY * a_pM->_21 + fZ * a_pM->_31 + fW * a_pM->_41;
+			a_pOut->y = fX * a_pM->_12 + fY * a_pM->_22 + fZ * a_pM->_32 + fW * a_pM->_42;
+			a_pOut->z = fX * a_pM->_13 + fY * a_pM->_23 + fZ * a_pM->_33 + fW * a_pM->_43;
+			a_pOut->w = fX * a_pM->_14 + fY * a_pM->_24 + fZ * a_pM->_34 + fW * a_pM->_44;
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	Weighted sum of four vectors
+		*	\param	Vector4* a_pOut - receives the sum
+		*	\param	const FLOAT* const* a_ppV - four vectors of four floats, need not be aligned
+		*	\param	const FLOAT* a_pWeights - four weights
+		*	\return	Vector4* - a_pOut
+		*/
+
+		Vector4* Vec4Blend(Vector4* a_pOut, const FLOAT* const* a_ppV, const FLOAT* a_pWeights)
+		{
+			FLOAT afSum[4];
+
+			for (UINT j = 0; j < 4; ++j)
+			{
+				afSum[j] = a_ppV[0][j] * a_pWeights[0];
+				afSum[j] += a_ppV[1][j] * a_pWeights[1];
+				afSum[j] += a_ppV[2][j] * a_pWeights[2];
+				afSum[j] += a_ppV[3][j] * a_pWeights[3];
+			}
+
+			*a_pOut = Vector4(afSum[0], afSum[1], afSum[2], afSum[3]);
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	Vec3TransformCoord() over an array of points
+		*	\param	Vector3* a_pOut - receives the transformed points
+		*	\param	UINT a_nOutStride - bytes between output points
+		*	\param	const Vector3* a_pV - points to transform
+		*	\param	UINT a_nVStride - bytes between input points
+		*	\param	const Matrix* a_pM - transformation matrix
+		*	\param	UINT a_nCount - number of points
+		*	\return	Vector3* - a_pOut
+		*/
+
+		Vector3* Vec3TransformCoordArray(Vector3* a_pOut, UINT a_nOutStride, const Vector3* a_pV, UINT a_nVStride, const Matrix* a_pM, UINT a_nCount)
+		{
+			char* pOut = (char*)a_pOut;
+			const char* pIn = (const char*)a_pV;
+
+			for (UINT i = 0; i < a_nCount; ++i, pOut += a_nOutStride, pIn += a_nVStride)
+				Reference::Vec3TransformCoord((Vector3*)pOut, (const Vector3*)pIn, a_pM);
+
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	Vec3TransformNormal() over an array of directions
+		*	\param	Vector3* a_pOut - receives the transformed directions
+		*	\param	UINT a_nOutStride - bytes between output directions
+		*	\param	const Vector3* a_pV - directions to transform
+		*	\param	UINT a_nVStride - bytes between input directions
+		*	\param	const Matrix* a_pM - transformation matrix
+		*	\param	UINT a_nCount - number of directions
+		*	\return	Vector3* - a_pOut
+		*/
+
+		Vector3* Vec3TransformNormalArray(Vector3* a_pOut, UINT a_nOutStride, const Vector3* a_pV, UINT a_nVStride, const Matrix* a_pM, UINT a_nCount)
+		{
+			char* pOut = (char*)a_pOut;
+			const char* pIn = (const char*)a_pV;
+
+			for (UINT i = 0; i < a_nCount; ++i, pOut += a_nOutStride, pIn += a_nVStride)
+				Reference::Vec3TransformNormal((Vector3*)pOut, (const Vector3*)pIn, a_pM);
+
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	Multiplies two matrices (a_pM1 is applied first)
+		*	\param	Matrix* a_pOut - receives a_pM1 * a_pM2 (may equal either input)
+		*	\param	const Matrix* a_pM1 - left matrix
+		*	\param	const Matrix* a_pM2 - right matrix
+		*	\return	Matrix* - a_pOut
+		*/
+
+		Matrix* MatrixMultiply(Matrix* a_pOut, const Matrix* a_pM1, const Matrix* a_pM2)
+		{
+			Matrix matTemp;
+
+			for (UINT i = 0; i < 4; ++i)
+				for (UINT j = 0; j < 4; ++j)
+					matTemp.m[i][j] =	a_pM1->m[i][0] * a_pM2->m[0][j] + a_pM1->m[i][1] * a_pM2->m[1][j] +
+										a_pM1->m[i][2] * a_pM2->m[2][j] + a_pM1->m[i][3] * a_pM2->m[3][j];
+
+			*a_pOut = matTemp;
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	MatrixMultiply() over arrays of matrices
+		*	\param	Matrix* a_pOut - receives a_pM1[i] * a_pM2[i]
+		*	\param	const Matrix* a_pM1 - left matrices
+		*	\param	const Matrix* a_pM2 - right matrices
+		*	\param	UINT a_nCount - number of matrices
+		*	\return	Matrix* - a_pOut
+		*/
+
+		Matrix* MatrixMultiplyArray(Matrix* a_pOut, const Matrix* a_pM1, const Matrix* a_pM2, UINT a_nCount)
+		{
+			for (UINT i = 0; i < a_nCount; ++i)
+				Reference::MatrixMultiply(&a_pOut[i], &a_pM1[i], &a_pM2[i]);
+
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	Transposes a matrix
+		*	\param	Matrix* a_pOut - receives the transpose (may equal a_pM)
+		*	\param	const Matrix* a_pM - matrix to transpose
+		*	\return	Matrix* - a_pOut
+		*/
+
+		Matrix* MatrixTranspose(Matrix* a_pOut, const Matrix* a_pM)
+		{
+			Matrix matTemp;
+
+			for (UINT i = 0; i < 4; ++i)
+				for (UINT j = 0; j < 4; ++j)
+					matTemp.m[i][j] = a_pM->m[j][i];
+
+			*a_pOut = matTemp;
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	Multiplies two affine matrices (a_pM1 is applied first)
+		*	\param	AffineMatrix* a_pOut - receives a_pM1 * a_pM2 (may equal either input)
+		*	\param	const AffineMatrix* a_pM1 - left matrix
+		*	\param	const AffineMatrix* a_pM2 - right matrix
+		*	\return	AffineMatrix* - a_pOut
+		*	\note	The storage is transposed so this is a_pM2' * a_pM1' with the implied (0, 0, 0, 1) row
+		*			of a_pM1' only contributing the translation of a_pM2
+		*/
+
+		AffineMatrix* AffineMultiply(AffineMatrix* a_pOut, const AffineMatrix* a_pM1, const AffineMatrix* a_pM2)
+		{
+			AffineMatrix matTemp;
+
+			for (UINT i = 0; i < 3; ++i)
+				for (UINT j = 0; j < 4; ++j)
+					matTemp.m[i][j] =	a_pM2->m[i][0] * a_pM1->m[0][j] + a_pM2->m[i][1] * a_pM1->m[1][j] +
+										a_pM2->m[i][2] * a_pM1->m[2][j] + (j == 3 ? a_pM2->m[i][3] : 0.0f);
+
+			*a_pOut = matTemp;
+			return a_pOut;
+		}
+
+		/**
+		*	\brief	Calculates the sine and cosine of an array of angles
+		*	\param	FLOAT* a_pSin - receives the sines
+		*	\param	FLOAT* a_pCos - receives the cosines
+		*	\param	const FLOAT* a_pAngles - angles in radians
+		*	\param	UINT a_nCount - number of angles
+		*/
+
+		void SinCosArray(FLOAT* a_pSin, FLOAT* a_pCos, const FLOAT* a_pAngles, UINT a_nCount)
+		{
+			for (UINT i = 0; i < a_nCount; ++i)
+				ScalarSinCos(&a_pSin[i], &a_pCos[i], a_pAngles[i]);
+		}
+
+		/**
+		*	\brief	Converts an array of floats to half floats
+		*	\param	unsigned short* a_pOut - receives the half floats
+		*	\param	const FLOAT* a_pIn - floats to convert
+		*	\param	UINT a_nCount - number of floats
+		*	\return	unsigned short* - a_pOut
+		*/
+
+		unsigned short* Float32To16Array(unsigned short* a_pOut, const FLOAT* a_pIn, UINT a_nCount)
+		{
+			for (UINT i = 0; i < a_nCount; ++i)
+				a_pOut[i] = ScalarFloat32To16(a_pIn[i]);
+
+			return a_pOut;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// SIMD helpers
+	//--------------------------------------------------------------------------------------
+
+#if defined(SGLIB_SIMD_SSE2)
+	namespace
+	{
+		// loads x, y, z into the low three lanes (w is zero)
+		inline __m128 LoadVector3(const Vector3* a_pV)
+		{
+			__m128 xy = _mm_castpd_ps(_mm_load_sd((const double*)a_pV));
+			__m128 z = _mm_load_ss(&a_pV->z);
+			return _mm_movelh_ps(xy, z);
+		}
+
+		inline void StoreVector3(Vector3* a_pOut, __m128 a_v)
+		{
+			_mm_store_sd((double*)a_pOut, _mm_castps_pd(a_v));
+			_mm_store_ss(&a_pOut->z, _mm_movehl_ps(a_v, a_v));
+		}
+
+		// row * matrix with the multiplies and adds in the same order as the reference
+		inline __m128 TransformRow(__m128 a_vX, __m128 a_vY, __m128 a_vZ, __m128 a_vW, const __m128* a_pRows)
+		{
+			__m128 vResult = _mm_add_ps(_mm_mul_ps(a_vX, a_pRows[0]), _mm_mul_ps(a_vY, a_pRows[1]));
+			vResult = _mm_add_ps(vResult, _mm_mul_ps(a_vZ, a_pRows[2]));
+			return _mm_add_ps(vResult, _mm_mul_ps(a_vW, a_pRows[3]));
+		}
+
+		inline void LoadRows(const Matrix* a_pM, __m128* a_pRows)
+		{
+			a_pRows[0] = _mm_loadu_ps(a_pM->m[0]);
+			a_pRows[1] = _mm_loadu_ps(a_pM->m[1]);
+			a_pRows[2] = _mm_loadu_ps(a_pM->m[2]);
+			a_pRows[3] = _mm_loadu_ps(a_pM->m[3]);
+		}
+
+		inline __m128 TransformCoord(__m128 a_v, const __m128* a_pRows)
+		{
+			__m128 vX = _mm_shuffle_ps(a_v, a_v, _MM_SHUFFLE(0, 0, 0, 0));
+			__m128 vY = _mm_shuffle_ps(a_v, a_v, _MM_SHUFFLE(1, 1, 1, 1));
+			__m128 vZ = _mm_shuffle_ps(a_v, a_v, _MM_SHUFFLE(2, 2, 2, 2));
+
+			// x * row0 + y * row1 + z * row2 + row3 (the w of a point is one so row3 is added directly)
+			__m128 vResult = _mm_add_ps(_mm_mul_ps(vX, a_pRows[0]), _mm_mul_ps(vY, a_pRows[1]));
+			vResult = _mm_add_ps(vResult, _mm_mul_ps(vZ, a_pRows[2]));
+			vResult = _mm_add_ps(vResult, a_pRows[3]);
+
+			return _mm_div_ps(vResult, _mm_shuffle_ps(vResult, vResult, _MM_SHUFFLE(3, 3, 3, 3)));
+		}
+
+		inline __m128 TransformNormal(__m128 a_v, const __m128* a_pRows)
+		{
+			__m128 vX = _mm_shuffle_ps(a_v, a_v, _MM_SHUFFLE(0, 0, 0, 0));
+			__m128 vY = _mm_shuffle_ps(a_v, a_v, _MM_SHUFFLE(1, 1, 1, 1));
+			__m128 vZ = _mm_shuffle_ps(a_v, a_v, _MM_SHUFFLE(2, 2, 2, 2));
+
+			__m128 vResult = _mm_add_ps(_mm_mul_ps(vX, a_pRows[0]), _mm_mul_ps(vY, a_pRows[1]));
+			return _mm_add_ps(vResult, _mm_mul_ps(vZ, a_pRows[2]));
+		}
+
+		inline void MultiplySSE(Matrix* a_pOut, const Matrix* a_pM1, const Matrix* a_pM2)
+		{
+			__m128 aRows[4];
+			LoadRows(a_pM2, aRows);
+
+			// read all of a_pM1 before writing so a_pOut may alias either input
+			__m128 aResult[4];
+			for (UINT i = 0; i < 4; ++i)
+			{
+				const FLOAT* pRow = a_pM1->m[i];
+				aResult[i] = TransformRow(_mm_set1_ps(pRow[0]), _mm_set1_ps(pRow[1]), _mm_set1_ps(pRow[2]), _mm_set1_ps(pRow[3]), aRows);
+			}
+
+			for (UINT i = 0; i < 4; ++i)
+				_mm_storeu_ps(a_pOut->m[i], aResult[i]);
+		}
+	}
+#endif
+
+#if defined(SGLIB_SIMD_AVX2)
+	namespace
+	{
+		inline __m256 Broadcast2(__m128 a_v)
+		{
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(a_v), a_v, 1);
+		}
+
+		inline __m256 Combine(__m128 a_vLow, __m128 a_vHigh)
+		{
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(a_vLow), a_vHigh, 1);
+		}
+	}
+#endif
+
+	//--------------------------------------------------------------------------------------
+	// trigonometric functions
+	//--------------------------------------------------------------------------------------
+
+	namespace
+	{
+		const FLOAT SG_1DIV2PI		= 0.159154943f;
+		const FLOAT SG_2PI_HI		= 6.28125f;			// 2 pi split so q * SG_2PI_HI is exact for |q| < 2^15
+		const FLOAT SG_2PI_LO		= 1.9353071796e-3f;
+		const FLOAT SG_PIDIV2		= 1.570796327f;
+		const FLOAT SG_ROUNDMAGIC	= 12582912.0f;	// 1.5 * 2^23, adding and subtracting it rounds to an integer
+
+		// minimax polynomials for sin(x) / x and cos(x) in x^2 over [-pi/2, pi/2]
+		const FLOAT SG_SIN[6] = { -2.3889859e-08f, 2.7525562e-06f, -0.00019840874f, 0.0083333310f, -0.16666667f, 1.0f };
+		const FLOAT SG_COS[6] = { -2.6051615e-07f, 2.4760495e-05f, -0.0013888378f, 0.041666638f, -0.5f, 1.0f };
+	}
+
+	/**
+	*	\brief	Calculates the sine and cosine of an angle
+	*	\param	FLOAT* a_pSin - receives the sine
+	*	\param	FLOAT* a_pCos - receives the cosine
+	*	\param	FLOAT a_fAngle - angle in radians
+	*	\note	The angle is reduced to [-pi, pi], reflected into [-pi/2, pi/2] and both polynomials are
+	*			evaluated on the result. SinCosArray() performs exactly the same operations four at a time.
+	*/
+
+	void ScalarSinCos(FLOAT* a_pSin, FLOAT* a_pCos, FLOAT a_fAngle)
+	{
+		// reduce to [-pi, pi]
+		FLOAT fQuotient = a_fAngle * SG_1DIV2PI;
+		fQuotient = (fQuotient + SG_ROUNDMAGIC) - SG_ROUNDMAGIC;
+		FLOAT fY = (a_fAngle - fQuotient * SG_2PI_HI) - fQuotient * SG_2PI_LO;
+
+		// reflect into [-pi/2, pi/2], the sine is unchanged and the cosine changes sign
+		FLOAT fSign = 1.0f;
+		if (fabs(fY) > SG_PIDIV2)
+		{
+			fY = ((fY < 0.0f) ? -SG_PI : SG_PI) - fY;
+			fSign = -1.0f;
+		}
+
+		FLOAT fY2 = fY * fY;
+		FLOAT fSin = SG_SIN[0], fCos = SG_COS[0];
+
+		for (UINT i = 1; i < 6; ++i)
+		{
+			fSin = fSin * fY2 + SG_SIN[i];
+			fCos = fCos * fY2 + SG_COS[i];
+		}
+
+		*a_pSin = fSin * fY;
+		*a_pCos = fCos * fSign;
+	}
+
+	/**
+	*	\brief	Calculates the sine and cosine of an array of angles
+	*	\param	FLOAT* a_pSin - receives the sines
+	*	\param	FLOAT* a_pCos - receives the cosines
+	*	\param	const FLOAT* a_pAngles - angles in radians
+	*	\param	UINT a_nCount - number of angles
+	*	\note	Results are identical to calling ScalarSinCos() on each angle
+	*/
+
+	void SinCosArray(FLOAT* a_pSin, FLOAT* a_pCos, const FLOAT* a_pAngles, UINT a_nCount)
+	{
+		UINT i = 0;
+
+#if defined(SGLIB_SIMD_SSE2)
+		const __m128 vSignMask = _mm_set1_ps(-0.0f);
+		const __m128 vOne = _mm_set1_ps(1.0f);
+
+		for (; i + 4 <= a_nCount; i += 4)
+		{
+			__m128 vAngle = _mm_loadu_ps(&a_pAngles[i]);
+
+			// reduce to [-pi, pi]
+			__m128 vQuotient = _mm_mul_ps(vAngle, _mm_set1_ps(SG_1DIV2PI));
+			vQuotient = _mm_sub_ps(_mm_add_ps(vQuotient, _mm_set1_ps(SG_ROUNDMAGIC)), _mm_set1_ps(SG_ROUNDMAGIC));
+			__m128 vY = _mm_sub_ps(vAngle, _mm_mul_ps(vQuotient, _mm_set1_ps(SG_2PI_HI)));
+			vY = _mm_sub_ps(vY, _mm_mul_ps(vQuotient, _mm_set1_ps(SG_2PI_LO)));
+
+			// reflect into [-pi/2, pi/2]
+			__m128 vReflect = _mm_cmpgt_ps(_mm_andnot_ps(vSignMask, vY), _mm_set1_ps(SG_PIDIV2));
+			__m128 vPi = _mm_or_ps(_mm_and_ps(vY, vSignMask), _mm_set1_ps(SG_PI));
+			vY = _mm_or_ps(_mm_and_ps(vReflect, _mm_sub_ps(vPi, vY)), _mm_andnot_ps(vReflect, vY));
+			__m128 vSign = _mm_xor_ps(vOne, _mm_and_ps(vReflect, vSignMask));
+
+			__m128 vY2 = _mm_mul_ps(vY, vY);
+			__m128 vSin = _mm_set1_ps(SG_SIN[0]), vCos = _mm_set1_ps(SG_COS[0]);
+
+			for (UINT j = 1; j < 6; ++j)
+			{
+				vSin = _mm_add_ps(_mm_mul_ps(vSin, vY2), _mm_set1_ps(SG_SIN[j]));
+				vCos = _mm_add_ps(_mm_mul_ps(vCos, vY2), _mm_set1_ps(SG_COS[j]));
+			}
+
+			_mm_storeu_ps(&a_pSin[i], _mm_mul_ps(vSin, vY));
+			_mm_storeu_ps(&a_pCos[i], _mm_mul_ps(vCos, vSign));
+		}
+#endif
+
+		for (; i < a_nCount; ++i)
+			ScalarSinCos(&a_pSin[i], &a_pCos[i], a_pAngles[i]);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// half precision conversions
+	//--------------------------------------------------------------------------------------
+
+	namespace
+	{
+		const UINT SG_HALF_OVERFLOW	= (127 + 16) << 23;					// smallest float too large for a half
+		const UINT SG_HALF_NORMAL	= (127 - 14) << 23;					// smallest float that is a normal half
+		const UINT SG_HALF_SUBNORM	= ((127 - 15) + (23 - 10) + 1) << 23;	// adding it shifts a subnormal half's bits into place
+		const UINT SG_HALF_BIAS		= 0xfff - ((127 - 15) << 23);		// rebiases the exponent and rounds half down
+
+		inline UINT FloatBits(FLOAT a_fValue)
+		{
+			UINT nBits;
+			memcpy(&nBits, &a_fValue, sizeof(nBits));
+			return nBits;
+		}
+
+		inline FLOAT BitsFloat(UINT a_nBits)
+		{
+			FLOAT fValue;
+			memcpy(&fValue, &a_nBits, sizeof(fValue));
+			return fValue;
+		}
+	}
+
+	/**
+	*	\brief	Converts a float to a half float
+	*	\param	FLOAT a_fValue - float to convert
+	*	\return	unsigned short - nearest half float, ties to even. Values too large become infinity and NaNs
+	*			stay NaNs.
+	*	\note	Float32To16Array() performs exactly the same operations four at a time
+	*/
+
+	unsigned short ScalarFloat32To16(FLOAT a_fValue)
+	{
+		UINT nBits = FloatBits(a_fValue);
+		UINT nSign = (nBits >> 16) & 0x8000;
+		UINT nAbs = nBits & 0x7fffffff;
+		UINT nHalf;
+
+		if (nAbs >= SG_HALF_OVERFLOW)
+		{
+			// infinity, or a quiet NaN
+			nHalf = (nAbs > 0x7f800000) ? 0x7e00 : 0x7c00;
+		}
+		else if (nAbs < SG_HALF_NORMAL)
+		{
+			// the float add rounds the mantissa into the low bits
+			nHalf = FloatBits(BitsFloat(nAbs) + BitsFloat(SG_HALF_SUBNORM)) - SG_HALF_SUBNORM;
+		}
+		else
+		{
+			// ties go to the even mantissa
+			UINT nOdd = (nAbs >> 13) & 1;
+			nHalf = (nAbs + SG_HALF_BIAS + nOdd) >> 13;
+		}
+
+		return (unsigned short)(nHalf | nSign);
+	}
+
+	/**
+	*	\brief	Converts a half float to a float
+	*	\param	unsigned short a_nValue - half float to convert
+	*	\return	FLOAT - the same value, every half float is exact as a float
+	*/
+
+	FLOAT ScalarFloat16To32(unsigned short a_nValue)
+	{
+		UINT nBits = (UINT)(a_nValue & 0x7fff) << 13;
+		UINT nExponent = nBits & 0x0f800000;
+
+		nBits += (127 - 15) << 23;
+
+		if (nExponent == 0x0f800000)
+		{
+			// infinity or NaN
+			nBits += (128 - 16) << 23;
+		}
+		else if (nExponent == 0)
+		{
+			// subnormal, renormalised by the float subtract
+			nBits = FloatBits(BitsFloat(nBits + (1 << 23)) - BitsFloat(113 << 23));
+		}
+
+		return BitsFloat(nBits | ((UINT)(a_nValue & 0x8000) << 16));
+	}
+
+	/**
+	*	\brief	Converts an array of floats to half floats
+	*	\param	unsigned short* a_pOut - receives the half floats
+	*	\param	const FLOAT* a_pIn - floats to convert
+	*	\param	UINT a_nCount - number of floats
+	*	\return	unsigned short* - a_pOut
+	*	\note	Results are identical to calling ScalarFloat32To16() on each float
+	*/
+
+	unsigned short* Float32To16Array(unsigned short* a_pOut, const FLOAT* a_pIn, UINT a_nCount)
+	{
+		UINT i = 0;
+
+#if defined(SGLIB_SIMD_SSE2)
+		const __m128i vAbsMask = _mm_set1_epi32(0x7fffffff);
+		const __m128i vOverflow = _mm_set1_epi32(SG_HALF_OVERFLOW);
+		const __m128i vNormal = _mm_set1_epi32(SG_HALF_NORMAL);
+		const __m128i vSubnorm = _mm_set1_epi32(SG_HALF_SUBNORM);
+		const __m128i vBias = _mm_set1_epi32(SG_HALF_BIAS);
+
+		for (; i + 8 <= a_nCount; i += 8)
+		{
+			__m128i avHalf[2];
+
+			for (UINT j = 0; j < 2; ++j)
+			{
+				__m128i vBits = _mm_castps_si128(_mm_loadu_ps(&a_pIn[i + j * 4]));
+				__m128i vSign = _mm_and_si128(_mm_srli_epi32(vBits, 16), _mm_set1_epi32(0x8000));
+				__m128i vAbs = _mm_and_si128(vBits, vAbsMask);
+
+				// all three cases, then the one each lane needs
+				__m128i vNaN = _mm_and_si128(_mm_cmpgt_epi32(vAbs, _mm_set1_epi32(0x7f800000)), _mm_set1_epi32(0x0200));
+				__m128i vSpecial = _mm_or_si128(vNaN, _mm_set1_epi32(0x7c00));
+
+				__m128i vSmall = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(vAbs), _mm_castsi128_ps(vSubnorm))), vSubnorm);
+
+				__m128i vOdd = _mm_and_si128(_mm_srli_epi32(vAbs, 13), _mm_set1_epi32(1));
+				__m128i vRegular = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(vAbs, vBias), vOdd), 13);
+
+				__m128i vIsSmall = _mm_cmpgt_epi32(vNormal, vAbs);
+				__m128i vInRange = _mm_cmpgt_epi32(vOverflow, vAbs);
+				__m128i vHalf = _mm_or_si128(_mm_and_si128(vIsSmall, vSmall), _mm_andnot_si128(vIsSmall, vRegular));
+				vHalf = _mm_or_si128(_mm_and_si128(vInRange, vHalf), _mm_andnot_si128(vInRange, vSpecial));
+
+				// sign extended so the saturating pack below leaves it alone
+				vHalf = _mm_or_si128(vHalf, vSign);
+				avHalf[j] = _mm_srai_epi32(_mm_slli_epi32(vHalf, 16), 16);
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&a_pOut[i]), _mm_packs_epi32(avHalf[0], avHalf[1]));
+		}
+#endif
+
+		for (; i < a_nCount; ++i)
+			a_pOut[i] = ScalarFloat32To16(a_pIn[i]);
+
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Converts an array of half floats to floats
+	*	\param	FLOAT* a_pOut - receives the floats
+	*	\param	const unsigned short* a_pIn - half floats to convert
+	*	\param	UINT a_nCount - number of half floats
+	*	\return	FLOAT* - a_pOut
+	*/
+
+	FLOAT* Float16To32Array(FLOAT* a_pOut, const unsigned short* a_pIn, UINT a_nCount)
+	{
+		for (UINT i = 0; i < a_nCount; ++i)
+			a_pOut[i] = ScalarFloat16To32(a_pIn[i]);
+
+		return a_pOut;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// vector functions
+	//--------------------------------------------------------------------------------------
+
+	/**
+	*	\brief	Normalizes a vector
+	*	\param	Vector3* a_pOut - receives the unit vector (may equal a_pV)
+	*	\param	const Vector3* a_pV - vector to normalize
+	*	\return	Vector3* - a_pOut
+	*	\note	A zero length vector results in a zero vector, as with D3DXVec3Normalize
+	*/
+
+	Vector3* Vec3Normalize(Vector3* a_pOut, const Vector3* a_pV)
+	{
+		FLOAT fLength = Vec3Length(a_pV);
+
+		if (fLength > 0.0f)
+			*a_pOut = *a_pV / fLength;
+		else
+			*a_pOut = Vector3(0.0f, 0.0f, 0.0f);
+
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Transforms a point by a matrix and projects the result back into w = 1
+	*	\param	Vector3* a_pOut - receives the transformed point (may equal a_pV)
+	*	\param	const Vector3* a_pV - point to transform
+	*	\param	const Matrix* a_pM - transformation matrix
+	*	\return	Vector3* - a_pOut
+	*/
+
+	Vector3* Vec3TransformCoord(Vector3* a_pOut, const Vector3* a_pV, const Matrix* a_pM)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		__m128 aRows[4];
+		LoadRows(a_pM, aRows);
+		StoreVector3(a_pOut, TransformCoord(LoadVector3(a_pV), aRows));
+		return a_pOut;
+#else
+		return Reference::Vec3TransformCoord(a_pOut, a_pV, a_pM);
+#endif
+	}
+
+	/**
+	*	\brief	Transforms a direction by the upper 3x3 of a matrix (translation is ignored)
+	*	\param	Vector3* a_pOut - receives the transformed direction (may equal a_pV)
+	*	\param	const Vector3* a_pV - direction to transform
+	*	\param	const Matrix* a_pM - transformation matrix
+	*	\return	Vector3* - a_pOut
+	*/
+
+	Vector3* Vec3TransformNormal(Vector3* a_pOut, const Vector3* a_pV, const Matrix* a_pM)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		__m128 aRows[4];
+		LoadRows(a_pM, aRows);
+		StoreVector3(a_pOut, TransformNormal(LoadVector3(a_pV), aRows));
+		return a_pOut;
+#else
+		return Reference::Vec3TransformNormal(a_pOut, a_pV, a_pM);
+#endif
+	}
+
+	/**
+	*	\brief	Transforms a point (w = 1) by a matrix without projecting it
+	*	\param	Vector4* a_pOut - receives the transformed point
+	*	\param	const Vector3* a_pV - point to transform
+	*	\param	const Matrix* a_pM - transformation matrix
+	*	\return	Vector4* - a_pOut
+	*/
+
+	Vector4* Vec3Transform(Vector4* a_pOut, const Vector3* a_pV, const Matrix* a_pM)
+	{
+		Vector4 vecIn(*a_pV, 1.0f);
+		return Vec4Transform(a_pOut, &vecIn, a_pM);
+	}
+
+	/**
+	*	\brief	Transforms a four component vector by a matrix
+	*	\param	Vector4* a_pOut - receives the transformed vector (may equal a_pV)
+	*	\param	const Vector4* a_pV - vector to transform
+	*	\param	const Matrix* a_pM - transformation matrix
+	*	\return	Vector4* - a_pOut
+	*/
+
+	Vector4* Vec4Transform(Vector4* a_pOut, const Vector4* a_pV, const Matrix* a_pM)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		__m128 aRows[4];
+		LoadRows(a_pM, aRows);
+		_mm_storeu_ps(&a_pOut->x, TransformRow(_mm_set1_ps(a_pV->x), _mm_set1_ps(a_pV->y), _mm_set1_ps(a_pV->z), _mm_set1_ps(a_pV->w), aRows));
+		return a_pOut;
+#else
+		return Reference::Vec4Transform(a_pOut, a_pV, a_pM);
+#endif
+	}
+
+	/**
+	*	\brief	Weighted sum of four vectors
+	*	\param	Vector4* a_pOut - receives the sum
+	*	\param	const FLOAT* const* a_ppV - four vectors of four floats, need not be aligned
+	*	\param	const FLOAT* a_pWeights - four weights
+	*	\return	Vector4* - a_pOut
+	*	\note	The SIMD path does the multiplies and adds in the same order as the reference
+	*/
+
+	Vector4* Vec4Blend(Vector4* a_pOut, const FLOAT* const* a_ppV, const FLOAT* a_pWeights)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		__m128 xSum = _mm_mul_ps(_mm_loadu_ps(a_ppV[0]), _mm_set1_ps(a_pWeights[0]));
+		xSum = _mm_add_ps(xSum, _mm_mul_ps(_mm_loadu_ps(a_ppV[1]), _mm_set1_ps(a_pWeights[1])));
+		xSum = _mm_add_ps(xSum, _mm_mul_ps(_mm_loadu_ps(a_ppV[2]), _mm_set1_ps(a_pWeights[2])));
+		xSum = _mm_add_ps(xSum, _mm_mul_ps(_mm_loadu_ps(a_ppV[3]), _mm_set1_ps(a_pWeights[3])));
+
+		_mm_storeu_ps(&a_pOut->x, xSum);
+		return a_pOut;
+#else
+		return Reference::Vec4Blend(a_pOut, a_ppV, a_pWeights);
+#endif
+	}
+
+	/**
+	*	\brief	Vec3TransformCoord() over an array of points
+	*	\param	Vector3* a_pOut - receives the transformed points
+	*	\param	UINT a_nOutStride - bytes between output points
+	*	\param	const Vector3* a_pV - points to transform
+	*	\param	UINT a_nVStride - bytes between input points
+	*	\param	const Matrix* a_pM - transformation matrix
+	*	\param	UINT a_nCount - number of points
+	*	\return	Vector3* - a_pOut
+	*	\note	The AVX2 path transforms two points per iteration, one in each 128 bit lane
+	*/
+
+	Vector3* Vec3TransformCoordArray(Vector3* a_pOut, UINT a_nOutStride, const Vector3* a_pV, UINT a_nVStride, const Matrix* a_pM, UINT a_nCount)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		char* pOut = (char*)a_pOut;
+		const char* pIn = (const char*)a_pV;
+		UINT i = 0;
+
+		__m128 aRows[4];
+		LoadRows(a_pM, aRows);
+
+	#if defined(SGLIB_SIMD_AVX2)
+		__m256 aRows2[4] = { Broadcast2(aRows[0]), Broadcast2(aRows[1]), Broadcast2(aRows[2]), Broadcast2(aRows[3]) };
+
+		for (; i + 2 <= a_nCount; i += 2, pOut += 2 * a_nOutStride, pIn += 2 * a_nVStride)
+		{
+			__m256 v = Combine(LoadVector3((const Vector3*)pIn), LoadVector3((const Vector3*)(pIn + a_nVStride)));
+
+			__m256 vResult = _mm256_add_ps(	_mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)), aRows2[0]),
+											_mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), aRows2[1]));
+			vResult = _mm256_add_ps(vResult, _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), aRows2[2]));
+			vResult = _mm256_add_ps(vResult, aRows2[3]);
+			vResult = _mm256_div_ps(vResult, _mm256_permute_ps(vResult, _MM_SHUFFLE(3, 3, 3, 3)));
+
+			StoreVector3((Vector3*)pOut, _mm256_castps256_ps128(vResult));
+			StoreVector3((Vector3*)(pOut + a_nOutStride), _mm256_extractf128_ps(vResult, 1));
+		}
+	#endif
+
+		for (; i < a_nCount; ++i, pOut += a_nOutStride, pIn += a_nVStride)
+			StoreVector3((Vector3*)pOut, TransformCoord(LoadVector3((const Vector3*)pIn), aRows));
+
+		return a_pOut;
+#else
+		return Reference::Vec3TransformCoordArray(a_pOut, a_nOutStride, a_pV, a_nVStride, a_pM, a_nCount);
+#endif
+	}
+
+	/**
+	*	\brief	Vec3TransformNormal() over an array of directions
+	*	\param	Vector3* a_pOut - receives the transformed directions
+	*	\param	UINT a_nOutStride - bytes between output directions
+	*	\param	const Vector3* a_pV - directions to transform
+	*	\param	UINT a_nVStride - bytes between input directions
+	*	\param	const Matrix* a_pM - transformation matrix
+	*	\param	UINT a_nCount - number of directions
+	*	\return	Vector3* - a_pOut
+	*	\note	The AVX2 path transforms two directions per iteration, one in each 128 bit lane
+	*/
+
+	Vector3* Vec3TransformNormalArray(Vector3* a_pOut, UINT a_nOutStride, const Vector3* a_pV, UINT a_nVStride, const Matrix* a_pM, UINT a_nCount)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		char* pOut = (char*)a_pOut;
+		const char* pIn = (const char*)a_pV;
+		UINT i = 0;
+
+		__m128 aRows[4];
+		LoadRows(a_pM, aRows);
+
+	#if defined(SGLIB_SIMD_AVX2)
+		__m256 aRows2[3] = { Broadcast2(aRows[0]), Broadcast2(aRows[1]), Broadcast2(aRows[2]) };
+
+		for (; i + 2 <= a_nCount; i += 2, pOut += 2 * a_nOutStride, pIn += 2 * a_nVStride)
+		{
+			__m256 v = Combine(LoadVector3((const Vector3*)pIn), LoadVector3((const Vector3*)(pIn + a_nVStride)));
+
+			__m256 vResult = _mm256_add_ps(	_mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)), aRows2[0]),
+											_mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), aRows2[1]));
+			vResult = _mm256_add_ps(vResult, _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), aRows2[2]));
+
+			StoreVector3((Vector3*)pOut, _mm256_castps256_ps128(vResult));
+			StoreVector3((Vector3*)(pOut + a_nOutStride), _mm256_extractf128_ps(vResult, 1));
+		}
+	#endif
+
+		for (; i < a_nCount; ++i, pOut += a_nOutStride, pIn += a_nVStride)
+			StoreVector3((Vector3*)pOut, TransformNormal(LoadVector3((const Vector3*)pIn), aRows));
+
+		return a_pOut;
+#else
+		return Reference::Vec3TransformNormalArray(a_pOut, a_nOutStride, a_pV, a_nVStride, a_pM, a_nCount);
+#endif
+	}
+
+	//--------------------------------------------------------------------------------------
+	// matrix functions
+	//--------------------------------------------------------------------------------------
+
+	/**
+	*	\brief	Sets a matrix to identity
+	*	\param	Matrix* a_pOut - matrix to set
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixIdentity(Matrix* a_pOut)
+	{
+		*a_pOut = Matrix(	1.0f, 0.0f, 0.0f, 0.0f,
+							0.0f, 1.0f, 0.0f, 0.0f,
+							0.0f, 0.0f, 1.0f, 0.0f,
+							0.0f, 0.0f, 0.0f, 1.0f);
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Checks whether a matrix is exactly identity
+	*	\param	const Matrix* a_pM - matrix to check
+	*	\return	BOOL - TRUE if identity
+	*/
+
+	BOOL MatrixIsIdentity(const Matrix* a_pM)
+	{
+		Matrix matIdentity;
+		MatrixIdentity(&matIdentity);
+		return *a_pM == matIdentity;
+	}
+
+	/**
+	*	\brief	Multiplies two matrices (a_pM1 is applied first)
+	*	\param	Matrix* a_pOut - receives a_pM1 * a_pM2 (may equal either input)
+	*	\param	const Matrix* a_pM1 - left matrix
+	*	\param	const Matrix* a_pM2 - right matrix
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixMultiply(Matrix* a_pOut, const Matrix* a_pM1, const Matrix* a_pM2)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		MultiplySSE(a_pOut, a_pM1, a_pM2);
+		return a_pOut;
+#else
+		return Reference::MatrixMultiply(a_pOut, a_pM1, a_pM2);
+#endif
+	}
+
+	/**
+	*	\brief	MatrixMultiply() over arrays of matrices
+	*	\param	Matrix* a_pOut - receives a_pM1[i] * a_pM2[i]
+	*	\param	const Matrix* a_pM1 - left matrices
+	*	\param	const Matrix* a_pM2 - right matrices
+	*	\param	UINT a_nCount - number of matrices
+	*	\return	Matrix* - a_pOut
+	*	\note	The AVX2 path computes two rows of the result per instruction
+	*/
+
+	Matrix* MatrixMultiplyArray(Matrix* a_pOut, const Matrix* a_pM1, const Matrix* a_pM2, UINT a_nCount)
+	{
+#if defined(SGLIB_SIMD_AVX2)
+		for (UINT n = 0; n < a_nCount; ++n)
+		{
+			const Matrix* pM1 = &a_pM1[n];
+			const Matrix* pM2 = &a_pM2[n];
+
+			__m256 aRows2[4] = {	Broadcast2(_mm_loadu_ps(pM2->m[0])), Broadcast2(_mm_loadu_ps(pM2->m[1])),
+									Broadcast2(_mm_loadu_ps(pM2->m[2])), Broadcast2(_mm_loadu_ps(pM2->m[3])) };
+
+			__m256 aResult[2];
+			for (UINT i = 0; i < 2; ++i)
+			{
+				const FLOAT* pRowA = pM1->m[i * 2];
+				const FLOAT* pRowB = pM1->m[i * 2 + 1];
+
+				__m256 vResult = _mm256_add_ps(	_mm256_mul_ps(Combine(_mm_set1_ps(pRowA[0]), _mm_set1_ps(pRowB[0])), aRows2[0]),
+												_mm256_mul_ps(Combine(_mm_set1_ps(pRowA[1]), _mm_set1_ps(pRowB[1])), aRows2[1]));
+				vResult = _mm256_add_ps(vResult, _mm256_mul_ps(Combine(_mm_set1_ps(pRowA[2]), _mm_set1_ps(pRowB[2])), aRows2[2]));
+				aResult[i] = _mm256_add_ps(vResult, _mm256_mul_ps(Combine(_mm_set1_ps(pRowA[3]), _mm_set1_ps(pRowB[3])), aRows2[3]));
+			}
+
+			_mm256_storeu_ps(a_pOut[n].m[0], aResult[0]);
+			_mm256_storeu_ps(a_pOut[n].m[2], aResult[1]);
+		}
+		return a_pOut;
+#elif defined(SGLIB_SIMD_SSE2)
+		for (UINT n = 0; n < a_nCount; ++n)
+			MultiplySSE(&a_pOut[n], &a_pM1[n], &a_pM2[n]);
+		return a_pOut;
+#else
+		return Reference::MatrixMultiplyArray(a_pOut, a_pM1, a_pM2, a_nCount);
+#endif
+	}
+
+	/**
+	*	\brief	Transposes a matrix
+	*	\param	Matrix* a_pOut - receives the transpose (may equal a_pM)
+	*	\param	const Matrix* a_pM - matrix to transpose
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixTranspose(Matrix* a_pOut, const Matrix* a_pM)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		__m128 aRows[4];
+		LoadRows(a_pM, aRows);
+		_MM_TRANSPOSE4_PS(aRows[0], aRows[1], aRows[2], aRows[3]);
+
+		_mm_storeu_ps(a_pOut->m[0], aRows[0]);
+		_mm_storeu_ps(a_pOut->m[1], aRows[1]);
+		_mm_storeu_ps(a_pOut->m[2], aRows[2]);
+		_mm_storeu_ps(a_pOut->m[3], aRows[3]);
+		return a_pOut;
+#else
+		return Reference::MatrixTranspose(a_pOut, a_pM);
+#endif
+	}
+
+	/**
+	*	\brief	Calculates the determinant of a matrix
+	*	\param	const Matrix* a_pM - matrix
+	*	\return	FLOAT - determinant
+	*/
+
+	FLOAT MatrixDeterminant(const Matrix* a_pM)
+	{
+		const FLOAT (*m)[4] = a_pM->m;
+
+		// 2x2 sub determinants of the bottom two rows
+		FLOAT f2323 = m[2][2] * m[3][3] - m[2][3] * m[3][2];
+		FLOAT f1323 = m[2][1] * m[3][3] - m[2][3] * m[3][1];
+		FLOAT f1223 = m[2][1] * m[3][2] - m[2][2] * m[3][1];
+		FLOAT f0323 = m[2][0] * m[3][3] - m[2][3] * m[3][0];
+		FLOAT f0223 = m[2][0] * m[3][2] - m[2][2] * m[3][0];
+		FLOAT f0123 = m[2][0] * m[3][1] - m[2][1] * m[3][0];
+
+		return	m[0][0] * (m[1][1] * f2323 - m[1][2] * f1323 + m[1][3] * f1223) -
+				m[0][1] * (m[1][0] * f2323 - m[1][2] * f0323 + m[1][3] * f0223) +
+				m[0][2] * (m[1][0] * f1323 - m[1][1] * f0323 + m[1][3] * f0123) -
+				m[0][3] * (m[1][0] * f1223 - m[1][1] * f0223 + m[1][2] * f0123);
+	}
+
+	/**
+	*	\brief	Inverts a matrix using cofactors
+	*	\param	Matrix* a_pOut - receives the inverse (may equal a_pM)
+	*	\param	FLOAT* a_pDeterminant - receives the determinant (may be NULL)
+	*	\param	const Matrix* a_pM - matrix to invert
+	*	\return	Matrix* - a_pOut or NULL if the matrix is singular (a_pOut is untouched)
+	*/
+
+	Matrix* MatrixInverse(Matrix* a_pOut, FLOAT* a_pDeterminant, const Matrix* a_pM)
+	{
+		const FLOAT (*m)[4] = a_pM->m;
+
+		FLOAT fA2323 = m[2][2] * m[3][3] - m[2][3] * m[3][2];
+		FLOAT fA1323 = m[2][1] * m[3][3] - m[2][3] * m[3][1];
+		FLOAT fA1223 = m[2][1] * m[3][2] - m[2][2] * m[3][1];
+		FLOAT fA0323 = m[2][0] * m[3][3] - m[2][3] * m[3][0];
+		FLOAT fA0223 = m[2][0] * m[3][2] - m[2][2] * m[3][0];
+		FLOAT fA0123 = m[2][0] * m[3][1] - m[2][1] * m[3][0];
+		FLOAT fA2313 = m[1][2] * m[3][3] - m[1][3] * m[3][2];
+		FLOAT fA1313 = m[1][1] * m[3][3] - m[1][3] * m[3][1];
+		FLOAT fA1213 = m[1][1] * m[3][2] - m[1][2] * m[3][1];
+		FLOAT fA2312 = m[1][2] * m[2][3] - m[1][3] * m[2][2];
+		FLOAT fA1312 = m[1][1] * m[2][3] - m[1][3] * m[2][1];
+		FLOAT fA1212 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		FLOAT fA0313 = m[1][0] * m[3][3] - m[1][3] * m[3][0];
+		FLOAT fA0213 = m[1][0] * m[3][2] - m[1][2] * m[3][0];
+		FLOAT fA0312 = m[1][0] * m[2][3] - m[1][3] * m[2][0];
+		FLOAT fA0212 = m[1][0] * m[2][2] - m[1][2] * m[2][0];
+		FLOAT fA0113 = m[1][0] * m[3][1] - m[1][1] * m[3][0];
+		FLOAT fA0112 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+
+		FLOAT fDet =	m[0][0] * (m[1][1] * fA2323 - m[1][2] * fA1323 + m[1][3] * fA1223) -
+						m[0][1] * (m[1][0] * fA2323 - m[1][2] * fA0323 + m[1][3] * fA0223) +
+						m[0][2] * (m[1][0] * fA1323 - m[1][1] * fA0323 + m[1][3] * fA0123) -
+						m[0][3] * (m[1][0] * fA1223 - m[1][1] * fA0223 + m[1][2] * fA0123);
+
+		if (a_pDeterminant)
+			*a_pDeterminant = fDet;
+
+		if (fDet == 0.0f)
+			return NULL;
+
+		FLOAT fInvDet = 1.0f / fDet;
+		Matrix matTemp;
+
+		matTemp._11 = fInvDet *  (m[1][1] * fA2323 - m[1][2] * fA1323 + m[1][3] * fA1223);
+		matTemp._12 = fInvDet * -(m[0][1] * fA2323 - m[0][2] * fA1323 + m[0][3] * fA1223);
+		matTemp._13 = fInvDet *  (m[0][1] * fA2313 - m[0][2] * fA1313 + m[0][3] * fA1213);
+		matTemp._14 = fInvDet * -(m[0][1] * fA2312 - m[0][2] * fA1312 + m[0][3] * fA1212);
+		matTemp._21 = fInvDet * -(m[1][0] * fA2323 - m[1][2] * fA0323 + m[1][3] * fA0223);
+		matTemp._22 = fInvDet *  (m[0][0] * fA2323 - m[0][2] * fA0323 + m[0][3] * fA0223);
+		matTemp._23 = fInvDet * -(m[0][0] * fA2313 - m[0][2] * fA0313 + m[0][3] * fA0213);
+		matTemp._24 = fInvDet *  (m[0][0] * fA2312 - m[0][2] * fA0312 + m[0][3] * fA0212);
+		matTemp._31 = fInvDet *  (m[1][0] * fA1323 - m[1][1] * fA0323 + m[1][3] * fA0123);
+		matTemp._32 = fInvDet * -(m[0][0] * fA1323 - m[0][1] * fA0323 + m[0][3] * fA0123);
+		matTemp._33 = fInvDet *  (m[0][0] * fA1313 - m[0][1] * fA0313 + m[0][3] * fA0113);
+		matTemp._34 = fInvDet * -(m[0][0] * fA1312 - m[0][1] * fA0312 + m[0][3] * fA0112);
+		matTemp._41 = fInvDet * -(m[1][0] * fA1223 - m[1][1] * fA0223 + m[1][2] * fA0123);
+		matTemp._42 = fInvDet *  (m[0][0] * fA1223 - m[0][1] * fA0223 + m[0][2] * fA0123);
+		matTemp._43 = fInvDet * -(m[0][0] * fA1213 - m[0][1] * fA0213 + m[0][2] * fA0113);
+		matTemp._44 = fInvDet *  (m[0][0] * fA1212 - m[0][1] * fA0212 + m[0][2] * fA0112);
+
+		*a_pOut = matTemp;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Splits a matrix built as scale * rotation * translation back into its parts
+	*	\param	Vector3* a_pOutScale - receives the scale
+	*	\param	Quaternion* a_pOutRotation - receives the rotation
+	*	\param	Vector3* a_pOutTranslation - receives the translation
+	*	\param	const Matrix* a_pM - matrix to decompose
+	*	\return	BOOL - FALSE if a scale is zero (the rotation is then identity)
+	*	\note	A mirrored matrix is returned as a negative x scale
+	*/
+
+	BOOL MatrixDecompose(Vector3* a_pOutScale, Quaternion* a_pOutRotation, Vector3* a_pOutTranslation, const Matrix* a_pM)
+	{
+		Vector3 vecRows[3] = {	Vector3(a_pM->_11, a_pM->_12, a_pM->_13),
+								Vector3(a_pM->_21, a_pM->_22, a_pM->_23),
+								Vector3(a_pM->_31, a_pM->_32, a_pM->_33) };
+
+		*a_pOutTranslation = Vector3(a_pM->_41, a_pM->_42, a_pM->_43);
+		*a_pOutScale = Vector3(Vec3Length(&vecRows[0]), Vec3Length(&vecRows[1]), Vec3Length(&vecRows[2]));
+
+		if (a_pOutScale->x == 0.0f || a_pOutScale->y == 0.0f || a_pOutScale->z == 0.0f)
+		{
+			QuaternionIdentity(a_pOutRotation);
+			return FALSE;
+		}
+
+		// a negative determinant means the basis is mirrored
+		Vector3 vecCross;
+		Vec3Cross(&vecCross, &vecRows[0], &vecRows[1]);
+		if (Vec3Dot(&vecCross, &vecRows[2]) < 0.0f)
+			a_pOutScale->x = -a_pOutScale->x;
+
+		Matrix matRotation;
+		MatrixIdentity(&matRotation);
+		for (UINT i = 0; i < 3; ++i)
+		{
+			FLOAT fScale = (i == 0) ? a_pOutScale->x : (i == 1) ? a_pOutScale->y : a_pOutScale->z;
+			matRotation.m[i][0] = vecRows[i].x / fScale;
+			matRotation.m[i][1] = vecRows[i].y / fScale;
+			matRotation.m[i][2] = vecRows[i].z / fScale;
+		}
+
+		QuaternionRotationMatrix(a_pOutRotation, &matRotation);
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Builds a translation matrix
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixTranslation(Matrix* a_pOut, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ)
+	{
+		MatrixIdentity(a_pOut);
+		a_pOut->_41 = a_fX;
+		a_pOut->_42 = a_fY;
+		a_pOut->_43 = a_fZ;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a scaling matrix
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixScaling(Matrix* a_pOut, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ)
+	{
+		MatrixIdentity(a_pOut);
+		a_pOut->_11 = a_fX;
+		a_pOut->_22 = a_fY;
+		a_pOut->_33 = a_fZ;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a matrix rotating around the x axis (clockwise looking towards the origin)
+	*	\param	FLOAT a_fAngle - angle in radians
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixRotationX(Matrix* a_pOut, FLOAT a_fAngle)
+	{
+		FLOAT fSin = sinf(a_fAngle), fCos = cosf(a_fAngle);
+
+		MatrixIdentity(a_pOut);
+		a_pOut->_22 = fCos;
+		a_pOut->_23 = fSin;
+		a_pOut->_32 = -fSin;
+		a_pOut->_33 = fCos;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a matrix rotating around the y axis
+	*	\param	FLOAT a_fAngle - angle in radians
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixRotationY(Matrix* a_pOut, FLOAT a_fAngle)
+	{
+		FLOAT fSin = sinf(a_fAngle), fCos = cosf(a_fAngle);
+
+		MatrixIdentity(a_pOut);
+		a_pOut->_11 = fCos;
+		a_pOut->_13 = -fSin;
+		a_pOut->_31 = fSin;
+		a_pOut->_33 = fCos;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a matrix rotating around the z axis
+	*	\param	FLOAT a_fAngle - angle in radians
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixRotationZ(Matrix* a_pOut, FLOAT a_fAngle)
+	{
+		FLOAT fSin = sinf(a_fAngle), fCos = cosf(a_fAngle);
+
+		MatrixIdentity(a_pOut);
+		a_pOut->_11 = fCos;
+		a_pOut->_12 = fSin;
+		a_pOut->_21 = -fSin;
+		a_pOut->_22 = fCos;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a matrix rotating around an arbitrary axis
+	*	\param	const Vector3* a_pAxis - axis of rotation (does not need to be normalized)
+	*	\param	FLOAT a_fAngle - angle in radians
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixRotationAxis(Matrix* a_pOut, const Vector3* a_pAxis, FLOAT a_fAngle)
+	{
+		Vector3 vecAxis;
+		Vec3Normalize(&vecAxis, a_pAxis);
+
+		FLOAT fSin = sinf(a_fAngle), fCos = cosf(a_fAngle), fOneMinusCos = 1.0f - fCos;
+		FLOAT fX = vecAxis.x, fY = vecAxis.y, fZ = vecAxis.z;
+
+		*a_pOut = Matrix(	fOneMinusCos * fX * fX + fCos,		fOneMinusCos * fX * fY + fSin * fZ,	fOneMinusCos * fX * fZ - fSin * fY,	0.0f,
+							fOneMinusCos * fX * fY - fSin * fZ,	fOneMinusCos * fY * fY + fCos,		fOneMinusCos * fY * fZ + fSin * fX,	0.0f,
+							fOneMinusCos * fX * fZ + fSin * fY,	fOneMinusCos * fY * fZ - fSin * fX,	fOneMinusCos * fZ * fZ + fCos,		0.0f,
+							0.0f,								0.0f,								0.0f,								1.0f);
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a rotation matrix from a quaternion
+	*	\param	const Quaternion* a_pQ - unit quaternion
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixRotationQuaternion(Matrix* a_pOut, const Quaternion* a_pQ)
+	{
+		FLOAT fX = a_pQ->x, fY = a_pQ->y, fZ = a_pQ->z, fW = a_pQ->w;
+
+		*a_pOut = Matrix(	1.0f - 2.0f * (fY * fY + fZ * fZ),	2.0f * (fX * fY + fZ * fW),			2.0f * (fX * fZ - fY * fW),			0.0f,
+							2.0f * (fX * fY - fZ * fW),			1.0f - 2.0f * (fX * fX + fZ * fZ),	2.0f * (fY * fZ + fX * fW),			0.0f,
+							2.0f * (fX * fZ + fY * fW),			2.0f * (fY * fZ - fX * fW),			1.0f - 2.0f * (fX * fX + fY * fY),	0.0f,
+							0.0f,								0.0f,								0.0f,								1.0f);
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a rotation matrix applying roll (z), then pitch (x), then yaw (y)
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixRotationYawPitchRoll(Matrix* a_pOut, FLOAT a_fYaw, FLOAT a_fPitch, FLOAT a_fRoll)
+	{
+		Matrix matRoll, matPitch, matYaw;
+
+		MatrixRotationZ(&matRoll, a_fRoll);
+		MatrixRotationX(&matPitch, a_fPitch);
+		MatrixRotationY(&matYaw, a_fYaw);
+
+		MatrixMultiply(a_pOut, &matRoll, &matPitch);
+		return MatrixMultiply(a_pOut, a_pOut, &matYaw);
+	}
+
+	/**
+	*	\brief	Builds a left handed view matrix
+	*	\param	const Vector3* a_pEye - camera position
+	*	\param	const Vector3* a_pAt - point the camera looks at
+	*	\param	const Vector3* a_pUp - up direction
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixLookAtLH(Matrix* a_pOut, const Vector3* a_pEye, const Vector3* a_pAt, const Vector3* a_pUp)
+	{
+		Vector3 vecX, vecY, vecZ;
+
+		vecZ = *a_pAt - *a_pEye;
+		Vec3Normalize(&vecZ, &vecZ);
+		Vec3Cross(&vecX, a_pUp, &vecZ);
+		Vec3Normalize(&vecX, &vecX);
+		Vec3Cross(&vecY, &vecZ, &vecX);
+
+		*a_pOut = Matrix(	vecX.x,						vecY.x,						vecZ.x,						0.0f,
+							vecX.y,						vecY.y,						vecZ.y,						0.0f,
+							vecX.z,						vecY.z,						vecZ.z,						0.0f,
+							-Vec3Dot(&vecX, a_pEye),	-Vec3Dot(&vecY, a_pEye),	-Vec3Dot(&vecZ, a_pEye),	1.0f);
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a left handed perspective projection matrix
+	*	\param	FLOAT a_fFovY - vertical field of view in radians
+	*	\param	FLOAT a_fAspect - width / height
+	*	\param	FLOAT a_fNear - near clipping plane
+	*	\param	FLOAT a_fFar - far clipping plane
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixPerspectiveFovLH(Matrix* a_pOut, FLOAT a_fFovY, FLOAT a_fAspect, FLOAT a_fNear, FLOAT a_fFar)
+	{
+		FLOAT fYScale = 1.0f / tanf(a_fFovY * 0.5f);
+		FLOAT fXScale = fYScale / a_fAspect;
+		FLOAT fDepth = a_fFar / (a_fFar - a_fNear);
+
+		*a_pOut = Matrix(	fXScale,	0.0f,		0.0f,				0.0f,
+							0.0f,		fYScale,	0.0f,				0.0f,
+							0.0f,		0.0f,		fDepth,				1.0f,
+							0.0f,		0.0f,		-a_fNear * fDepth,	0.0f);
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a left handed orthographic projection matrix
+	*	\param	FLOAT a_fWidth - width of the view volume
+	*	\param	FLOAT a_fHeight - height of the view volume
+	*	\param	FLOAT a_fNear - near clipping plane
+	*	\param	FLOAT a_fFar - far clipping plane
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixOrthoLH(Matrix* a_pOut, FLOAT a_fWidth, FLOAT a_fHeight, FLOAT a_fNear, FLOAT a_fFar)
+	{
+		FLOAT fDepth = 1.0f / (a_fFar - a_fNear);
+
+		*a_pOut = Matrix(	2.0f / a_fWidth,	0.0f,				0.0f,				0.0f,
+							0.0f,				2.0f / a_fHeight,	0.0f,				0.0f,
+							0.0f,				0.0f,				fDepth,				0.0f,
+							0.0f,				0.0f,				-a_fNear * fDepth,	1.0f);
+		return a_pOut;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// affine matrix functions
+	//--------------------------------------------------------------------------------------
+
+	/**
+	*	\brief	Sets an affine matrix to identity
+	*	\return	AffineMatrix* - a_pOut
+	*/
+
+	AffineMatrix* AffineIdentity(AffineMatrix* a_pOut)
+	{
+		memset(a_pOut->m, 0, sizeof(a_pOut->m));
+		a_pOut->m[0][0] = a_pOut->m[1][1] = a_pOut->m[2][2] = 1.0f;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Converts a matrix to affine storage
+	*	\param	AffineMatrix* a_pOut - receives the first three columns of a_pM
+	*	\param	const Matrix* a_pM - matrix to convert, the fourth column is assumed to be (0, 0, 0, 1)
+	*	\return	AffineMatrix* - a_pOut
+	*/
+
+	AffineMatrix* AffineFromMatrix(AffineMatrix* a_pOut, const Matrix* a_pM)
+	{
+		for (UINT i = 0; i < 3; ++i)
+			for (UINT j = 0; j < 4; ++j)
+				a_pOut->m[i][j] = a_pM->m[j][i];
+
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Expands an affine matrix to a full matrix
+	*	\param	Matrix* a_pOut - receives a_pM with the fourth column set to (0, 0, 0, 1)
+	*	\param	const AffineMatrix* a_pM - matrix to expand
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixFromAffine(Matrix* a_pOut, const AffineMatrix* a_pM)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		__m128 aRows[4] = { _mm_loadu_ps(a_pM->m[0]), _mm_loadu_ps(a_pM->m[1]), _mm_loadu_ps(a_pM->m[2]), _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f) };
+		_MM_TRANSPOSE4_PS(aRows[0], aRows[1], aRows[2], aRows[3]);
+
+		_mm_storeu_ps(a_pOut->m[0], aRows[0]);
+		_mm_storeu_ps(a_pOut->m[1], aRows[1]);
+		_mm_storeu_ps(a_pOut->m[2], aRows[2]);
+		_mm_storeu_ps(a_pOut->m[3], aRows[3]);
+#else
+		for (UINT i = 0; i < 4; ++i)
+		{
+			a_pOut->m[i][0] = a_pM->m[0][i];
+			a_pOut->m[i][1] = a_pM->m[1][i];
+			a_pOut->m[i][2] = a_pM->m[2][i];
+			a_pOut->m[i][3] = (i == 3) ? 1.0f : 0.0f;
+		}
+#endif
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Multiplies two affine matrices (a_pM1 is applied first)
+	*	\param	AffineMatrix* a_pOut - receives a_pM1 * a_pM2 (may equal either input)
+	*	\param	const AffineMatrix* a_pM1 - left matrix
+	*	\param	const AffineMatrix* a_pM2 - right matrix
+	*	\return	AffineMatrix* - a_pOut
+	*/
+
+	AffineMatrix* AffineMultiply(AffineMatrix* a_pOut, const AffineMatrix* a_pM1, const AffineMatrix* a_pM2)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		const __m128 vMaskW = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+		__m128 aRows[3] = { _mm_loadu_ps(a_pM1->m[0]), _mm_loadu_ps(a_pM1->m[1]), _mm_loadu_ps(a_pM1->m[2]) };
+
+		// read all of a_pM2 before writing so a_pOut may alias either input
+		__m128 aResult[3];
+		for (UINT i = 0; i < 3; ++i)
+		{
+			const FLOAT* pRow = a_pM2->m[i];
+
+			__m128 vResult = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pRow[0]), aRows[0]), _mm_mul_ps(_mm_set1_ps(pRow[1]), aRows[1]));
+			vResult = _mm_add_ps(vResult, _mm_mul_ps(_mm_set1_ps(pRow[2]), aRows[2]));
+			aResult[i] = _mm_add_ps(vResult, _mm_and_ps(_mm_loadu_ps(pRow), vMaskW));
+		}
+
+		_mm_storeu_ps(a_pOut->m[0], aResult[0]);
+		_mm_storeu_ps(a_pOut->m[1], aResult[1]);
+		_mm_storeu_ps(a_pOut->m[2], aResult[2]);
+		return a_pOut;
+#else
+		return Reference::AffineMultiply(a_pOut, a_pM1, a_pM2);
+#endif
+	}
+
+	/**
+	*	\brief	Multiplies an affine matrix by a full matrix, used to build world * view * projection
+	*	\param	Matrix* a_pOut - receives a_pM1 * a_pM2 (may equal a_pM2)
+	*	\param	const AffineMatrix* a_pM1 - left matrix
+	*	\param	const Matrix* a_pM2 - right matrix
+	*	\return	Matrix* - a_pOut
+	*/
+
+	Matrix* MatrixMultiplyAffine(Matrix* a_pOut, const AffineMatrix* a_pM1, const Matrix* a_pM2)
+	{
+		Matrix matTemp;
+		MatrixFromAffine(&matTemp, a_pM1);
+		return MatrixMultiply(a_pOut, &matTemp, a_pM2);
+	}
+
+	/**
+	*	\brief	Inverts an affine matrix
+	*	\param	AffineMatrix* a_pOut - receives the inverse (may equal a_pM)
+	*	\param	FLOAT* a_pDeterminant - receives the determinant (may be NULL)
+	*	\param	const AffineMatrix* a_pM - matrix to invert
+	*	\return	AffineMatrix* - a_pOut or NULL if the matrix is singular (a_pOut is untouched)
+	*	\note	Only the 3x3 part is inverted, the translation of the inverse is the negated translation
+	*			transformed by it
+	*/
+
+	AffineMatrix* AffineInverse(AffineMatrix* a_pOut, FLOAT* a_pDeterminant, const AffineMatrix* a_pM)
+	{
+		const FLOAT (*m)[4] = a_pM->m;
+
+		FLOAT fC00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		FLOAT fC01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		FLOAT fC02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+
+		FLOAT fDet = m[0][0] * fC00 + m[0][1] * fC01 + m[0][2] * fC02;
+
+		if (a_pDeterminant)
+			*a_pDeterminant = fDet;
+
+		if (fDet == 0.0f)
+			return NULL;
+
+		FLOAT fInvDet = 1.0f / fDet;
+		AffineMatrix matTemp;
+
+		matTemp.m[0][0] = fC00 * fInvDet;
+		matTemp.m[1][0] = fC01 * fInvDet;
+		matTemp.m[2][0] = fC02 * fInvDet;
+		matTemp.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * fInvDet;
+		matTemp.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * fInvDet;
+		matTemp.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * fInvDet;
+		matTemp.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * fInvDet;
+		matTemp.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * fInvDet;
+		matTemp.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * fInvDet;
+
+		for (UINT i = 0; i < 3; ++i)
+			matTemp.m[i][3] = -(matTemp.m[i][0] * m[0][3] + matTemp.m[i][1] * m[1][3] + matTemp.m[i][2] * m[2][3]);
+
+		*a_pOut = matTemp;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Calculates the matrix normals are transformed by, the inverse transpose of the 3x3 part
+	*	\param	AffineMatrix* a_pOut - receives the normal matrix with a zero translation (may equal a_pM)
+	*	\param	const AffineMatrix* a_pM - matrix positions are transformed by
+	*	\return	AffineMatrix* - a_pOut
+	*	\note	Rotations with a uniform scale s skip the inverse as the inverse transpose is then just the
+	*			3x3 part divided by s squared. A singular matrix returns its own 3x3 part.
+	*/
+
+	AffineMatrix* AffineNormalMatrix(AffineMatrix* a_pOut, const AffineMatrix* a_pM)
+	{
+		const FLOAT (*m)[4] = a_pM->m;
+
+		// rows of the 3x3 part in Matrix terms are the columns of the transposed storage
+		Vector3 vecRows[3] = {	Vector3(m[0][0], m[1][0], m[2][0]),
+								Vector3(m[0][1], m[1][1], m[2][1]),
+								Vector3(m[0][2], m[1][2], m[2][2]) };
+
+		FLOAT fLengthSq = Vec3LengthSq(&vecRows[0]);
+		FLOAT fTolerance = fLengthSq * 1e-4f;
+
+		if (fLengthSq > 0.0f &&
+			fabsf(Vec3LengthSq(&vecRows[1]) - fLengthSq) <= fTolerance &&
+			fabsf(Vec3LengthSq(&vecRows[2]) - fLengthSq) <= fTolerance &&
+			fabsf(Vec3Dot(&vecRows[0], &vecRows[1])) <= fTolerance &&
+			fabsf(Vec3Dot(&vecRows[0], &vecRows[2])) <= fTolerance &&
+			fabsf(Vec3Dot(&vecRows[1], &vecRows[2])) <= fTolerance)
+		{
+			FLOAT fInvLengthSq = 1.0f / fLengthSq;
+
+			for (UINT i = 0; i < 3; ++i)
+			{
+				a_pOut->m[i][0] = m[i][0] * fInvLengthSq;
+				a_pOut->m[i][1] = m[i][1] * fInvLengthSq;
+				a_pOut->m[i][2] = m[i][2] * fInvLengthSq;
+				a_pOut->m[i][3] = 0.0f;
+			}
+			return a_pOut;
+		}
+
+		AffineMatrix matInverse;
+
+		if (!AffineInverse(&matInverse, NULL, a_pM))
+		{
+			if (a_pOut != a_pM)
+				*a_pOut = *a_pM;
+
+			a_pOut->m[0][3] = a_pOut->m[1][3] = a_pOut->m[2][3] = 0.0f;
+			return a_pOut;
+		}
+
+		// the inverse is stored transposed already, transposing the 3x3 again gives the inverse transpose
+		for (UINT i = 0; i < 3; ++i)
+		{
+			for (UINT j = 0; j < 3; ++j)
+				a_pOut->m[i][j] = matInverse.m[j][i];
+
+			a_pOut->m[i][3] = 0.0f;
+		}
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds an affine translation matrix
+	*	\return	AffineMatrix* - a_pOut
+	*/
+
+	AffineMatrix* AffineTranslation(AffineMatrix* a_pOut, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ)
+	{
+		AffineIdentity(a_pOut);
+		a_pOut->m[0][3] = a_fX;
+		a_pOut->m[1][3] = a_fY;
+		a_pOut->m[2][3] = a_fZ;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds an affine scaling matrix
+	*	\return	AffineMatrix* - a_pOut
+	*/
+
+	AffineMatrix* AffineScaling(AffineMatrix* a_pOut, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ)
+	{
+		AffineIdentity(a_pOut);
+		a_pOut->m[0][0] = a_fX;
+		a_pOut->m[1][1] = a_fY;
+		a_pOut->m[2][2] = a_fZ;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds an affine matrix rotating around the x axis, see MatrixRotationX()
+	*	\param	FLOAT a_fAngle - angle in radians
+	*	\return	AffineMatrix* - a_pOut
+	*/
+
+	AffineMatrix* AffineRotationX(AffineMatrix* a_pOut, FLOAT a_fAngle)
+	{
+		FLOAT fSin = sinf(a_fAngle), fCos = cosf(a_fAngle);
+
+		AffineIdentity(a_pOut);
+		a_pOut->m[1][1] = fCos;
+		a_pOut->m[2][1] = fSin;
+		a_pOut->m[1][2] = -fSin;
+		a_pOut->m[2][2] = fCos;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds an affine matrix rotating around the y axis, see MatrixRotationY()
+	*	\param	FLOAT a_fAngle - angle in radians
+	*	\return	AffineMatrix* - a_pOut
+	*/
+
+	AffineMatrix* AffineRotationY(AffineMatrix* a_pOut, FLOAT a_fAngle)
+	{
+		FLOAT fSin = sinf(a_fAngle), fCos = cosf(a_fAngle);
+
+		AffineIdentity(a_pOut);
+		a_pOut->m[0][0] = fCos;
+		a_pOut->m[2][0] = -fSin;
+		a_pOut->m[0][2] = fSin;
+		a_pOut->m[2][2] = fCos;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds an affine matrix rotating around the z axis, see MatrixRotationZ()
+	*	\param	FLOAT a_fAngle - angle in radians
+	*	\return	AffineMatrix* - a_pOut
+	*/
+
+	AffineMatrix* AffineRotationZ(AffineMatrix* a_pOut, FLOAT a_fAngle)
+	{
+		FLOAT fSin = sinf(a_fAngle), fCos = cosf(a_fAngle);
+
+		AffineIdentity(a_pOut);
+		a_pOut->m[0][0] = fCos;
+		a_pOut->m[1][0] = fSin;
+		a_pOut->m[0][1] = -fSin;
+		a_pOut->m[1][1] = fCos;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds scale * rotation * translation directly into affine storage
+	*	\param	AffineMatrix* a_pOut - receives the combined matrix
+	*	\param	const Vector3* a_pScale - scale along each axis
+	*	\param	const Quaternion* a_pRotation - rotation (expected to be normalized)
+	*	\param	const Vector3* a_pTranslation - translation
+	*	\return	AffineMatrix* - a_pOut
+	*	\note	Inverse of MatrixDecompose() for matrices without shear
+	*/
+
+	AffineMatrix* AffineTransformation(AffineMatrix* a_pOut, const Vector3* a_pScale, const Quaternion* a_pRotation, const Vector3* a_pTranslation)
+	{
+		FLOAT fX = a_pRotation->x, fY = a_pRotation->y, fZ = a_pRotation->z, fW = a_pRotation->w;
+		FLOAT fSX = a_pScale->x, fSY = a_pScale->y, fSZ = a_pScale->z;
+
+		// column c of the rotation matrix with each row r scaled by the scale along r
+		a_pOut->m[0][0] = fSX * (1.0f - 2.0f * (fY * fY + fZ * fZ));
+		a_pOut->m[0][1] = fSY * (2.0f * (fX * fY - fZ * fW));
+		a_pOut->m[0][2] = fSZ * (2.0f * (fX * fZ + fY * fW));
+		a_pOut->m[0][3] = a_pTranslation->x;
+
+		a_pOut->m[1][0] = fSX * (2.0f * (fX * fY + fZ * fW));
+		a_pOut->m[1][1] = fSY * (1.0f - 2.0f * (fX * fX + fZ * fZ));
+		a_pOut->m[1][2] = fSZ * (2.0f * (fY * fZ - fX * fW));
+		a_pOut->m[1][3] = a_pTranslation->y;
+
+		a_pOut->m[2][0] = fSX * (2.0f * (fX * fZ - fY * fW));
+		a_pOut->m[2][1] = fSY * (2.0f * (fY * fZ + fX * fW));
+		a_pOut->m[2][2] = fSZ * (1.0f - 2.0f * (fX * fX + fY * fY));
+		a_pOut->m[2][3] = a_pTranslation->z;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Transforms a point by an affine matrix (no projection is needed as w stays one)
+	*	\param	Vector3* a_pOut - receives the transformed point (may equal a_pV)
+	*	\param	const Vector3* a_pV - point to transform
+	*	\param	const AffineMatrix* a_pM - transformation matrix
+	*	\return	Vector3* - a_pOut
+	*/
+
+	Vector3* Vec3TransformCoord(Vector3* a_pOut, const Vector3* a_pV, const AffineMatrix* a_pM)
+	{
+		const FLOAT fX = a_pV->x, fY = a_pV->y, fZ = a_pV->z;
+		const FLOAT (*m)[4] = a_pM->m;
+
+		a_pOut->x = m[0][0] * fX + m[0][1] * fY + m[0][2] * fZ + m[0][3];
+		a_pOut->y = m[1][0] * fX + m[1][1] * fY + m[1][2] * fZ + m[1][3];
+		a_pOut->z = m[2][0] * fX + m[2][1] * fY + m[2][2] * fZ + m[2][3];
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Transforms a direction by the 3x3 part of an affine matrix
+	*	\param	Vector3* a_pOut - receives the transformed direction (may equal a_pV)
+	*	\param	const Vector3* a_pV - direction to transform
+	*	\param	const AffineMatrix* a_pM - transformation matrix
+	*	\return	Vector3* - a_pOut
+	*/
+
+	Vector3* Vec3TransformNormal(Vector3* a_pOut, const Vector3* a_pV, const AffineMatrix* a_pM)
+	{
+		const FLOAT fX = a_pV->x, fY = a_pV->y, fZ = a_pV->z;
+		const FLOAT (*m)[4] = a_pM->m;
+
+		a_pOut->x = m[0][0] * fX + m[0][1] * fY + m[0][2] * fZ;
+		a_pOut->y = m[1][0] * fX + m[1][1] * fY + m[1][2] * fZ;
+		a_pOut->z = m[2][0] * fX + m[2][1] * fY + m[2][2] * fZ;
+		return a_pOut;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// quaternion functions
+	//--------------------------------------------------------------------------------------
+
+	/**
+	*	\brief	Normalizes a quaternion
+	*	\return	Quaternion* - a_pOut (identity if a_pQ has zero length)
+	*/
+
+	Quaternion* QuaternionNormalize(Quaternion* a_pOut, const Quaternion* a_pQ)
+	{
+		FLOAT fLength = sqrtf(QuaternionDot(a_pQ, a_pQ));
+
+		if (fLength > 0.0f)
+		{
+			FLOAT fInv = 1.0f / fLength;
+			*a_pOut = Quaternion(a_pQ->x * fInv, a_pQ->y * fInv, a_pQ->z * fInv, a_pQ->w * fInv);
+		}
+		else
+			QuaternionIdentity(a_pOut);
+
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Concatenates two rotations, the result rotates by a_pQ1 then by a_pQ2 (a_pQ2 * a_pQ1)
+	*	\return	Quaternion* - a_pOut (may equal either input)
+	*/
+
+	Quaternion* QuaternionMultiply(Quaternion* a_pOut, const Quaternion* a_pQ1, const Quaternion* a_pQ2)
+	{
+		const Quaternion& q1 = *a_pQ1;
+		const Quaternion& q2 = *a_pQ2;
+
+		Quaternion quatTemp(q2.w * q1.x + q2.x * q1.w + q2.y * q1.z - q2.z * q1.y,
+							q2.w * q1.y - q2.x * q1.z + q2.y * q1.w + q2.z * q1.x,
+							q2.w * q1.z + q2.x * q1.y - q2.y * q1.x + q2.z * q1.w,
+							q2.w * q1.w - q2.x * q1.x - q2.y * q1.y - q2.z * q1.z);
+
+		*a_pOut = quatTemp;
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a quaternion rotating around an arbitrary axis
+	*	\param	const Vector3* a_pAxis - axis of rotation (does not need to be normalized)
+	*	\param	FLOAT a_fAngle - angle in radians
+	*	\return	Quaternion* - a_pOut
+	*/
+
+	Quaternion* QuaternionRotationAxis(Quaternion* a_pOut, const Vector3* a_pAxis, FLOAT a_fAngle)
+	{
+		Vector3 vecAxis;
+		Vec3Normalize(&vecAxis, a_pAxis);
+
+		FLOAT fSin = sinf(a_fAngle * 0.5f);
+
+		*a_pOut = Quaternion(vecAxis.x * fSin, vecAxis.y * fSin, vecAxis.z * fSin, cosf(a_fAngle * 0.5f));
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Extracts the rotation of a matrix
+	*	\param	const Matrix* a_pM - matrix whose upper 3x3 is a pure rotation
+	*	\return	Quaternion* - a_pOut
+	*/
+
+	Quaternion* QuaternionRotationMatrix(Quaternion* a_pOut, const Matrix* a_pM)
+	{
+		const Matrix& m = *a_pM;
+		FLOAT fTrace = m._11 + m._22 + m._33;
+		FLOAT fS;
+
+		if (fTrace > 0.0f)
+		{
+			fS = sqrtf(fTrace + 1.0f) * 2.0f;
+			*a_pOut = Quaternion((m._23 - m._32) / fS, (m._31 - m._13) / fS, (m._12 - m._21) / fS, 0.25f * fS);
+		}
+		else if (m._11 > m._22 && m._11 > m._33)
+		{
+			fS = sqrtf(1.0f + m._11 - m._22 - m._33) * 2.0f;
+			*a_pOut = Quaternion(0.25f * fS, (m._12 + m._21) / fS, (m._13 + m._31) / fS, (m._23 - m._32) / fS);
+		}
+		else if (m._22 > m._33)
+		{
+			fS = sqrtf(1.0f + m._22 - m._11 - m._33) * 2.0f;
+			*a_pOut = Quaternion((m._12 + m._21) / fS, 0.25f * fS, (m._23 + m._32) / fS, (m._31 - m._13) / fS);
+		}
+		else
+		{
+			fS = sqrtf(1.0f + m._33 - m._11 - m._22) * 2.0f;
+			*a_pOut = Quaternion((m._13 + m._31) / fS, (m._23 + m._32) / fS, 0.25f * fS, (m._12 - m._21) / fS);
+		}
+
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Builds a quaternion applying roll (z), then pitch (x), then yaw (y)
+	*	\return	Quaternion* - a_pOut
+	*/
+
+	Quaternion* QuaternionRotationYawPitchRoll(Quaternion* a_pOut, FLOAT a_fYaw, FLOAT a_fPitch, FLOAT a_fRoll)
+	{
+		Quaternion quatRoll, quatPitch, quatYaw;
+		Vector3 vecX(1.0f, 0.0f, 0.0f), vecY(0.0f, 1.0f, 0.0f), vecZ(0.0f, 0.0f, 1.0f);
+
+		QuaternionRotationAxis(&quatRoll, &vecZ, a_fRoll);
+		QuaternionRotationAxis(&quatPitch, &vecX, a_fPitch);
+		QuaternionRotationAxis(&quatYaw, &vecY, a_fYaw);
+
+		QuaternionMultiply(a_pOut, &quatRoll, &quatPitch);
+		return QuaternionMultiply(a_pOut, a_pOut, &quatYaw);
+	}
+
+	/**
+	*	\brief	Spherical linear interpolation along the shortest arc
+	*	\param	FLOAT a_fT - interpolation factor (0 returns a_pQ1, 1 returns a_pQ2)
+	*	\return	Quaternion* - a_pOut
+	*	\note	Falls back to a normalized linear interpolation when the rotations are nearly equal
+	*/
+
+	Quaternion* QuaternionSlerp(Quaternion* a_pOut, const Quaternion* a_pQ1, const Quaternion* a_pQ2, FLOAT a_fT)
+	{
+		FLOAT fCos = QuaternionDot(a_pQ1, a_pQ2);
+		FLOAT fSign = 1.0f;
+
+		// take the shorter way around
+		if (fCos < 0.0f)
+		{
+			fCos = -fCos;
+			fSign = -1.0f;
+		}
+
+		FLOAT fScale1, fScale2;
+
+		if (fCos < 0.9999f)
+		{
+			FLOAT fAngle = acosf(fCos);
+			FLOAT fInvSin = 1.0f / sinf(fAngle);
+
+			fScale1 = sinf((1.0f - a_fT) * fAngle) * fInvSin;
+			fScale2 = sinf(a_fT * fAngle) * fInvSin * fSign;
+		}
+		else
+		{
+			fScale1 = 1.0f - a_fT;
+			fScale2 = a_fT * fSign;
+		}
+
+		Quaternion quatTemp(fScale1 * a_pQ1->x + fScale2 * a_pQ2->x,
+							fScale1 * a_pQ1->y + fScale2 * a_pQ2->y,
+							fScale1 * a_pQ1->z + fScale2 * a_pQ2->z,
+							fScale1 * a_pQ1->w + fScale2 * a_pQ2->w);
+
+		if (fCos >= 0.9999f)
+			QuaternionNormalize(&quatTemp, &quatTemp);
+
+		*a_pOut = quatTemp;
+		return a_pOut;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// plane and frustum functions
+	//--------------------------------------------------------------------------------------
+
+	/**
+	*	\brief	Scales a plane so its normal has unit length
+	*	\return	Plane* - a_pOut
+	*/
+
+	Plane* PlaneNormalize(Plane* a_pOut, const Plane* a_pP)
+	{
+		FLOAT fLength = sqrtf(a_pP->a * a_pP->a + a_pP->b * a_pP->b + a_pP->c * a_pP->c);
+
+		if (fLength > 0.0f)
+		{
+			FLOAT fInv = 1.0f / fLength;
+			*a_pOut = Plane(a_pP->a * fInv, a_pP->b * fInv, a_pP->c * fInv, a_pP->d * fInv);
+		}
+		else
+			*a_pOut = Plane(0.0f, 0.0f, 0.0f, 0.0f);
+
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Extracts the frustum planes from a combined world * view * projection matrix
+	*	\param	Frustum* a_pOut - receives normalized planes in the space the matrix transforms from
+	*	\param	const Matrix* a_pM - clip matrix
+	*	\return	Frustum* - a_pOut
+	*/
+
+	Frustum* FrustumFromMatrix(Frustum* a_pOut, const Matrix* a_pM)
+	{
+		const Matrix& m = *a_pM;
+		Plane* pPlanes = a_pOut->planes;
+
+		// each plane is the fourth column of the matrix plus or minus one of the others
+		pPlanes[Frustum::LEFT]			= Plane(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41);
+		pPlanes[Frustum::RIGHT]			= Plane(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41);
+		pPlanes[Frustum::BOTTOM]		= Plane(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42);
+		pPlanes[Frustum::TOP]			= Plane(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42);
+		pPlanes[Frustum::NEAR_PLANE]	= Plane(m._13, m._23, m._33, m._43);
+		pPlanes[Frustum::FAR_PLANE]		= Plane(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43);
+
+		for (UINT i = 0; i < Frustum::NUM_PLANES; ++i)
+			PlaneNormalize(&pPlanes[i], &pPlanes[i]);
+
+		return a_pOut;
+	}
+
+	/**
+	*	\brief	Tests an axis aligned box against a frustum
+	*	\param	const Vector3* a_pMin - box minimum
+	*	\param	const Vector3* a_pMax - box maximum
+	*	\return	BOOL - FALSE if the box is entirely outside one of the planes
+	*	\note	Conservative, boxes near a corner of the frustum may pass while being outside
+	*/
+
+	BOOL FrustumTestAABB(const Frustum* a_pF, const Vector3* a_pMin, const Vector3* a_pMax)
+	{
+		for (UINT i = 0; i < Frustum::NUM_PLANES; ++i)
+		{
+			const Plane& rPlane = a_pF->planes[i];
+
+			// corner of the box furthest along the plane normal
+			Vector3 vecPositive(rPlane.a >= 0.0f ? a_pMax->x : a_pMin->x,
+								rPlane.b >= 0.0f ? a_pMax->y : a_pMin->y,
+								rPlane.c >= 0.0f ? a_pMax->z : a_pMin->z);
+
+			if (PlaneDotCoord(&rPlane, &vecPositive) < 0.0f)
+				return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Tests a sphere against a frustum
+	*	\param	const Vector3* a_pCentre - sphere centre
+	*	\param	FLOAT a_fRadius - sphere radius
+	*	\return	BOOL - FALSE if the sphere is entirely outside one of the planes
+	*/
+
+	BOOL FrustumTestSphere(const Frustum* a_pF, const Vector3* a_pCentre, FLOAT a_fRadius)
+	{
+		for (UINT i = 0; i < Frustum::NUM_PLANES; ++i)
+			if (PlaneDotCoord(&a_pF->planes[i], a_pCentre) < -a_fRadius)
+				return FALSE;
+
+		return TRUE;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// aligned storage
+	//--------------------------------------------------------------------------------------
+
+	/**
+	*	\brief	Allocates memory aligned to a power of two boundary
+	*	\param	size_t a_nSize - bytes to allocate
+	*	\param	size_t a_nAlignment - alignment in bytes (power of two)
+	*	\return	void* - aligned memory or NULL, free with AlignedFree()
+	*/
+
+	void* AlignedMalloc(size_t a_nSize, size_t a_nAlignment)
+	{
+		// over allocate and store the original pointer just before the aligned block
+		char* pRaw = (char*)malloc(a_nSize + a_nAlignment + sizeof(void*));
+		if (!pRaw)
+			return NULL;
+
+		size_t nAligned = ((size_t)(pRaw + sizeof(void*)) + a_nAlignment - 1) & ~(a_nAlignment - 1);
+		((void**)nAligned)[-1] = pRaw;
+
+		return (void*)nAligned;
+	}
+
+	/**
+	*	\brief	Frees memory allocated with AlignedMalloc()
+	*	\param	void* a_pMemory - memory to free (may be NULL)
+	*/
+
+	void AlignedFree(void* a_pMemory)
+	{
+		if (a_pMemory)
+			free(((void**)a_pMemory)[-1]);
+	}
+}
@@ -0,0 +1,558 @@
+/**
+*	\file		SGMath.h
+*	\brief		Vector, matrix, quaternion and plane types used throughout SGLib
+*	\date		19/10/26
+*	\version	1.0
+*
+*	SGLib's own math library. It follows the D3DX conventions exactly - row vectors multiplied on the
+*	left of the matrix (v * M), left handed coordinate systems, matrices stored row major with the
+*	translation in the fourth row - and the functions mirror their D3DX counterparts (D3DXMatrixMultiply
+*	becomes SGLib::MatrixMultiply and so on) so code can move between the two without any reordering.
+*	Nothing in this file depends on DirectX, the library builds on any platform with a C++ compiler.
+*
+*	The hot functions (matrix multiply, vector transforms and their array versions) have an SSE2 path
+*	and the array functions additionally an AVX2 path. Which is used is decided at compile time:
+*
+*		SGLIB_SIMD_SCALAR	- define to force the scalar reference implementation
+*		__AVX2__			- set by the compiler (/arch:AVX2, -mavx2) to enable the AVX2 paths
+*		SSE2				- enabled on x64, with /arch:SSE2 or with -msse2
+*
+*	The scalar reference is always compiled into SGLib::Reference so the SIMD paths can be checked and
+*	timed against it. Every SIMD path performs the same multiplies and adds in the same order as the
+*	reference and never uses reciprocal approximations, so the results are bit identical provided the
+*	compiler does not contract multiplies and adds into FMAs (the default with /fp:precise).
+*
+*	When the DirectX headers have been included first the types also convert to and from D3DMATRIX,
+*	D3DVECTOR and the D3DX types. AsD3D() reinterprets a type in place for passing to device calls.
+*
+*	Vector4, Quaternion and Matrix are 16 byte aligned. Older MSVC versions cannot pass aligned types
+*	by value, which std::vector and std::pair both do, so arrays of them should be held in an
+*	SGLib::AlignedArray instead.
+*/
+
+#ifndef SGLIB_SGMATH
+#define SGLIB_SGMATH
+
+#pragma once
+
+#include "SGPlatform.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+// select the SIMD paths
+#if !defined(SGLIB_SIMD_SCALAR)
+	#if defined(__AVX2__)
+		#define SGLIB_SIMD_AVX2
+	#endif
+	#if defined(SGLIB_SIMD_AVX2) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define SGLIB_SIMD_SSE2
+	#endif
+#endif
+
+#if defined(_MSC_VER)
+	#define SGLIB_ALIGN(x)	__declspec(align(x))
+#else
+	#define SGLIB_ALIGN(x)	__attribute__((aligned(x)))
+#endif
+
+namespace SGLib
+{
+	const FLOAT SG_PI = 3.141592654f;
+
+	struct Vector3;
+	struct Vector4;
+	struct Quaternion;
+	struct Matrix;
+	struct AffineMatrix;
+	struct Plane;
+
+	// three component vector (position, direction, normal)
+	struct Vector3
+	{
+		FLOAT x, y, z;
+
+		Vector3() {}
+		Vector3(FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ) : x(a_fX), y(a_fY), z(a_fZ) {}
+		explicit Vector3(const FLOAT* a_pf) : x(a_pf[0]), y(a_pf[1]), z(a_pf[2]) {}
+
+		Vector3&	operator+= (const Vector3& a_rV)	{ x += a_rV.x; y += a_rV.y; z += a_rV.z; return *this; }
+		Vector3&	operator-= (const Vector3& a_rV)	{ x -= a_rV.x; y -= a_rV.y; z -= a_rV.z; return *this; }
+		Vector3&	operator*= (FLOAT a_f)				{ x *= a_f; y *= a_f; z *= a_f; return *this; }
+		Vector3&	operator/= (FLOAT a_f)				{ x /= a_f; y /= a_f; z /= a_f; return *this; }
+
+		Vector3		operator+ () const					{ return *this; }
+		Vector3		operator- () const					{ return Vector3(-x, -y, -z); }
+
+		Vector3		operator+ (const Vector3& a_rV) const	{ return Vector3(x + a_rV.x, y + a_rV.y, z + a_rV.z); }
+		Vector3		operator- (const Vector3& a_rV) const	{ return Vector3(x - a_rV.x, y - a_rV.y, z - a_rV.z); }
+		Vector3		operator* (FLOAT a_f) const				{ return Vector3(x * a_f, y * a_f, z * a_f); }
+		Vector3		operator/ (FLOAT a_f) const				{ return Vector3(x / a_f, y / a_f, z / a_f); }
+
+		friend Vector3 operator* (FLOAT a_f, const Vector3& a_rV)	{ return Vector3(a_f * a_rV.x, a_f * a_rV.y, a_f * a_rV.z); }
+
+		bool		operator== (const Vector3& a_rV) const	{ return x == a_rV.x && y == a_rV.y && z == a_rV.z; }
+		bool		operator!= (const Vector3& a_rV) const	{ return !(*this == a_rV); }
+
+#ifdef D3DVECTOR_DEFINED
+		Vector3(const D3DVECTOR& a_rV) : x(a_rV.x), y(a_rV.y), z(a_rV.z) {}
+		const D3DVECTOR*	AsD3D() const	{ return reinterpret_cast<const D3DVECTOR*>(this); }
+		D3DVECTOR*			AsD3D()			{ return reinterpret_cast<D3DVECTOR*>(this); }
+#endif
+#ifdef __D3DX9MATH_H__
+		operator D3DXVECTOR3() const		{ return D3DXVECTOR3(x, y, z); }
+#endif
+	};
+
+	// four component vector (homogeneous position, colour)
+	struct SGLIB_ALIGN(16) Vector4
+	{
+		FLOAT x, y, z, w;
+
+		Vector4() {}
+		Vector4(FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ, FLOAT a_fW) : x(a_fX), y(a_fY), z(a_fZ), w(a_fW) {}
+		Vector4(const Vector3& a_rV, FLOAT a_fW) : x(a_rV.x), y(a_rV.y), z(a_rV.z), w(a_fW) {}
+		explicit Vector4(const FLOAT* a_pf) : x(a_pf[0]), y(a_pf[1]), z(a_pf[2]), w(a_pf[3]) {}
+
+		Vector4&	operator+= (const Vector4& a_rV)	{ x += a_rV.x; y += a_rV.y; z += a_rV.z; w += a_rV.w; return *this; }
+		Vector4&	operator-= (const Vector4& a_rV)	{ x -= a_rV.x; y -= a_rV.y; z -= a_rV.z; w -= a_rV.w; return *this; }
+		Vector4&	operator*= (FLOAT a_f)				{ x *= a_f; y *= a_f; z *= a_f; w *= a_f; return *this; }
+
+		Vector4		operator- () const						{ return Vector4(-x, -y, -z, -w); }
+		Vector4		operator+ (const Vector4& a_rV) const	{ return Vector4(x + a_rV.x, y + a_rV.y, z + a_rV.z, w + a_rV.w); }
+		Vector4		operator- (const Vector4& a_rV) const	{ return Vector4(x - a_rV.x, y - a_rV.y, z - a_rV.z, w - a_rV.w); }
+		Vector4		operator* (FLOAT a_f) const				{ return Vector4(x * a_f, y * a_f, z * a_f, w * a_f); }
+
+		bool		operator== (const Vector4& a_rV) const	{ return x == a_rV.x && y == a_rV.y && z == a_rV.z && w == a_rV.w; }
+		bool		operator!= (const Vector4& a_rV) const	{ return !(*this == a_rV); }
+
+#ifdef __D3DX9MATH_H__
+		Vector4(const D3DXVECTOR4& a_rV) : x(a_rV.x), y(a_rV.y), z(a_rV.z), w(a_rV.w) {}
+		operator D3DXVECTOR4() const		{ return D3DXVECTOR4(x, y, z, w); }
+		const D3DXVECTOR4*	AsD3D() const	{ return reinterpret_cast<const D3DXVECTOR4*>(this); }
+		D3DXVECTOR4*		AsD3D()			{ return reinterpret_cast<D3DXVECTOR4*>(this); }
+#endif
+	};
+
+	// rotation quaternion, w is the scalar part
+	struct SGLIB_ALIGN(16) Quaternion
+	{
+		FLOAT x, y, z, w;
+
+		Quaternion() {}
+		Quaternion(FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ, FLOAT a_fW) : x(a_fX), y(a_fY), z(a_fZ), w(a_fW) {}
+
+		Quaternion	operator- () const		{ return Quaternion(-x, -y, -z, -w); }
+
+		bool		operator== (const Quaternion& a_rQ) const	{ return x == a_rQ.x && y == a_rQ.y && z == a_rQ.z && w == a_rQ.w; }
+		bool		operator!= (const Quaternion& a_rQ) const	{ return !(*this == a_rQ); }
+
+#ifdef __D3DX9MATH_H__
+		Quaternion(const D3DXQUATERNION& a_rQ) : x(a_rQ.x), y(a_rQ.y), z(a_rQ.z), w(a_rQ.w) {}
+		operator D3DXQUATERNION() const		{ return D3DXQUATERNION(x, y, z, w); }
+#endif
+	};
+
+	// row major 4x4 matrix, vectors are transformed as rows (v * M)
+	struct SGLIB_ALIGN(16) Matrix
+	{
+		union
+		{
+			struct
+			{
+				FLOAT _11, _12, _13, _14;
+				FLOAT _21, _22, _23, _24;
+				FLOAT _31, _32, _33, _34;
+				FLOAT _41, _42, _43, _44;
+			};
+			FLOAT m[4][4];
+		};
+
+		Matrix() {}
+		Matrix(	FLOAT a_f11, FLOAT a_f12, FLOAT a_f13, FLOAT a_f14,
+				FLOAT a_f21, FLOAT a_f22, FLOAT a_f23, FLOAT a_f24,
+				FLOAT a_f31, FLOAT a_f32, FLOAT a_f33, FLOAT a_f34,
+				FLOAT a_f41, FLOAT a_f42, FLOAT a_f43, FLOAT a_f44) :
+					_11(a_f11), _12(a_f12), _13(a_f13), _14(a_f14),
+					_21(a_f21), _22(a_f22), _23(a_f23), _24(a_f24),
+					_31(a_f31), _32(a_f32), _33(a_f33), _34(a_f34),
+					_41(a_f41), _42(a_f42), _43(a_f43), _44(a_f44) {}
+		explicit Matrix(const FLOAT* a_pf)	{ memcpy(m, a_pf, sizeof(m)); }
+
+		FLOAT&		operator() (UINT a_nRow, UINT a_nCol)		{ return m[a_nRow][a_nCol]; }
+		FLOAT		operator() (UINT a_nRow, UINT a_nCol) const	{ return m[a_nRow][a_nCol]; }
+
+		Matrix&		operator*= (const Matrix& a_rM);
+		Matrix		operator* (const Matrix& a_rM) const;
+
+		bool		operator== (const Matrix& a_rM) const	{ return memcmp(m, a_rM.m, sizeof(m)) == 0; }
+		bool		operator!= (const Matrix& a_rM) const	{ return !(*this == a_rM); }
+
+#ifdef D3DMATRIX_DEFINED
+		Matrix(const D3DMATRIX& a_rM)		{ memcpy(m, &a_rM, sizeof(m)); }
+#endif
+#ifdef __D3DX9MATH_H__
+		operator D3DXMATRIX() const			{ return D3DXMATRIX(&_11); }
+		const D3DXMATRIX*	AsD3D() const	{ return reinterpret_cast<const D3DXMATRIX*>(this); }
+		D3DXMATRIX*			AsD3D()			{ return reinterpret_cast<D3DXMATRIX*>(this); }
+#elif defined(D3DMATRIX_DEFINED)
+		const D3DMATRIX*	AsD3D() const	{ return reinterpret_cast<const D3DMATRIX*>(this); }
+		D3DMATRIX*			AsD3D()			{ return reinterpret_cast<D3DMATRIX*>(this); }
+#endif
+	};
+
+	// affine transform, i.e. a Matrix whose fourth column is (0, 0, 0, 1). The first three columns are
+	// stored transposed so each row produces one output component (x' = dot(m[0], (x, y, z, 1))) and the
+	// constant column is never stored - 48 bytes instead of 64 and 36 multiplies per product instead of 64.
+	struct SGLIB_ALIGN(16) AffineMatrix
+	{
+		FLOAT m[3][4];
+
+		AffineMatrix() {}
+		explicit AffineMatrix(const Matrix& a_rM);
+
+		// element access with Matrix indices (row 3 is the translation, column 3 is not stored)
+		FLOAT&		operator() (UINT a_nRow, UINT a_nCol)		{ return m[a_nCol][a_nRow]; }
+		FLOAT		operator() (UINT a_nRow, UINT a_nCol) const	{ return m[a_nCol][a_nRow]; }
+
+		AffineMatrix&	operator*= (const AffineMatrix& a_rM);
+		AffineMatrix	operator* (const AffineMatrix& a_rM) const;
+
+		bool		operator== (const AffineMatrix& a_rM) const	{ return memcmp(m, a_rM.m, sizeof(m)) == 0; }
+		bool		operator!= (const AffineMatrix& a_rM) const	{ return !(*this == a_rM); }
+	};
+
+	// plane ax + by + cz + d = 0
+	struct Plane
+	{
+		FLOAT a, b, c, d;
+
+		Plane() {}
+		Plane(FLOAT a_fA, FLOAT a_fB, FLOAT a_fC, FLOAT a_fD) : a(a_fA), b(a_fB), c(a_fC), d(a_fD) {}
+	};
+
+	// six planes bounding a view volume, normals point inwards
+	struct Frustum
+	{
+		enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, NUM_PLANES };
+
+		Plane planes[NUM_PLANES];
+	};
+
+	//--------------------------------------------------------------------------------------
+	// trigonometric functions
+	//--------------------------------------------------------------------------------------
+
+	// polynomial approximations, absolute error below 1e-6 for angles up to about 10000 radians
+	void		ScalarSinCos			(FLOAT* a_pSin, FLOAT* a_pCos, FLOAT a_fAngle);
+	void		SinCosArray				(FLOAT* a_pSin, FLOAT* a_pCos, const FLOAT* a_pAngles, UINT a_nCount);
+
+	//--------------------------------------------------------------------------------------
+	// half precision conversions
+	//--------------------------------------------------------------------------------------
+
+	// IEEE 754 half floats as D3DDECLTYPE_FLOAT16_2/4 and the half shader type read them (D3DXFloat32To16Array)
+	unsigned short	ScalarFloat32To16		(FLOAT a_fValue);
+	FLOAT			ScalarFloat16To32		(unsigned short a_nValue);
+	unsigned short*	Float32To16Array		(unsigned short* a_pOut, const FLOAT* a_pIn, UINT a_nCount);
+	FLOAT*			Float16To32Array		(FLOAT* a_pOut, const unsigned short* a_pIn, UINT a_nCount);
+
+	//--------------------------------------------------------------------------------------
+	// vector functions
+	//--------------------------------------------------------------------------------------
+
+	inline FLOAT Vec3Dot(const Vector3* a_pV1, const Vector3* a_pV2)
+	{
+		return a_pV1->x * a_pV2->x + a_pV1->y * a_pV2->y + a_pV1->z * a_pV2->z;
+	}
+
+	inline FLOAT Vec3LengthSq(const Vector3* a_pV)
+	{
+		return Vec3Dot(a_pV, a_pV);
+	}
+
+	inline FLOAT Vec3Length(const Vector3* a_pV)
+	{
+		return sqrtf(Vec3LengthSq(a_pV));
+	}
+
+	inline Vector3* Vec3Cross(Vector3* a_pOut, const Vector3* a_pV1, const Vector3* a_pV2)
+	{
+		Vector3 vecTemp(a_pV1->y * a_pV2->z - a_pV1->z * a_pV2->y,
+						a_pV1->z * a_pV2->x - a_pV1->x * a_pV2->z,
+						a_pV1->x * a_pV2->y - a_pV1->y * a_pV2->x);
+		*a_pOut = vecTemp;
+		return a_pOut;
+	}
+
+	inline Vector3* Vec3Scale(Vector3* a_pOut, const Vector3* a_pV, FLOAT a_fScale)
+	{
+		*a_pOut = *a_pV * a_fScale;
+		return a_pOut;
+	}
+
+	inline Vector3* Vec3Lerp(Vector3* a_pOut, const Vector3* a_pV1, const Vector3* a_pV2, FLOAT a_fT)
+	{
+		a_pOut->x = a_pV1->x + a_fT * (a_pV2->x - a_pV1->x);
+		a_pOut->y = a_pV1->y + a_fT * (a_pV2->y - a_pV1->y);
+		a_pOut->z = a_pV1->z + a_fT * (a_pV2->z - a_pV1->z);
+		return a_pOut;
+	}
+
+	inline Vector3* Vec3Minimize(Vector3* a_pOut, const Vector3* a_pV1, const Vector3* a_pV2)
+	{
+		a_pOut->x = a_pV1->x < a_pV2->x ? a_pV1->x : a_pV2->x;
+		a_pOut->y = a_pV1->y < a_pV2->y ? a_pV1->y : a_pV2->y;
+		a_pOut->z = a_pV1->z < a_pV2->z ? a_pV1->z : a_pV2->z;
+		return a_pOut;
+	}
+
+	inline Vector3* Vec3Maximize(Vector3* a_pOut, const Vector3* a_pV1, const Vector3* a_pV2)
+	{
+		a_pOut->x = a_pV1->x > a_pV2->x ? a_pV1->x : a_pV2->x;
+		a_pOut->y = a_pV1->y > a_pV2->y ? a_pV1->y : a_pV2->y;
+		a_pOut->z = a_pV1->z > a_pV2->z ? a_pV1->z : a_pV2->z;
+		return a_pOut;
+	}
+
+	Vector3*	Vec3Normalize			(Vector3* a_pOut, const Vector3* a_pV);
+	Vector3*	Vec3TransformCoord		(Vector3* a_pOut, const Vector3* a_pV, const Matrix* a_pM);
+	Vector3*	Vec3TransformNormal		(Vector3* a_pOut, const Vector3* a_pV, const Matrix* a_pM);
+	Vector4*	Vec3Transform			(Vector4* a_pOut, const Vector3* a_pV, const Matrix* a_pM);
+	Vector4*	Vec4Transform			(Vector4* a_pOut, const Vector4* a_pV, const Matrix* a_pM);
+	Vector4*	Vec4Blend				(Vector4* a_pOut, const FLOAT* const* a_ppV, const FLOAT* a_pWeights);
+
+	// strides are in bytes so the vectors can be interleaved with other vertex data
+	Vector3*	Vec3TransformCoordArray	(Vector3* a_pOut, UINT a_nOutStride, const Vector3* a_pV, UINT a_nVStride, const Matrix* a_pM, UINT a_nCount);
+	Vector3*	Vec3TransformNormalArray(Vector3* a_pOut, UINT a_nOutStride, const Vector3* a_pV, UINT a_nVStride, const Matrix* a_pM, UINT a_nCount);
+
+	//--------------------------------------------------------------------------------------
+	// matrix functions
+	//--------------------------------------------------------------------------------------
+
+	Matrix*		MatrixIdentity			(Matrix* a_pOut);
+	BOOL		MatrixIsIdentity		(const Matrix* a_pM);
+	Matrix*		MatrixMultiply			(Matrix* a_pOut, const Matrix* a_pM1, const Matrix* a_pM2);
+	Matrix*		MatrixMultiplyArray		(Matrix* a_pOut, const Matrix* a_pM1, const Matrix* a_pM2, UINT a_nCount);
+	Matrix*		MatrixTranspose			(Matrix* a_pOut, const Matrix* a_pM);
+	FLOAT		MatrixDeterminant		(const Matrix* a_pM);
+	Matrix*		MatrixInverse			(Matrix* a_pOut, FLOAT* a_pDeterminant, const Matrix* a_pM);
+	BOOL		MatrixDecompose			(Vector3* a_pOutScale, Quaternion* a_pOutRotation, Vector3* a_pOutTranslation, const Matrix* a_pM);
+
+	Matrix*		MatrixTranslation		(Matrix* a_pOut, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ);
+	Matrix*		MatrixScaling			(Matrix* a_pOut, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ);
+	Matrix*		MatrixRotationX			(Matrix* a_pOut, FLOAT a_fAngle);
+	Matrix*		MatrixRotationY			(Matrix* a_pOut, FLOAT a_fAngle);
+	Matrix*		MatrixRotationZ			(Matrix* a_pOut, FLOAT a_fAngle);
+	Matrix*		MatrixRotationAxis		(Matrix* a_pOut, const Vector3* a_pAxis, FLOAT a_fAngle);
+	Matrix*		MatrixRotationQuaternion(Matrix* a_pOut, const Quaternion* a_pQ);
+	Matrix*		MatrixRotationYawPitchRoll(Matrix* a_pOut, FLOAT a_fYaw, FLOAT a_fPitch, FLOAT a_fRoll);
+
+	Matrix*		MatrixLookAtLH			(Matrix* a_pOut, const Vector3* a_pEye, const Vector3* a_pAt, const Vector3* a_pUp);
+	Matrix*		MatrixPerspectiveFovLH	(Matrix* a_pOut, FLOAT a_fFovY, FLOAT a_fAspect, FLOAT a_fNear, FLOAT a_fFar);
+	Matrix*		MatrixOrthoLH			(Matrix* a_pOut, FLOAT a_fWidth, FLOAT a_fHeight, FLOAT a_fNear, FLOAT a_fFar);
+
+	inline Matrix& Matrix::operator*= (const Matrix& a_rM)
+	{
+		MatrixMultiply(this, this, &a_rM);
+		return *this;
+	}
+
+	inline Matrix Matrix::operator* (const Matrix& a_rM) const
+	{
+		Matrix matOut;
+		MatrixMultiply(&matOut, this, &a_rM);
+		return matOut;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// affine matrix functions (same conventions as the Matrix versions)
+	//--------------------------------------------------------------------------------------
+
+	AffineMatrix*	AffineIdentity			(AffineMatrix* a_pOut);
+	AffineMatrix*	AffineFromMatrix		(AffineMatrix* a_pOut, const Matrix* a_pM);
+	Matrix*			MatrixFromAffine		(Matrix* a_pOut, const AffineMatrix* a_pM);
+	AffineMatrix*	AffineMultiply			(AffineMatrix* a_pOut, const AffineMatrix* a_pM1, const AffineMatrix* a_pM2);
+	Matrix*			MatrixMultiplyAffine	(Matrix* a_pOut, const AffineMatrix* a_pM1, const Matrix* a_pM2);
+	AffineMatrix*	AffineInverse			(AffineMatrix* a_pOut, FLOAT* a_pDeterminant, const AffineMatrix* a_pM);
+	AffineMatrix*	AffineNormalMatrix		(AffineMatrix* a_pOut, const AffineMatrix* a_pM);
+
+	AffineMatrix*	AffineTranslation		(AffineMatrix* a_pOut, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ);
+	AffineMatrix*	AffineScaling			(AffineMatrix* a_pOut, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ);
+	AffineMatrix*	AffineRotationX			(AffineMatrix* a_pOut, FLOAT a_fAngle);
+	AffineMatrix*	AffineRotationY			(AffineMatrix* a_pOut, FLOAT a_fAngle);
+	AffineMatrix*	AffineRotationZ			(AffineMatrix* a_pOut, FLOAT a_fAngle);
+	AffineMatrix*	AffineTransformation	(AffineMatrix* a_pOut, const Vector3* a_pScale, const Quaternion* a_pRotation, const Vector3* a_pTranslation);
+
+	Vector3*		Vec3TransformCoord		(Vector3* a_pOut, const Vector3* a_pV, const AffineMatrix* a_pM);
+	Vector3*		Vec3TransformNormal		(Vector3* a_pOut, const Vector3* a_pV, const AffineMatrix* a_pM);
+
+	inline AffineMatrix::AffineMatrix(const Matrix& a_rM)
+	{
+		AffineFromMatrix(this, &a_rM);
+	}
+
+	inline AffineMatrix& AffineMatrix::operator*= (const AffineMatrix& a_rM)
+	{
+		AffineMultiply(this, this, &a_rM);
+		return *this;
+	}
+
+	inline AffineMatrix AffineMatrix::operator* (const AffineMatrix& a_rM) const
+	{
+		AffineMatrix matOut;
+		AffineMultiply(&matOut, this, &a_rM);
+		return matOut;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// quaternion functions (QuaternionMultiply(q1, q2) rotates by q1 then q2, like MatrixMultiply)
+	//--------------------------------------------------------------------------------------
+
+	inline Quaternion* QuaternionIdentity(Quaternion* a_pOut)
+	{
+		a_pOut->x = a_pOut->y = a_pOut->z = 0.0f;
+		a_pOut->w = 1.0f;
+		return a_pOut;
+	}
+
+	inline FLOAT QuaternionDot(const Quaternion* a_pQ1, const Quaternion* a_pQ2)
+	{
+		return a_pQ1->x * a_pQ2->x + a_pQ1->y * a_pQ2->y + a_pQ1->z * a_pQ2->z + a_pQ1->w * a_pQ2->w;
+	}
+
+	inline Quaternion* QuaternionConjugate(Quaternion* a_pOut, const Quaternion* a_pQ)
+	{
+		a_pOut->x = -a_pQ->x;
+		a_pOut->y = -a_pQ->y;
+		a_pOut->z = -a_pQ->z;
+		a_pOut->w = a_pQ->w;
+		return a_pOut;
+	}
+
+	Quaternion*	QuaternionNormalize		(Quaternion* a_pOut, const Quaternion* a_pQ);
+	Quaternion*	QuaternionMultiply		(Quaternion* a_pOut, const Quaternion* a_pQ1, const Quaternion* a_pQ2);
+	Quaternion*	QuaternionRotationAxis	(Quaternion* a_pOut, const Vector3* a_pAxis, FLOAT a_fAngle);
+	Quaternion*	QuaternionRotationMatrix(Quaternion* a_pOut, const Matrix* a_pM);
+	Quaternion*	QuaternionRotationYawPitchRoll(Quaternion* a_pOut, FLOAT a_fYaw, FLOAT a_fPitch, FLOAT a_fRoll);
+	Quaternion*	QuaternionSlerp			(Quaternion* a_pOut, const Quaternion* a_pQ1, const Quaternion* a_pQ2, FLOAT a_fT);
+
+	//--------------------------------------------------------------------------------------
+	// plane and frustum functions
+	//--------------------------------------------------------------------------------------
+
+	inline FLOAT PlaneDotCoord(const Plane* a_pP, const Vector3* a_pV)
+	{
+		return a_pP->a * a_pV->x + a_pP->b * a_pV->y + a_pP->c * a_pV->z + a_pP->d;
+	}
+
+	inline FLOAT PlaneDotNormal(const Plane* a_pP, const Vector3* a_pV)
+	{
+		return a_pP->a * a_pV->x + a_pP->b * a_pV->y + a_pP->c * a_pV->z;
+	}
+
+	Plane*		PlaneNormalize			(Plane* a_pOut, const Plane* a_pP);
+
+	// extracts the planes of the clip volume of a world * view * projection matrix (d3d z range [0, w])
+	Frustum*	FrustumFromMatrix		(Frustum* a_pOut, const Matrix* a_pM);
+	BOOL		FrustumTestAABB			(const Frustum* a_pF, const Vector3* a_pMin, const Vector3* a_pMax);
+	BOOL		FrustumTestSphere		(const Frustum* a_pF, const Vector3* a_pCentre, FLOAT a_fRadius);
+
+	//--------------------------------------------------------------------------------------
+	// scalar reference implementations of the functions with SIMD paths
+	//--------------------------------------------------------------------------------------
+
+	namespace Reference
+	{
+		Vector3*	Vec3TransformCoord		(Vector3* a_pOut, const Vector3* a_pV, const Matrix* a_pM);
+		Vector3*	Vec3TransformNormal		(Vector3* a_pOut, const Vector3* a_pV, const Matrix* a_pM);
+		Vector4*	Vec4Transform			(Vector4* a_pOut, const Vector4* a_pV, const Matrix* a_pM);
+		Vector4*	Vec4Blend				(Vector4* a_pOut, const FLOAT* const* a_ppV, const FLOAT* a_pWeights);
+		Vector3*	Vec3TransformCoordArray	(Vector3* a_pOut, UINT a_nOutStride, const Vector3* a_pV, UINT a_nVStride, const Matrix* a_pM, UINT a_nCount);
+		Vector3*	Vec3TransformNormalArray(Vector3* a_pOut, UINT a_nOutStride, const Vector3* a_pV, UINT a_nVStride, const Matrix* a_pM, UINT a_nCount);
+		Matrix*		MatrixMultiply			(Matrix* a_pOut, const Matrix* a_pM1, const Matrix* a_pM2);
+		Matrix*		MatrixMultiplyArray		(Matrix* a_pOut, const Matrix* a_pM1, const Matrix* a_pM2, UINT a_nCount);
+		Matrix*		MatrixTranspose			(Matrix* a_pOut, const Matrix* a_pM);
+		AffineMatrix*	AffineMultiply		(AffineMatrix* a_pOut, const AffineMatrix* a_pM1, const AffineMatrix* a_pM2);
+		void		SinCosArray				(FLOAT* a_pSin, FLOAT* a_pCos, const FLOAT* a_pAngles, UINT a_nCount);
+		unsigned short*	Float32To16Array	(unsigned short* a_pOut, const FLOAT* a_pIn, UINT a_nCount);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// aligned storage
+	//--------------------------------------------------------------------------------------
+
+	void*	AlignedMalloc	(size_t a_nSize, size_t a_nAlignment = 16);
+	void	AlignedFree		(void* a_pMemory);
+
+	/**
+	*	\brief	Growable array of plain data types with 16 byte aligned storage
+	*	\note	Elements are copied with memcpy and never constructed or destroyed, so Type must be a plain
+	*			data type such as the math types above.
+	*/
+	template<class Type>
+	class AlignedArray
+	{
+	public:
+		AlignedArray() : m_pData(NULL), m_nSize(0), m_nCapacity(0) {}
+		explicit AlignedArray(UINT a_nSize) : m_pData(NULL), m_nSize(0), m_nCapacity(0)	{ Resize(a_nSize); }
+		AlignedArray(const AlignedArray& a_rArray) : m_pData(NULL), m_nSize(0), m_nCapacity(0)	{ *this = a_rArray; }
+		~AlignedArray()		{ AlignedFree(m_pData); }
+
+		AlignedArray& operator= (const AlignedArray& a_rArray)
+		{
+			if (this != &a_rArray)
+			{
+				Resize(a_rArray.m_nSize);
+				if (m_nSize)
+					memcpy(m_pData, a_rArray.m_pData, m_nSize * sizeof(Type));
+			}
+			return *this;
+		}
+
+		void Reserve(UINT a_nCapacity)
+		{
+			if (a_nCapacity <= m_nCapacity)
+				return;
+
+			Type* pData = (Type*)AlignedMalloc(a_nCapacity * sizeof(Type));
+			if (m_nSize)
+				memcpy(pData, m_pData, m_nSize * sizeof(Type));
+
+			AlignedFree(m_pData);
+			m_pData = pData;
+			m_nCapacity = a_nCapacity;
+		}
+
+		// new elements are left uninitialised
+		void Resize(UINT a_nSize)
+		{
+			if (a_nSize > m_nCapacity)
+				Reserve(a_nSize > m_nCapacity * 2 ? a_nSize : m_nCapacity * 2);
+			m_nSize = a_nSize;
+		}
+
+		void PushBack(const Type& a_rValue)
+		{
+			if (m_nSize == m_nCapacity)
+				Reserve(m_nCapacity ? m_nCapacity * 2 : 8);
+			m_pData[m_nSize++] = a_rValue;
+		}
+
+		void		Clear()							{ m_nSize = 0; }
+		UINT		Size() const					{ return m_nSize; }
+		BOOL		Empty() const					{ return m_nSize == 0; }
+		Type*		Data()							{ return m_pData; }
+		const Type*	Data() const					{ return m_pData; }
+		Type&		operator[] (UINT a_nPos)		{ return m_pData[a_nPos]; }
+		const Type&	operator[] (UINT a_nPos) const	{ return m_pData[a_nPos]; }
+
+	private:
+		Type*	m_pData;		///< aligned element storage
+		UINT	m_nSize;		///< number of elements in use
+		UINT	m_nCapacity;	///< number of elements allocated
+	};
+}
+
+#endif
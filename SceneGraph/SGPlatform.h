@@ -0,0 +1,84 @@
+/**
+*	\file		SGPlatform.h
+*	\brief		Basic Windows types used by the parts of SGLib that don't touch the device
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Headers of code that has nothing to do with Direct3D (the math library, the scene graph's
+*	hierarchy and scheduling, animation, the job system and the particle simulation) include this
+*	rather than dxstdafx.h, so they build on platforms without DirectX. On Windows it is windows.h.
+*	Elsewhere it declares the handful of Windows types and functions that code uses, with the
+*	character types wide as in SGLib's Unicode builds and the interlocked functions built on the
+*	compiler's atomic builtins.
+*
+*	Classes that do talk to the device include dxstdafx.h themselves, before any SGLib header, so
+*	the conversions in SGMath.h between its types and the D3DX ones are available to them.
+*/
+
+#ifndef SGLIB_SGPLATFORM
+#define SGLIB_SGPLATFORM
+
+#pragma once
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+#else
+
+#include <cstdio>
+#include <cwchar>
+#include <sched.h>
+#include <unistd.h>
+
+typedef float			FLOAT;
+typedef int				INT;
+typedef unsigned int	UINT;
+typedef int				BOOL;
+typedef unsigned char	BYTE;
+typedef unsigned short	WORD;
+typedef unsigned int	DWORD;
+typedef int				LONG;
+typedef void*			LPVOID;
+typedef wchar_t			TCHAR;
+typedef const wchar_t*	LPCTSTR;
+typedef const char*		LPCSTR;
+
+#ifndef TRUE
+#define TRUE	1
+#define FALSE	0
+#endif
+
+// warnings go to stderr instead of the debugger
+inline void OutputDebugString(LPCTSTR a_sMessage)
+{
+	fputws(a_sMessage, stderr);
+}
+
+// full barriers, as their Win32 namesakes are
+inline LONG InterlockedExchange(volatile LONG* a_pTarget, LONG a_nValue)
+{
+	LONG nOld = *a_pTarget, nSeen;
+
+	while ((nSeen = __sync_val_compare_and_swap(a_pTarget, nOld, a_nValue)) != nOld)
+		nOld = nSeen;
+
+	return nOld;
+}
+
+inline LONG InterlockedExchangeAdd(volatile LONG* a_pTarget, LONG a_nValue)	{ return __sync_fetch_and_add(a_pTarget, a_nValue); }
+inline LONG InterlockedIncrement(volatile LONG* a_pTarget)					{ return __sync_add_and_fetch(a_pTarget, 1); }
+inline LONG InterlockedDecrement(volatile LONG* a_pTarget)					{ return __sync_sub_and_fetch(a_pTarget, 1); }
+
+// 0 gives up the rest of the time slice
+inline void Sleep(DWORD a_nMilliseconds)
+{
+	if (a_nMilliseconds == 0)
+		sched_yield();
+	else
+		usleep(a_nMilliseconds * 1000);
+}
+
+#endif
+
+#endif
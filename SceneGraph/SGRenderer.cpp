@@ -14,8 +14,16 @@ namespace SGLib
 	SGRenderer::SGRenderer() :	m_dwOptions(D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER),
 								m_colourClear(D3DCOLOR_XRGB(0, 0, 0)),
 								m_fZClear(1.0f),
-								m_dwStencil(0)
+								m_dwStencil(0),
+								m_nBudget(0),
+								m_nBudgetTicks(0),
+								m_nSpentTicks(0),
+								m_bBudgetSpent(FALSE),
+								m_bInBudget(FALSE),
+								m_nMinLateness(0),
+								m_nDeferred(0)
 	{
+		AffineIdentity(&m_oMatrixUpdate);
 	}
 
 	/**
@@ -50,6 +58,44 @@ namespace SGLib
 		m_dwStencil = a_dwStencil;
 	}
 
+	/**
+	*	\brief	Mutator for the time low rate nodes may take each update pass
+	*	\param	UINT a_nMicroseconds - CPU time in microseconds, 0 lets every due node update
+	*	\note	Only nodes with an update rate other than UPDATE_EVERY_FRAME count against the budget, see
+	*			SGLib::Node::SetUpdateRate(). A node that starts before the budget runs out is always
+	*			finished, so a pass can go over by up to one node's hierarchy.
+	*/
+
+	void SGRenderer::SetUpdateBudget(UINT a_nMicroseconds)
+	{
+		LARGE_INTEGER nFrequency;
+		QueryPerformanceFrequency(&nFrequency);
+
+		m_nBudget = a_nMicroseconds;
+		m_nBudgetTicks = nFrequency.QuadPart * a_nMicroseconds / 1000000;
+		m_nMinLateness = 0;
+	}
+
+	/**
+	*	\brief	Accessor for the update budget
+	*	\return	UINT - microseconds low rate nodes may take each update pass, 0 if there is no limit
+	*/
+
+	UINT SGRenderer::GetUpdateBudget() const
+	{
+		return m_nBudget;
+	}
+
+	/**
+	*	\brief	Accessor for the number of nodes held back by the budget in the last update pass
+	*	\return	UINT - nodes that were due but left for a later frame
+	*/
+
+	UINT SGRenderer::GetNumDeferred() const
+	{
+		return m_nDeferred;
+	}
+
 	/**
 	*	\brief	Public entry point for rendering of a_pNodeBase and its hierarchy
 	*	\param	Node* a_pNodeBase - base node in the node structure being rendered
@@ -65,6 +111,8 @@ namespace SGLib
 		// clear back buffer
 		V(a_pNodeBase->GetDevice()->Clear(0, NULL, m_dwOptions,
 									m_colourClear, m_fZClear, m_dwStencil))
+
+		UploadTransient();
 		
 		V(a_pNodeBase->GetDevice()->BeginScene())
 
@@ -74,19 +122,70 @@ namespace SGLib
 		V(a_pNodeBase->GetDevice()->EndScene())
 	}
 
+	/**
+	*	\brief	Writes the transient geometry of the frame into the shared ring before anything is drawn
+	*	\note	Does nothing without a shared SGLib::DynamicRing. The particle systems simulated since the
+	*			last frame are copied in one lock and the ring is unlocked again for drawing.
+	*/
+
+	void SGRenderer::UploadTransient()
+	{
+		DynamicRing* pRing = DynamicRing::GetShared();
+
+		if (!pRing)
+			return;
+
+		pRing->BeginFrame();
+		ParticleSystem::UploadSimulated(pRing);
+		pRing->Flush();
+	}
+
 	/**
 	*	\brief	Public entry point for updating of a_pNodeBase and its hierarchy prior to rendering
 	*	\param	Node* a_pNodeBase - base node in the node structure being updated
 	*	\param	FLOAT a_fTimeDiff - time difference between update calls
+	*	\note	Begins a new SGLib::AnimSystem frame and animates every skeleton, so the scene should be
+	*			updated through one call a frame. The particle systems reached are simulated afterwards by
+	*			SGLib::ParticleStage::Run().
 	*/
 
 	void SGRenderer::Update(Node* a_pNodeBase, FLOAT a_fTimeDiff)
 	{
+		HRESULT hr;
+		Matrix	matWorld;
+
 		if (!a_pNodeBase)
 			return;
 
+		// each update pass is one animation frame, skeletons are animated in parallel before it
+		AnimSystem::BeginFrame();
+		AnimSystem::Animate(a_fTimeDiff);
+
+		// transforms track the world matrix themselves during the update so it is only read once
+		V(a_pNodeBase->GetDevice()->GetTransform(D3DTS_WORLD, matWorld.AsD3D()))
+
+		// if the starting world matrix changed every node has to be updated under it
+		AffineMatrix matUpdate(matWorld);
+		BOOL bMoved = (matUpdate != m_oMatrixUpdate);
+
+		m_oMatrixUpdate = matUpdate;
+		Transform::SetUpdateWorld(m_oMatrixUpdate);
+
+		// while the budget keeps running out only the nodes that have waited longest are let in
+		if (m_bBudgetSpent)
+			++m_nMinLateness;
+		else if (m_nMinLateness > 0)
+			--m_nMinLateness;
+
+		m_nSpentTicks = 0;
+		m_bBudgetSpent = FALSE;
+		m_nDeferred = 0;
+
 		// call general update function for base node
-		UpdateNode(a_pNodeBase, a_fTimeDiff);
+		UpdateNode(a_pNodeBase, a_fTimeDiff, bMoved);
+
+		// the particle systems updated in the pass are simulated together in parallel
+		ParticleStage::Run();
 	}
 
 	/**
@@ -154,7 +253,9 @@ namespace SGLib
 				m_stpStates.push(dynamic_cast<State*>(a_pNode));
 			}
 
-			a_pNode->Render();
+			// particle systems outside the view frustum are not drawn, their children still are
+			if (enCurrentNode != PARTICLESYS || dynamic_cast<ParticleSystem*>(a_pNode)->UpdateVisibility())
+				a_pNode->Render();
 
 			// if child exists, render it
 			if (pNodeChild)
@@ -185,28 +286,133 @@ namespace SGLib
 	/**
 	*	\brief	Updates a_pNode and calls this function on its child and sibling if they exist
 	*	\param	Node* a_pNode - node being updated
-	*	\note	This function calls both Update() and PostUpdate() on a_pNode
+	*	\param	FLOAT a_fTimeDiff - time difference between update calls
+	*	\param	BOOL a_bMoved - TRUE if the world matrix a_pNode sits under changed this pass
+	*	\return	BOOL - TRUE if a_pNode, its siblings or anything below them is still awake
+	*	\note	This function calls both Update() and PostUpdate() on a_pNode. Static nodes and their 
+	*			child hierarchy are skipped as their matrices have already been baked. Sleeping nodes
+	*			are skipped along with their child hierarchy unless an awake node is below them or
+	*			a_bMoved is set. Nodes with a lower update rate are left to UpdateScheduled().
 	*/
 
-	void SGRenderer::UpdateNode(Node* a_pNode, FLOAT a_fTimeDiff)
+	BOOL SGRenderer::UpdateNode(Node* a_pNode, FLOAT a_fTimeDiff, BOOL a_bMoved)
 	{
-		Node* pNodeChild = NULL;
 		Node* pNodeSibling = NULL;
+		BOOL bAwake = FALSE;
+
+		if (!a_pNode->IsStatic() && (a_bMoved || a_pNode->m_bAwake || a_pNode->m_bAwakeBelow))
+		{
+			if (a_pNode->m_enUpdateRate == UPDATE_EVERY_FRAME)
+				bAwake = UpdateHierarchy(a_pNode, a_fTimeDiff, a_bMoved);
+			else
+				bAwake = UpdateScheduled(a_pNode, a_fTimeDiff, a_bMoved);
+		}
+
+		// if sibling node exists, update it
+		pNodeSibling = a_pNode->GetSibling();
+		if (pNodeSibling && UpdateNode(pNodeSibling, a_fTimeDiff, a_bMoved))
+			bAwake = TRUE;
+
+		return bAwake;
+	}
+
+	/**
+	*	\brief	Updates a_pNode and its child hierarchy
+	*	\param	Node* a_pNode - node being updated
+	*	\param	FLOAT a_fTimeDiff - time passed to a_pNode and its child hierarchy
+	*	\param	BOOL a_bMoved - TRUE if the world matrix a_pNode sits under changed
+	*	\return	BOOL - TRUE if a_pNode or anything below it is still awake
+	*/
+
+	BOOL SGRenderer::UpdateHierarchy(Node* a_pNode, FLOAT a_fTimeDiff, BOOL a_bMoved)
+	{
+		Node* pNodeChild = NULL;
 
 		// update this node
 		a_pNode->Update(a_fTimeDiff);
 
+		// children are updated under a new world matrix if this node moved
+		BOOL bMoved = a_bMoved || a_pNode->m_bMoved;
+		a_pNode->m_bMoved = FALSE;
+
+		// rebuilt from the child hierarchy, nodes woken while it is updated set it again
+		a_pNode->m_bAwakeBelow = FALSE;
+
 		// if child node exists, update it
 		pNodeChild = a_pNode->GetChild();
-		if (pNodeChild)
-			UpdateNode(pNodeChild, a_fTimeDiff);
+		if (pNodeChild && UpdateNode(pNodeChild, a_fTimeDiff, bMoved))
+			a_pNode->m_bAwakeBelow = TRUE;
 
 		// perform post update operations on this node
 		a_pNode->PostUpdate();
 
-		// if sibling node exists, update it
-		pNodeSibling = a_pNode->GetSibling();
-		if (pNodeSibling)
-			UpdateNode(pNodeSibling, a_fTimeDiff);
+		return a_pNode->m_bAwake || a_pNode->m_bAwakeBelow;
+	}
+
+	/**
+	*	\brief	Updates a_pNode and its child hierarchy if its update rate and the update budget allow it
+	*	\param	Node* a_pNode - node with an update rate other than UPDATE_EVERY_FRAME
+	*	\param	FLOAT a_fTimeDiff - time passed since the last pass reached a_pNode
+	*	\param	BOOL a_bMoved - TRUE if the world matrix a_pNode sits under changed
+	*	\return	BOOL - TRUE if a_pNode or anything below it is still awake
+	*	\note	The time of every pass a_pNode is held back for is added up and passed to its hierarchy
+	*			when it is updated. Low rate nodes inside the hierarchy of another are only held to their
+	*			rate as their time is already counted against the budget.
+	*/
+
+	BOOL SGRenderer::UpdateScheduled(Node* a_pNode, FLOAT a_fTimeDiff, BOOL a_bMoved)
+	{
+		UINT nRate = (UINT)a_pNode->m_enUpdateRate;
+
+		a_pNode->m_fRateTime += a_fTimeDiff;
+		++a_pNode->m_nRateFrames;
+
+		BOOL bDue = (a_pNode->m_nRateFrames >= nRate);
+
+		// a due node waits if the budget is spent or others have been waiting longer
+		if (bDue && m_nBudget > 0 && !m_bInBudget)
+		{
+			if (m_bBudgetSpent || a_pNode->m_nRateFrames - nRate < m_nMinLateness)
+			{
+				bDue = FALSE;
+				++m_nDeferred;
+			}
+		}
+
+		if (!bDue)
+		{
+			// keep the node in the pass so it catches up with the move when it is updated
+			if (a_bMoved)
+			{
+				a_pNode->m_bMoved = TRUE;
+				a_pNode->Wake();
+			}
+
+			return a_pNode->m_bAwake || a_pNode->m_bAwakeBelow;
+		}
+
+		FLOAT fTimeDiff = a_pNode->m_fRateTime;
+
+		a_pNode->m_fRateTime = 0.0f;
+		a_pNode->m_nRateFrames = 0;
+
+		if (m_nBudget == 0 || m_bInBudget)
+			return UpdateHierarchy(a_pNode, fTimeDiff, a_bMoved);
+
+		// time the whole hierarchy against the budget
+		LARGE_INTEGER nStart, nEnd;
+		QueryPerformanceCounter(&nStart);
+
+		m_bInBudget = TRUE;
+		BOOL bAwake = UpdateHierarchy(a_pNode, fTimeDiff, a_bMoved);
+		m_bInBudget = FALSE;
+
+		QueryPerformanceCounter(&nEnd);
+
+		m_nSpentTicks += nEnd.QuadPart - nStart.QuadPart;
+		if (m_nSpentTicks >= m_nBudgetTicks)
+			m_bBudgetSpent = TRUE;
+
+		return bAwake;
 	}
 }
\ No newline at end of file
@@ -9,6 +9,29 @@
 *	techniques this class will have to be extended to perform the 'behind-the-scene' connections and traversals.
 *
 *	Update: 22/5/07 - The functionality to define the clear options of the back buffer has been included
+*
+*	Update 19/10/26 - Update() runs an animation phase before the traversal, see SGLib::AnimSystem::Animate()
+*
+*	Update 19/10/26 - The update traversal skips sleeping nodes and only follows paths leading to an awake
+*						node, so its cost follows the number of nodes with work to do. A node is still
+*						updated when the world matrix above it moved. See SGLib::Node::Wake().
+*
+*	Update 19/10/26 - Nodes with an update rate other than every frame (see SGLib::Node::SetUpdateRate()) are
+*						held to a CPU budget in microseconds set with SetUpdateBudget(). Once the time
+*						spent on them in a pass reaches the budget the rest wait for a later frame, still
+*						being handed all the time they missed. When the budget keeps running out only
+*						the nodes that have waited longest are let in, so every node keeps being
+*						updated and the frame time stays flat however much low rate work there is.
+*
+*	Update 19/10/26 - Update() runs SGLib::ParticleStage::Run() after the traversal, which simulates the
+*						particle systems the pass reached.
+*
+*	Update 19/10/26 - Render() first writes the frame's transient geometry into the shared
+*						SGLib::DynamicRing, if there is one, in a single lock with UploadTransient().
+*						Renderers overriding Render() should call it before drawing.
+*
+*	Update 19/10/26 - RenderNode() skips the Render() of particle systems whose world box is outside the
+*						view frustum, see SGLib::ParticleSystem::UpdateVisibility().
 */
 
 #ifndef SGLIB_SGRENDERER
@@ -16,10 +39,15 @@
 
 #pragma once
 
+#include "dxstdafx.h"
 #include "Node.h"
 #include "Shader.h"
 #include "State.h"
 #include "Articulated.h"
+#include "AnimSystem.h"
+#include "ParticleStage.h"
+#include "ParticleSystem.h"
+#include "DynamicRing.h"
 
 #include <stack>
 
@@ -41,15 +69,32 @@ namespace SGLib
 		FLOAT				m_fZClear;		///< depth to clear the z buffer to
 		DWORD				m_dwStencil;	///< value to set stencil plane to
 
+		AffineMatrix		m_oMatrixUpdate;	///< world matrix the last update pass started from
+
+		// variables associated with the update budget
+		UINT				m_nBudget;			///< microseconds low rate updates may take each pass, 0 for no limit
+		LONGLONG			m_nBudgetTicks;		///< budget in performance counter ticks
+		LONGLONG			m_nSpentTicks;		///< ticks spent on low rate updates this pass
+		BOOL				m_bBudgetSpent;		///< TRUE once the budget has run out this pass
+		BOOL				m_bInBudget;		///< TRUE while a low rate node's hierarchy is being updated
+		UINT				m_nMinLateness;		///< frames a due node must be overdue by to be let in
+		UINT				m_nDeferred;		///< due nodes held back this pass
+
 	public:
 		virtual void	Render(Node* a_pNodeBase);
 		virtual void	Update(Node* a_pNodeBase, FLOAT a_fTimeDiff);
 		void			SetClearColour(D3DCOLOR a_colour);
 		void			SetClearOptions(DWORD a_dwOptions, FLOAT a_fZClear = 1.0f, DWORD a_dwStencil = 0);
+		void			SetUpdateBudget(UINT a_nMicroseconds);
+		UINT			GetUpdateBudget() const;
+		UINT			GetNumDeferred() const;
 
 	protected:
 		virtual void	RenderNode(Node* a_pNode);
-		virtual void	UpdateNode(Node* a_pNode, FLOAT a_fTimeDiff);
+		virtual BOOL	UpdateNode(Node* a_pNode, FLOAT a_fTimeDiff, BOOL a_bMoved);
+		void			UploadTransient();
+		BOOL			UpdateHierarchy(Node* a_pNode, FLOAT a_fTimeDiff, BOOL a_bMoved);
+		BOOL			UpdateScheduled(Node* a_pNode, FLOAT a_fTimeDiff, BOOL a_bMoved);
 	};
 }
 
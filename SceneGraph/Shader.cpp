@@ -1,4 +1,5 @@
 #include "Shader.h"
+#include "Transform.h"
 
 namespace SGLib
 {
@@ -121,6 +122,38 @@ namespace SGLib
 			m_pReference->RenderGeometry(a_pGeometryNode);
 	}
 
+	/**
+	*	\brief	Retrieves the world matrix for the geometry being rendered and the matrix its normals need
+	*	\param	Matrix* a_pWorld - [out] world matrix
+	*	\param	Matrix* a_pWorldIT - [out] inverse transpose of the world matrix, may be NULL
+	*	\note	Uses the matrices cached on the transform currently rendering (see Transform::GetRenderTransform())
+	*			so the inverse is only calculated when the world matrix changes. Falls back to reading and 
+	*			inverting the device's world matrix when geometry is rendered outside of a transform.
+	*/
+
+	void Shader::GetWorldMatrices(Matrix* a_pWorld, Matrix* a_pWorldIT) const
+	{
+		const Transform* pTransform = Transform::GetRenderTransform();
+
+		if (pTransform)
+		{
+			MatrixFromAffine(a_pWorld, &pTransform->GetWorldMatrix());
+
+			if (a_pWorldIT)
+				MatrixFromAffine(a_pWorldIT, &pTransform->GetNormalMatrix());
+			return;
+		}
+
+		HRESULT hr;
+		V(m_pD3DDevice->GetTransform(D3DTS_WORLD, a_pWorld->AsD3D()))
+
+		if (a_pWorldIT)
+		{
+			MatrixInverse(a_pWorldIT, NULL, a_pWorld);
+			MatrixTranspose(a_pWorldIT, a_pWorldIT);
+		}
+	}
+
 	/**
 	*	\brief	Creates the effect from the m_sFileName
 	*/
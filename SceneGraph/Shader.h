@@ -10,6 +10,9 @@
 *	set. The rendering for each geometry mesh is performed using the RenderGeometry function. In this function the 
 *	effect's variables are set up according to the specific geometry object (eg. world matrix, textures etc.) and 
 *	then calls the geometry objects render function.
+*
+*	Update 19/10/26 - Added GetWorldMatrices() which hands out the world matrix and its inverse transpose
+*						cached on the rendering SGLib::Transform instead of inverting the device matrix per draw.
 */
 
 #ifndef SGLIB_SHADER
@@ -17,7 +20,8 @@
 
 #pragma once
 
-#include "node.h"
+#include "dxstdafx.h"
+#include "Node.h"
 #include "Geometry.h"
 
 namespace SGLib
@@ -43,6 +47,7 @@ namespace SGLib
 		Shader*			m_pReference;	///< points to shader object that contins effect used by this node
 
 		void		CreateEffect();
+		void		GetWorldMatrices(Matrix* a_pWorld, Matrix* a_pWorldIT) const;
 	};
 }
 
@@ -0,0 +1,420 @@
+#include "Skeleton.h"
+#include "Articulated.h"
+
+namespace SGLib
+{
+	UINT Skeleton::s_nSkeletons = 0;
+
+	/**
+	*	\brief	Skeleton constructor
+	*/
+
+	Skeleton::Skeleton() :	m_bAnimated(FALSE),
+							m_nAnimFrame(0),
+							m_bChanged(FALSE),
+							m_fPendingTime(0.0f),
+							m_fBlendTime(0.0f),
+							m_fBlendLength(0.0f),
+							m_nLastEval(0),
+							m_nPhase(0),
+							m_bPosed(FALSE),
+							m_vecPosition(0.0f, 0.0f, 0.0f)
+	{
+	}
+
+	/**
+	*	\brief	Skeleton destructor
+	*	\note	The links are not touched, use Articulated::ReleaseSkeleton() to hand them back their own updates
+	*/
+
+	Skeleton::~Skeleton()
+	{
+		AnimSystem::Unregister(this);
+	}
+
+	/**
+	*	\brief	Collects the links of a hierarchy
+	*	\param	Articulated* a_pRoot - root link, its siblings are not included
+	*	\return	UINT - number of links in the skeleton
+	*	\note	Any skeletons built on links below a_pRoot are released and those links join this one
+	*/
+
+	UINT Skeleton::Build(Articulated* a_pRoot)
+	{
+		Clear();
+
+		if (a_pRoot == NULL || a_pRoot->IsStatic())
+			return 0;
+
+		m_vecLinks.push_back(a_pRoot);
+		m_vecParents.push_back(-1);
+
+		Collect(a_pRoot->GetChild(), 0);
+
+		UINT nLinks = (UINT)m_vecLinks.size();
+
+		m_arrRot.Resize(nLinks);
+		m_arrTwist.Resize(nLinks);
+		m_arrCosRot.Resize(nLinks);
+		m_arrCosTwist.Resize(nLinks);
+		m_arrDisp.Resize(nLinks);
+		m_arrDH.Resize(nLinks);
+		m_arrLocal.Resize(nLinks);
+		m_arrChild.Resize(nLinks);
+
+		m_vecKeys.resize(nLinks);
+		m_arrRotFrom.Resize(nLinks);
+		m_arrTwistFrom.Resize(nLinks);
+		m_arrRotTo.Resize(nLinks);
+		m_arrTwistTo.Resize(nLinks);
+
+		for (UINT i = 0; i < nLinks; ++i)
+			m_vecLinks[i]->m_bSolved = TRUE;
+
+		m_bPosed = FALSE;
+		m_nPhase = s_nSkeletons++ % AnimSystem::MAX_UPDATE_PERIOD;
+
+		AnimSystem::Register(this);
+
+		// the root has to be updated to solve the skeleton the first time
+		a_pRoot->Wake();
+
+		return nLinks;
+	}
+
+	/**
+	*	\brief	Walks a node and its siblings adding every link reached without passing through a transform
+	*	\param	Node* a_pNode - first node to visit, may be NULL
+	*	\param	INT a_nParent - index of the link the nodes hang off
+	*/
+
+	void Skeleton::Collect(Node* a_pNode, INT a_nParent)
+	{
+		for (; a_pNode; a_pNode = a_pNode->GetSibling())
+		{
+			// frozen nodes are no longer updated
+			if (a_pNode->IsStatic())
+				continue;
+
+			if (a_pNode->GetType() == ARTICULATED)
+			{
+				Articulated* pLink = dynamic_cast<Articulated*>(a_pNode);
+
+				// absorb any skeleton built further down
+				if (pLink->m_pSkeleton)
+				{
+					delete pLink->m_pSkeleton;
+					pLink->m_pSkeleton = NULL;
+				}
+
+				INT nLink = (INT)m_vecLinks.size();
+				m_vecLinks.push_back(pLink);
+				m_vecParents.push_back(a_nParent);
+
+				Collect(a_pNode->GetChild(), nLink);
+			}
+			// a transform changes the world matrix in ways the skeleton doesn't know about
+			else if (dynamic_cast<Transform*>(a_pNode) == NULL)
+				Collect(a_pNode->GetChild(), a_nParent);
+		}
+	}
+
+	/**
+	*	\brief	Removes all links and leaves the animation phase
+	*	\note	The links are not touched, see the destructor
+	*/
+
+	void Skeleton::Clear()
+	{
+		AnimSystem::Unregister(this);
+
+		m_vecLinks.clear();
+		m_vecParents.clear();
+		m_arrRot.Clear();
+		m_arrTwist.Clear();
+		m_arrCosRot.Clear();
+		m_arrCosTwist.Clear();
+		m_arrDisp.Clear();
+		m_arrDH.Clear();
+		m_arrLocal.Clear();
+		m_arrChild.Clear();
+		m_vecKeys.clear();
+		m_arrRotFrom.Clear();
+		m_arrTwistFrom.Clear();
+		m_arrRotTo.Clear();
+		m_arrTwistTo.Clear();
+
+		m_fPendingTime = m_fBlendTime = m_fBlendLength = 0.0f;
+		m_bPosed = FALSE;
+		m_bAnimated = FALSE;
+		m_bChanged = FALSE;
+	}
+
+	/**
+	*	\brief	Animates every link and calculates their DH matrices and their matrices relative to the
+	*			root's parent
+	*	\param	FLOAT a_fTimeDiff - time difference since last update call
+	*	\note	Does nothing if the skeleton has already been animated this frame and not solved since. Safe
+	*			to run on several skeletons at once as long as each is only run by one thread. Only notes
+	*			whether any DH matrix changed, WakeChanged() wakes the root link afterwards.
+	*/
+
+	void Skeleton::Animate(FLOAT a_fTimeDiff)
+	{
+		UINT nLinks = (UINT)m_vecLinks.size();
+
+		if (nLinks == 0 || (m_bAnimated && m_nAnimFrame == AnimSystem::GetFrame()))
+			return;
+
+		m_fPendingTime += a_fTimeDiff;
+		m_fBlendTime += a_fTimeDiff;
+
+		// distant skeletons evaluate their animation less often
+		UINT nPeriod = AnimSystem::GetUpdatePeriod(m_vecPosition);
+
+		if (!m_bPosed || AnimSystem::GetFrame() - m_nLastEval >= nPeriod)
+			Evaluate(nPeriod);
+		else
+			AnimSystem::CountJoints(0, 0, nLinks);
+
+		FLOAT fWeight = (m_fBlendTime < m_fBlendLength) ? m_fBlendTime / m_fBlendLength : 1.0f;
+
+		// blend the angles and gather the DH parameters
+		for (UINT i = 0; i < nLinks; ++i)
+		{
+			Articulated* pLink = m_vecLinks[i];
+
+			pLink->m_fRotAngle = m_arrRotFrom[i] + (m_arrRotTo[i] - m_arrRotFrom[i]) * fWeight;
+			pLink->m_fTwistAngle = m_arrTwistFrom[i] + (m_arrTwistTo[i] - m_arrTwistFrom[i]) * fWeight;
+
+			m_arrRot[i] = pLink->m_fRotAngle;
+			m_arrTwist[i] = pLink->m_fTwistAngle;
+			m_arrDisp[i] = pLink->m_fLinkDisplacement;
+		}
+
+		// sines are written over the angles
+		SinCosArray(&m_arrRot[0], &m_arrCosRot[0], &m_arrRot[0], nLinks);
+		SinCosArray(&m_arrTwist[0], &m_arrCosTwist[0], &m_arrTwist[0], nLinks);
+
+		DHMatrixArray(&m_arrDH[0], &m_arrRot[0], &m_arrCosRot[0], &m_arrTwist[0], &m_arrCosTwist[0], &m_arrDisp[0], nLinks);
+
+		BOOL bChanged = FALSE;
+
+		// parents always come before their children so one pass chains the whole skeleton
+		for (UINT i = 0; i < nLinks; ++i)
+		{
+			Articulated* pLink = m_vecLinks[i];
+			INT nParent = m_vecParents[i];
+
+			if (pLink->m_oDHMat != m_arrDH[i])
+				bChanged = TRUE;
+
+			if (nParent < 0)
+				m_arrLocal[i] = m_arrDH[i];
+			else
+				AffineMultiply(&m_arrLocal[i], &m_arrDH[i], &m_arrChild[nParent]);
+
+			pLink->m_oDHMat = m_arrDH[i];
+			pLink->ApplyLinkLength(m_arrLocal[i], m_arrChild[i]);
+		}
+
+		m_bChanged = m_bChanged || bChanged;
+		m_bAnimated = TRUE;
+		m_nAnimFrame = AnimSystem::GetFrame();
+	}
+
+	/**
+	*	\brief	Wakes the root link if the last Animate() changed a DH matrix
+	*	\note	Otherwise the root may sleep and never solve the new pose. Waking writes to the root's
+	*			ancestors, which other skeletons share, so call it from one thread only.
+	*/
+
+	void Skeleton::WakeChanged()
+	{
+		if (m_bChanged && !m_vecLinks.empty())
+			m_vecLinks[0]->Wake();
+
+		m_bChanged = FALSE;
+	}
+
+	/**
+	*	\brief	Places the animated links under the root's parent and writes their world matrices
+	*	\param	FLOAT a_fTimeDiff - time difference since last update call, used if the skeleton hasn't
+	*			been animated this frame
+	*	\param	const AffineMatrix& a_rMatrixParent - world matrix set when the root link is reached
+	*	\note	Links whose world matrix changed are woken so the update pass passes it on to their children
+	*/
+
+	void Skeleton::Solve(FLOAT a_fTimeDiff, const AffineMatrix& a_rMatrixParent)
+	{
+		UINT nLinks = (UINT)m_vecLinks.size();
+
+		if (nLinks == 0)
+			return;
+
+		// without an animation phase this frame the skeleton animates itself
+		Animate(a_fTimeDiff);
+		WakeChanged();
+		m_bAnimated = FALSE;
+
+		// the level of detail of the next frame is chosen from here
+		m_vecPosition = Vector3(a_rMatrixParent.m[0][3], a_rMatrixParent.m[1][3], a_rMatrixParent.m[2][3]);
+
+		for (UINT i = 0; i < nLinks; ++i)
+		{
+			AffineMatrix matWorld;
+			AffineMultiply(&matWorld, &m_arrLocal[i], &a_rMatrixParent);
+
+			Articulated* pLink = m_vecLinks[i];
+			pLink->SetWorldMatrix(matWorld);
+
+			if (pLink->m_bMoved)
+				pLink->Wake();
+		}
+	}
+
+	/**
+	*	\brief	Advances the animation of every link by the time passed since the last evaluation and
+	*			samples or copies the pose they want
+	*	\param	UINT a_nPeriod - frames until the next evaluation, 1 shows the new pose straight away
+	*/
+
+	void Skeleton::Evaluate(UINT a_nPeriod)
+	{
+		UINT nLinks = (UINT)m_vecLinks.size();
+
+		// blend from whatever is being shown now so changing rate never pops
+		if (m_bPosed && a_nPeriod > 1)
+		{
+			FLOAT fWeight = (m_fBlendTime < m_fBlendLength) ? m_fBlendTime / m_fBlendLength : 1.0f;
+
+			for (UINT i = 0; i < nLinks; ++i)
+			{
+				m_arrRotFrom[i] += (m_arrRotTo[i] - m_arrRotFrom[i]) * fWeight;
+				m_arrTwistFrom[i] += (m_arrTwistTo[i] - m_arrTwistFrom[i]) * fWeight;
+			}
+		}
+
+		// advance every link and describe the pose they want
+		for (UINT i = 0; i < nLinks; ++i)
+		{
+			Articulated* pLink = m_vecLinks[i];
+			PoseKey& rKey = m_vecKeys[i];
+
+			if (pLink->AdvanceAnimation(m_fPendingTime))
+			{
+				rKey.m_nClip = pLink->m_nCurrClip;
+				rKey.m_fA = AnimSystem::SnapTime(pLink->m_fTimeOffset, pLink->m_fAnimLength);
+				rKey.m_fB = 0.0f;
+			}
+			else
+			{
+				rKey.m_nClip = AnimLibrary::INVALID_ID;
+				rKey.m_fA = pLink->m_fRotAngle;
+				rKey.m_fB = pLink->m_fTwistAngle;
+			}
+		}
+
+		if (AnimSystem::FindPose(&m_vecKeys[0], nLinks, &m_arrRotTo[0], &m_arrTwistTo[0]))
+		{
+			AnimSystem::CountJoints(0, nLinks, 0);
+		}
+		else
+		{
+			for (UINT i = 0; i < nLinks; ++i)
+			{
+				Articulated* pLink = m_vecLinks[i];
+
+				if (m_vecKeys[i].m_nClip != AnimLibrary::INVALID_ID)
+					pLink->SampleAnimation(m_vecKeys[i].m_fA);
+
+				m_arrRotTo[i] = pLink->m_fRotAngle;
+				m_arrTwistTo[i] = pLink->m_fTwistAngle;
+			}
+
+			AnimSystem::StorePose(&m_vecKeys[0], nLinks, &m_arrRotTo[0], &m_arrTwistTo[0]);
+			AnimSystem::CountJoints(nLinks, 0, 0);
+		}
+
+		if (!m_bPosed || a_nPeriod == 1)
+		{
+			memcpy(&m_arrRotFrom[0], &m_arrRotTo[0], nLinks * sizeof(FLOAT));
+			memcpy(&m_arrTwistFrom[0], &m_arrTwistTo[0], nLinks * sizeof(FLOAT));
+		}
+
+		// the first evaluation is pushed back so skeletons built together don't evaluate together
+		m_nLastEval = AnimSystem::GetFrame() - (m_bPosed ? 0 : m_nPhase);
+		m_fBlendLength = m_fBlendTime;
+		m_fBlendTime = 0.0f;
+		m_fPendingTime = 0.0f;
+		m_bPosed = TRUE;
+	}
+
+	/**
+	*	\brief	Accessor for the number of links
+	*	\return	UINT - number of links collected by Build()
+	*/
+
+	UINT Skeleton::GetNumLinks() const
+	{
+		return (UINT)m_vecLinks.size();
+	}
+
+	/**
+	*	\brief	Calculates a DH matrix, rotation(z, a_fRotAngle) * rotation(x, a_fTwistAngle) * translation(0, 0, a_fDisplacement)
+	*	\param	AffineMatrix* a_pOut - receives the DH matrix
+	*	\param	FLOAT a_fRotAngle - rotation of the x axis around the z axis
+	*	\param	FLOAT a_fTwistAngle - rotation of the z axis around the x axis
+	*	\param	FLOAT a_fDisplacement - length along the z axis
+	*	\return	AffineMatrix* - a_pOut
+	*	\note	Gives exactly the same result as DHMatrixArray()
+	*/
+
+	AffineMatrix* Skeleton::DHMatrix(AffineMatrix* a_pOut, FLOAT a_fRotAngle, FLOAT a_fTwistAngle, FLOAT a_fDisplacement)
+	{
+		FLOAT fSinRot, fCosRot, fSinTwist, fCosTwist;
+
+		ScalarSinCos(&fSinRot, &fCosRot, a_fRotAngle);
+		ScalarSinCos(&fSinTwist, &fCosTwist, a_fTwistAngle);
+
+		return DHMatrixArray(a_pOut, &fSinRot, &fCosRot, &fSinTwist, &fCosTwist, &a_fDisplacement, 1);
+	}
+
+	/**
+	*	\brief	Writes DH matrices directly from the sines and cosines of their angles
+	*	\param	AffineMatrix* a_pOut - receives a_nCount DH matrices
+	*	\param	const FLOAT* a_pSinRot - sines of the rotation angles
+	*	\param	const FLOAT* a_pCosRot - cosines of the rotation angles
+	*	\param	const FLOAT* a_pSinTwist - sines of the twist angles
+	*	\param	const FLOAT* a_pCosTwist - cosines of the twist angles
+	*	\param	const FLOAT* a_pDisplacement - link displacements
+	*	\param	UINT a_nCount - number of matrices
+	*	\return	AffineMatrix* - a_pOut
+	*	\note	With ct, st, ca, sa the cosines and sines of the rotation and twist the DH matrix is
+	*
+	*			|  ct   st*ca   st*sa |
+	*			| -st   ct*ca   ct*sa |	(rows, D3DX convention)
+	*			|  0   -sa      ca    |
+	*			|  0    0       d     |
+	*
+	*			which costs four multiplies instead of two matrix products
+	*/
+
+	AffineMatrix* Skeleton::DHMatrixArray(AffineMatrix* a_pOut, const FLOAT* a_pSinRot, const FLOAT* a_pCosRot,
+										  const FLOAT* a_pSinTwist, const FLOAT* a_pCosTwist, const FLOAT* a_pDisplacement, UINT a_nCount)
+	{
+		for (UINT i = 0; i < a_nCount; ++i)
+		{
+			const FLOAT fST = a_pSinRot[i], fCT = a_pCosRot[i];
+			const FLOAT fSA = a_pSinTwist[i], fCA = a_pCosTwist[i];
+			FLOAT (*m)[4] = a_pOut[i].m;
+
+			// affine storage is transposed, m[c][r] holds row r column c
+			m[0][0] = fCT;			m[0][1] = -fST;			m[0][2] = 0.0f;			m[0][3] = 0.0f;
+			m[1][0] = fST * fCA;	m[1][1] = fCT * fCA;	m[1][2] = -fSA;			m[1][3] = 0.0f;
+			m[2][0] = fST * fSA;	m[2][1] = fCT * fSA;	m[2][2] = fCA;			m[2][3] = a_pDisplacement[i];
+		}
+
+		return a_pOut;
+	}
+}
@@ -0,0 +1,117 @@
+/**
+*	\class		SGLib::Skeleton
+*	\brief		Solves the DH matrices and world matrices of a whole hierarchy of Articulated links at once
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Build() collects the Articulated links below (and including) a root link in the order the update
+*	pass visits them, so every link comes after the link it hangs off. Each frame Animate()
+*
+*		- advances the animation of every link and gathers the rotation angle, twist angle and
+*		  displacement into structure of arrays form
+*		- calculates every sine and cosine with SinCosArray()
+*		- writes each DH matrix directly from its closed form (see DHMatrix())
+*		- chains the matrices from the root down in one pass, offsetting each by its link length
+*
+*	all relative to the matrix the root link is reached with, and then the root link calls Solve() which
+*	multiplies the chained matrices by the parent's world matrix and writes them back, so the links' own
+*	Update() only has to pass the world matrix on to their children.
+*
+*	A skeleton with links registers itself with SGLib::AnimSystem, whose Animate() runs Animate() on
+*	every registered skeleton in parallel with SGLib::JobSystem before the update pass. Animate() only
+*	touches the skeleton and its own links, so the skeletons don't wait on each other except to share
+*	poses. If the animation phase didn't run Solve() animates the skeleton itself.
+*
+*	How often the animation is actually sampled is up to SGLib::AnimSystem. A skeleton evaluated every
+*	N frames blends the angles it shows from the pose it was showing at the last evaluation towards the
+*	pose evaluated, and a pose already evaluated by another skeleton this frame is copied instead of
+*	sampled. The matrices are still solved every frame so the skeleton follows its parent smoothly. As
+*	the animation phase runs before the update pass the distance is measured from where the skeleton was
+*	solved last frame.
+*
+*	Animate() notes when any DH matrix changed and WakeChanged() then wakes the root link, and Solve()
+*	wakes every link whose world matrix changed, so a skeleton holding still drops out of the update pass
+*	with its links. Waking walks up the shared ancestors, so AnimSystem::Animate() calls WakeChanged() on
+*	the calling thread once the parallel loop has finished rather than from the jobs.
+*
+*	Only links that hang off another link (directly or through nodes that don't change the world matrix
+*	such as geometry, shaders and states) are part of the skeleton. A Transform between two links ends the
+*	skeleton at that point and links below it update themselves as before. Build() must be called again
+*	if links are added, removed or frozen.
+*/
+
+#ifndef SGLIB_SKELETON
+#define SGLIB_SKELETON
+
+#pragma once
+
+#include "SGMath.h"
+#include "AnimSystem.h"
+#include <vector>
+
+namespace SGLib
+{
+	class Node;
+	class Articulated;
+
+	class Skeleton
+	{
+	public:
+		Skeleton();
+		~Skeleton();
+
+		UINT	Build		(Articulated* a_pRoot);
+		void	Clear		();
+		void	Animate		(FLOAT a_fTimeDiff);
+		void	Solve		(FLOAT a_fTimeDiff, const AffineMatrix& a_rMatrixParent);
+		void	WakeChanged	();
+
+		UINT	GetNumLinks	() const;
+
+		static AffineMatrix*	DHMatrix		(AffineMatrix* a_pOut, FLOAT a_fRotAngle, FLOAT a_fTwistAngle, FLOAT a_fDisplacement);
+		static AffineMatrix*	DHMatrixArray	(AffineMatrix* a_pOut, const FLOAT* a_pSinRot, const FLOAT* a_pCosRot,
+												 const FLOAT* a_pSinTwist, const FLOAT* a_pCosTwist, const FLOAT* a_pDisplacement, UINT a_nCount);
+
+	protected:
+		std::vector<Articulated*>	m_vecLinks;		///< links in update order
+		std::vector<INT>			m_vecParents;	///< index of the link each link hangs off, -1 for the root
+
+		// structure of arrays gathered from the links each Animate()
+		AlignedArray<FLOAT>			m_arrRot;		///< rotation angles, sines are written over them
+		AlignedArray<FLOAT>			m_arrTwist;		///< twist angles, sines are written over them
+		AlignedArray<FLOAT>			m_arrCosRot;	///< rotation cosines
+		AlignedArray<FLOAT>			m_arrCosTwist;	///< twist cosines
+		AlignedArray<FLOAT>			m_arrDisp;		///< link displacements
+		AlignedArray<AffineMatrix>	m_arrDH;		///< DH matrices
+		AlignedArray<AffineMatrix>	m_arrLocal;		///< matrix of each link relative to the root's parent
+		AlignedArray<AffineMatrix>	m_arrChild;		///< matrix each link leaves set for its children, relative to the root's parent
+		BOOL						m_bAnimated;	///< TRUE from Animate() until the matrices are solved
+		UINT						m_nAnimFrame;	///< frame Animate() last ran on
+		BOOL						m_bChanged;		///< TRUE from an Animate() that changed a DH matrix until WakeChanged()
+
+		// level of detail
+		std::vector<PoseKey>		m_vecKeys;		///< pose wanted by the last evaluation
+		AlignedArray<FLOAT>			m_arrRotFrom;	///< rotation angles shown at the last evaluation
+		AlignedArray<FLOAT>			m_arrTwistFrom;	///< twist angles shown at the last evaluation
+		AlignedArray<FLOAT>			m_arrRotTo;		///< rotation angles of the last evaluation
+		AlignedArray<FLOAT>			m_arrTwistTo;	///< twist angles of the last evaluation
+		FLOAT						m_fPendingTime;	///< time not yet passed on to the links' animations
+		FLOAT						m_fBlendTime;	///< time since the last evaluation
+		FLOAT						m_fBlendLength;	///< time the blend to the last evaluation takes
+		UINT						m_nLastEval;	///< frame of the last evaluation
+		UINT						m_nPhase;		///< frames the first evaluation is pushed back by
+		BOOL						m_bPosed;		///< TRUE once the links have been evaluated
+		Vector3						m_vecPosition;	///< world position the skeleton was last solved at
+
+		static UINT					s_nSkeletons;	///< skeletons built, spreads them across the update period
+
+		void	Collect		(Node* a_pNode, INT a_nParent);
+		void	Evaluate	(UINT a_nPeriod);
+
+	private:
+		Skeleton(const Skeleton&);
+		Skeleton& operator= (const Skeleton&);
+	};
+}
+
+#endif
@@ -0,0 +1,818 @@
+#include "SkinnedGeometry.h"
+#include "Articulated.h"
+#include "AnimSystem.h"
+#include "JobSystem.h"
+#include <cstring>
+
+#if defined(SGLIB_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace SGLib
+{
+	// vertices skinned by each job range
+	static const UINT SKIN_GRAIN = 1024;
+
+	// vertex shader constants the bone palette path needs to be available
+	static const DWORD PALETTE_MIN_CONSTANTS = 256;
+
+	// SkinVertex as seen by the bone palette vertex shader
+	static const D3DVERTEXELEMENT9 s_aSkinDecl[] =
+	{
+		{ 0, 0,  D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+		{ 0, 12, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL, 0 },
+		{ 0, 24, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+		{ 0, 32, D3DDECLTYPE_UBYTE4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_BLENDINDICES, 0 },
+		{ 0, 36, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_BLENDWEIGHT, 0 },
+		D3DDECL_END()
+	};
+
+	// what a job range needs to skin its vertices
+	struct SkinJob
+	{
+		StaticVertex*		pOut;			///< locked vertex buffer
+		const SkinVertex*	pIn;			///< source vertices
+		const AffineMatrix*	pPalette;		///< bone world matrices
+		const AffineMatrix*	pNormalPalette;	///< bone normal matrices
+	};
+
+	/**
+	*	\brief	SkinnedGeometry constructor - the node is empty until Build() is called
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
+	*/
+
+	SkinnedGeometry::SkinnedGeometry(LPDIRECT3DDEVICE9 a_pD3DDevice) :
+										Node(a_pD3DDevice),
+										Geometry(a_pD3DDevice, NULL),
+										m_pSkinnedVB(NULL),
+										m_pStaticVB(NULL),
+										m_pIB(NULL),
+										m_pDecl(NULL),
+										m_b32BitIndices(FALSE),
+										m_bBonePalette(FALSE),
+										m_bPaletteCaps(FALSE),
+										m_nPaletteFrame(0),
+										m_nSkinnedFrame(0),
+										m_bPaletteValid(FALSE),
+										m_bSkinnedValid(FALSE)
+	{
+	}
+
+	/**
+	*	\brief	SkinnedGeometry destructor
+	*	\note	The merged links are not touched and remain invisible
+	*/
+
+	SkinnedGeometry::~SkinnedGeometry(void)
+	{
+		Clear();
+	}
+
+	/**
+	*	\brief	Merges the meshes of a hierarchy of articulated links into this node
+	*	\param	Articulated* a_pRoot - root link, every link below it is searched but not its siblings
+	*	\return	UINT - number of links merged (bones in the palette)
+	*	\post	Merged links are made invisible, any previous contents of the node are discarded
+	*/
+
+	UINT SkinnedGeometry::Build(Articulated* a_pRoot)
+	{
+		Clear();
+
+		if (!a_pRoot)
+			return 0;
+
+		// find every link with a mesh, the bone index is the order found
+		Collect(a_pRoot, FALSE);
+
+		// faces of each batch material, appended to the index buffer in material order afterwards
+		std::vector<std::vector<DWORD> > vecFaces;
+
+		for (UINT i = 0; i < m_vecBones.size(); ++i)
+		{
+			Merge(m_vecBones[i], (unsigned char)i, vecFaces);
+			m_vecBones[i]->SetVisible(FALSE);
+		}
+
+		for (DWORD i = 0; i < (DWORD)vecFaces.size(); ++i)
+		{
+			if (vecFaces[i].empty())
+				continue;
+
+			Range oRange;
+			oRange.dwMat = i;
+			oRange.nFirstIndex = (UINT)m_vecIndices.size();
+			oRange.nNumFaces = (UINT)vecFaces[i].size() / 3;
+
+			DWORD dwMin = 0xFFFFFFFF, dwMax = 0;
+			for (UINT j = 0; j < vecFaces[i].size(); ++j)
+			{
+				dwMin = (vecFaces[i][j] < dwMin) ? vecFaces[i][j] : dwMin;
+				dwMax = (vecFaces[i][j] > dwMax) ? vecFaces[i][j] : dwMax;
+			}
+
+			oRange.nMinVertex = dwMin;
+			oRange.nNumVertices = dwMax - dwMin + 1;
+
+			m_vecIndices.insert(m_vecIndices.end(), vecFaces[i].begin(), vecFaces[i].end());
+			m_vecRanges.push_back(oRange);
+		}
+
+		m_arrPalette.Resize((UINT)m_vecBones.size());
+		m_arrNormalPalette.Resize((UINT)m_vecBones.size());
+
+		// create the textures and buffers
+		OnCreateDevice(m_pD3DDevice);
+		CreateSkinnedBuffer();
+
+		return (UINT)m_vecBones.size();
+	}
+
+	/**
+	*	\brief	Releases all buffers and materials held by the node and forgets its bones
+	*/
+
+	void SkinnedGeometry::Clear()
+	{
+		ReleaseBuffers();
+		ReleaseMaterials();
+
+		m_vecBones.clear();
+		m_vecVertices.clear();
+		m_vecIndices.clear();
+		m_vecRanges.clear();
+		m_arrPalette.Clear();
+		m_arrNormalPalette.Clear();
+		m_arrUpload.Clear();
+		m_vecTexNames.clear();
+		SAFE_DELETE_ARRAY(m_pMaterials);
+		m_dwNumMat = 0;
+
+		m_bPaletteValid = FALSE;
+		m_bSkinnedValid = FALSE;
+	}
+
+	/**
+	*	\brief	Mutator for whether the shader transforms the vertices with the bone palette
+	*	\param	BOOL a_bBonePalette - TRUE to draw the unskinned vertices, FALSE to skin them on the CPU
+	*	\note	The bone palette is only used if UsesBonePalette() agrees
+	*/
+
+	void SkinnedGeometry::SetBonePalette(BOOL a_bBonePalette)
+	{
+		m_bBonePalette = a_bBonePalette;
+		m_bSkinnedValid = FALSE;
+	}
+
+	/**
+	*	\brief	Accessor for whether Render() draws the unskinned vertices for the shader to transform
+	*	\return	BOOL - TRUE if the bone palette path was asked for and the device and bone count allow it
+	*/
+
+	BOOL SkinnedGeometry::UsesBonePalette() const
+	{
+		return m_bBonePalette && m_bPaletteCaps && m_pStaticVB && m_pDecl && m_vecBones.size() <= MAX_PALETTE_BONES;
+	}
+
+	/**
+	*	\brief	Uploads the bone palette to an effect for the bone palette path
+	*	\param	LPD3DXEFFECT a_pEffect - effect drawing this node
+	*	\param	LPCSTR a_sParam - name of the float4x3 (or float4x4) array parameter
+	*	\note	The world matrices are used for normals as well, which is only correct while the bones
+	*			are scaled uniformly
+	*/
+
+	void SkinnedGeometry::SetBoneMatrices(LPD3DXEFFECT a_pEffect, LPCSTR a_sParam)
+	{
+		if (!a_pEffect || m_vecBones.empty())
+			return;
+
+		HRESULT hr;
+
+		UpdatePalette();
+
+		m_arrUpload.Resize(m_arrPalette.Size());
+		for (UINT i = 0; i < m_arrPalette.Size(); ++i)
+			MatrixFromAffine(&m_arrUpload[i], &m_arrPalette[i]);
+
+		V(a_pEffect->SetMatrixArray(a_sParam, m_arrUpload[0].AsD3D(), m_arrUpload.Size()))
+	}
+
+	/**
+	*	\brief	Accessor for number of bones in the palette
+	*	\return	UINT - number of links merged
+	*/
+
+	UINT SkinnedGeometry::GetNumBones() const
+	{
+		return (UINT)m_vecBones.size();
+	}
+
+	/**
+	*	\brief	Accessor for number of vertices in the merged mesh
+	*	\return	UINT - number of vertices skinned each frame
+	*/
+
+	UINT SkinnedGeometry::GetNumVertices() const
+	{
+		return (UINT)m_vecVertices.size();
+	}
+
+	/**
+	*	\brief	Accessor for number of material ranges in the merged mesh
+	*	\return	UINT - draw calls each Render() makes
+	*/
+
+	UINT SkinnedGeometry::GetNumRanges() const
+	{
+		return (UINT)m_vecRanges.size();
+	}
+
+	/**
+	*	\brief	Skins the vertices into the dynamic vertex buffer with the bones' current world matrices
+	*	\note	Only skins once per animation frame (see SGLib::AnimSystem::GetFrame()) however many times
+	*			the node is rendered, so shadow and lighting passes share the result
+	*/
+
+	void SkinnedGeometry::Skin()
+	{
+		if (m_vecVertices.empty() || !m_pSkinnedVB)
+			return;
+
+		UINT nFrame = AnimSystem::GetFrame();
+
+		if (m_bSkinnedValid && m_nSkinnedFrame == nFrame)
+			return;
+
+		UpdatePalette();
+
+		StaticVertex* pOut = NULL;
+
+		if (FAILED(m_pSkinnedVB->Lock(0, 0, (void**)&pOut, D3DLOCK_DISCARD)))
+			return;
+
+		SkinJob oJob;
+		oJob.pOut = pOut;
+		oJob.pIn = &m_vecVertices[0];
+		oJob.pPalette = m_arrPalette.Data();
+		oJob.pNormalPalette = m_arrNormalPalette.Data();
+
+		JobSystem::ParallelFor((UINT)m_vecVertices.size(), SKIN_GRAIN, SkinRange, &oJob);
+
+		m_pSkinnedVB->Unlock();
+
+		m_nSkinnedFrame = nFrame;
+		m_bSkinnedValid = TRUE;
+	}
+
+	/**
+	*	\brief	Renders the merged mesh with one draw call per material
+	*	\pre	Device must point to a valid DIRECT3DDEVICE object
+	*	\note	Leaves the stream source, indices and vertex format set. The previous material and texture
+	*			are restored afterwards.
+	*/
+
+	void SkinnedGeometry::Render()
+	{
+		if (m_vecRanges.empty() || !m_bVisible || !m_pIB)
+			return;
+
+		HRESULT hr;
+
+		if (UsesBonePalette())
+		{
+			V(m_pD3DDevice->SetVertexDeclaration(m_pDecl))
+			V(m_pD3DDevice->SetStreamSource(0, m_pStaticVB, 0, sizeof(SkinVertex)))
+		}
+		else
+		{
+			Skin();
+
+			if (!m_bSkinnedValid)
+				return;
+
+			V(m_pD3DDevice->SetFVF(StaticVertex::FVF))
+			V(m_pD3DDevice->SetStreamSource(0, m_pSkinnedVB, 0, sizeof(StaticVertex)))
+		}
+
+		V(m_pD3DDevice->SetIndices(m_pIB))
+
+		D3DMATERIAL9 PrevMat;
+		LPDIRECT3DBASETEXTURE9 pPrevTex = NULL;
+
+		V(m_pD3DDevice->GetMaterial(&PrevMat))
+		V(m_pD3DDevice->GetTexture(0, &pPrevTex))
+
+		// ranges are unique per material so each one changes it
+		for (UINT i = 0; i < m_vecRanges.size(); ++i)
+		{
+			const Range& rRange = m_vecRanges[i];
+
+			V(m_pD3DDevice->SetMaterial(&m_pMaterials[rRange.dwMat]))
+			V(m_pD3DDevice->SetTexture(0, m_pTextures ? m_pTextures[rRange.dwMat] : NULL))
+
+			V(m_pD3DDevice->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, rRange.nMinVertex, rRange.nNumVertices,
+												 rRange.nFirstIndex, rRange.nNumFaces))
+		}
+
+		// restore previous material and texture
+		V(m_pD3DDevice->SetMaterial(&PrevMat))
+		V(m_pD3DDevice->SetTexture(0, pPrevTex))
+		SAFE_RELEASE(pPrevTex);
+	}
+
+	/**
+	*	\brief	Called when DIRECT3DDEVICE object has been created
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to new DIRECT3DDEVICE
+	*	\note	Recreates the textures and the managed buffers from the system memory copies and checks
+	*			whether the device can run the bone palette path
+	*/
+
+	void SkinnedGeometry::OnCreateDevice(LPDIRECT3DDEVICE9 a_pD3DDevice)
+	{
+		Node::OnCreateDevice(a_pD3DDevice);
+
+		HRESULT hr;
+
+		ReleaseMaterials();
+
+		if (m_dwNumMat)
+		{
+			m_pTextures = new LPDIRECT3DTEXTURE9[m_dwNumMat];
+
+			for (DWORD i = 0; i < m_dwNumMat; ++i)
+			{
+				m_pTextures[i] = NULL;
+
+				if (!m_vecTexNames[i].empty())
+					V(D3DXCreateTextureFromFileA(m_pD3DDevice, m_vecTexNames[i].c_str(), &m_pTextures[i]))
+			}
+		}
+
+		D3DCAPS9 oCaps;
+		memset(&oCaps, 0, sizeof(oCaps));
+		V(m_pD3DDevice->GetDeviceCaps(&oCaps))
+		m_bPaletteCaps = oCaps.MaxVertexShaderConst >= PALETTE_MIN_CONSTANTS;
+
+		CreateBuffers();
+	}
+
+	/**
+	*	\brief	Called when DIRECT3DDEVICE object has been reset
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to DIRECT3DDEVICE
+	*	\note	Recreates the dynamic vertex buffer, which lives in the default pool
+	*/
+
+	void SkinnedGeometry::OnResetDevice(LPDIRECT3DDEVICE9 a_pD3DDevice)
+	{
+		Node::OnResetDevice(a_pD3DDevice);
+
+		CreateSkinnedBuffer();
+	}
+
+	/**
+	*	\brief	Called when DIRECT3DDEVICE object has been lost
+	*	\post	Releases the dynamic vertex buffer
+	*/
+
+	void SkinnedGeometry::OnLostDevice()
+	{
+		Node::OnLostDevice();
+
+		SAFE_RELEASE(m_pSkinnedVB);
+		m_bSkinnedValid = FALSE;
+	}
+
+	/**
+	*	\brief	Called when DIRECT3DDEVICE object has been destroyed
+	*	\post	Releases the textures and buffers, the system memory copies are kept
+	*/
+
+	void SkinnedGeometry::OnDestroyDevice()
+	{
+		Node::OnDestroyDevice();
+
+		ReleaseBuffers();
+		ReleaseMaterials();
+	}
+
+	/**
+	*	\brief	Skins vertices by their weighted bone matrices
+	*	\param	StaticVertex* a_pOut - receives the world space vertices, may be write combined memory
+	*	\param	const SkinVertex* a_pIn - vertices to skin
+	*	\param	const AffineMatrix* a_pPalette - world matrix of each bone
+	*	\param	const AffineMatrix* a_pNormalPalette - inverse transpose of each bone's world matrix
+	*	\param	UINT a_nCount - number of vertices
+	*	\note	Bones with a weight of 0 are skipped so rigid vertices only read one matrix. Each output
+	*			vertex is written once in order and never read back. The SSE2 path makes the same multiplies
+	*			and adds in the same order as the scalar path so the results are identical.
+	*/
+
+	void SkinnedGeometry::SkinVertices(	StaticVertex* a_pOut,
+										const SkinVertex* a_pIn,
+										const AffineMatrix* a_pPalette,
+										const AffineMatrix* a_pNormalPalette,
+										UINT a_nCount)
+	{
+#if defined(SGLIB_SIMD_SSE2)
+		const __m128 vZero = _mm_setzero_ps();
+		const __m128 vOneW = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+		const __m128 vMaskXYZ = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+		for (UINT i = 0; i < a_nCount; ++i)
+		{
+			const SkinVertex& rIn = a_pIn[i];
+
+			// blend the rows of the weighted bone matrices
+			__m128 vR0 = vZero, vR1 = vZero, vR2 = vZero;
+			__m128 vN0 = vZero, vN1 = vZero, vN2 = vZero;
+
+			for (UINT j = 0; j < 4; ++j)
+			{
+				if (rIn.afWeights[j] == 0.0f)
+					continue;
+
+				const __m128 vW = _mm_set1_ps(rIn.afWeights[j]);
+				const AffineMatrix& rM = a_pPalette[rIn.aBones[j]];
+				const AffineMatrix& rN = a_pNormalPalette[rIn.aBones[j]];
+
+				vR0 = _mm_add_ps(vR0, _mm_mul_ps(vW, _mm_load_ps(rM.m[0])));
+				vR1 = _mm_add_ps(vR1, _mm_mul_ps(vW, _mm_load_ps(rM.m[1])));
+				vR2 = _mm_add_ps(vR2, _mm_mul_ps(vW, _mm_load_ps(rM.m[2])));
+				vN0 = _mm_add_ps(vN0, _mm_mul_ps(vW, _mm_load_ps(rN.m[0])));
+				vN1 = _mm_add_ps(vN1, _mm_mul_ps(vW, _mm_load_ps(rN.m[1])));
+				vN2 = _mm_add_ps(vN2, _mm_mul_ps(vW, _mm_load_ps(rN.m[2])));
+			}
+
+			// (x, y, z, 1) and (nx, ny, nz, 0), the fourth float loaded is the next member
+			__m128 vPos = _mm_or_ps(_mm_and_ps(_mm_loadu_ps(&rIn.vecPos.x), vMaskXYZ), vOneW);
+			__m128 vNrm = _mm_and_ps(_mm_loadu_ps(&rIn.vecNormal.x), vMaskXYZ);
+
+			// each row dotted with the vector, summed across by transposing
+			__m128 vP0 = _mm_mul_ps(vR0, vPos), vP1 = _mm_mul_ps(vR1, vPos), vP2 = _mm_mul_ps(vR2, vPos), vP3 = vZero;
+			__m128 vQ0 = _mm_mul_ps(vN0, vNrm), vQ1 = _mm_mul_ps(vN1, vNrm), vQ2 = _mm_mul_ps(vN2, vNrm), vQ3 = vZero;
+
+			_MM_TRANSPOSE4_PS(vP0, vP1, vP2, vP3);
+			_MM_TRANSPOSE4_PS(vQ0, vQ1, vQ2, vQ3);
+
+			__m128 vOutPos = _mm_add_ps(_mm_add_ps(_mm_add_ps(vP0, vP1), vP2), vP3);
+			__m128 vOutNrm = _mm_add_ps(_mm_add_ps(_mm_add_ps(vQ0, vQ1), vQ2), vQ3);
+
+			// renormalise the blended normal
+			__m128 vSq = _mm_mul_ps(vOutNrm, vOutNrm);
+			__m128 vLenSq = _mm_add_ss(_mm_add_ss(vSq, _mm_shuffle_ps(vSq, vSq, _MM_SHUFFLE(1, 1, 1, 1))),
+									   _mm_shuffle_ps(vSq, vSq, _MM_SHUFFLE(2, 2, 2, 2)));
+			__m128 vLen = _mm_sqrt_ss(vLenSq);
+
+			if (_mm_cvtss_f32(vLen) > 0.0f)
+				vOutNrm = _mm_div_ps(vOutNrm, _mm_shuffle_ps(vLen, vLen, _MM_SHUFFLE(0, 0, 0, 0)));
+
+			// (px, py, pz, nx) and (ny, nz, u, v)
+			__m128 vUV = _mm_castpd_ps(_mm_load_sd((const double*)&rIn.fU));
+			__m128 vZX = _mm_shuffle_ps(vOutPos, vOutNrm, _MM_SHUFFLE(0, 0, 2, 2));
+
+			_mm_storeu_ps(&a_pOut[i].vecPos.x, _mm_shuffle_ps(vOutPos, vZX, _MM_SHUFFLE(2, 0, 1, 0)));
+			_mm_storeu_ps(&a_pOut[i].vecNormal.y, _mm_shuffle_ps(vOutNrm, vUV, _MM_SHUFFLE(1, 0, 2, 1)));
+		}
+#else
+		for (UINT i = 0; i < a_nCount; ++i)
+		{
+			const SkinVertex& rIn = a_pIn[i];
+
+			// blend the rows of the weighted bone matrices
+			FLOAT afR[3][4], afN[3][4];
+			memset(afR, 0, sizeof(afR));
+			memset(afN, 0, sizeof(afN));
+
+			for (UINT j = 0; j < 4; ++j)
+			{
+				const FLOAT fW = rIn.afWeights[j];
+
+				if (fW == 0.0f)
+					continue;
+
+				const AffineMatrix& rM = a_pPalette[rIn.aBones[j]];
+				const AffineMatrix& rN = a_pNormalPalette[rIn.aBones[j]];
+
+				for (UINT nRow = 0; nRow < 3; ++nRow)
+				{
+					for (UINT nCol = 0; nCol < 4; ++nCol)
+					{
+						afR[nRow][nCol] = afR[nRow][nCol] + fW * rM.m[nRow][nCol];
+						afN[nRow][nCol] = afN[nRow][nCol] + fW * rN.m[nRow][nCol];
+					}
+				}
+			}
+
+			const Vector3& rPos = rIn.vecPos;
+			const Vector3& rNrm = rIn.vecNormal;
+			FLOAT afPos[3], afNrm[3];
+
+			for (UINT nRow = 0; nRow < 3; ++nRow)
+			{
+				afPos[nRow] = ((afR[nRow][0] * rPos.x + afR[nRow][1] * rPos.y) + afR[nRow][2] * rPos.z) + afR[nRow][3] * 1.0f;
+				afNrm[nRow] = ((afN[nRow][0] * rNrm.x + afN[nRow][1] * rNrm.y) + afN[nRow][2] * rNrm.z) + afN[nRow][3] * 0.0f;
+			}
+
+			// renormalise the blended normal
+			FLOAT fLen = sqrtf((afNrm[0] * afNrm[0] + afNrm[1] * afNrm[1]) + afNrm[2] * afNrm[2]);
+
+			if (fLen > 0.0f)
+			{
+				afNrm[0] /= fLen;
+				afNrm[1] /= fLen;
+				afNrm[2] /= fLen;
+			}
+
+			StaticVertex& rOut = a_pOut[i];
+			rOut.vecPos.x = afPos[0];
+			rOut.vecPos.y = afPos[1];
+			rOut.vecPos.z = afPos[2];
+			rOut.vecNormal.x = afNrm[0];
+			rOut.vecNormal.y = afNrm[1];
+			rOut.vecNormal.z = afNrm[2];
+			rOut.fU = rIn.fU;
+			rOut.fV = rIn.fV;
+		}
+#endif
+	}
+
+	/**
+	*	\brief	Recursively finds the links below a node that have a mesh to merge
+	*	\param	Node* a_pNode - current node, its child is searched as well
+	*	\param	BOOL a_bSiblings - TRUE to search the node's siblings, FALSE for the root
+	*/
+
+	void SkinnedGeometry::Collect(Node* a_pNode, BOOL a_bSiblings)
+	{
+		for (Node* pNode = a_pNode; pNode; pNode = a_bSiblings ? pNode->GetSibling() : NULL)
+		{
+			if (pNode->GetType() == ARTICULATED)
+			{
+				Articulated* pLink = dynamic_cast<Articulated*>(pNode);
+
+				// one byte bone indices limit the palette to 256 links
+				if (pLink && pLink->IsVisible() && pLink->GetMesh() && m_vecBones.size() < 256)
+					m_vecBones.push_back(pLink);
+			}
+
+			if (pNode->GetChild())
+				Collect(pNode->GetChild(), TRUE);
+		}
+	}
+
+	/**
+	*	\brief	Appends a link's mesh to the merged vertices and its faces to the faces of each material
+	*	\param	Articulated* a_pLink - link being merged
+	*	\param	unsigned char a_nBone - palette index of the link
+	*	\param	std::vector<std::vector<DWORD> >& a_rvecFaces - indices of the faces of each batch material
+	*/
+
+	void SkinnedGeometry::Merge(	Articulated* a_pLink,
+									unsigned char a_nBone,
+									std::vector<std::vector<DWORD> >& a_rvecFaces)
+	{
+		HRESULT hr;
+		LPD3DXMESH pSource = a_pLink->GetMesh();
+		LPD3DXMESH pClone = NULL;
+
+		// convert to position, normal and texture coordinates in system memory so it can be read back
+		if (FAILED(pSource->CloneMeshFVF(D3DXMESH_SYSTEMMEM | D3DXMESH_32BIT, StaticVertex::FVF, m_pD3DDevice, &pClone)))
+		{
+			OutputDebugString(L"Warning: SkinnedGeometry failed to clone mesh, link not merged\n");
+			return;
+		}
+
+		if (!(pSource->GetFVF() & D3DFVF_NORMAL))
+			V(D3DXComputeNormals(pClone, NULL))
+
+		DWORD dwNumMat = a_pLink->GetNumMaterials();
+		const D3DMATERIAL9* pMaterials = a_pLink->GetMaterials();
+
+		// map subsets onto the node's unique materials
+		std::vector<DWORD> vecMatRemap(dwNumMat);
+		for (DWORD i = 0; i < dwNumMat; ++i)
+			vecMatRemap[i] = AddMaterial(pMaterials[i], a_pLink->GetTextureName(i));
+
+		if (a_rvecFaces.size() < m_dwNumMat)
+			a_rvecFaces.resize(m_dwNumMat);
+
+		StaticVertex* pVertices = NULL;
+		DWORD* pIndices = NULL;
+		DWORD* pAttributes = NULL;
+		DWORD dwNumVertices = pClone->GetNumVertices();
+		DWORD dwNumFaces = pClone->GetNumFaces();
+		DWORD dwBase = (DWORD)m_vecVertices.size();
+
+		V(pClone->LockVertexBuffer(D3DLOCK_READONLY, (LPVOID*)&pVertices))
+		V(pClone->LockIndexBuffer(D3DLOCK_READONLY, (LPVOID*)&pIndices))
+		V(pClone->LockAttributeBuffer(D3DLOCK_READONLY, &pAttributes))
+
+		// the part is rigid, every vertex follows the link alone
+		SkinVertex oVertex;
+		oVertex.aBones[0] = a_nBone;
+		oVertex.aBones[1] = oVertex.aBones[2] = oVertex.aBones[3] = 0;
+		oVertex.afWeights[0] = 1.0f;
+		oVertex.afWeights[1] = oVertex.afWeights[2] = oVertex.afWeights[3] = 0.0f;
+
+		for (DWORD i = 0; i < dwNumVertices; ++i)
+		{
+			oVertex.vecPos = pVertices[i].vecPos;
+			oVertex.vecNormal = pVertices[i].vecNormal;
+			oVertex.fU = pVertices[i].fU;
+			oVertex.fV = pVertices[i].fV;
+
+			m_vecVertices.push_back(oVertex);
+		}
+
+		for (DWORD i = 0; i < dwNumFaces; ++i)
+		{
+			if (pAttributes[i] >= dwNumMat)
+				continue;
+
+			std::vector<DWORD>& rvecFaces = a_rvecFaces[vecMatRemap[pAttributes[i]]];
+
+			for (UINT j = 0; j < 3; ++j)
+				rvecFaces.push_back(dwBase + pIndices[i * 3 + j]);
+		}
+
+		V(pClone->UnlockAttributeBuffer())
+		V(pClone->UnlockIndexBuffer())
+		V(pClone->UnlockVertexBuffer())
+
+		SAFE_RELEASE(pClone);
+	}
+
+	/**
+	*	\brief	Finds or adds a material and texture pair in the node's material array
+	*	\param	const D3DMATERIAL9& a_rMaterial - material to add
+	*	\param	LPCSTR a_sTexName - texture filename or NULL if untextured
+	*	\return	DWORD - index of the material in m_pMaterials
+	*	\note	Only called during Build(), before the textures are loaded
+	*/
+
+	DWORD SkinnedGeometry::AddMaterial(const D3DMATERIAL9& a_rMaterial, LPCSTR a_sTexName)
+	{
+		std::string sTexName(a_sTexName ? a_sTexName : "");
+
+		for (DWORD i = 0; i < m_dwNumMat; ++i)
+			if (memcmp(&m_pMaterials[i], &a_rMaterial, sizeof(D3DMATERIAL9)) == 0 && m_vecTexNames[i] == sTexName)
+				return i;
+
+		// grow the material array by one
+		D3DMATERIAL9* pMaterials = new D3DMATERIAL9[m_dwNumMat + 1];
+		for (DWORD i = 0; i < m_dwNumMat; ++i)
+			pMaterials[i] = m_pMaterials[i];
+
+		pMaterials[m_dwNumMat] = a_rMaterial;
+
+		SAFE_DELETE_ARRAY(m_pMaterials);
+		m_pMaterials = pMaterials;
+		m_vecTexNames.push_back(sTexName);
+
+		return m_dwNumMat++;
+	}
+
+	/**
+	*	\brief	Gathers the world and normal matrix of every bone, once per animation frame
+	*/
+
+	void SkinnedGeometry::UpdatePalette()
+	{
+		UINT nFrame = AnimSystem::GetFrame();
+
+		if (m_bPaletteValid && m_nPaletteFrame == nFrame)
+			return;
+
+		for (UINT i = 0; i < m_vecBones.size(); ++i)
+		{
+			m_arrPalette[i] = m_vecBones[i]->GetWorldMatrix();
+			m_arrNormalPalette[i] = m_vecBones[i]->GetNormalMatrix();
+		}
+
+		m_nPaletteFrame = nFrame;
+		m_bPaletteValid = TRUE;
+	}
+
+	/**
+	*	\brief	Creates the managed index buffer, the unskinned vertex buffer and the vertex declaration
+	*	\note	32 bit indices are only used when there are more than 65535 vertices
+	*/
+
+	void SkinnedGeometry::CreateBuffers()
+	{
+		ReleaseBuffers();
+
+		if (m_vecIndices.empty())
+			return;
+
+		HRESULT hr;
+		UINT nNumVertices = (UINT)m_vecVertices.size();
+		UINT nNumIndices = (UINT)m_vecIndices.size();
+		LPVOID pData = NULL;
+
+		m_b32BitIndices = nNumVertices > 0xFFFF;
+
+		if (FAILED(m_pD3DDevice->CreateIndexBuffer(nNumIndices * (m_b32BitIndices ? sizeof(DWORD) : sizeof(WORD)), D3DUSAGE_WRITEONLY,
+												   m_b32BitIndices ? D3DFMT_INDEX32 : D3DFMT_INDEX16, D3DPOOL_MANAGED, &m_pIB, NULL)))
+		{
+			OutputDebugString(L"Warning: SkinnedGeometry failed to create index buffer\n");
+			m_pIB = NULL;
+			return;
+		}
+
+		V(m_pIB->Lock(0, 0, &pData, 0))
+		if (m_b32BitIndices)
+		{
+			memcpy(pData, &m_vecIndices[0], nNumIndices * sizeof(DWORD));
+		}
+		else
+		{
+			WORD* pShort = (WORD*)pData;
+			for (UINT i = 0; i < nNumIndices; ++i)
+				pShort[i] = (WORD)m_vecIndices[i];
+		}
+		V(m_pIB->Unlock())
+
+		// the unskinned vertices are only needed by the bone palette path
+		if (!m_bPaletteCaps)
+			return;
+
+		if (FAILED(m_pD3DDevice->CreateVertexBuffer(nNumVertices * sizeof(SkinVertex), D3DUSAGE_WRITEONLY, 0,
+													D3DPOOL_MANAGED, &m_pStaticVB, NULL)) ||
+			FAILED(m_pD3DDevice->CreateVertexDeclaration(s_aSkinDecl, &m_pDecl)))
+		{
+			OutputDebugString(L"Warning: SkinnedGeometry failed to create bone palette buffers, skinning on the CPU\n");
+			SAFE_RELEASE(m_pStaticVB);
+			SAFE_RELEASE(m_pDecl);
+			return;
+		}
+
+		V(m_pStaticVB->Lock(0, 0, &pData, 0))
+		memcpy(pData, &m_vecVertices[0], nNumVertices * sizeof(SkinVertex));
+		V(m_pStaticVB->Unlock())
+	}
+
+	/**
+	*	\brief	Creates the dynamic vertex buffer CPU skinning writes into
+	*	\note	The buffer is in the default pool so it is recreated every time the device is reset
+	*/
+
+	void SkinnedGeometry::CreateSkinnedBuffer()
+	{
+		SAFE_RELEASE(m_pSkinnedVB);
+		m_bSkinnedValid = FALSE;
+
+		if (m_vecVertices.empty())
+			return;
+
+		if (FAILED(m_pD3DDevice->CreateVertexBuffer((UINT)m_vecVertices.size() * sizeof(StaticVertex), D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
+													StaticVertex::FVF, D3DPOOL_DEFAULT, &m_pSkinnedVB, NULL)))
+		{
+			OutputDebugString(L"Warning: SkinnedGeometry failed to create dynamic vertex buffer\n");
+			m_pSkinnedVB = NULL;
+		}
+	}
+
+	/**
+	*	\brief	Releases the vertex and index buffers and the vertex declaration
+	*/
+
+	void SkinnedGeometry::ReleaseBuffers()
+	{
+		SAFE_RELEASE(m_pSkinnedVB);
+		SAFE_RELEASE(m_pStaticVB);
+		SAFE_RELEASE(m_pIB);
+		SAFE_RELEASE(m_pDecl);
+
+		m_bSkinnedValid = FALSE;
+	}
+
+	/**
+	*	\brief	Releases the textures, the materials and texture names are kept
+	*/
+
+	void SkinnedGeometry::ReleaseMaterials()
+	{
+		if (m_pTextures)
+			for (DWORD i = 0; i < m_dwNumMat; ++i)
+				if (m_pTextures[i])
+					SAFE_RELEASE(m_pTextures[i]);
+
+		SAFE_DELETE_ARRAY(m_pTextures);
+	}
+
+	/**
+	*	\brief	Job run on each range of vertices by Skin()
+	*	\param	void* a_pData - the SkinJob
+	*	\param	UINT a_nBegin - first vertex of the range
+	*	\param	UINT a_nEnd - vertex after the last of the range
+	*/
+
+	void SkinnedGeometry::SkinRange(void* a_pData, UINT a_nBegin, UINT a_nEnd)
+	{
+		const SkinJob* pJob = (const SkinJob*)a_pData;
+
+		SkinVertices(pJob->pOut + a_nBegin, pJob->pIn + a_nBegin, pJob->pPalette, pJob->pNormalPalette, a_nEnd - a_nBegin);
+	}
+}
@@ -0,0 +1,134 @@
+/**
+*	\class		SGLib::SkinnedGeometry
+*	\brief		Merges the meshes of an Articulated hierarchy into one skinned mesh drawn with a single call per material
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Build() walks a hierarchy of SGLib::Articulated links and appends the mesh of every visible link to
+*	one vertex and index buffer. Vertices carry up to four bone indices and weights, the bones being the
+*	links themselves. The parts merged from links are rigid, so their vertices stay in the link's space
+*	with the link as their only bone at weight 1 and the palette needs no bind pose. Faces are grouped
+*	by material so the whole character draws in one DrawIndexedPrimitive per unique material (one for a
+*	single texture atlas) instead of one DrawSubset per part. The merged links are made invisible but
+*	keep animating and solving their matrices as before.
+*
+*	The bone palette is the world matrix of each link from the last update. It is applied in one of two
+*	ways -
+*
+*		CPU skinning (default) - once per frame the vertices are transformed by their weighted palette
+*		matrices (SSE2 when available, split across SGLib::JobSystem workers) and written straight into
+*		a dynamic vertex buffer in the SGLib::StaticVertex format, so any shader drawing ordinary
+*		geometry can draw it.
+*
+*		Bone palette (SetBonePalette(TRUE)) - the static vertices, bone indices and weights are drawn as
+*		they are and the shader must transform them, uploading the palette with SetBoneMatrices() and
+*		using a skinned technique. Falls back to CPU skinning if the device has too few vertex shader
+*		constants or there are more than MAX_PALETTE_BONES bones.
+*
+*	Like SGLib::StaticBatch the node renders in world space so it must be placed where the world matrix
+*	is identity, and it should come after the links in the update pass. A CPU copy of the vertices and
+*	indices is kept so the buffers can be recreated when the device is.
+*/
+
+#ifndef SGLIB_SKINNEDGEOMETRY
+#define SGLIB_SKINNEDGEOMETRY
+
+#pragma once
+
+#include "StaticBatch.h"
+#include <vector>
+
+namespace SGLib
+{
+	class Articulated;
+
+	// vertex format of the merged mesh, also the input of the bone palette vertex shader
+	struct SkinVertex
+	{
+		Vector3			vecPos;			///< position in bone space
+		Vector3			vecNormal;		///< normal in bone space
+		FLOAT			fU;				///< texture u coordinate
+		FLOAT			fV;				///< texture v coordinate
+		unsigned char	aBones[4];		///< palette indices
+		FLOAT			afWeights[4];	///< weight of each bone, summing to 1 (unused bones weigh 0)
+	};
+
+	class SkinnedGeometry : public Geometry
+	{
+	public:
+		static const UINT MAX_PALETTE_BONES = 32;	///< bones the bone palette path can upload (g_boneMatrices in the effect)
+
+		SkinnedGeometry(LPDIRECT3DDEVICE9 a_pD3DDevice);
+		~SkinnedGeometry(void);
+
+	protected:
+		// indices drawn with one material
+		struct Range
+		{
+			DWORD	dwMat;			///< index into the material array
+			UINT	nFirstIndex;	///< first index in the index buffer
+			UINT	nNumFaces;		///< number of triangles
+			UINT	nMinVertex;		///< lowest vertex referenced
+			UINT	nNumVertices;	///< span of vertices referenced
+		};
+
+		std::vector<Articulated*>		m_vecBones;			///< links whose world matrices form the palette
+		std::vector<SkinVertex>			m_vecVertices;		///< system memory copy of the vertices
+		std::vector<DWORD>				m_vecIndices;		///< system memory copy of the indices, grouped by material
+		std::vector<Range>				m_vecRanges;		///< index ranges sorted by material
+
+		AlignedArray<AffineMatrix>		m_arrPalette;		///< world matrix of each bone
+		AlignedArray<AffineMatrix>		m_arrNormalPalette;	///< inverse transpose of each bone's world matrix
+		AlignedArray<Matrix>			m_arrUpload;		///< palette expanded for SetBoneMatrices()
+
+		LPDIRECT3DVERTEXBUFFER9			m_pSkinnedVB;		///< dynamic buffer written by CPU skinning
+		LPDIRECT3DVERTEXBUFFER9			m_pStaticVB;		///< unskinned vertices for the bone palette path
+		LPDIRECT3DINDEXBUFFER9			m_pIB;				///< index buffer shared by both paths
+		LPDIRECT3DVERTEXDECLARATION9	m_pDecl;			///< declaration of SkinVertex
+		BOOL							m_b32BitIndices;	///< TRUE if there are more than 65535 vertices
+
+		BOOL							m_bBonePalette;		///< TRUE if the bone palette path was asked for
+		BOOL							m_bPaletteCaps;		///< TRUE if the device has enough constants for it
+		UINT							m_nPaletteFrame;	///< animation frame the palette was gathered on
+		UINT							m_nSkinnedFrame;	///< animation frame the vertex buffer was skinned on
+		BOOL							m_bPaletteValid;	///< FALSE until the palette has been gathered
+		BOOL							m_bSkinnedValid;	///< FALSE when the vertex buffer has to be skinned
+
+	public:
+		UINT	Build(Articulated* a_pRoot);
+		void	Clear();
+
+		void	SetBonePalette(BOOL a_bBonePalette);
+		BOOL	UsesBonePalette() const;
+		void	SetBoneMatrices(LPD3DXEFFECT a_pEffect, LPCSTR a_sParam);
+
+		UINT	GetNumBones() const;
+		UINT	GetNumVertices() const;
+		UINT	GetNumRanges() const;
+
+		void	Skin();
+		void	Render();
+
+		void	OnCreateDevice(LPDIRECT3DDEVICE9 a_pD3DDevice);
+		void	OnResetDevice(LPDIRECT3DDEVICE9 a_pD3DDevice);
+		void	OnLostDevice();
+		void	OnDestroyDevice();
+
+		static void	SkinVertices(StaticVertex* a_pOut, const SkinVertex* a_pIn, const AffineMatrix* a_pPalette,
+								 const AffineMatrix* a_pNormalPalette, UINT a_nCount);
+
+	protected:
+		void	Collect(Node* a_pNode, BOOL a_bSiblings);
+		void	Merge(Articulated* a_pLink, unsigned char a_nBone, std::vector<std::vector<DWORD> >& a_rvecFaces);
+		DWORD	AddMaterial(const D3DMATERIAL9& a_rMaterial, LPCSTR a_sTexName);
+		void	UpdatePalette();
+		void	CreateBuffers();
+		void	CreateSkinnedBuffer();
+		void	ReleaseBuffers();
+		void	ReleaseMaterials();
+
+		static void	SkinRange(void* a_pData, UINT a_nBegin, UINT a_nEnd);
+	};
+}
+
+#endif
@@ -14,7 +14,8 @@
 
 #pragma once
 
-#include "node.h"
+#include "dxstdafx.h"
+#include "Node.h"
 #include <vector>
 
 namespace SGLib
@@ -0,0 +1,504 @@
+#include "StaticBatch.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace SGLib
+{
+	/**
+	*	\brief	StaticBatch constructor - the batch is empty until Build() is called
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
+	*	\param	FLOAT a_fCellSize - width and depth of the world space grid cells chunks are split on
+	*/
+
+	StaticBatch::StaticBatch(	LPDIRECT3DDEVICE9 a_pD3DDevice,
+								FLOAT a_fCellSize) :
+									Node(a_pD3DDevice),
+									Geometry(a_pD3DDevice, NULL),
+									m_fCellSize(a_fCellSize),
+									m_nDrawn(0)
+	{
+		if (m_fCellSize <= 0.0f)
+			m_fCellSize = 500.0f;
+	}
+
+	/**
+	*	\brief	StaticBatch destructor
+	*	\note	The merged source nodes are not touched and remain invisible
+	*/
+
+	StaticBatch::~StaticBatch(void)
+	{
+		Clear();
+	}
+
+	/**
+	*	\brief	Merges all static, visible geometry in a node hierarchy into this batch
+	*	\param	Node* a_pRoot - first node of the hierarchy to search, its siblings are searched as well
+	*	\param	const Matrix& a_rMatrixWorld - world matrix in effect at a_pRoot
+	*	\return	UINT - number of geometry nodes merged
+	*	\pre	The hierarchy has been frozen with SGLib::Node::Freeze()
+	*	\post	Merged nodes are made invisible, any previous contents of the batch are discarded
+	*/
+
+	UINT StaticBatch::Build(Node* a_pRoot, const Matrix& a_rMatrixWorld)
+	{
+		Clear();
+
+		if (!a_pRoot)
+			return 0;
+
+		// find all geometry that can be merged along with its world matrix
+		std::vector<Geometry*> vecGeometry;
+		AlignedArray<AffineMatrix> arrWorld;
+		Collect(a_pRoot, AffineMatrix(a_rMatrixWorld), vecGeometry, arrWorld);
+
+		// merge each piece of geometry into the chunks
+		std::map<ChunkKey, UINT> mapChunks;
+
+		for (UINT i = 0; i < vecGeometry.size(); ++i)
+		{
+			Merge(vecGeometry[i], arrWorld[i], mapChunks);
+			vecGeometry[i]->SetVisible(FALSE);
+		}
+
+		// order chunks by material (map is sorted on material first) so Render() switches state least
+		std::vector<Chunk> vecSorted(mapChunks.size());
+		UINT nChunk = 0;
+
+		for (std::map<ChunkKey, UINT>::iterator it = mapChunks.begin(); it != mapChunks.end(); ++it, ++nChunk)
+		{
+			Chunk& rChunk = m_vecChunks[it->second];
+
+			vecSorted[nChunk].dwMat = rChunk.dwMat;
+			vecSorted[nChunk].vecMin = rChunk.vecMin;
+			vecSorted[nChunk].vecMax = rChunk.vecMax;
+			vecSorted[nChunk].vecVertices.swap(rChunk.vecVertices);
+			vecSorted[nChunk].vecIndices.swap(rChunk.vecIndices);
+			vecSorted[nChunk].pMesh = NULL;
+		}
+
+		m_vecChunks.swap(vecSorted);
+
+		// create the textures and meshes
+		OnCreateDevice(m_pD3DDevice);
+
+		return (UINT)vecGeometry.size();
+	}
+
+	/**
+	*	\brief	Releases all chunks and materials held by the batch
+	*/
+
+	void StaticBatch::Clear()
+	{
+		ReleaseMeshes();
+		ReleaseMaterials();
+
+		m_vecChunks.clear();
+		m_vecTexNames.clear();
+		SAFE_DELETE_ARRAY(m_pMaterials);
+		m_dwNumMat = 0;
+		m_nDrawn = 0;
+	}
+
+	/**
+	*	\brief	Accessor for number of chunks in the batch
+	*	\return	UINT - number of chunks (one draw call each)
+	*/
+
+	UINT StaticBatch::GetNumChunks() const
+	{
+		return (UINT)m_vecChunks.size();
+	}
+
+	/**
+	*	\brief	Accessor for number of chunks that passed frustum culling in the last Render() call
+	*	\return	UINT - number of chunks drawn
+	*/
+
+	UINT StaticBatch::GetNumDrawn() const
+	{
+		return m_nDrawn;
+	}
+
+	/**
+	*	\brief	Renders every chunk whose bounding box intersects the view frustum
+	*	\pre	Device must point to a valid DIRECT3DDEVICE object
+	*	\note	Material and texture are only set when they change between chunks. The previous material
+	*			and texture are restored afterwards.
+	*/
+
+	void StaticBatch::Render()
+	{
+		m_nDrawn = 0;
+
+		if (m_vecChunks.empty() || !m_bVisible)
+			return;
+
+		HRESULT hr;
+		Matrix oMatWorld, oMatView, oMatProj, oMatClip;
+
+		V(m_pD3DDevice->GetTransform(D3DTS_WORLD, oMatWorld.AsD3D()))
+		V(m_pD3DDevice->GetTransform(D3DTS_VIEW, oMatView.AsD3D()))
+		V(m_pD3DDevice->GetTransform(D3DTS_PROJECTION, oMatProj.AsD3D()))
+
+		MatrixMultiply(&oMatClip, &oMatWorld, &oMatView);
+		MatrixMultiply(&oMatClip, &oMatClip, &oMatProj);
+
+		Frustum oFrustum;
+		FrustumFromMatrix(&oFrustum, &oMatClip);
+
+		D3DMATERIAL9 PrevMat;
+		LPDIRECT3DBASETEXTURE9 pPrevTex = NULL;
+		DWORD dwCurrentMat = m_dwNumMat;
+
+		V(m_pD3DDevice->GetMaterial(&PrevMat))
+		V(m_pD3DDevice->GetTexture(0, &pPrevTex))
+
+		for (UINT i = 0; i < m_vecChunks.size(); ++i)
+		{
+			Chunk& rChunk = m_vecChunks[i];
+
+			if (!rChunk.pMesh)
+				continue;
+
+			if (!FrustumTestAABB(&oFrustum, &rChunk.vecMin, &rChunk.vecMax))
+				continue;
+
+			// chunks are sorted by material so this only changes once per material
+			if (rChunk.dwMat != dwCurrentMat)
+			{
+				dwCurrentMat = rChunk.dwMat;
+
+				V(m_pD3DDevice->SetMaterial(&m_pMaterials[dwCurrentMat]))
+				V(m_pD3DDevice->SetTexture(0, m_pTextures ? m_pTextures[dwCurrentMat] : NULL))
+			}
+
+			V(rChunk.pMesh->DrawSubset(0))
+			++m_nDrawn;
+		}
+
+		// restore previous material and texture
+		V(m_pD3DDevice->SetMaterial(&PrevMat))
+		V(m_pD3DDevice->SetTexture(0, pPrevTex))
+		SAFE_RELEASE(pPrevTex);
+	}
+
+	/**
+	*	\brief	Called when DIRECT3DDEVICE object has been created
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to new DIRECT3DDEVICE
+	*	\note	Recreates the textures and chunk meshes from the system memory copies
+	*/
+
+	void StaticBatch::OnCreateDevice(LPDIRECT3DDEVICE9 a_pD3DDevice)
+	{
+		Node::OnCreateDevice(a_pD3DDevice);
+
+		HRESULT hr;
+
+		ReleaseMaterials();
+
+		if (m_dwNumMat)
+		{
+			m_pTextures = new LPDIRECT3DTEXTURE9[m_dwNumMat];
+
+			for (DWORD i = 0; i < m_dwNumMat; ++i)
+			{
+				m_pTextures[i] = NULL;
+
+				if (!m_vecTexNames[i].empty())
+					V(D3DXCreateTextureFromFileA(m_pD3DDevice, m_vecTexNames[i].c_str(), &m_pTextures[i]))
+			}
+		}
+
+		CreateMeshes();
+	}
+
+	/**
+	*	\brief	Called when DIRECT3DDEVICE object has been destroyed
+	*	\post	Releases the textures and chunk meshes, the system memory copies are kept
+	*/
+
+	void StaticBatch::OnDestroyDevice()
+	{
+		Node::OnDestroyDevice();
+
+		ReleaseMeshes();
+		ReleaseMaterials();
+	}
+
+	/**
+	*	\brief	Recursively finds the geometry nodes in a hierarchy that can be merged
+	*	\param	Node* a_pNode - current node, its child and sibling are also searched
+	*	\param	const AffineMatrix& a_rMatrixWorld - world matrix in effect at a_pNode
+	*	\param	std::vector<Geometry*>& a_rvecGeometry - receives the geometry found
+	*	\param	AlignedArray<AffineMatrix>& a_rarrWorld - receives the world matrix of each piece of geometry
+	*/
+
+	void StaticBatch::Collect(	Node* a_pNode,
+								const AffineMatrix& a_rMatrixWorld,
+								std::vector<Geometry*>& a_rvecGeometry,
+								AlignedArray<AffineMatrix>& a_rarrWorld)
+	{
+		// siblings share the same parent world so walk them iteratively
+		for (Node* pNode = a_pNode; pNode; pNode = pNode->GetSibling())
+		{
+			if (pNode->GetType() == GEOMETRY && pNode->IsStatic() && pNode != this)
+			{
+				Geometry* pGeometry = dynamic_cast<Geometry*>(pNode);
+
+				// only plain geometry with a mesh (never another batch)
+				if (pGeometry && !dynamic_cast<StaticBatch*>(pNode) &&
+					pGeometry->IsVisible() && pGeometry->GetMesh())
+				{
+					a_rvecGeometry.push_back(pGeometry);
+					a_rarrWorld.PushBack(a_rMatrixWorld);
+				}
+			}
+
+			if (pNode->GetChild())
+			{
+				AffineMatrix oMatChild;
+				pNode->CalculateChildWorld(a_rMatrixWorld, oMatChild);
+				Collect(pNode->GetChild(), oMatChild, a_rvecGeometry, a_rarrWorld);
+			}
+		}
+	}
+
+	/**
+	*	\brief	Transforms a geometry node's mesh into world space and adds its faces to the chunks
+	*	\param	Geometry* a_pGeometry - geometry being merged
+	*	\param	const AffineMatrix& a_rMatrixWorld - world matrix of the geometry
+	*	\param	std::map<ChunkKey, UINT>& a_rmapChunks - maps chunk keys to indices into m_vecChunks
+	*	\note	Faces are assigned to a grid cell by their centroid so chunk bounds may overlap slightly
+	*/
+
+	void StaticBatch::Merge(	Geometry* a_pGeometry,
+								const AffineMatrix& a_rMatrixWorld,
+								std::map<ChunkKey, UINT>& a_rmapChunks)
+	{
+		HRESULT hr;
+		LPD3DXMESH pSource = a_pGeometry->GetMesh();
+		LPD3DXMESH pClone = NULL;
+
+		// convert to the batch vertex format in system memory so it can be read back
+		if (FAILED(pSource->CloneMeshFVF(D3DXMESH_SYSTEMMEM | D3DXMESH_32BIT, StaticVertex::FVF, m_pD3DDevice, &pClone)))
+		{
+			OutputDebugString(L"Warning: StaticBatch failed to clone mesh, geometry not merged\n");
+			return;
+		}
+
+		if (!(pSource->GetFVF() & D3DFVF_NORMAL))
+			V(D3DXComputeNormals(pClone, NULL))
+
+		DWORD dwNumMat = a_pGeometry->GetNumMaterials();
+		const D3DMATERIAL9* pMaterials = a_pGeometry->GetMaterials();
+
+		// map subsets onto the batch's unique materials
+		std::vector<DWORD> vecMatRemap(dwNumMat);
+		for (DWORD i = 0; i < dwNumMat; ++i)
+			vecMatRemap[i] = AddMaterial(pMaterials[i], a_pGeometry->GetTextureName(i));
+
+		// normals are transformed by the inverse transpose so non uniform scales keep them perpendicular
+		Matrix oMatWorld, oMatNormal;
+		MatrixFromAffine(&oMatWorld, &a_rMatrixWorld);
+		MatrixInverse(&oMatNormal, NULL, &oMatWorld);
+		MatrixTranspose(&oMatNormal, &oMatNormal);
+
+		StaticVertex* pVertices = NULL;
+		DWORD* pIndices = NULL;
+		DWORD* pAttributes = NULL;
+		DWORD dwNumVertices = pClone->GetNumVertices();
+		DWORD dwNumFaces = pClone->GetNumFaces();
+
+		V(pClone->LockVertexBuffer(D3DLOCK_READONLY, (LPVOID*)&pVertices))
+		V(pClone->LockIndexBuffer(D3DLOCK_READONLY, (LPVOID*)&pIndices))
+		V(pClone->LockAttributeBuffer(D3DLOCK_READONLY, &pAttributes))
+
+		// transform all vertices once up front
+		std::vector<StaticVertex> vecWorld(dwNumVertices);
+		for (DWORD i = 0; i < dwNumVertices; ++i)
+		{
+			vecWorld[i] = pVertices[i];
+			Vec3TransformCoord(&vecWorld[i].vecPos, &pVertices[i].vecPos, &oMatWorld);
+			Vec3TransformNormal(&vecWorld[i].vecNormal, &pVertices[i].vecNormal, &oMatNormal);
+			Vec3Normalize(&vecWorld[i].vecNormal, &vecWorld[i].vecNormal);
+		}
+
+		// source vertex index -> chunk vertex index, per chunk touched by this mesh
+		std::map<UINT, std::vector<DWORD> > mapRemap;
+
+		for (DWORD i = 0; i < dwNumFaces; ++i)
+		{
+			if (pAttributes[i] >= dwNumMat)
+				continue;
+
+			const DWORD* pFace = &pIndices[i * 3];
+
+			Vector3 vecCentre = (vecWorld[pFace[0]].vecPos + vecWorld[pFace[1]].vecPos + vecWorld[pFace[2]].vecPos) / 3.0f;
+
+			ChunkKey oKey;
+			oKey.dwMat = vecMatRemap[pAttributes[i]];
+			oKey.nCellX = (INT)floorf(vecCentre.x / m_fCellSize);
+			oKey.nCellZ = (INT)floorf(vecCentre.z / m_fCellSize);
+
+			// find or create the chunk for this face
+			std::map<ChunkKey, UINT>::iterator itChunk = a_rmapChunks.find(oKey);
+			if (itChunk == a_rmapChunks.end())
+			{
+				Chunk oChunk;
+				oChunk.dwMat = oKey.dwMat;
+				oChunk.vecMin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+				oChunk.vecMax = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+				oChunk.pMesh = NULL;
+
+				m_vecChunks.push_back(oChunk);
+				itChunk = a_rmapChunks.insert(std::make_pair(oKey, (UINT)m_vecChunks.size() - 1)).first;
+			}
+
+			Chunk& rChunk = m_vecChunks[itChunk->second];
+			std::vector<DWORD>& rvecRemap = mapRemap[itChunk->second];
+
+			if (rvecRemap.empty())
+				rvecRemap.resize(dwNumVertices, 0xFFFFFFFF);
+
+			for (UINT j = 0; j < 3; ++j)
+			{
+				DWORD dwIndex = pFace[j];
+
+				// add each vertex to a chunk only once
+				if (rvecRemap[dwIndex] == 0xFFFFFFFF)
+				{
+					const StaticVertex& rVertex = vecWorld[dwIndex];
+
+					rvecRemap[dwIndex] = (DWORD)rChunk.vecVertices.size();
+					rChunk.vecVertices.push_back(rVertex);
+
+					Vec3Minimize(&rChunk.vecMin, &rChunk.vecMin, &rVertex.vecPos);
+					Vec3Maximize(&rChunk.vecMax, &rChunk.vecMax, &rVertex.vecPos);
+				}
+
+				rChunk.vecIndices.push_back(rvecRemap[dwIndex]);
+			}
+		}
+
+		V(pClone->UnlockAttributeBuffer())
+		V(pClone->UnlockIndexBuffer())
+		V(pClone->UnlockVertexBuffer())
+
+		SAFE_RELEASE(pClone);
+	}
+
+	/**
+	*	\brief	Finds or adds a material and texture pair in the batch's material array
+	*	\param	const D3DMATERIAL9& a_rMaterial - material to add
+	*	\param	LPCSTR a_sTexName - texture filename or NULL if untextured
+	*	\return	DWORD - index of the material in m_pMaterials
+	*	\note	Only called during Build(), before the textures are loaded
+	*/
+
+	DWORD StaticBatch::AddMaterial(const D3DMATERIAL9& a_rMaterial, LPCSTR a_sTexName)
+	{
+		std::string sTexName(a_sTexName ? a_sTexName : "");
+
+		for (DWORD i = 0; i < m_dwNumMat; ++i)
+			if (memcmp(&m_pMaterials[i], &a_rMaterial, sizeof(D3DMATERIAL9)) == 0 && m_vecTexNames[i] == sTexName)
+				return i;
+
+		// grow the material array by one
+		D3DMATERIAL9* pMaterials = new D3DMATERIAL9[m_dwNumMat + 1];
+		for (DWORD i = 0; i < m_dwNumMat; ++i)
+			pMaterials[i] = m_pMaterials[i];
+
+		pMaterials[m_dwNumMat] = a_rMaterial;
+
+		SAFE_DELETE_ARRAY(m_pMaterials);
+		m_pMaterials = pMaterials;
+		m_vecTexNames.push_back(sTexName);
+
+		return m_dwNumMat++;
+	}
+
+	/**
+	*	\brief	Creates a managed mesh for each chunk from its system memory copy
+	*	\note	32 bit indices are only used for chunks with more than 65535 vertices
+	*/
+
+	void StaticBatch::CreateMeshes()
+	{
+		HRESULT hr;
+
+		for (UINT i = 0; i < m_vecChunks.size(); ++i)
+		{
+			Chunk& rChunk = m_vecChunks[i];
+
+			SAFE_RELEASE(rChunk.pMesh);
+
+			DWORD dwNumVertices = (DWORD)rChunk.vecVertices.size();
+			DWORD dwNumFaces = (DWORD)rChunk.vecIndices.size() / 3;
+			BOOL b32Bit = dwNumVertices > 0xFFFF;
+
+			if (!dwNumFaces)
+				continue;
+
+			if (FAILED(D3DXCreateMeshFVF(dwNumFaces, dwNumVertices, D3DXMESH_MANAGED | (b32Bit ? D3DXMESH_32BIT : 0),
+										StaticVertex::FVF, m_pD3DDevice, &rChunk.pMesh)))
+			{
+				OutputDebugString(L"Warning: StaticBatch failed to create chunk mesh\n");
+				rChunk.pMesh = NULL;
+				continue;
+			}
+
+			LPVOID pVertices = NULL;
+			LPVOID pIndices = NULL;
+			DWORD* pAttributes = NULL;
+
+			V(rChunk.pMesh->LockVertexBuffer(0, &pVertices))
+			memcpy(pVertices, &rChunk.vecVertices[0], dwNumVertices * sizeof(StaticVertex));
+			V(rChunk.pMesh->UnlockVertexBuffer())
+
+			V(rChunk.pMesh->LockIndexBuffer(0, &pIndices))
+			if (b32Bit)
+			{
+				memcpy(pIndices, &rChunk.vecIndices[0], rChunk.vecIndices.size() * sizeof(DWORD));
+			}
+			else
+			{
+				WORD* pShort = (WORD*)pIndices;
+				for (UINT j = 0; j < rChunk.vecIndices.size(); ++j)
+					pShort[j] = (WORD)rChunk.vecIndices[j];
+			}
+			V(rChunk.pMesh->UnlockIndexBuffer())
+
+			// the whole chunk is a single subset
+			V(rChunk.pMesh->LockAttributeBuffer(0, &pAttributes))
+			memset(pAttributes, 0, dwNumFaces * sizeof(DWORD));
+			V(rChunk.pMesh->UnlockAttributeBuffer())
+		}
+	}
+
+	/**
+	*	\brief	Releases the chunk meshes
+	*/
+
+	void StaticBatch::ReleaseMeshes()
+	{
+		for (UINT i = 0; i < m_vecChunks.size(); ++i)
+			SAFE_RELEASE(m_vecChunks[i].pMesh);
+	}
+
+	/**
+	*	\brief	Releases the textures, the materials and texture names are kept
+	*/
+
+	void StaticBatch::ReleaseMaterials()
+	{
+		if (m_pTextures)
+			for (DWORD i = 0; i < m_dwNumMat; ++i)
+				if (m_pTextures[i])
+					SAFE_RELEASE(m_pTextures[i]);
+
+		SAFE_DELETE_ARRAY(m_pTextures);
+	}
+}
@@ -0,0 +1,103 @@
+/**
+*	\class		SGLib::StaticBatch
+*	\brief		Merges static geometry into world space meshes grouped by material and region
+*	\date		19/10/26
+*	\version	1.0
+*
+*	Every visible, static (see SGLib::Node::Freeze()) Geometry node found by Build() is transformed into
+*	world space and its faces are appended to a chunk keyed on material, texture and the grid cell the
+*	face falls in. Each chunk becomes a single mesh so the draw calls, material switches and texture binds
+*	for static scenery drop from one per mesh subset to one per material per cell. Chunks keep a world
+*	space bounding box and are frustum culled in Render(), so the cell size controls the trade off between
+*	draw calls and culling accuracy.
+*
+*	Merged source nodes are made invisible. The batch renders in world space so it must be placed where
+*	the world matrix is identity. A CPU copy of each chunk is kept so the meshes can be recreated in
+*	OnCreateDevice() without walking the source nodes again.
+*/
+
+#ifndef SGLIB_STATICBATCH
+#define SGLIB_STATICBATCH
+
+#pragma once
+
+#include "Geometry.h"
+#include <vector>
+#include <map>
+#include <string>
+
+namespace SGLib
+{
+	// vertex format used by merged chunks
+	struct StaticVertex
+	{
+		Vector3		vecPos;		///< world space position
+		Vector3		vecNormal;	///< world space normal
+		FLOAT		fU;			///< texture u coordinate
+		FLOAT		fV;			///< texture v coordinate
+
+		static const DWORD FVF = D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1;
+	};
+
+	class StaticBatch : public Geometry
+	{
+	public:
+		StaticBatch(LPDIRECT3DDEVICE9 a_pD3DDevice, FLOAT a_fCellSize = 500.0f);
+		~StaticBatch(void);
+
+	protected:
+		// key used to group faces into chunks
+		struct ChunkKey
+		{
+			DWORD	dwMat;		///< index into the batch's material array
+			INT		nCellX;		///< grid cell along the x axis
+			INT		nCellZ;		///< grid cell along the z axis
+
+			bool operator< (const ChunkKey& a_rKey) const
+			{
+				if (dwMat != a_rKey.dwMat)
+					return dwMat < a_rKey.dwMat;
+				if (nCellX != a_rKey.nCellX)
+					return nCellX < a_rKey.nCellX;
+				return nCellZ < a_rKey.nCellZ;
+			}
+		};
+
+		// a single draw call worth of merged geometry
+		struct Chunk
+		{
+			DWORD						dwMat;			///< index into the batch's material array
+			Vector3						vecMin;			///< world space bounding box minimum
+			Vector3						vecMax;			///< world space bounding box maximum
+			std::vector<StaticVertex>	vecVertices;	///< system memory copy of the vertices
+			std::vector<DWORD>			vecIndices;		///< system memory copy of the indices
+			LPD3DXMESH					pMesh;			///< mesh created from the vertices and indices
+		};
+
+		FLOAT				m_fCellSize;	///< width and depth of the grid cells chunks are split on
+		std::vector<Chunk>	m_vecChunks;	///< chunks sorted by material
+		UINT				m_nDrawn;		///< number of chunks drawn in the last Render() call
+
+	public:
+		UINT	Build(Node* a_pRoot, const Matrix& a_rMatrixWorld);
+		void	Clear();
+
+		UINT	GetNumChunks() const;
+		UINT	GetNumDrawn() const;
+
+		void	Render();
+
+		void	OnCreateDevice(LPDIRECT3DDEVICE9 a_pD3DDevice);
+		void	OnDestroyDevice();
+
+	protected:
+		void	Collect(Node* a_pNode, const AffineMatrix& a_rMatrixWorld, std::vector<Geometry*>& a_rvecGeometry, AlignedArray<AffineMatrix>& a_rarrWorld);
+		void	Merge(Geometry* a_pGeometry, const AffineMatrix& a_rMatrixWorld, std::map<ChunkKey, UINT>& a_rmapChunks);
+		DWORD	AddMaterial(const D3DMATERIAL9& a_rMaterial, LPCSTR a_sTexName);
+		void	CreateMeshes();
+		void	ReleaseMeshes();
+		void	ReleaseMaterials();
+	};
+}
+
+#endif
@@ -0,0 +1,160 @@
+//====================================================================
+// AnimLibraryTest.cpp
+// Checks that compressed clips stay within the maximum error and
+// reports how much smaller they are than their keys
+// Date 19/10/26
+//====================================================================
+
+#include "AnimLibrary.h"
+#include "TestUtil.h"
+#include <cmath>
+
+using namespace SGLib;
+using namespace SGLibTest;
+
+namespace
+{
+	const FLOAT PI = 3.141592654f;
+
+	// the walk of the Enlightened demo's character, hand keyed every half second
+	void AddWalkClips(std::vector<AnimContainer>& a_rvecClips)
+	{
+		const FLOAT afRot[7][5] =
+		{
+			{ PI/20, -PI/25, PI/20, PI/6, PI/20 },
+			{ PI/20, PI/6, PI/20, -PI/25, PI/20 },
+			{ PI/15, PI/6, PI/15, -PI/10, PI/15 },
+			{ PI/15, -PI/10, PI/15, PI/6, PI/15 },
+			{ -PI/13, -PI/50, -PI/13, -PI/6, -PI/13 },
+			{ -PI/13, -PI/6, -PI/13, -PI/50, -PI/13 },
+			{ -PI/24, -PI/20, -PI/24, -PI/20, -PI/24 }
+		};
+		const FLOAT afTwist[7] = { -PI/15, PI/15, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+		for (UINT c = 0; c < 7; ++c)
+		{
+			std::vector<TimeStep> vecRot, vecTwist;
+
+			for (UINT k = 0; k < 5; ++k)
+				vecRot.push_back(TimeStep(k * 0.5f, afRot[c][k]));
+			vecTwist.push_back(TimeStep(0.0f, afTwist[c]));
+
+			a_rvecClips.push_back(AnimContainer(vecRot, vecTwist));
+		}
+	}
+
+	// one track sampled from motion capture like data, a couple of sines that stop for a hold part way
+	void MakeTrack(Random& a_rRandom, FLOAT a_fRate, FLOAT a_fLength, FLOAT a_fHoldMin, FLOAT a_fHoldMax, std::vector<TimeStep>& a_rvecKeys)
+	{
+		FLOAT fAmp1 = a_rRandom.Uniform(0.1f, 0.6f), fFreq1 = a_rRandom.Uniform(0.15f, 0.6f), fPhase1 = a_rRandom.Uniform(0.0f, 2.0f * PI);
+		FLOAT fAmp2 = a_rRandom.Uniform(0.02f, 0.15f), fFreq2 = a_rRandom.Uniform(0.5f, 1.25f), fPhase2 = a_rRandom.Uniform(0.0f, 2.0f * PI);
+		FLOAT fHoldStart = a_rRandom.Uniform(0.5f, 1.5f);
+		FLOAT fHoldEnd = fHoldStart + a_rRandom.Uniform(a_fHoldMin, a_fHoldMax);
+
+		UINT nKeys = (UINT)(a_fLength * a_fRate) + 1;
+
+		for (UINT i = 0; i < nKeys; ++i)
+		{
+			FLOAT fTime = i / a_fRate;
+			FLOAT fMotion = (fTime < fHoldStart) ? fTime : ((fTime < fHoldEnd) ? fHoldStart : fTime - (fHoldEnd - fHoldStart));
+
+			a_rvecKeys.push_back(TimeStep(fTime, fAmp1 * sinf(2.0f * PI * fFreq1 * fMotion + fPhase1) + fAmp2 * sinf(2.0f * PI * fFreq2 * fMotion + fPhase2)));
+		}
+	}
+
+	// 40 joints with their rotation and twist keyed together
+	void AddCaptureClips(std::vector<AnimContainer>& a_rvecClips, UINT a_nSeed, FLOAT a_fRate, FLOAT a_fLength, FLOAT a_fHoldMin, FLOAT a_fHoldMax)
+	{
+		Random oRandom(a_nSeed);
+
+		for (UINT j = 0; j < 40; ++j)
+		{
+			std::vector<TimeStep> vecRot, vecTwist;
+
+			MakeTrack(oRandom, a_fRate, a_fLength, a_fHoldMin, a_fHoldMax, vecRot);
+			MakeTrack(oRandom, a_fRate, a_fLength, a_fHoldMin, a_fHoldMax, vecTwist);
+
+			a_rvecClips.push_back(AnimContainer(vecRot, vecTwist));
+		}
+	}
+
+	// largest difference between a clip and its keys, at every key and eight times between each pair
+	FLOAT ClipError(UINT a_nClip, const AnimContainer& a_rAnim)
+	{
+		FLOAT fError = 0.0f;
+		AnimCursor oCursor;
+		UINT nRotKey = 0, nTwistKey = 0;
+		const std::vector<TimeStep>& rvecRot = a_rAnim.m_vecRot;
+		const std::vector<TimeStep>& rvecTwist = a_rAnim.m_vecTwist;
+
+		for (UINT i = 0; i < rvecRot.size(); ++i)
+		{
+			FLOAT fStart = rvecRot[i].m_fTime;
+			FLOAT fEnd = (i + 1 < rvecRot.size()) ? rvecRot[i + 1].m_fTime : fStart;
+
+			for (UINT s = 0; s < 8; ++s)
+			{
+				FLOAT fTime = fStart + (fEnd - fStart) * s / 8.0f;
+				FLOAT fRot, fTwist;
+
+				AnimLibrary::SampleClip(a_nClip, fTime, oCursor, fRot, fTwist);
+
+				FLOAT fRotDiff = (FLOAT)fabs(fRot - SampleKeys(&rvecRot[0], (UINT)rvecRot.size(), fTime, nRotKey));
+				FLOAT fTwistDiff = (FLOAT)fabs(fTwist - SampleKeys(&rvecTwist[0], (UINT)rvecTwist.size(), fTime, nTwistKey));
+
+				fError = (fRotDiff > fError) ? fRotDiff : fError;
+				fError = (fTwistDiff > fError) ? fTwistDiff : fError;
+			}
+		}
+
+		return fError;
+	}
+
+	// adds a set of clips to an empty library and returns how many times smaller they became
+	double Compress(const char* a_sName, const std::vector<AnimContainer>& a_rvecClips)
+	{
+		AnimLibrary::Clear();
+
+		FLOAT fError = 0.0f;
+
+		for (UINT i = 0; i < a_rvecClips.size(); ++i)
+		{
+			// limits wide enough that nothing is clamped
+			UINT nClip = AnimLibrary::AddClip(a_rvecClips[i], -PI, PI, -PI, PI);
+			FLOAT fClipError = ClipError(nClip, a_rvecClips[i]);
+
+			fError = (fClipError > fError) ? fClipError : fError;
+		}
+
+		double fRatio = (double)AnimLibrary::GetSourceBytes() / AnimLibrary::GetMemoryUsed();
+
+		printf("%-26s %6u bytes -> %6u bytes %6.2fx, error %.4f\n", a_sName, AnimLibrary::GetSourceBytes(), AnimLibrary::GetMemoryUsed(), fRatio, fError);
+
+		// a little over the maximum for the float rounding of sampling itself
+		CHECK(fError <= AnimLibrary::GetMaxError() * 1.01f);
+
+		return fRatio;
+	}
+}
+
+int main()
+{
+	std::vector<AnimContainer> vecWalk, vecCapture, vecHolds;
+
+	AddWalkClips(vecWalk);
+
+	// 30 Hz with holds of up to a second and 60 Hz with holds of several, the long gap beside dense
+	// keys that the block splitting is for
+	AddCaptureClips(vecCapture, 7, 30.0f, 4.0f, 0.4f, 1.2f);
+	AddCaptureClips(vecHolds, 11, 60.0f, 6.0f, 2.0f, 4.0f);
+
+	// hand keyed clips have nothing to drop, see AnimLibrary.h
+	Compress("demo walk", vecWalk);
+
+	CHECK(Compress("30 Hz capture", vecCapture) >= 4.0);
+	CHECK(Compress("60 Hz capture, long holds", vecHolds) >= 4.0);
+
+	AnimLibrary::Clear();
+
+	return Failures() ? 1 : 0;
+}
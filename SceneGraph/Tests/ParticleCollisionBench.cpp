@@ -0,0 +1,192 @@
+//====================================================================
+// ParticleCollisionBench.cpp
+// Times ParticleCollider on 500k particles falling onto a terrain
+// among a thousand spheres and boxes
+// Date 19/10/26
+//====================================================================
+//
+// Usage: ParticleCollisionBench [scale]
+//
+// scale multiplies the number of particles and frames, ctest runs it with a
+// small one. The collide cost per particle is printed at a quarter, half
+// and all of the particles so it can be seen to stay flat, and every frame
+// checks that no particle was left under the terrain. An empty field is
+// checked first, as one whose loading failed.
+
+#include "ParticleCollider.h"
+#include "TestUtil.h"
+#include <cmath>
+#include <cstdlib>
+
+using namespace SGLib;
+using namespace SGLibTest;
+
+namespace
+{
+	const UINT		PARTICLES = 500000;
+	const UINT		FRAMES = 60;
+	const FLOAT		TIME_STEP = 1.0f / 60.0f;
+	const UINT		FIELD_SIZE = 257;		///< samples along each side of the terrain
+	const FLOAT		FIELD_CELL = 1.0f;
+	const FLOAT		FIELD_HEIGHT = 3.0f;	///< highest hill
+	const FLOAT		SPREAD = 120.0f;		///< particles and colliders lie within +-SPREAD on x and z
+
+	// rolling hills centred on the origin
+	void MakeTerrain(Heightfield& a_rField)
+	{
+		AlignedArray<FLOAT> arrHeights(FIELD_SIZE * FIELD_SIZE);
+
+		for (UINT z = 0; z < FIELD_SIZE; ++z)
+			for (UINT x = 0; x < FIELD_SIZE; ++x)
+				arrHeights[z * FIELD_SIZE + x] = FIELD_HEIGHT * 0.5f * (1.0f + sinf(x * 0.11f) * cosf(z * 0.07f));
+
+		FLOAT fHalf = (FIELD_SIZE - 1) * FIELD_CELL * 0.5f;
+		a_rField.Create(arrHeights.Data(), FIELD_SIZE, FIELD_SIZE, Vector3(-fHalf, 0.0f, -fHalf), FIELD_CELL);
+	}
+
+	// spheres and boxes held clear of the hills, so pushing a particle out of them never sinks it into the ground
+	void MakeColliders(ParticleCollider& a_rCollider, const Heightfield* a_pField, Random& a_rRandom)
+	{
+		a_rCollider.AddHeightfield(a_pField, ParticleCollider::RESPONSE_BOUNCE, 0.4f, 0.2f);
+
+		for (UINT i = 0; i < 800; ++i)
+		{
+			Vector3 vecCentre(a_rRandom.Uniform(-SPREAD, SPREAD), a_rRandom.Uniform(8.0f, 20.0f), a_rRandom.Uniform(-SPREAD, SPREAD));
+			a_rCollider.AddSphere(vecCentre, a_rRandom.Uniform(1.0f, 3.0f));
+		}
+
+		for (UINT i = 0; i < 200; ++i)
+		{
+			Vector3 vecMin(a_rRandom.Uniform(-SPREAD, SPREAD), a_rRandom.Uniform(5.0f, 15.0f), a_rRandom.Uniform(-SPREAD, SPREAD));
+			Vector3 vecSize(a_rRandom.Uniform(1.0f, 6.0f), a_rRandom.Uniform(1.0f, 6.0f), a_rRandom.Uniform(1.0f, 6.0f));
+
+			// one box in four kills what touches it
+			ParticleCollider::Response eResponse = (i % 4 == 0) ? ParticleCollider::RESPONSE_KILL : ParticleCollider::RESPONSE_BOUNCE;
+			a_rCollider.AddBox(vecMin, vecMin + vecSize, eResponse);
+		}
+
+		a_rCollider.Build();
+	}
+
+	void Spawn(ParticleStore& a_rStore, UINT a_nCount, Random& a_rRandom)
+	{
+		UINT nFirst;
+		UINT nAdded = a_rStore.Allocate(a_nCount, &nFirst);
+
+		for (UINT i = nFirst; i < nFirst + nAdded; ++i)
+		{
+			Vector3 vecPos(a_rRandom.Uniform(-SPREAD, SPREAD), a_rRandom.Uniform(5.0f, 30.0f), a_rRandom.Uniform(-SPREAD, SPREAD));
+			Vector3 vecVel(a_rRandom.Uniform(-3.0f, 3.0f), a_rRandom.Uniform(-2.0f, 4.0f), a_rRandom.Uniform(-3.0f, 3.0f));
+
+			a_rStore.Set(i, vecPos, vecVel, 0.0f, 1e6f, 0.1f, 1.0f, 0xffffffff);
+		}
+	}
+
+	// particles under the terrain by more than rounding
+	UINT CountUnderground(const ParticleStore& a_rStore, const Heightfield& a_rField)
+	{
+		const FLOAT* pPos[3] = { a_rStore.GetStream(ParticleStore::POS_X), a_rStore.GetStream(ParticleStore::POS_Y), a_rStore.GetStream(ParticleStore::POS_Z) };
+		UINT nUnder = 0;
+
+		for (UINT i = 0; i < a_rStore.GetNumAlive(); ++i)
+		{
+			FLOAT fHeight;
+
+			if (a_rField.GetHeight(pPos[0][i], pPos[2][i], &fHeight) && pPos[1][i] < fHeight - 1e-3f)
+				++nUnder;
+		}
+
+		return nUnder;
+	}
+
+	void Run(UINT a_nParticles, UINT a_nFrames, const ParticleCollider& a_rCollider, const Heightfield& a_rField)
+	{
+		Random oRandom(a_nParticles);
+		ParticleStore oStore;
+		AlignedArray<UINT> arrDead(a_nParticles);
+		Vector3 vecGravity(0.0f, -9.8f, 0.0f);
+
+		oStore.Resize(a_nParticles);
+		Spawn(oStore, a_nParticles, oRandom);
+
+		double fIntegrate = 0.0, fCollide = 0.0;
+		UINT nKilled = 0, nUnder = 0;
+
+		for (UINT nFrame = 0; nFrame < a_nFrames; ++nFrame)
+		{
+			double fStart = Seconds();
+			UINT nDead = oStore.IntegrateRange(0, oStore.GetNumAlive(), TIME_STEP, vecGravity, arrDead.Data());
+			double fMoved = Seconds();
+			UINT nAllDead = a_rCollider.Collide(oStore, 0, oStore.GetNumAlive(), NULL, NULL, arrDead.Data(), nDead);
+			double fEnd = Seconds();
+
+			fIntegrate += fMoved - fStart;
+			fCollide += fEnd - fMoved;
+
+			oStore.KillSlots(arrDead.Data(), nAllDead);
+			nKilled += nAllDead - nDead;
+			nUnder += CountUnderground(oStore, a_rField);
+
+			// keep the count up so every frame collides the same number
+			Spawn(oStore, a_nParticles - oStore.GetNumAlive(), oRandom);
+		}
+
+		double fPerFrame = 1e3 / a_nFrames;
+		double fPerParticle = 1e9 / ((double)a_nFrames * a_nParticles);
+
+		printf("%8u particles  integrate %7.2f ms  collide %7.2f ms a frame  %6.1f ns a particle  %u killed\n",
+			   a_nParticles, fIntegrate * fPerFrame, fCollide * fPerFrame, fCollide * fPerParticle, nKilled);
+
+		CHECK(nUnder == 0);
+	}
+
+	// a field whose Create() failed has no height anywhere, and a collider refuses it
+	void TestEmptyField()
+	{
+		Heightfield oEmpty;
+		FLOAT fHeight = 0.0f;
+		Vector3 vecNormal;
+
+		CHECK(oEmpty.IsEmpty());
+		CHECK(!oEmpty.GetHeight(5.0f, 5.0f, &fHeight));
+		CHECK(!oEmpty.GetNormal(5.0f, 5.0f, &vecNormal));
+
+		FLOAT afHeights[2] = { 1.0f, 2.0f };
+		oEmpty.Create(afHeights, 2, 1, Vector3(0.0f, 0.0f, 0.0f), 1.0f);
+
+		CHECK(oEmpty.IsEmpty());
+		CHECK(!oEmpty.GetHeight(0.5f, 0.0f, &fHeight));
+
+		ParticleCollider oCollider;
+		CHECK(oCollider.AddHeightfield(&oEmpty) == ParticleCollider::NO_COLLIDER);
+		CHECK(oCollider.AddHeightfield(NULL) == ParticleCollider::NO_COLLIDER);
+		CHECK(oCollider.GetNumColliders() == 0);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double fScale = (argc > 1) ? atof(argv[1]) : 1.0;
+	UINT nParticles = (UINT)(PARTICLES * fScale);
+	UINT nFrames = (UINT)(FRAMES * fScale);
+
+	nParticles = (nParticles > 1000) ? nParticles : 1000;
+	nFrames = (nFrames > 4) ? nFrames : 4;
+
+	TestEmptyField();
+
+	Random oRandom(2024);
+	Heightfield oField;
+	ParticleCollider oCollider(8.0f);
+
+	MakeTerrain(oField);
+	MakeColliders(oCollider, &oField, oRandom);
+
+	printf("%u colliders, one thread\n", oCollider.GetNumColliders());
+
+	Run(nParticles / 4, nFrames, oCollider, oField);
+	Run(nParticles / 2, nFrames, oCollider, oField);
+	Run(nParticles, nFrames, oCollider, oField);
+
+	return Failures() ? 1 : 0;
+}
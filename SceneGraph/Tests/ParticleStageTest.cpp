@@ -0,0 +1,171 @@
+//====================================================================
+// ParticleStageTest.cpp
+// Checks that ParticleStage writes the same vertices, byte for byte,
+// whether it runs on the calling thread alone or across workers
+// Date 19/10/26
+//====================================================================
+
+#include "ParticleSimulation.h"
+#include "ParticleStage.h"
+#include "JobSystem.h"
+#include "TestUtil.h"
+#include <cstring>
+
+using namespace SGLib;
+using namespace SGLibTest;
+
+namespace
+{
+	const UINT	FRAMES = 90;
+
+	// sprays particles up from the origin, every stream written for the whole range at once
+	class Fountain : public ParticleSimulation
+	{
+	public:
+		Fountain(INT a_nMaxParticles, FLOAT a_fRate, UINT a_nSeed) :
+			ParticleSimulation(Vector3(0.0f, -9.8f, 0.0f), a_nMaxParticles, 1.0f / a_fRate),
+			m_nSimulated(0)
+		{
+			m_oEmitter.SetSeed(a_nSeed);
+		}
+
+		UINT	m_nSimulated;	///< calls to OnSimulated()
+
+		void InitParticles(UINT a_nFirst, UINT a_nCount)
+		{
+			FLOAT* pPosX = m_oParticles.GetStream(ParticleStore::POS_X) + a_nFirst;
+			FLOAT* pPosY = m_oParticles.GetStream(ParticleStore::POS_Y) + a_nFirst;
+			FLOAT* pPosZ = m_oParticles.GetStream(ParticleStore::POS_Z) + a_nFirst;
+			FLOAT* pVelX = m_oParticles.GetStream(ParticleStore::VEL_X) + a_nFirst;
+			FLOAT* pVelY = m_oParticles.GetStream(ParticleStore::VEL_Y) + a_nFirst;
+			FLOAT* pVelZ = m_oParticles.GetStream(ParticleStore::VEL_Z) + a_nFirst;
+			UINT* pColours = m_oParticles.GetColours() + a_nFirst;
+
+			m_oEmitter.Uniform(pPosX, a_nCount, -0.5f, 0.5f);
+			m_oEmitter.Uniform(pPosY, a_nCount, 0.0f, 0.5f);
+			m_oEmitter.Uniform(pPosZ, a_nCount, -0.5f, 0.5f);
+			m_oEmitter.UniformDirections(pVelX, pVelY, pVelZ, a_nCount, 4.0f, 9.0f);
+			m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::LIFE) + a_nFirst, a_nCount, 1.0f, 3.0f);
+			m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::SIZE) + a_nFirst, a_nCount, 0.05f, 0.2f);
+			m_oEmitter.Uniform(m_oParticles.GetStream(ParticleStore::MASS) + a_nFirst, a_nCount, 0.5f, 2.0f);
+
+			FLOAT* pAge = m_oParticles.GetStream(ParticleStore::AGE) + a_nFirst;
+
+			for (UINT i = 0; i < a_nCount; ++i)
+			{
+				pVelY[i] = (pVelY[i] > 0.0f) ? pVelY[i] : -pVelY[i];
+				pAge[i] = 0.0f;
+				pColours[i] = 0xff000000 | (a_nFirst + i);
+			}
+		}
+
+	protected:
+		void OnSimulated()
+		{
+			++m_nSimulated;
+		}
+	};
+
+	// adds the vertices of every system to a running FNV-1a hash
+	void HashVertices(Fountain* const* a_ppSystems, UINT a_nSystems, unsigned long long& a_rnHash)
+	{
+		for (UINT s = 0; s < a_nSystems; ++s)
+		{
+			const BYTE* pBytes = reinterpret_cast<const BYTE*>(a_ppSystems[s]->GetVertices());
+			UINT nBytes = a_ppSystems[s]->GetNumVertices() * sizeof(ParticleVertex);
+
+			for (UINT i = 0; i < nBytes; ++i)
+				a_rnHash = (a_rnHash ^ pBytes[i]) * 1099511628211ULL;
+		}
+	}
+
+	// runs the same three systems with a pool of a_nWorkers and returns the hash of every frame's vertices
+	void RunScene(UINT a_nWorkers, std::vector<unsigned long long>& a_rvecHashes, UINT& a_rnVertices)
+	{
+		JobSystem::Init(a_nWorkers);
+
+		ParticleCollider oCollider;
+		oCollider.AddPlane(Plane(0.0f, 1.0f, 0.0f, 0.0f), ParticleCollider::RESPONSE_BOUNCE, 0.5f, 0.1f);
+		oCollider.AddSphere(Vector3(1.0f, 3.0f, 0.0f), 1.0f, ParticleCollider::RESPONSE_KILL);
+
+		// one large enough to be cut into many chunks, one sorted under a rotated, moved world matrix
+		// and one that only bursts
+		Fountain oLarge(60000, 30000.0f, 11);
+		Fountain oSorted(12000, 4000.0f, 12);
+		Fountain oBursts(8000, 0.0f, 13);
+		Fountain* apSystems[3] = { &oLarge, &oSorted, &oBursts };
+
+		oLarge.SetCollider(&oCollider);
+		oSorted.SetCollider(&oCollider);
+		oSorted.SetSortMode(ParticleSort::SORT_INCREMENTAL);
+		oBursts.GetEmitter().AddBurst(0.1f, 5000);
+		oBursts.GetEmitter().AddBurst(0.8f, 3000);
+
+		AffineMatrix oIdentity, oSortedWorld, oTranslation;
+		AffineIdentity(&oIdentity);
+		AffineRotationY(&oSortedWorld, 0.7f);
+		AffineTranslation(&oTranslation, 2.0f, 0.5f, -1.0f);
+		AffineMultiply(&oSortedWorld, &oSortedWorld, &oTranslation);
+
+		ParticleStage::SetView(Vector3(0.0f, 2.0f, -10.0f), Vector3(0.0f, 0.0f, 1.0f));
+
+		a_rvecHashes.clear();
+		a_rnVertices = 0;
+
+		for (UINT nFrame = 0; nFrame < FRAMES; ++nFrame)
+		{
+			// uneven steps, as a real frame rate gives
+			FLOAT fTimeDiff = (nFrame % 3 == 0) ? 0.02f : 0.015f;
+
+			oLarge.Step(fTimeDiff, oIdentity);
+			oSorted.Step(fTimeDiff, oSortedWorld);
+			oBursts.Step(fTimeDiff, oIdentity);
+
+			ParticleStage::Run();
+
+			unsigned long long nHash = 14695981039346656037ULL;
+			HashVertices(apSystems, 3, nHash);
+			a_rvecHashes.push_back(nHash);
+
+			for (UINT s = 0; s < 3; ++s)
+				a_rnVertices += apSystems[s]->GetNumVertices();
+		}
+
+		// every system stepped every frame hears about it once
+		CHECK(oLarge.m_nSimulated == FRAMES);
+		CHECK(oSorted.m_nSimulated == FRAMES);
+		CHECK(oSorted.GetSort().GetNumSorted() == oSorted.GetNumVertices());
+
+		JobSystem::Shutdown();
+	}
+}
+
+int main()
+{
+	std::vector<unsigned long long> vecSerial, vecParallel;
+	UINT nSerialVertices, nParallelVertices;
+
+	RunScene(0, vecSerial, nSerialVertices);
+	printf("no workers:    %u vertices over %u frames\n", nSerialVertices, FRAMES);
+
+	CHECK(nSerialVertices > 0);
+
+	const UINT anWorkers[] = { 1, 3, 7 };
+
+	for (UINT w = 0; w < sizeof(anWorkers) / sizeof(anWorkers[0]); ++w)
+	{
+		RunScene(anWorkers[w], vecParallel, nParallelVertices);
+
+		UINT nSame = 0;
+
+		for (UINT i = 0; i < FRAMES; ++i)
+			nSame += (vecParallel[i] == vecSerial[i]) ? 1 : 0;
+
+		printf("%u workers:     %u vertices, %u of %u frames identical\n", anWorkers[w], nParallelVertices, nSame, FRAMES);
+
+		CHECK(nParallelVertices == nSerialVertices);
+		CHECK(nSame == FRAMES);
+	}
+
+	return Failures() ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+//====================================================================
+// ParticleVertexTest.cpp
+// Checks that particles written as ParticleVertex decode back to
+// within the format's precision, and that widening them for devices
+// without half floats keeps every value
+// Date 19/10/26
+//====================================================================
+
+#include "ParticleSimulation.h"
+#include "ParticleStage.h"
+#include "JobSystem.h"
+#include "TestUtil.h"
+#include <cmath>
+#include <cstring>
+
+using namespace SGLib;
+using namespace SGLibTest;
+
+namespace
+{
+	// fills particles one at a time through the default InitParticles(), spread over a wide box
+	class Spray : public ParticleSimulation
+	{
+	public:
+		Spray() : ParticleSimulation(Vector3(0.0f, -9.8f, 0.0f), 5000, 1.0f / 4000.0f), m_oRandom(5) {}
+
+		void InitParticle(Particle* a_pPart)
+		{
+			a_pPart->vecInitPos = Vector3(m_oRandom.Uniform(-40.0f, 60.0f), m_oRandom.Uniform(0.0f, 5.0f), m_oRandom.Uniform(-3.0f, 3.0f));
+			a_pPart->vecInitVec = Vector3(m_oRandom.Uniform(-20.0f, 20.0f), m_oRandom.Uniform(0.0f, 30.0f), m_oRandom.Uniform(-0.01f, 0.01f));
+			a_pPart->fInitSize = m_oRandom.Uniform(0.1f, 4.0f);
+			a_pPart->fLifeTime = m_oRandom.Uniform(0.5f, 2.0f);
+			a_pPart->fMass = m_oRandom.Uniform(0.001f, 100.0f);
+			a_pPart->colInitial = 0x80000000 | (DWORD)m_oRandom.Uniform(0.0f, 16777215.0f);
+		}
+
+	protected:
+		Random	m_oRandom;
+	};
+
+	// half floats keep 11 significant bits, values below their smallest normal are kept to 2^-24
+	BOOL HalfClose(FLOAT a_fDecoded, FLOAT a_fValue)
+	{
+		return fabsf(a_fDecoded - a_fValue) <= fabsf(a_fValue) * (1.0f / 2048.0f) + 6e-8f;
+	}
+
+	void TestDecode(const Spray& a_rSpray)
+	{
+		const ParticleStore& rStore = a_rSpray.GetParticles();
+		const ParticleVertex* pVertices = a_rSpray.GetVertices();
+
+		Vector3 vecMin, vecMax;
+		a_rSpray.GetBounds(&vecMin, &vecMax);
+
+		// half an integer step along each axis, and of the size
+		Vector3 vecStep = (vecMax - vecMin) * (0.5f / 65534.0f);
+		FLOAT fMaxSize = 0.0f;
+
+		for (UINT i = 0; i < rStore.GetNumAlive(); ++i)
+			fMaxSize = (rStore.GetStream(ParticleStore::SIZE)[i] > fMaxSize) ? rStore.GetStream(ParticleStore::SIZE)[i] : fMaxSize;
+
+		FLOAT fSizeStep = fMaxSize * (0.5f / 32767.0f);
+		UINT nBad[6] = { 0, 0, 0, 0, 0, 0 };
+
+		for (UINT i = 0; i < a_rSpray.GetNumVertices(); ++i)
+		{
+			Particle oPart;
+			a_rSpray.DecodeVertex(pVertices[i], &oPart);
+
+			const FLOAT* pfPos = &oPart.vecInitPos.x;
+			const FLOAT* pfStep = &vecStep.x;
+			const FLOAT* pfVel = &oPart.vecInitVec.x;
+
+			for (UINT nAxis = 0; nAxis < 3; ++nAxis)
+			{
+				// a little over half a step for the rounding of the offset and scale themselves
+				if (fabsf(pfPos[nAxis] - rStore.GetStream((ParticleStore::Stream)(ParticleStore::POS_X + nAxis))[i]) > pfStep[nAxis] * 1.01f + 1e-5f)
+					++nBad[0];
+
+				if (!HalfClose(pfVel[nAxis], rStore.GetStream((ParticleStore::Stream)(ParticleStore::VEL_X + nAxis))[i]))
+					++nBad[1];
+			}
+
+			if (fabsf(oPart.fInitSize - rStore.GetStream(ParticleStore::SIZE)[i]) > fSizeStep * 1.01f + 1e-6f)
+				++nBad[2];
+
+			if (!HalfClose(oPart.fMass, rStore.GetStream(ParticleStore::MASS)[i]))
+				++nBad[3];
+
+			// the time decodes as the system's time less the age
+			if (!HalfClose(const_cast<Spray&>(a_rSpray).GetTime() - oPart.fInitTime, rStore.GetStream(ParticleStore::AGE)[i]) ||
+				!HalfClose(oPart.fLifeTime, rStore.GetStream(ParticleStore::LIFE)[i]))
+				++nBad[4];
+
+			if (oPart.colInitial != rStore.GetColours()[i])
+				++nBad[5];
+		}
+
+		printf("%u vertices decoded, %u %u %u %u %u %u outside the precision (position, velocity, size, mass, times, colour)\n",
+			   a_rSpray.GetNumVertices(), nBad[0], nBad[1], nBad[2], nBad[3], nBad[4], nBad[5]);
+
+		CHECK(a_rSpray.GetNumVertices() > 1000);
+		CHECK(nBad[0] == 0 && nBad[1] == 0 && nBad[2] == 0);
+		CHECK(nBad[3] == 0 && nBad[4] == 0 && nBad[5] == 0);
+	}
+
+	void TestWiden(const Spray& a_rSpray)
+	{
+		UINT nCount = a_rSpray.GetNumVertices();
+		const ParticleVertex* pVertices = a_rSpray.GetVertices();
+		std::vector<ParticleVertexWide> vecWide(nCount);
+
+		ParticleSimulation::WidenVertices(&vecWide[0], pVertices, nCount);
+
+		UINT nBad = 0;
+
+		for (UINT i = 0; i < nCount; ++i)
+		{
+			const ParticleVertex& rIn = pVertices[i];
+			const ParticleVertexWide& rOut = vecWide[i];
+
+			BOOL bSame = memcmp(rIn.aPosSize, rOut.aPosSize, sizeof(rIn.aPosSize)) == 0 && rIn.colInitial == rOut.colInitial;
+
+			for (UINT k = 0; k < 4; ++k)
+				bSame = bSame && rOut.aVelMass[k] == ScalarFloat16To32(rIn.aVelMass[k]);
+
+			for (UINT k = 0; k < 2; ++k)
+				bSame = bSame && rOut.aAgeLife[k] == ScalarFloat16To32(rIn.aAgeLife[k]);
+
+			nBad += bSame ? 0 : 1;
+		}
+
+		printf("%u vertices widened, %u changed\n", nCount, nBad);
+
+		// the layouts the two vertex declarations describe
+		CHECK(sizeof(ParticleVertex) == 24);
+		CHECK(sizeof(ParticleVertexWide) == 36);
+		CHECK(nBad == 0);
+	}
+}
+
+int main()
+{
+	JobSystem::Init(0);
+
+	Spray oSpray;
+	AffineMatrix oIdentity;
+	AffineIdentity(&oIdentity);
+
+	for (UINT nFrame = 0; nFrame < 30; ++nFrame)
+	{
+		oSpray.Step(1.0f / 60.0f, oIdentity);
+		ParticleStage::Run();
+	}
+
+	TestDecode(oSpray);
+	TestWiden(oSpray);
+
+	JobSystem::Shutdown();
+
+	return Failures() ? 1 : 0;
+}
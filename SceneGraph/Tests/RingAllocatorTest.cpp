@@ -0,0 +1,171 @@
+//====================================================================
+// RingAllocatorTest.cpp
+// Checks where RingAllocator places ranges, when it wraps and which
+// generations stay valid
+// Date 19/10/26
+//====================================================================
+
+#include "RingAllocator.h"
+#include "TestUtil.h"
+
+using namespace SGLib;
+using namespace SGLibTest;
+
+namespace
+{
+	// ranges follow each other, each offset rounded up to its stride
+	void TestAppend()
+	{
+		RingAllocator oRing(1000);
+		UINT nOffset;
+
+		// the first allocation always starts the ring
+		CHECK(oRing.Allocate(10, 1, &nOffset) == RingAllocator::RING_WRAP);
+		CHECK(nOffset == 0);
+
+		UINT nGeneration = oRing.GetGeneration();
+		CHECK(nGeneration != 0);
+
+		CHECK(oRing.Allocate(24, 24, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 24);
+		CHECK(oRing.GetHead() == 48);
+
+		CHECK(oRing.Allocate(44, 44, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 88);
+		CHECK(oRing.GetHead() == 132);
+
+		// already aligned, so no padding
+		CHECK(oRing.Allocate(8, 4, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 132);
+
+		// a stride of 0 is taken as 1
+		CHECK(oRing.Allocate(3, 0, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 140);
+
+		// padding counts towards the frame
+		CHECK(oRing.GetFrameBytes() == 143);
+		CHECK(oRing.GetGeneration() == nGeneration);
+		CHECK(oRing.IsValid(nGeneration));
+		CHECK(!oRing.IsValid(0));
+	}
+
+	// a range that doesn't fit after the head starts over at 0 in a new generation
+	void TestWrap()
+	{
+		RingAllocator oRing(100);
+		UINT nOffset;
+
+		oRing.Allocate(60, 4, &nOffset);
+		UINT nOldGeneration = oRing.GetGeneration();
+
+		CHECK(oRing.Allocate(30, 4, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 60);
+		CHECK(oRing.IsValid(nOldGeneration));
+
+		// fits in size but not once aligned after the head at 90, and WillWrap() says so beforehand
+		CHECK(!oRing.WillWrap(8, 2));
+		CHECK(oRing.WillWrap(8, 8));
+		CHECK(!oRing.WillWrap(0, 8));
+		CHECK(oRing.Allocate(8, 8, &nOffset) == RingAllocator::RING_WRAP);
+		CHECK(nOffset == 0);
+
+		UINT nNewGeneration = oRing.GetGeneration();
+		CHECK(nNewGeneration == nOldGeneration + 1);
+		CHECK(!oRing.IsValid(nOldGeneration));
+		CHECK(oRing.IsValid(nNewGeneration));
+		CHECK(oRing.GetFrameWraps() == 2);
+
+		// appending again after the wrap keeps the generation
+		CHECK(oRing.Allocate(16, 4, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 8);
+		CHECK(oRing.IsValid(nNewGeneration));
+
+		// filling the ring exactly still appends
+		CHECK(oRing.Allocate(76, 1, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 24);
+		CHECK(oRing.GetHead() == 100);
+
+		// Reset() invalidates everything and the next range starts the ring again
+		oRing.Reset(200);
+		CHECK(!oRing.IsValid(nNewGeneration));
+		CHECK(oRing.Allocate(150, 1, &nOffset) == RingAllocator::RING_WRAP);
+		CHECK(nOffset == 0);
+	}
+
+	// BeginFrame() wraps before the frame when the last frame's bytes wouldn't fit after the head
+	void TestEarlyWrap()
+	{
+		RingAllocator oRing(1000);
+		UINT nOffset;
+
+		oRing.BeginFrame();
+		oRing.Allocate(300, 4, &nOffset);
+		oRing.Allocate(100, 4, &nOffset);
+		CHECK(oRing.GetFrameBytes() == 400);
+
+		// 600 left is room for the last frame's 400
+		oRing.BeginFrame();
+		UINT nGeneration = oRing.GetGeneration();
+
+		CHECK(oRing.Allocate(300, 4, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 400);
+		CHECK(oRing.Allocate(100, 4, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 700);
+		CHECK(oRing.IsValid(nGeneration));
+
+		// 200 left isn't, so the frame starts at 0 rather than splitting
+		oRing.BeginFrame();
+
+		CHECK(oRing.Allocate(50, 4, &nOffset) == RingAllocator::RING_WRAP);
+		CHECK(nOffset == 0);
+		CHECK(!oRing.IsValid(nGeneration));
+		CHECK(oRing.Allocate(300, 4, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(nOffset == 52);
+		CHECK(oRing.GetFrameWraps() == 1);
+
+		// an empty frame leaves nothing to make room for
+		oRing.BeginFrame();
+		oRing.BeginFrame();
+
+		CHECK(oRing.Allocate(100, 4, &nOffset) == RingAllocator::RING_APPEND);
+		CHECK(oRing.GetFrameWraps() == 0);
+	}
+
+	// a range larger than the ring, or empty, is refused and changes nothing
+	void TestOversize()
+	{
+		RingAllocator oRing(256);
+		UINT nOffset = 12345;
+
+		oRing.Allocate(64, 16, &nOffset);
+
+		UINT nGeneration = oRing.GetGeneration();
+		UINT nHead = oRing.GetHead();
+		nOffset = 12345;
+
+		CHECK(oRing.Allocate(257, 1, &nOffset) == RingAllocator::RING_FAILED);
+		CHECK(oRing.Allocate(0, 16, &nOffset) == RingAllocator::RING_FAILED);
+		CHECK(nOffset == 12345);
+		CHECK(oRing.GetHead() == nHead);
+		CHECK(oRing.IsValid(nGeneration));
+
+		// the whole ring is not oversize
+		CHECK(oRing.Allocate(256, 16, &nOffset) == RingAllocator::RING_WRAP);
+
+		// nor is anything allocated from an empty ring
+		RingAllocator oEmpty;
+		CHECK(oEmpty.Allocate(1, 1, &nOffset) == RingAllocator::RING_FAILED);
+	}
+}
+
+int main()
+{
+	TestAppend();
+	TestWrap();
+	TestEarlyWrap();
+	TestOversize();
+
+	printf("RingAllocator: %d failures\n", Failures());
+
+	return Failures() ? 1 : 0;
+}
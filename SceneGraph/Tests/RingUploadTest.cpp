@@ -0,0 +1,197 @@
+//====================================================================
+// RingUploadTest.cpp
+// Checks that RingUpload writes every range while the memory it
+// points into is still mapped, also when the ring wraps part way
+// through an upload
+// Date 19/10/26
+//====================================================================
+
+#include "RingUpload.h"
+#include "JobSystem.h"
+#include "TestUtil.h"
+#include <cstring>
+#include <vector>
+
+using namespace SGLib;
+using namespace SGLibTest;
+
+namespace
+{
+	const BYTE UNMAPPED = 0xCD;
+
+	// a ring in system memory that hands out new memory for every mapping, starting empty after a
+	// discard, and fills a mapping with UNMAPPED once it ends so a late write shows up
+	class MemoryRing : public MappedRing
+	{
+	public:
+		MemoryRing(UINT a_nBytes) : MappedRing(a_nBytes), m_vecContents(a_nBytes, 0) {}
+		~MemoryRing() { Flush(); }
+
+		std::vector<BYTE>					m_vecContents;	///< what is read after Flush()
+		std::vector< std::vector<BYTE> >	m_vecMappings;	///< every mapping handed out, the last may be current
+
+		// TRUE if nothing was written to a mapping after it ended
+		BOOL NoLateWrites() const
+		{
+			for (UINT i = 0; i < m_vecMappings.size(); ++i)
+			{
+				for (UINT k = 0; k < m_vecMappings[i].size(); ++k)
+				{
+					if (m_vecMappings[i][k] != UNMAPPED)
+						return FALSE;
+				}
+			}
+
+			return TRUE;
+		}
+
+	protected:
+		BOOL HasMemory() const { return TRUE; }
+
+		// the old mappings are kept so a late write lands in memory that is still there
+		BYTE* Map(BOOL a_bDiscard)
+		{
+			m_vecMappings.push_back(a_bDiscard ? std::vector<BYTE>(GetCapacity(), 0) : m_vecContents);
+
+			return &m_vecMappings.back()[0];
+		}
+
+		void Unmap()
+		{
+			m_vecContents = m_vecMappings.back();
+			memset(&m_vecMappings.back()[0], UNMAPPED, m_vecContents.size());
+		}
+	};
+
+	// a range filled with one value
+	struct Source
+	{
+		BYTE	nValue;			///< value written
+		UINT	nSize;			///< bytes written
+		UINT	nOffset;		///< where the ring put them
+		UINT	nGeneration;	///< ring generation they were put in
+	};
+
+	void WriteSource(const void* a_pSource, BYTE* a_pDest)
+	{
+		const Source* pSource = static_cast<const Source*>(a_pSource);
+
+		memset(a_pDest, pSource->nValue, pSource->nSize);
+	}
+
+	// uploads the sources as one frame and returns the number of runs
+	UINT UploadFrame(MemoryRing* a_pRing, std::vector<Source>* a_pvecSources)
+	{
+		a_pRing->BeginFrame();
+
+		RingUpload oUpload(a_pRing, WriteSource);
+
+		for (UINT i = 0; i < a_pvecSources->size(); ++i)
+		{
+			Source& rSource = (*a_pvecSources)[i];
+			CHECK(oUpload.Add(&rSource, rSource.nSize, 4, &rSource.nOffset, &rSource.nGeneration) != NULL);
+		}
+
+		oUpload.Run();
+		a_pRing->Flush();
+
+		return oUpload.GetNumRuns();
+	}
+
+	// every range still valid reads back what was written to it
+	UINT CountIntact(const MemoryRing& a_rRing, const std::vector<Source>& a_rvecSources)
+	{
+		UINT nIntact = 0;
+
+		for (UINT i = 0; i < a_rvecSources.size(); ++i)
+		{
+			const Source& rSource = a_rvecSources[i];
+
+			if (!a_rRing.IsValid(rSource.nGeneration))
+				continue;
+
+			BOOL bIntact = TRUE;
+
+			for (UINT k = 0; k < rSource.nSize; ++k)
+				bIntact = bIntact && a_rRing.m_vecContents[rSource.nOffset + k] == rSource.nValue;
+
+			nIntact += bIntact ? 1 : 0;
+		}
+
+		return nIntact;
+	}
+
+	Source MakeSource(BYTE a_nValue, UINT a_nSize)
+	{
+		Source oSource = { a_nValue, a_nSize, 0, 0 };
+		return oSource;
+	}
+
+	// a frame that fits after the head is written in one run under one mapping
+	void TestAppend()
+	{
+		MemoryRing oRing(1000);
+		std::vector<Source> vecSources;
+
+		vecSources.push_back(MakeSource(1, 100));
+		vecSources.push_back(MakeSource(2, 200));
+
+		CHECK(UploadFrame(&oRing, &vecSources) == 1);
+		CHECK(CountIntact(oRing, vecSources) == 2);
+
+		vecSources[0].nValue = 3;
+		vecSources[1].nValue = 4;
+
+		CHECK(UploadFrame(&oRing, &vecSources) == 1);
+		CHECK(CountIntact(oRing, vecSources) == 2);
+		CHECK(vecSources[0].nOffset == 300);
+		CHECK(oRing.NoLateWrites());
+	}
+
+	// a frame larger than the last one that doesn't fit after the head wraps part way through, and the
+	// ranges held before the wrap are written before their mapping ends
+	void TestWrapMidUpload()
+	{
+		MemoryRing oRing(1000);
+		std::vector<Source> vecSources;
+
+		vecSources.push_back(MakeSource(1, 300));
+		CHECK(UploadFrame(&oRing, &vecSources) == 1);
+
+		// 700 left is room for the last frame's 300, so BeginFrame() doesn't wrap, but 800 don't fit
+		vecSources.clear();
+
+		for (UINT i = 0; i < 8; ++i)
+			vecSources.push_back(MakeSource((BYTE)(10 + i), 100));
+
+		UINT nRuns = UploadFrame(&oRing, &vecSources);
+
+		printf("%u runs, %u of %u ranges intact after the wrap, %u mappings\n",
+			   nRuns, CountIntact(oRing, vecSources), (UINT)vecSources.size(), (UINT)oRing.m_vecMappings.size());
+
+		CHECK(nRuns == 2);
+		CHECK(oRing.GetAllocator().GetFrameWraps() == 1);
+		CHECK(oRing.NoLateWrites());
+
+		// the first 7 went after the head, the last one started the ring over and is the only valid one
+		CHECK(vecSources[6].nOffset == 900);
+		CHECK(vecSources[7].nOffset == 0);
+		CHECK(!oRing.IsValid(vecSources[6].nGeneration));
+		CHECK(CountIntact(oRing, vecSources) == 1);
+	}
+}
+
+int main()
+{
+	// with workers, so the writes really run on other threads
+	JobSystem::Init();
+
+	TestAppend();
+	TestWrapMidUpload();
+
+	JobSystem::Shutdown();
+
+	printf("RingUpload: %d failures\n", Failures());
+
+	return Failures() ? 1 : 0;
+}
@@ -0,0 +1,248 @@
+//====================================================================
+// SGMathBench.cpp
+// Times the SIMD paths of SGMath against SGLib::Reference and checks
+// that both give bit identical results
+// Date 19/10/26
+//====================================================================
+//
+// Usage: SGMathBench [scale]
+//
+// scale multiplies the number of repetitions, ctest runs it with a small
+// one so the results are still compared on every build. The paths timed
+// are the ones the build selected, see SGMath.h.
+
+#include "SGMath.h"
+#include "TestUtil.h"
+#include <cstdlib>
+
+using namespace SGLib;
+using namespace SGLibTest;
+
+namespace
+{
+	const UINT COUNT = 4096;	// items per repetition, small enough to stay in the cache
+
+	AlignedArray<Matrix>		s_arrMatA(COUNT);
+	AlignedArray<Matrix>		s_arrMatB(COUNT);
+	AlignedArray<AffineMatrix>	s_arrAffA(COUNT);
+	AlignedArray<AffineMatrix>	s_arrAffB(COUNT);
+	AlignedArray<Vector3>		s_arrVec3(COUNT);
+	AlignedArray<Vector4>		s_arrVec4(COUNT);
+	AlignedArray<FLOAT>			s_arrFloat(COUNT);
+	AlignedArray<FLOAT>			s_arrWeights(COUNT * 4);
+	Matrix						s_matTransform;
+
+	// output of the reference and of the SIMD path, compared after each case
+	AlignedArray<Matrix>		s_arrOut[2] = { AlignedArray<Matrix>(COUNT), AlignedArray<Matrix>(COUNT) };
+
+	void MatrixMultiplyCase(BOOL a_bReference, void* a_pOut)
+	{
+		Matrix* pOut = (Matrix*)a_pOut;
+
+		if (a_bReference)
+			for (UINT i = 0; i < COUNT; ++i)
+				Reference::MatrixMultiply(&pOut[i], &s_arrMatA[i], &s_arrMatB[i]);
+		else
+			for (UINT i = 0; i < COUNT; ++i)
+				MatrixMultiply(&pOut[i], &s_arrMatA[i], &s_arrMatB[i]);
+	}
+
+	void MatrixMultiplyArrayCase(BOOL a_bReference, void* a_pOut)
+	{
+		if (a_bReference)
+			Reference::MatrixMultiplyArray((Matrix*)a_pOut, s_arrMatA.Data(), s_arrMatB.Data(), COUNT);
+		else
+			MatrixMultiplyArray((Matrix*)a_pOut, s_arrMatA.Data(), s_arrMatB.Data(), COUNT);
+	}
+
+	void AffineMultiplyCase(BOOL a_bReference, void* a_pOut)
+	{
+		AffineMatrix* pOut = (AffineMatrix*)a_pOut;
+
+		if (a_bReference)
+			for (UINT i = 0; i < COUNT; ++i)
+				Reference::AffineMultiply(&pOut[i], &s_arrAffA[i], &s_arrAffB[i]);
+		else
+			for (UINT i = 0; i < COUNT; ++i)
+				AffineMultiply(&pOut[i], &s_arrAffA[i], &s_arrAffB[i]);
+	}
+
+	void Vec3TransformCoordArrayCase(BOOL a_bReference, void* a_pOut)
+	{
+		if (a_bReference)
+			Reference::Vec3TransformCoordArray((Vector3*)a_pOut, sizeof(Vector3), s_arrVec3.Data(), sizeof(Vector3), &s_matTransform, COUNT);
+		else
+			Vec3TransformCoordArray((Vector3*)a_pOut, sizeof(Vector3), s_arrVec3.Data(), sizeof(Vector3), &s_matTransform, COUNT);
+	}
+
+	void Vec3TransformNormalArrayCase(BOOL a_bReference, void* a_pOut)
+	{
+		if (a_bReference)
+			Reference::Vec3TransformNormalArray((Vector3*)a_pOut, sizeof(Vector3), s_arrVec3.Data(), sizeof(Vector3), &s_matTransform, COUNT);
+		else
+			Vec3TransformNormalArray((Vector3*)a_pOut, sizeof(Vector3), s_arrVec3.Data(), sizeof(Vector3), &s_matTransform, COUNT);
+	}
+
+	void Vec4TransformCase(BOOL a_bReference, void* a_pOut)
+	{
+		Vector4* pOut = (Vector4*)a_pOut;
+
+		if (a_bReference)
+			for (UINT i = 0; i < COUNT; ++i)
+				Reference::Vec4Transform(&pOut[i], &s_arrVec4[i], &s_matTransform);
+		else
+			for (UINT i = 0; i < COUNT; ++i)
+				Vec4Transform(&pOut[i], &s_arrVec4[i], &s_matTransform);
+	}
+
+	void Vec4BlendCase(BOOL a_bReference, void* a_pOut)
+	{
+		Vector4* pOut = (Vector4*)a_pOut;
+		const FLOAT* apKeys[4];
+
+		for (UINT i = 0; i < COUNT; ++i)
+		{
+			// unaligned keys spread over the floats, as track keys are packed in their channels
+			for (UINT k = 0; k < 4; ++k)
+				apKeys[k] = &s_arrFloat[(i * 7 + k * 13) % (COUNT - 3)];
+
+			if (a_bReference)
+				Reference::Vec4Blend(&pOut[i], apKeys, &s_arrWeights[i * 4]);
+			else
+				Vec4Blend(&pOut[i], apKeys, &s_arrWeights[i * 4]);
+		}
+	}
+
+	void SinCosArrayCase(BOOL a_bReference, void* a_pOut)
+	{
+		FLOAT* pOut = (FLOAT*)a_pOut;
+
+		if (a_bReference)
+			Reference::SinCosArray(pOut, pOut + COUNT, s_arrFloat.Data(), COUNT);
+		else
+			SinCosArray(pOut, pOut + COUNT, s_arrFloat.Data(), COUNT);
+	}
+
+	void Float32To16ArrayCase(BOOL a_bReference, void* a_pOut)
+	{
+		if (a_bReference)
+			Reference::Float32To16Array((unsigned short*)a_pOut, s_arrFloat.Data(), COUNT);
+		else
+			Float32To16Array((unsigned short*)a_pOut, s_arrFloat.Data(), COUNT);
+	}
+
+	struct Case
+	{
+		const char*	sName;			///< function timed
+		void		(*pRun)(BOOL a_bReference, void* a_pOut);
+		size_t		nOutBytes;		///< bytes of output compared
+		UINT		nRepeats;		///< repetitions at scale 1
+	};
+
+	const Case s_aCases[] =
+	{
+		{ "MatrixMultiply",				MatrixMultiplyCase,				COUNT * sizeof(Matrix),			2000 },
+		{ "MatrixMultiplyArray",		MatrixMultiplyArrayCase,		COUNT * sizeof(Matrix),			2000 },
+		{ "AffineMultiply",				AffineMultiplyCase,				COUNT * sizeof(AffineMatrix),	2000 },
+		{ "Vec3TransformCoordArray",	Vec3TransformCoordArrayCase,	COUNT * sizeof(Vector3),		8000 },
+		{ "Vec3TransformNormalArray",	Vec3TransformNormalArrayCase,	COUNT * sizeof(Vector3),		8000 },
+		{ "Vec4Transform",				Vec4TransformCase,				COUNT * sizeof(Vector4),		8000 },
+		{ "Vec4Blend",					Vec4BlendCase,					COUNT * sizeof(Vector4),		8000 },
+		{ "SinCosArray",				SinCosArrayCase,				COUNT * sizeof(FLOAT) * 2,		4000 },
+		{ "Float32To16Array",			Float32To16ArrayCase,			COUNT * sizeof(unsigned short),	8000 }
+	};
+
+	// fastest of a few runs, in seconds per repetition
+	double Time(const Case& a_rCase, BOOL a_bReference, UINT a_nRepeats)
+	{
+		double fBest = 1e30;
+
+		for (UINT nRun = 0; nRun < 3; ++nRun)
+		{
+			double fStart = Seconds();
+
+			for (UINT i = 0; i < a_nRepeats; ++i)
+				a_rCase.pRun(a_bReference, s_arrOut[a_bReference ? 0 : 1].Data());
+
+			double fTime = (Seconds() - fStart) / a_nRepeats;
+			fBest = (fTime < fBest) ? fTime : fBest;
+		}
+
+		return fBest;
+	}
+
+	void FillData()
+	{
+		Random oRandom(12345);
+
+		for (UINT i = 0; i < COUNT; ++i)
+		{
+			for (UINT r = 0; r < 4; ++r)
+			{
+				for (UINT c = 0; c < 4; ++c)
+				{
+					s_arrMatA[i](r, c) = oRandom.Uniform(-2.0f, 2.0f);
+					s_arrMatB[i](r, c) = oRandom.Uniform(-2.0f, 2.0f);
+				}
+			}
+
+			for (UINT r = 0; r < 4; ++r)
+			{
+				for (UINT c = 0; c < 3; ++c)
+				{
+					s_arrAffA[i](r, c) = oRandom.Uniform(-2.0f, 2.0f);
+					s_arrAffB[i](r, c) = oRandom.Uniform(-2.0f, 2.0f);
+				}
+			}
+
+			s_arrVec3[i] = Vector3(oRandom.Uniform(-100.0f, 100.0f), oRandom.Uniform(-100.0f, 100.0f), oRandom.Uniform(-100.0f, 100.0f));
+			s_arrVec4[i] = Vector4(s_arrVec3[i].x, s_arrVec3[i].y, s_arrVec3[i].z, oRandom.Uniform(0.5f, 2.0f));
+			s_arrFloat[i] = oRandom.Uniform(-70000.0f, 70000.0f) * ((i & 1) ? 1e-4f : 1.0f);
+
+			// Catmull-Rom weights reach a little outside [0, 1]
+			for (UINT k = 0; k < 4; ++k)
+				s_arrWeights[i * 4 + k] = oRandom.Uniform(-0.2f, 1.2f);
+		}
+
+		// a perspective view so the coordinate transform divides by a w other than 1
+		Vector3 vecEye(10.0f, 20.0f, -50.0f), vecAt(0.0f, 0.0f, 0.0f), vecUp(0.0f, 1.0f, 0.0f);
+		Matrix matView, matProj;
+		MatrixLookAtLH(&matView, &vecEye, &vecAt, &vecUp);
+		MatrixPerspectiveFovLH(&matProj, 0.8f, 1.333f, 1.0f, 1000.0f);
+		Reference::MatrixMultiply(&s_matTransform, &matView, &matProj);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double fScale = (argc > 1) ? atof(argv[1]) : 1.0;
+
+	FillData();
+
+#if defined(SGLIB_SIMD_AVX2)
+	const char* sPath = "AVX2";
+#elif defined(SGLIB_SIMD_SSE2)
+	const char* sPath = "SSE2";
+#else
+	const char* sPath = "scalar";
+#endif
+
+	printf("%-26s %14s %14s %8s\n", "function", "reference", sPath, "speedup");
+
+	for (UINT i = 0; i < sizeof(s_aCases) / sizeof(s_aCases[0]); ++i)
+	{
+		const Case& rCase = s_aCases[i];
+		UINT nRepeats = (UINT)(rCase.nRepeats * fScale);
+		nRepeats = (nRepeats > 0) ? nRepeats : 1;
+
+		double fReference = Time(rCase, TRUE, nRepeats);
+		double fSimd = Time(rCase, FALSE, nRepeats);
+
+		// items per microsecond, so millions a second
+		printf("%-26s %10.1f M/s %10.1f M/s %7.2fx\n", rCase.sName, COUNT / fReference * 1e-6, COUNT / fSimd * 1e-6, fReference / fSimd);
+
+		CHECK(memcmp(s_arrOut[0].Data(), s_arrOut[1].Data(), rCase.nOutBytes) == 0);
+	}
+
+	return Failures() ? 1 : 0;
+}
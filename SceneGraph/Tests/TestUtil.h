@@ -0,0 +1,72 @@
+/**
+*	\file		TestUtil.h
+*	\brief		Checks, a timer and a random number generator shared by the headless tests and benchmarks
+*	\date		19/10/26
+*	\version	1.0
+*
+*	The tests are plain programs that return non zero when a CHECK() failed, so they run under ctest
+*	without a test framework. Only the device free parts of SGLib are tested, see CMakeLists.txt.
+*/
+
+#ifndef SGLIB_TESTUTIL
+#define SGLIB_TESTUTIL
+
+#pragma once
+
+#include "SGPlatform.h"
+#include <cstdio>
+
+#if !defined(_WIN32)
+#include <time.h>
+#endif
+
+namespace SGLibTest
+{
+	// failed checks so far, the test returns it from main()
+	inline int& Failures()
+	{
+		static int s_nFailures = 0;
+		return s_nFailures;
+	}
+
+	inline void Check(bool a_bPassed, const char* a_sExpr, const char* a_sFile, int a_nLine)
+	{
+		if (!a_bPassed)
+		{
+			fprintf(stderr, "%s(%d): check failed: %s\n", a_sFile, a_nLine, a_sExpr);
+			++Failures();
+		}
+	}
+
+	// seconds since an arbitrary start
+	inline double Seconds()
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER nCount, nFrequency;
+		QueryPerformanceCounter(&nCount);
+		QueryPerformanceFrequency(&nFrequency);
+		return (double)nCount.QuadPart / (double)nFrequency.QuadPart;
+#else
+		timespec oTime;
+		clock_gettime(CLOCK_MONOTONIC, &oTime);
+		return oTime.tv_sec + oTime.tv_nsec * 1e-9;
+#endif
+	}
+
+	// small linear congruential generator so the data is the same on every platform
+	class Random
+	{
+	public:
+		explicit Random(UINT a_nSeed) : m_nState(a_nSeed) {}
+
+		UINT	Next()								{ m_nState = m_nState * 1664525u + 1013904223u; return m_nState; }
+		FLOAT	Uniform(FLOAT a_fMin, FLOAT a_fMax)	{ return a_fMin + (a_fMax - a_fMin) * (FLOAT)(Next() >> 8) * (1.0f / 16777216.0f); }
+
+	private:
+		UINT	m_nState;	///< last number generated
+	};
+}
+
+#define CHECK(expr)	SGLibTest::Check((expr) ? true : false, #expr, __FILE__, __LINE__)
+
+#endif
@@ -1,28 +1,93 @@
+#include "dxstdafx.h"
 #include "Transform.h"
+#include "TransformTrack.h"
+#include "AnimSystem.h"
 
 namespace SGLib
 {
+	AffineMatrix Transform::s_oMatrixWorld(Matrix(	1.0f, 0.0f, 0.0f, 0.0f,
+													0.0f, 1.0f, 0.0f, 0.0f,
+													0.0f, 0.0f, 1.0f, 0.0f,
+													0.0f, 0.0f, 0.0f, 1.0f));
+	const Transform* Transform::s_pRenderTransform = NULL;
+
+	/**
+	*	\brief	Transform constructor
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
+	*	\param	const Matrix& a_rMatrixTrans - reference to matrix to set transform with
+	*/
+
+	Transform::Transform(	LPDIRECT3DDEVICE9 a_pD3DDevice, 
+							const Matrix& a_rMatrixTrans) : 
+								Node(a_pD3DDevice),
+								m_bTRS(FALSE),
+								m_bTransDirty(FALSE),
+								m_bNormalDirty(TRUE),
+								m_pRenderPrevious(NULL)
+	{
+		InitTrack();
+		AffineIdentity(&m_oMatrix);
+		SetMatrix(a_rMatrixTrans);
+	}
+
 	/**
 	*	\brief	Transform constructor
 	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
-	*	\param	D3DXMATRIX a_oMatrixTrans - reference to matrix to set transform with
+	*	\param	const AffineMatrix& a_rMatrixTrans - reference to matrix to set transform with
 	*/
 
 	Transform::Transform(	LPDIRECT3DDEVICE9 a_pD3DDevice, 
-							D3DXMATRIX& a_rMatrixTrans) : 
-								Node(a_pD3DDevice)
+							const AffineMatrix& a_rMatrixTrans) : 
+								Node(a_pD3DDevice),
+								m_bTRS(FALSE),
+								m_bTransDirty(FALSE),
+								m_bNormalDirty(TRUE),
+								m_pRenderPrevious(NULL)
 	{
+		InitTrack();
+		AffineIdentity(&m_oMatrix);
 		SetMatrix(a_rMatrixTrans);
 	}
 
+	/**
+	*	\brief	Transform constructor - the transform is stored as separate parts (see SetTRS())
+	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
+	*	\param	const Vector3& a_rvecTranslation - translation
+	*	\param	const Quaternion& a_rquatRotation - rotation
+	*	\param	const Vector3& a_rvecScale - scale along each axis
+	*/
+
+	Transform::Transform(	LPDIRECT3DDEVICE9 a_pD3DDevice, 
+							const Vector3& a_rvecTranslation,
+							const Quaternion& a_rquatRotation,
+							const Vector3& a_rvecScale) : 
+								Node(a_pD3DDevice),
+								m_bTRS(TRUE),
+								m_bTransDirty(TRUE),
+								m_bNormalDirty(TRUE),
+								m_pRenderPrevious(NULL)
+	{
+		InitTrack();
+		AffineIdentity(&m_oMatrix);
+		SetTRS(a_rvecTranslation, a_rquatRotation, a_rvecScale);
+	}
+
 	/**
 	*	\brief	Transform protected constructor - only used by derived types
 	*	\param	LPDIRECT3DDEVICE9 a_pD3DDevice - pointer to direct3ddevice used for directx operations
 	*/
 
 	Transform::Transform(LPDIRECT3DDEVICE9 a_pD3DDevice) : 
-							Node(a_pD3DDevice)
+							Node(a_pD3DDevice),
+							m_bTRS(FALSE),
+							m_bTransDirty(FALSE),
+							m_bNormalDirty(TRUE),
+							m_pRenderPrevious(NULL)
 	{
+		InitTrack();
+		AffineIdentity(&m_oMatrixTrans);
+		AffineIdentity(&m_oMatrix);
+		AffineIdentity(&m_oMatrixPrevious);
 	}
 
 	/**
@@ -32,38 +97,515 @@ namespace SGLib
 
 	Transform::~Transform(void)
 	{
+		if (m_pTrack)
+			AnimSystem::Unregister(this);
+	}
+
+	/**
+	*	\brief	Mutator for matrix transformation
+	*	\param	const Matrix& a_rMatrixTrans - matrix to set transform with
+	*	\note	Only the first three columns are kept, the fourth must be (0, 0, 0, 1)
+	*/
+
+	void Transform::SetMatrix(const Matrix& a_rMatrixTrans)
+	{
+		// output string to console if a projective matrix is passed in
+		if (a_rMatrixTrans._14 != 0.0f || a_rMatrixTrans._24 != 0.0f || a_rMatrixTrans._34 != 0.0f || a_rMatrixTrans._44 != 1.0f)
+			OutputDebugString(L"Warning: Transform matrix is not affine -> fourth column ignored");
+
+		SetMatrix(AffineMatrix(a_rMatrixTrans));
 	}
 
 	/**
 	*	\brief	Mutator for matrix transformation
-	*	\param	D3DXMATRIX& a_rMatrixTrans - matrix to set transform with
+	*	\param	const AffineMatrix& a_rMatrixTrans - matrix to set transform with
 	*/
 
-	void Transform::SetMatrix(D3DXMATRIX& a_rMatrixTrans)
+	void Transform::SetMatrix(const AffineMatrix& a_rMatrixTrans)
 	{
+		// output string to console if a baked transform is being edited
+		if (m_bStatic)
+			OutputDebugString(L"Warning: Static transform modified -> call Unfreeze() first");
+
 		m_oMatrixTrans = a_rMatrixTrans;
+		m_bTRS = FALSE;
+		m_bTransDirty = FALSE;
+		Wake();
+	}
+
+	/**
+	*	\brief	Multiplies current transform matrix by a_rMatrixTrans and sets it as new transform
+	*	\param	const Matrix& a_rMatrixTrans - matrix to set multiply original transform matrix with
+	*	\note	Only the first three columns are used, the fourth must be (0, 0, 0, 1)
+	*/
+
+	void Transform::MultMatrix(const Matrix& a_rMatrixTrans)
+	{
+		MultMatrix(AffineMatrix(a_rMatrixTrans));
 	}
 
 	/**
 	*	\brief	Multiplies current transform matrix by a_rMatrixTrans and sets it as new transform
-	*	\param	D3DXMATRIX& a_rMatrixTrans - matrix to set multiply original transform matrix with
+	*	\param	const AffineMatrix& a_rMatrixTrans - matrix to set multiply original transform matrix with
 	*/
 
-	void Transform::MultMatrix(D3DXMATRIX& a_rMatrixTrans)
+	void Transform::MultMatrix(const AffineMatrix& a_rMatrixTrans)
 	{
-		D3DXMatrixMultiply(&m_oMatrixTrans, &m_oMatrixTrans, &a_rMatrixTrans);
+		// output string to console if a baked transform is being edited
+		if (m_bStatic)
+			OutputDebugString(L"Warning: Static transform modified -> call Unfreeze() first");
+
+		AffineMultiply(&m_oMatrixTrans, &GetAffineMatrix(), &a_rMatrixTrans);
+		m_bTRS = FALSE;
+		m_bTransDirty = FALSE;
+		Wake();
 	}
 
 	/**
 	*	\brief	Accessor for matrix transformation
-	*	\return	D3DXMATRIX - returns transform matrix
+	*	\return	Matrix - returns transform matrix expanded to a full matrix
+	*/
+
+	Matrix Transform::GetMatrix()
+	{
+		Matrix matOut;
+		return *MatrixFromAffine(&matOut, &GetAffineMatrix());
+	}
+
+	/**
+	*	\brief	Accessor for matrix transformation without expanding it
+	*	\return	const AffineMatrix& - returns transform matrix
+	*	\note	Recomposes the matrix if a translation, rotation or scale part has changed
 	*/
 
-	D3DXMATRIX Transform::GetMatrix()
+	const AffineMatrix& Transform::GetAffineMatrix() const
 	{
+		if (m_bTransDirty)
+		{
+			AffineTransformation(&m_oMatrixTrans, &m_vecScale, &m_quatRotation, &m_vecTranslation);
+			m_bTransDirty = FALSE;
+		}
+
 		return m_oMatrixTrans;
 	}
 
+	/**
+	*	\brief	Sets the transform from separate parts, applied as scale then rotation then translation
+	*	\param	const Vector3& a_rvecTranslation - translation
+	*	\param	const Quaternion& a_rquatRotation - rotation (normalized before it is stored)
+	*	\param	const Vector3& a_rvecScale - scale along each axis
+	*/
+
+	void Transform::SetTRS(const Vector3& a_rvecTranslation, const Quaternion& a_rquatRotation, const Vector3& a_rvecScale)
+	{
+		EditTRS();
+
+		m_vecTranslation = a_rvecTranslation;
+		QuaternionNormalize(&m_quatRotation, &a_rquatRotation);
+		m_vecScale = a_rvecScale;
+	}
+
+	/**
+	*	\brief	Mutator for the translation part of the transform
+	*	\param	const Vector3& a_rvecTranslation - new translation
+	*/
+
+	void Transform::SetTranslation(const Vector3& a_rvecTranslation)
+	{
+		EditTRS();
+		m_vecTranslation = a_rvecTranslation;
+	}
+
+	/**
+	*	\brief	Mutator for the rotation part of the transform
+	*	\param	const Quaternion& a_rquatRotation - new rotation (normalized before it is stored)
+	*/
+
+	void Transform::SetRotation(const Quaternion& a_rquatRotation)
+	{
+		EditTRS();
+		QuaternionNormalize(&m_quatRotation, &a_rquatRotation);
+	}
+
+	/**
+	*	\brief	Mutator for the scale part of the transform
+	*	\param	const Vector3& a_rvecScale - new scale along each axis
+	*/
+
+	void Transform::SetScale(const Vector3& a_rvecScale)
+	{
+		EditTRS();
+		m_vecScale = a_rvecScale;
+	}
+
+	/**
+	*	\brief	Moves the transform in its parent's space
+	*	\param	const Vector3& a_rvecOffset - offset added to the translation
+	*/
+
+	void Transform::Translate(const Vector3& a_rvecOffset)
+	{
+		EditTRS();
+		m_vecTranslation += a_rvecOffset;
+	}
+
+	/**
+	*	\brief	Rotates the transform in its parent's space around its own position
+	*	\param	const Quaternion& a_rquatRotation - rotation applied after the current rotation
+	*	\note	The result is renormalized so repeated calls do not drift
+	*/
+
+	void Transform::Rotate(const Quaternion& a_rquatRotation)
+	{
+		EditTRS();
+		QuaternionMultiply(&m_quatRotation, &m_quatRotation, &a_rquatRotation);
+		QuaternionNormalize(&m_quatRotation, &m_quatRotation);
+	}
+
+	/**
+	*	\brief	Accessor for the translation part of the transform
+	*	\return	Vector3 - translation (read straight from the matrix if the parts are not in use)
+	*/
+
+	Vector3 Transform::GetTranslation() const
+	{
+		if (m_bTRS)
+			return m_vecTranslation;
+
+		return Vector3(m_oMatrixTrans.m[0][3], m_oMatrixTrans.m[1][3], m_oMatrixTrans.m[2][3]);
+	}
+
+	/**
+	*	\brief	Accessor for the rotation part of the transform
+	*	\return	Quaternion - rotation
+	*	\note	Decomposes the matrix if the parts are not in use
+	*/
+
+	Quaternion Transform::GetRotation() const
+	{
+		if (m_bTRS)
+			return m_quatRotation;
+
+		Matrix matTrans;
+		Vector3 vecScale, vecTranslation;
+		Quaternion quatRotation;
+
+		MatrixFromAffine(&matTrans, &m_oMatrixTrans);
+		MatrixDecompose(&vecScale, &quatRotation, &vecTranslation, &matTrans);
+		return quatRotation;
+	}
+
+	/**
+	*	\brief	Accessor for the scale part of the transform
+	*	\return	Vector3 - scale along each axis
+	*	\note	Decomposes the matrix if the parts are not in use
+	*/
+
+	Vector3 Transform::GetScale() const
+	{
+		if (m_bTRS)
+			return m_vecScale;
+
+		Matrix matTrans;
+		Vector3 vecScale, vecTranslation;
+		Quaternion quatRotation;
+
+		MatrixFromAffine(&matTrans, &m_oMatrixTrans);
+		MatrixDecompose(&vecScale, &quatRotation, &vecTranslation, &matTrans);
+		return vecScale;
+	}
+
+	/**
+	*	\brief	Prepares the translation, rotation and scale parts to be edited and marks the matrix dirty
+	*	\note	The first edit after SetMatrix() or MultMatrix() decomposes the matrix once to seed the parts.
+	*			Wakes the transform so the edit reaches its world matrix in the next update pass.
+	*/
+
+	void Transform::EditTRS()
+	{
+		// output string to console if a baked transform is being edited
+		if (m_bStatic)
+			OutputDebugString(L"Warning: Static transform modified -> call Unfreeze() first");
+
+		PrepareTRS();
+		Wake();
+	}
+
+	/**
+	*	\brief	Decomposes the matrix into the parts if they aren't in use yet and marks the matrix dirty
+	*	\note	EditTRS() without waking, for ApplyTrack() which may run on a job thread
+	*/
+
+	void Transform::PrepareTRS()
+	{
+		if (!m_bTRS)
+		{
+			Matrix matTrans;
+			MatrixFromAffine(&matTrans, &m_oMatrixTrans);
+			MatrixDecompose(&m_vecScale, &m_quatRotation, &m_vecTranslation, &matTrans);
+			m_bTRS = TRUE;
+		}
+
+		m_bTransDirty = TRUE;
+	}
+
+	/**
+	*	\brief	Attaches keyframed tracks that drive the translation, rotation and scale parts
+	*	\param	const TransformTrack* a_pTrack - track to play from its start, NULL to detach the current one
+	*	\param	BOOL a_bRepeat - TRUE to loop the track, otherwise it holds its last keys once it ends
+	*	\note	The track is sampled by SGLib::AnimSystem::Animate() and is not owned by the transform. The
+	*			parts keep the values last sampled when the track is detached.
+	*/
+
+	void Transform::SetTrack(const TransformTrack* a_pTrack, BOOL a_bRepeat)
+	{
+		// output string to console if the node won't use the parts the track drives
+		if (a_pTrack && GetType() != TRANSFORM)
+			OutputDebugString(L"Warning: Track attached to a node that computes its own matrix -> track ignored");
+
+		m_pTrack = a_pTrack;
+		m_bTrackRepeat = a_bRepeat;
+		m_bTrackPlaying = (a_pTrack != NULL);
+		m_fTrackTime = 0.0f;
+		m_anTrackKeys[0] = m_anTrackKeys[1] = m_anTrackKeys[2] = 0;
+
+		if (a_pTrack)
+			AnimSystem::Register(this);
+		else
+			AnimSystem::Unregister(this);
+	}
+
+	/**
+	*	\brief	Accessor for the attached track
+	*	\return	const TransformTrack* - track driving the parts, NULL if none
+	*/
+
+	const TransformTrack* Transform::GetTrack() const
+	{
+		return m_pTrack;
+	}
+
+	/**
+	*	\brief	Seeks the attached track, playing it again if it had ended
+	*	\param	FLOAT a_fTime - time into the track
+	*/
+
+	void Transform::SetTrackTime(FLOAT a_fTime)
+	{
+		m_fTrackTime = a_fTime;
+		m_bTrackPlaying = (m_pTrack != NULL);
+	}
+
+	/**
+	*	\brief	Accessor for the time into the attached track
+	*	\return	FLOAT - time sampled by the last animation frame
+	*/
+
+	FLOAT Transform::GetTrackTime() const
+	{
+		return m_fTrackTime;
+	}
+
+	/**
+	*	\brief	Mutator for the playback speed of the attached track
+	*	\param	FLOAT a_fSpeed - multiplier of the time passed, negative plays in reverse
+	*/
+
+	void Transform::SetTrackSpeed(FLOAT a_fSpeed)
+	{
+		m_fTrackSpeed = a_fSpeed;
+	}
+
+	/**
+	*	\brief	Accessor for the playback speed of the attached track
+	*	\return	FLOAT - multiplier of the time passed
+	*/
+
+	FLOAT Transform::GetTrackSpeed() const
+	{
+		return m_fTrackSpeed;
+	}
+
+	/**
+	*	\brief	Accessor for whether the attached track is still playing
+	*	\return	BOOL - FALSE if there is no track or it doesn't loop and has ended
+	*/
+
+	BOOL Transform::IsTrackPlaying() const
+	{
+		return m_bTrackPlaying;
+	}
+
+	/**
+	*	\brief	Advances the time of the attached track
+	*	\param	FLOAT a_fTimeDiff - time difference since last update call
+	*	\return	BOOL - TRUE if the track should be sampled, including the update it ends on
+	*/
+
+	BOOL Transform::AdvanceTrack(FLOAT a_fTimeDiff)
+	{
+		// frozen transforms keep their baked matrices
+		if (!m_pTrack || !m_bTrackPlaying || m_bStatic)
+			return FALSE;
+
+		FLOAT fLength = m_pTrack->GetLength();
+
+		m_fTrackTime += a_fTimeDiff * m_fTrackSpeed;
+
+		// if the track has ended, either end when playing in reverse
+		if (m_fTrackTime > fLength || m_fTrackTime < 0.0f)
+		{
+			if (m_bTrackRepeat && fLength > 0.0f)
+			{
+				m_fTrackTime = fmod(m_fTrackTime, fLength);
+				if (m_fTrackTime < 0.0f)
+					m_fTrackTime += fLength;
+			}
+			else
+			{
+				m_fTrackTime = (m_fTrackTime < 0.0f) ? 0.0f : fLength;
+				m_bTrackPlaying = FALSE;
+			}
+		}
+
+		return TRUE;
+	}
+
+	/**
+	*	\brief	Stores the values sampled from the attached track in the translation, rotation and scale parts
+	*	\param	const Vector4* a_pValues - value of each channel, see TransformTrack::BlendSamples()
+	*	\note	Parts whose channel has no keys are left alone. Runs on the animation jobs, so the
+	*			transform is only woken by the following WakeSampled().
+	*/
+
+	void Transform::ApplyTrack(const Vector4* a_pValues)
+	{
+		PrepareTRS();
+		m_bTrackSampled = TRUE;
+
+		if (m_pTrack->GetNumKeys(TransformTrack::TRANSLATION))
+		{
+			const Vector4& rValue = a_pValues[TransformTrack::TRANSLATION];
+			m_vecTranslation = Vector3(rValue.x, rValue.y, rValue.z);
+		}
+
+		if (m_pTrack->GetNumKeys(TransformTrack::ROTATION))
+		{
+			const Vector4& rValue = a_pValues[TransformTrack::ROTATION];
+			Quaternion quatRotation(rValue.x, rValue.y, rValue.z, rValue.w);
+			QuaternionNormalize(&m_quatRotation, &quatRotation);
+		}
+
+		if (m_pTrack->GetNumKeys(TransformTrack::SCALE))
+		{
+			const Vector4& rValue = a_pValues[TransformTrack::SCALE];
+			m_vecScale = Vector3(rValue.x, rValue.y, rValue.z);
+		}
+	}
+
+	/**
+	*	\brief	Wakes the transform if its track was sampled since the last call
+	*	\note	Called by AnimSystem::Animate() on its own thread after the tracks have been sampled
+	*/
+
+	void Transform::WakeSampled()
+	{
+		if (m_bTrackSampled)
+			Wake();
+
+		m_bTrackSampled = FALSE;
+	}
+
+	/**
+	*	\brief	Sets up a transform with no track attached
+	*/
+
+	void Transform::InitTrack()
+	{
+		m_pTrack = NULL;
+		m_fTrackTime = 0.0f;
+		m_fTrackSpeed = 1.0f;
+		m_bTrackRepeat = FALSE;
+		m_bTrackPlaying = FALSE;
+		m_anTrackKeys[0] = m_anTrackKeys[1] = m_anTrackKeys[2] = 0;
+		m_bTrackSampled = FALSE;
+	}
+
+	/**
+	*	\brief	Accessor for the world matrix calculated in the last update
+	*	\return	const AffineMatrix& - world matrix
+	*/
+
+	const AffineMatrix& Transform::GetWorldMatrix() const
+	{
+		return m_oMatrix;
+	}
+
+	/**
+	*	\brief	Accessor for the matrix normals are transformed into world space with
+	*	\return	const AffineMatrix& - inverse transpose of the world matrix (zero translation)
+	*	\note	Only recalculated if the world matrix has changed since the last call
+	*/
+
+	const AffineMatrix& Transform::GetNormalMatrix() const
+	{
+		if (m_bNormalDirty)
+		{
+			AffineNormalMatrix(&m_oMatrixNormal, &m_oMatrix);
+			m_bNormalDirty = FALSE;
+		}
+
+		return m_oMatrixNormal;
+	}
+
+	/**
+	*	\brief	Stores a newly calculated world matrix and invalidates the normal matrix if it changed
+	*	\param	const AffineMatrix& a_rMatrixWorld - new world matrix
+	*	\note	A change also flags the node as moved so the renderer updates its sleeping children
+	*/
+
+	void Transform::SetWorldMatrix(const AffineMatrix& a_rMatrixWorld)
+	{
+		if (m_oMatrix != a_rMatrixWorld)
+		{
+			m_oMatrix = a_rMatrixWorld;
+			m_bNormalDirty = TRUE;
+			m_bMoved = TRUE;
+		}
+	}
+
+	/**
+	*	\brief	Sets the world matrix the update pass starts from
+	*	\param	const AffineMatrix& a_rMatrixWorld - world matrix in effect before the root node is updated
+	*	\note	Called by SGLib::SGRenderer::Update(), Transform nodes then push and pop it like they do the
+	*			device's world matrix during rendering
+	*/
+
+	void Transform::SetUpdateWorld(const AffineMatrix& a_rMatrixWorld)
+	{
+		s_oMatrixWorld = a_rMatrixWorld;
+	}
+
+	/**
+	*	\brief	Accessor for the world matrix in effect at the current point of the update pass
+	*	\return	const AffineMatrix& - current update world matrix
+	*/
+
+	const AffineMatrix& Transform::GetUpdateWorld()
+	{
+		return s_oMatrixWorld;
+	}
+
+	/**
+	*	\brief	Accessor for the transform whose world matrix is currently set on the device
+	*	\return	const Transform* - innermost transform between its Render() and PostRender() calls or NULL
+	*/
+
+	const Transform* Transform::GetRenderTransform()
+	{
+		return s_pRenderTransform;
+	}
+
 	/**
 	*	\brief	Accessor for object's type
 	*	\return	NodeType - returns SGLib::NodeType::TRANSFORM
@@ -83,9 +625,14 @@ namespace SGLib
 	void Transform::Render()
 	{
 		HRESULT hr;
+		Matrix matWorld;
 
 		// set combined matrix
-		V(m_pD3DDevice->SetTransform(D3DTS_WORLD, &m_oMatrix))
+		MatrixFromAffine(&matWorld, &m_oMatrix);
+		V(m_pD3DDevice->SetTransform(D3DTS_WORLD, matWorld.AsD3D()))
+
+		m_pRenderPrevious = s_pRenderTransform;
+		s_pRenderTransform = this;
 	}
 
 	/**
@@ -98,43 +645,74 @@ namespace SGLib
 	void Transform::PostRender()
 	{
 		HRESULT hr;
+		Matrix matWorld;
 
 		// set old world matrix back
-		V(m_pD3DDevice->SetTransform(D3DTS_WORLD, &m_oMatrixPrevious))
+		MatrixFromAffine(&matWorld, &m_oMatrixPrevious);
+		V(m_pD3DDevice->SetTransform(D3DTS_WORLD, matWorld.AsD3D()))
+
+		s_pRenderTransform = m_pRenderPrevious;
 	}
 
 	/**
 	*	\brief	Update function called on the initial pass of the scene graph before the render call
 	*	\param	FLOAT a_fTimeDiff - time difference since last update call
-	*	\pre	Device must point to a valid DIRECT3DDEVICE object
 	*	\post	Previous world matrix is stored and new world matrix is set
+	*	\note	The transform then sleeps until it is edited, it is still updated whenever its parent moves
 	*/
 
 	void Transform::Update(FLOAT a_fTimeDiff)
 	{
-		HRESULT	hr;
-
 		// retrieve current world matrix
-		V(m_pD3DDevice->GetTransform(D3DTS_WORLD, &m_oMatrixPrevious))
+		m_oMatrixPrevious = s_oMatrixWorld;
 
 		// calculate new world matrix
-		D3DXMatrixMultiply(&m_oMatrix, &m_oMatrixPrevious, &m_oMatrixTrans);
+		AffineMatrix matWorld;
+		AffineMultiply(&matWorld, &m_oMatrixPrevious, &GetAffineMatrix());
+		SetWorldMatrix(matWorld);
 
 		// set new world matrix
-		V(m_pD3DDevice->SetTransform(D3DTS_WORLD, &m_oMatrix))
+		s_oMatrixWorld = m_oMatrix;
+
+		GoToSleep();
 	}
 
 	/**
 	*	\brief	Sets the previous world matrix back
-	*	\pre	Device must point to a valid DIRECT3DDEVICE object
 	*	\post	Previous world matrix is set
 	*/
 
 	void Transform::PostUpdate()
 	{
-		HRESULT hr;
-
 		// set old world matrix back
-		V(m_pD3DDevice->SetTransform(D3DTS_WORLD, &m_oMatrixPrevious))
+		s_oMatrixWorld = m_oMatrixPrevious;
+	}
+
+	/**
+	*	\brief	Stores the matrices Update() would have calculated and bakes the child hierarchy
+	*	\param	const AffineMatrix& a_rMatrixParent - world matrix set when this node is reached
+	*	\post	Combined and previous matrices are valid for Render() and PostRender() without an update
+	*/
+
+	void Transform::Bake(const AffineMatrix& a_rMatrixParent)
+	{
+		AffineMatrix matWorld;
+
+		m_oMatrixPrevious = a_rMatrixParent;
+		AffineMultiply(&matWorld, &m_oMatrixPrevious, &GetAffineMatrix());
+		SetWorldMatrix(matWorld);
+
+		Node::Bake(a_rMatrixParent);
+	}
+
+	/**
+	*	\brief	Calculates the world matrix this node leaves set for its child during Update()
+	*	\param	const AffineMatrix& a_rMatrixParent - world matrix set when this node is reached
+	*	\param	AffineMatrix& a_rMatrixChild - receives combined matrix
+	*/
+
+	void Transform::CalculateChildWorld(const AffineMatrix& a_rMatrixParent, AffineMatrix& a_rMatrixChild) const
+	{
+		AffineMultiply(&a_rMatrixChild, &a_rMatrixParent, &GetAffineMatrix());
 	}
 }
\ No newline at end of file
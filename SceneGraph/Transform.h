@@ -7,6 +7,35 @@
 *
 *	The Transform node provides the basis for simple world transforms as well as the camera and projection
 *	matrices.
+*
+*	Update 19/10/26 - Matrices are stored as SGLib::AffineMatrix (48 bytes, 36 multiplies per product) as
+*						world and view transforms never use the fourth column. Full matrices are only built
+*						when handing them to the device. The world matrix is no longer read back from the
+*						device during the update pass, the current update world is held in s_oMatrixWorld and
+*						SGLib::SGRenderer::Update() seeds it once per pass.
+*
+*	Update 19/10/26 - The transform can optionally be held as separate translation, rotation and scale. Once
+*						any of the TRS mutators is used the components become authoritative and the matrix is
+*						only recomposed when one of them has changed since it was last needed. SetMatrix() and
+*						MultMatrix() switch the node back to plain matrix storage.
+*
+*	Update 19/10/26 - The inverse transpose of the world matrix used for normals is cached and only
+*						recalculated the first time it is asked for after the world matrix changes. While a
+*						transform is rendering it is available through GetRenderTransform() so shaders do not
+*						have to read back and invert the device's world matrix for every draw.
+*
+*	Update 19/10/26 - SetTrack() attaches an SGLib::TransformTrack whose translation, rotation and scale keys
+*						drive the TRS parts. Playing tracks are sampled together in a batched SIMD pass by
+*						SGLib::AnimSystem::Animate() before the update pass. Only plain transforms use their
+*						parts, derived nodes such as SGLib::Articulated ignore a track.
+*
+*	Update 19/10/26 - A transform sleeps after each update and is woken by SetMatrix(), MultMatrix() and the
+*						TRS mutators, including a playing track. The renderer still updates it when the
+*						world matrix it sits under changes. See SGLib::Node::Wake().
+*
+*	Update 19/10/26 - Sampling a track no longer wakes the transform from the animation jobs, as waking
+*						writes to ancestors other jobs share. AnimSystem::Animate() calls WakeSampled()
+*						on its own thread once the tracks have been sampled.
 */
 
 #ifndef SGLIB_TRANSFORM
@@ -14,29 +43,89 @@
 
 #pragma once
 
-#include "node.h"
+#include "Node.h"
 
 namespace SGLib
 {
+	class TransformTrack;
+
 	class Transform : public virtual Node
 	{
+		friend class TransformTrack;
+
 	public:
-		Transform	(LPDIRECT3DDEVICE9 a_pD3DDevice, D3DXMATRIX& a_rMatrixTrans);
+		Transform	(LPDIRECT3DDEVICE9 a_pD3DDevice, const Matrix& a_rMatrixTrans);
+		Transform	(LPDIRECT3DDEVICE9 a_pD3DDevice, const AffineMatrix& a_rMatrixTrans);
+		Transform	(LPDIRECT3DDEVICE9 a_pD3DDevice, const Vector3& a_rvecTranslation, const Quaternion& a_rquatRotation, const Vector3& a_rvecScale);
 		~Transform	(void);
 
 	protected:
 		Transform	(LPDIRECT3DDEVICE9 a_pD3DDevice);
 
 	protected:
-		D3DXMATRIX	m_oMatrixTrans;		///< transform to apply
-		D3DXMATRIX	m_oMatrix;			///< combined matrix state
-		D3DXMATRIX	m_oMatrixPrevious;	///< previous matrix state
+		mutable AffineMatrix	m_oMatrixTrans;		///< transform to apply (composed from the TRS parts when m_bTRS is set)
+		AffineMatrix			m_oMatrix;			///< combined matrix state
+		AffineMatrix			m_oMatrixPrevious;	///< previous matrix state
+
+		Quaternion		m_quatRotation;		///< rotation part, only valid when m_bTRS is set
+		Vector3			m_vecTranslation;	///< translation part, only valid when m_bTRS is set
+		Vector3			m_vecScale;			///< scale part, only valid when m_bTRS is set
+		BOOL			m_bTRS;				///< TRUE if the parts above are authoritative
+		mutable BOOL	m_bTransDirty;		///< TRUE if a part has changed since m_oMatrixTrans was composed
+
+		const TransformTrack*	m_pTrack;			///< keyframed tracks driving the parts above, NULL if none
+		FLOAT					m_fTrackTime;		///< time into the track
+		FLOAT					m_fTrackSpeed;		///< playback speed, negative plays in reverse
+		BOOL					m_bTrackRepeat;		///< TRUE if the track loops
+		BOOL					m_bTrackPlaying;	///< FALSE once a track that doesn't loop has ended
+		UINT					m_anTrackKeys[3];	///< key cursor of each channel
+		BOOL					m_bTrackSampled;	///< set by ApplyTrack() until WakeSampled() wakes the transform
+
+		mutable AffineMatrix	m_oMatrixNormal;	///< inverse transpose of m_oMatrix
+		mutable BOOL			m_bNormalDirty;		///< TRUE if m_oMatrix has changed since m_oMatrixNormal was calculated
+		const Transform*		m_pRenderPrevious;	///< transform that was rendering when Render() was called
+
+		static AffineMatrix		s_oMatrixWorld;			///< world matrix in effect at the current point of the update pass
+		static const Transform*	s_pRenderTransform;		///< innermost transform currently rendering
 
 	public:
 		// matrix operation functions
-		void		SetMatrix(D3DXMATRIX& a_rMatrixTrans);
-		void		MultMatrix(D3DXMATRIX& a_rMatrixTrans);
-		D3DXMATRIX	GetMatrix();
+		void		SetMatrix(const Matrix& a_rMatrixTrans);
+		void		SetMatrix(const AffineMatrix& a_rMatrixTrans);
+		void		MultMatrix(const Matrix& a_rMatrixTrans);
+		void		MultMatrix(const AffineMatrix& a_rMatrixTrans);
+		Matrix		GetMatrix();
+		const AffineMatrix&	GetAffineMatrix() const;
+
+		// decomposed translation, rotation and scale functions
+		void		SetTRS			(const Vector3& a_rvecTranslation, const Quaternion& a_rquatRotation, const Vector3& a_rvecScale);
+		void		SetTranslation	(const Vector3& a_rvecTranslation);
+		void		SetRotation		(const Quaternion& a_rquatRotation);
+		void		SetScale		(const Vector3& a_rvecScale);
+		void		Translate		(const Vector3& a_rvecOffset);
+		void		Rotate			(const Quaternion& a_rquatRotation);
+		Vector3		GetTranslation	() const;
+		Quaternion	GetRotation		() const;
+		Vector3		GetScale		() const;
+
+		// keyframed translation, rotation and scale
+		void					SetTrack		(const TransformTrack* a_pTrack, BOOL a_bRepeat);
+		const TransformTrack*	GetTrack		() const;
+		void					SetTrackTime	(FLOAT a_fTime);
+		FLOAT					GetTrackTime	() const;
+		void					SetTrackSpeed	(FLOAT a_fSpeed);
+		FLOAT					GetTrackSpeed	() const;
+		BOOL					IsTrackPlaying	() const;
+		void					WakeSampled		();
+
+		// world matrix and its normal matrix as calculated in the last update
+		const AffineMatrix&	GetWorldMatrix() const;
+		const AffineMatrix&	GetNormalMatrix() const;
+
+		// world matrix tracked through the update pass
+		static void					SetUpdateWorld(const AffineMatrix& a_rMatrixWorld);
+		static const AffineMatrix&	GetUpdateWorld();
+		static const Transform*		GetRenderTransform();
 
 		// scene graph related functions
 		virtual NodeType	GetType() const;
@@ -44,6 +133,18 @@ namespace SGLib
 		virtual void		PostRender();
 		virtual void		Update(FLOAT a_fTimeDiff);
 		virtual void		PostUpdate();
+		virtual void		CalculateChildWorld(const AffineMatrix& a_rMatrixParent, AffineMatrix& a_rMatrixChild) const;
+
+	protected:
+		virtual void		Bake(const AffineMatrix& a_rMatrixParent);
+		void				SetWorldMatrix(const AffineMatrix& a_rMatrixWorld);
+		BOOL				AdvanceTrack(FLOAT a_fTimeDiff);
+		void				ApplyTrack(const Vector4* a_pValues);
+
+	private:
+		void		EditTRS();
+		void		PrepareTRS();
+		void		InitTrack();
 	};
 }
 
@@ -0,0 +1,309 @@
+#include "TransformTrack.h"
+#include "Transform.h"
+#include <limits>
+
+using std::vector;
+
+namespace SGLib
+{
+	/**
+	*	\brief	TransformTrack constructor
+	*	\param	Interpolation a_eInterpolation - how keys are interpolated
+	*/
+
+	TransformTrack::TransformTrack(Interpolation a_eInterpolation) :	m_eInterpolation(a_eInterpolation),
+																		m_fLength(0.0f)
+	{
+	}
+
+	/**
+	*	\brief	TransformTrack destructor
+	*	\note	Transforms still playing the track must have been detached, see the class description
+	*/
+
+	TransformTrack::~TransformTrack()
+	{
+	}
+
+	/**
+	*	\brief	Adds a key to the translation channel
+	*	\param	FLOAT a_fTime - time of the key, replaces any key already at that time
+	*	\param	const Vector3& a_rvecTranslation - translation at that time
+	*/
+
+	void TransformTrack::AddTranslationKey(FLOAT a_fTime, const Vector3& a_rvecTranslation)
+	{
+		AddKey(TRANSLATION, a_fTime, a_rvecTranslation.x, a_rvecTranslation.y, a_rvecTranslation.z, 0.0f);
+	}
+
+	/**
+	*	\brief	Adds a key to the rotation channel
+	*	\param	FLOAT a_fTime - time of the key, replaces any key already at that time
+	*	\param	const Quaternion& a_rquatRotation - rotation at that time (normalized before it is stored)
+	*/
+
+	void TransformTrack::AddRotationKey(FLOAT a_fTime, const Quaternion& a_rquatRotation)
+	{
+		Quaternion quatRotation;
+		QuaternionNormalize(&quatRotation, &a_rquatRotation);
+
+		AddKey(ROTATION, a_fTime, quatRotation.x, quatRotation.y, quatRotation.z, quatRotation.w);
+
+		// keep every key on the same hemisphere as the one before it so blends take the short way round
+		vector<TrackKey>& rvecKeys = m_avecKeys[ROTATION];
+
+		for (UINT i = 1; i < rvecKeys.size(); ++i)
+		{
+			const FLOAT* pPrev = rvecKeys[i - 1].m_afValue;
+			FLOAT* pCurr = rvecKeys[i].m_afValue;
+
+			if (pPrev[0] * pCurr[0] + pPrev[1] * pCurr[1] + pPrev[2] * pCurr[2] + pPrev[3] * pCurr[3] < 0.0f)
+			{
+				for (UINT j = 0; j < 4; ++j)
+					pCurr[j] = -pCurr[j];
+			}
+		}
+	}
+
+	/**
+	*	\brief	Adds a key to the scale channel
+	*	\param	FLOAT a_fTime - time of the key, replaces any key already at that time
+	*	\param	const Vector3& a_rvecScale - scale along each axis at that time
+	*/
+
+	void TransformTrack::AddScaleKey(FLOAT a_fTime, const Vector3& a_rvecScale)
+	{
+		AddKey(SCALE, a_fTime, a_rvecScale.x, a_rvecScale.y, a_rvecScale.z, 0.0f);
+	}
+
+	/**
+	*	\brief	Inserts a key into a channel keeping it sorted by time
+	*	\param	Channel a_eChannel - channel to add to
+	*	\param	FLOAT a_fTime - time of the key, clamped to 0
+	*	\param	FLOAT a_fX - first component
+	*	\param	FLOAT a_fY - second component
+	*	\param	FLOAT a_fZ - third component
+	*	\param	FLOAT a_fW - fourth component
+	*/
+
+	void TransformTrack::AddKey(Channel a_eChannel, FLOAT a_fTime, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ, FLOAT a_fW)
+	{
+		TrackKey oKey;
+		oKey.m_fTime = (a_fTime < 0.0f) ? 0.0f : a_fTime;
+		oKey.m_afValue[0] = a_fX;
+		oKey.m_afValue[1] = a_fY;
+		oKey.m_afValue[2] = a_fZ;
+		oKey.m_afValue[3] = a_fW;
+
+		vector<TrackKey>& rvecKeys = m_avecKeys[a_eChannel];
+		vector<TrackKey>::iterator iter = rvecKeys.begin();
+
+		while (iter != rvecKeys.end() && iter->m_fTime < oKey.m_fTime)
+			++iter;
+
+		if (iter != rvecKeys.end() && iter->m_fTime == oKey.m_fTime)
+			*iter = oKey;
+		else
+			rvecKeys.insert(iter, oKey);
+
+		if (oKey.m_fTime > m_fLength)
+			m_fLength = oKey.m_fTime;
+	}
+
+	/**
+	*	\brief	Removes every key
+	*/
+
+	void TransformTrack::Clear()
+	{
+		for (UINT i = 0; i < NUM_CHANNELS; ++i)
+			m_avecKeys[i].clear();
+
+		m_fLength = 0.0f;
+	}
+
+	/**
+	*	\brief	Mutator for how keys are interpolated
+	*	\param	Interpolation a_eInterpolation - STEP, LINEAR or CUBIC
+	*/
+
+	void TransformTrack::SetInterpolation(Interpolation a_eInterpolation)
+	{
+		m_eInterpolation = a_eInterpolation;
+	}
+
+	/**
+	*	\brief	Accessor for how keys are interpolated
+	*	\return	Interpolation - STEP, LINEAR or CUBIC
+	*/
+
+	TransformTrack::Interpolation TransformTrack::GetInterpolation() const
+	{
+		return m_eInterpolation;
+	}
+
+	/**
+	*	\brief	Accessor for the length of the track
+	*	\return	FLOAT - time of the last key of any channel
+	*/
+
+	FLOAT TransformTrack::GetLength() const
+	{
+		return m_fLength;
+	}
+
+	/**
+	*	\brief	Accessor for the number of keys in a channel
+	*	\param	Channel a_eChannel - TRANSLATION, ROTATION or SCALE
+	*	\return	UINT - number of keys, 0 if the track leaves that part of the transform alone
+	*/
+
+	UINT TransformTrack::GetNumKeys(Channel a_eChannel) const
+	{
+		return (UINT)m_avecKeys[a_eChannel].size();
+	}
+
+	/**
+	*	\brief	Finds the keys each channel blends at a time and their weights
+	*	\param	FLOAT a_fTime - time to sample
+	*	\param	UINT* a_pnKeys - cursor of each channel, used as the starting point of the search and
+	*						   updated to the key found
+	*	\param	TrackSample& a_rSample - receives the keys and weights
+	*	\note	Outside the track every weight goes to the first or last key
+	*/
+
+	void TransformTrack::Prepare(FLOAT a_fTime, UINT* a_pnKeys, TrackSample& a_rSample) const
+	{
+		for (UINT c = 0; c < NUM_CHANNELS; ++c)
+		{
+			const vector<TrackKey>& rvecKeys = m_avecKeys[c];
+			const FLOAT** ppKeys = a_rSample.m_apKeys[c];
+			FLOAT* pWeights = a_rSample.m_afWeights[c];
+
+			if (rvecKeys.empty())
+			{
+				ppKeys[0] = NULL;
+				continue;
+			}
+
+			UINT nKeys = (UINT)rvecKeys.size();
+			UINT nKey = a_pnKeys[c] = FindKey(&rvecKeys[0], nKeys, a_fTime, a_pnKeys[c]);
+
+			const TrackKey& rPrev = rvecKeys[nKey];
+
+			// before the first key or past the last
+			if (nKey + 1 >= nKeys || a_fTime <= rPrev.m_fTime)
+			{
+				ppKeys[0] = ppKeys[1] = ppKeys[2] = ppKeys[3] = rPrev.m_afValue;
+				pWeights[0] = pWeights[2] = pWeights[3] = 0.0f;
+				pWeights[1] = 1.0f;
+				continue;
+			}
+
+			const TrackKey& rNext = rvecKeys[nKey + 1];
+
+			// the spline repeats the end keys where there are none beyond the pair
+			ppKeys[0] = rvecKeys[(nKey > 0) ? nKey - 1 : nKey].m_afValue;
+			ppKeys[1] = rPrev.m_afValue;
+			ppKeys[2] = rNext.m_afValue;
+			ppKeys[3] = rvecKeys[(nKey + 2 < nKeys) ? nKey + 2 : nKey + 1].m_afValue;
+
+			FLOAT fSpan = rNext.m_fTime - rPrev.m_fTime;
+			FLOAT fT = (fSpan > std::numeric_limits<float>::epsilon()) ? (a_fTime - rPrev.m_fTime) / fSpan : 1.0f;
+
+			switch (m_eInterpolation)
+			{
+			case STEP:
+				pWeights[0] = pWeights[2] = pWeights[3] = 0.0f;
+				pWeights[1] = 1.0f;
+				break;
+
+			case LINEAR:
+				pWeights[0] = pWeights[3] = 0.0f;
+				pWeights[1] = 1.0f - fT;
+				pWeights[2] = fT;
+				break;
+
+			case CUBIC:
+			{
+				// Catmull-Rom basis
+				FLOAT fT2 = fT * fT;
+				FLOAT fT3 = fT2 * fT;
+
+				pWeights[0] = 0.5f * (-fT3 + 2.0f * fT2 - fT);
+				pWeights[1] = 0.5f * (3.0f * fT3 - 5.0f * fT2 + 2.0f);
+				pWeights[2] = 0.5f * (-3.0f * fT3 + 4.0f * fT2 + fT);
+				pWeights[3] = 0.5f * (fT3 - fT2);
+				break;
+			}
+			}
+		}
+	}
+
+	/**
+	*	\brief	Sums the weighted keys of every channel of a batch of samples
+	*	\param	Vector4* a_pOut - receives NUM_CHANNELS values per sample, channels without keys are not written
+	*	\param	const TrackSample* a_pSamples - keys and weights found by Prepare()
+	*	\param	UINT a_nCount - number of samples
+	*	\note	Each channel is one Vec4Blend() of its four keys, whose SIMD path SGMathBench checks against
+	*			the scalar reference.
+	*/
+
+	void TransformTrack::BlendSamples(Vector4* a_pOut, const TrackSample* a_pSamples, UINT a_nCount)
+	{
+		for (UINT i = 0; i < a_nCount; ++i)
+		{
+			const TrackSample& rSample = a_pSamples[i];
+
+			for (UINT c = 0; c < NUM_CHANNELS; ++c)
+			{
+				const FLOAT* const* ppKeys = rSample.m_apKeys[c];
+				const FLOAT* pWeights = rSample.m_afWeights[c];
+
+				if (ppKeys[0] == NULL)
+					continue;
+
+				Vec4Blend(&a_pOut[i * NUM_CHANNELS + c], ppKeys, pWeights);
+			}
+		}
+	}
+
+	/**
+	*	\brief	Advances and samples the tracks of a list of transforms and stores the results in their
+	*			translation, rotation and scale parts
+	*	\param	Transform* const* a_ppTransforms - transforms, those without a playing track are skipped
+	*	\param	UINT a_nCount - number of transforms
+	*	\param	FLOAT a_fTimeDiff - time difference since last update call
+	*	\note	Transforms are gathered SAMPLE_BATCH at a time so each batch is blended in one pass
+	*/
+
+	void TransformTrack::SampleTransforms(Transform* const* a_ppTransforms, UINT a_nCount, FLOAT a_fTimeDiff)
+	{
+		TrackSample aSamples[SAMPLE_BATCH];
+		Vector4 avecValues[SAMPLE_BATCH * NUM_CHANNELS];
+		Transform* apPlaying[SAMPLE_BATCH];
+
+		for (UINT nStart = 0; nStart < a_nCount; nStart += SAMPLE_BATCH)
+		{
+			UINT nEnd = (a_nCount - nStart > SAMPLE_BATCH) ? nStart + SAMPLE_BATCH : a_nCount;
+			UINT nPlaying = 0;
+
+			// advance every track and find the keys it blends
+			for (UINT i = nStart; i < nEnd; ++i)
+			{
+				Transform* pTransform = a_ppTransforms[i];
+
+				if (!pTransform->AdvanceTrack(a_fTimeDiff))
+					continue;
+
+				pTransform->m_pTrack->Prepare(pTransform->m_fTrackTime, pTransform->m_anTrackKeys, aSamples[nPlaying]);
+				apPlaying[nPlaying++] = pTransform;
+			}
+
+			BlendSamples(avecValues, aSamples, nPlaying);
+
+			for (UINT i = 0; i < nPlaying; ++i)
+				apPlaying[i]->ApplyTrack(&avecValues[i * NUM_CHANNELS]);
+		}
+	}
+}
@@ -0,0 +1,104 @@
+/**
+*	\class		SGLib::TransformTrack
+*	\brief		Translation, rotation and scale keyframe tracks that can drive any SGLib::Transform
+*	\date		19/10/26
+*	\version	1.0
+*
+*	A track holds up to three channels of keys - translation, rotation (a quaternion) and scale - and
+*	how to interpolate between them:
+*
+*		STEP	- holds each key until the next one
+*		LINEAR	- interpolates straight between the keys either side
+*		CUBIC	- Catmull-Rom spline through the keys, using the keys before and after the pair as well
+*
+*	Rotation keys are normalized and flipped onto the same hemisphere as the key before them as they are
+*	added, so interpolating their components takes the short way round and only needs renormalizing.
+*
+*	Every mode is a weighted sum of four keys per channel. Each frame SGLib::AnimSystem::Animate() hands
+*	all the transforms playing a track to SampleTransforms(), which advances their time and finds their
+*	keys with the FindKey() cursor search (see Keyframe.h), sums every channel of the whole batch in
+*	one SIMD pass with BlendSamples() and stores the results as the transforms' translation, rotation
+*	and scale parts. A channel without keys leaves that part of the transform alone.
+*
+*	Tracks are not owned by the transforms playing them and one track can be played by any number of
+*	transforms. The track must outlive them, or be detached with Transform::SetTrack(NULL) first, and
+*	must not be edited while SGLib::AnimSystem::Animate() is running.
+*/
+
+#ifndef SGLIB_TRANSFORMTRACK
+#define SGLIB_TRANSFORMTRACK
+
+#pragma once
+
+#include "SGMath.h"
+#include "Keyframe.h"
+#include <vector>
+
+namespace SGLib
+{
+	class Transform;
+
+	// a key of one channel, translation and scale leave w at 0
+	struct TrackKey
+	{
+		FLOAT	m_fTime;		///< time of the key
+		FLOAT	m_afValue[4];	///< x, y, z and w
+	};
+
+	// the keys every channel of one transform blends this frame and their weights, see BlendSamples()
+	struct TrackSample
+	{
+		const FLOAT*	m_apKeys[3][4];		///< values of the four keys of each channel, the first is NULL if the channel has no keys
+		FLOAT			m_afWeights[3][4];	///< weight of each key
+	};
+
+	class TransformTrack
+	{
+	public:
+		enum Channel
+		{
+			TRANSLATION,
+			ROTATION,
+			SCALE,
+			NUM_CHANNELS
+		};
+
+		enum Interpolation
+		{
+			STEP,
+			LINEAR,
+			CUBIC
+		};
+
+		static const UINT SAMPLE_BATCH = 64;	///< transforms SampleTransforms() gathers before each blend
+
+		TransformTrack(Interpolation a_eInterpolation = LINEAR);
+		~TransformTrack();
+
+	protected:
+		std::vector<TrackKey>	m_avecKeys[NUM_CHANNELS];	///< keys of each channel sorted by time
+		Interpolation			m_eInterpolation;			///< how keys are interpolated
+		FLOAT					m_fLength;					///< time of the last key of any channel
+
+	public:
+		void			AddTranslationKey	(FLOAT a_fTime, const Vector3& a_rvecTranslation);
+		void			AddRotationKey		(FLOAT a_fTime, const Quaternion& a_rquatRotation);
+		void			AddScaleKey			(FLOAT a_fTime, const Vector3& a_rvecScale);
+		void			Clear				();
+
+		void			SetInterpolation	(Interpolation a_eInterpolation);
+		Interpolation	GetInterpolation	() const;
+		FLOAT			GetLength			() const;
+		UINT			GetNumKeys			(Channel a_eChannel) const;
+
+		void			Prepare				(FLOAT a_fTime, UINT* a_pnKeys, TrackSample& a_rSample) const;
+
+		static void		BlendSamples		(Vector4* a_pOut, const TrackSample* a_pSamples, UINT a_nCount);
+		static void		SampleTransforms	(Transform* const* a_ppTransforms, UINT a_nCount, FLOAT a_fTimeDiff);
+
+	protected:
+		void			AddKey				(Channel a_eChannel, FLOAT a_fTime, FLOAT a_fX, FLOAT a_fY, FLOAT a_fZ, FLOAT a_fW);
+	};
+}
+
+#endif
@@ -100,6 +100,8 @@ namespace SGLib
 		SAFE_DELETE(m_pTextures);
 		SAFE_DELETE_ARRAY(m_pMaterials);	
 		SAFE_RELEASE(m_pMesh);
+
+		m_vecTexNames.clear();
 	}
 
 	/**
@@ -122,6 +124,72 @@ namespace SGLib
 		m_bVisible = a_bVisible;
 	}
 
+	/**
+	*	\brief	Accessor for visibility boolean
+	*	\return	BOOL - TRUE if the mesh is rendered
+	*/
+
+	BOOL Geometry::IsVisible() const
+	{
+		return m_bVisible;
+	}
+
+	/**
+	*	\brief	Accessor for mesh
+	*	\return	LPD3DXMESH - mesh rendered by this node or NULL if none has been loaded
+	*/
+
+	LPD3DXMESH Geometry::GetMesh() const
+	{
+		if (m_pReference)
+			return m_pReference->GetMesh();
+
+		return m_pMesh;
+	}
+
+	/**
+	*	\brief	Accessor for number of materials (one per mesh subset)
+	*	\return	DWORD - number of materials
+	*/
+
+	DWORD Geometry::GetNumMaterials() const
+	{
+		if (m_pReference)
+			return m_pReference->GetNumMaterials();
+
+		return m_dwNumMat;
+	}
+
+	/**
+	*	\brief	Accessor for material array
+	*	\return	const D3DMATERIAL9* - array of GetNumMaterials() materials
+	*/
+
+	const D3DMATERIAL9* Geometry::GetMaterials() const
+	{
+		if (m_pReference)
+			return m_pReference->GetMaterials();
+
+		return m_pMaterials;
+	}
+
+	/**
+	*	\brief	Accessor for the texture filename of a subset
+	*	\param	DWORD a_dwMat - subset number
+	*	\return	LPCSTR - filename the texture was loaded from or NULL if the subset is untextured
+	*/
+
+	LPCSTR Geometry::GetTextureName(DWORD a_dwMat) const
+	{
+		if (m_pReference)
+			return m_pReference->GetTextureName(a_dwMat);
+
+		if (a_dwMat >= m_vecTexNames.size() || m_vecTexNames[a_dwMat].empty())
+			return NULL;
+
+		return m_vecTexNames[a_dwMat].c_str();
+	}
+
 	/**
 	*	\brief	Render function called when the scene graph is initially rendering this node. Renders 
 	*			the mesh associated with this object.
@@ -134,7 +202,8 @@ namespace SGLib
 		// if reference exists use its mesh
 		if (m_pReference)
 		{
-			m_pReference->Geometry::Render();
+			if (m_bVisible)
+				m_pReference->Geometry::Render();
 			return;
 		}
 
@@ -212,6 +281,7 @@ namespace SGLib
 		// create appropriate number of materials and textures
 		m_pMaterials = new D3DMATERIAL9[m_dwNumMat];
 		m_pTextures = new LPDIRECT3DTEXTURE9[m_dwNumMat];
+		m_vecTexNames.resize(m_dwNumMat);
 
 		for (DWORD i = 0; i < m_dwNumMat; ++i)
 		{
@@ -223,6 +293,7 @@ namespace SGLib
 			if (pMaterials[i].pTextureFilename)
 			{
 				V(D3DXCreateTextureFromFileA(m_pD3DDevice, pMaterials[i].pTextureFilename, &m_pTextures[i]))
+				m_vecTexNames[i] = pMaterials[i].pTextureFilename;
 			}
 			else if (m_pTextures)
 			{